@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// in-tree microbenchmark runner. a BENCH does its setup, says how many bytes one call handles (for MB/s, 0 if
+// that means nothing) and hands the timed part to run(), which calibrates the iteration count and keeps the best
+// of a few rounds. results can go out as json and be compared against a saved baseline, see bench_main.cpp
+
+struct bench_state {
+    // bytes one call of the timed function handles
+    std::uint64_t bytes = 0;
+    // filled in by run()
+    double ns_per_op = 0;
+    std::uint64_t iterations = 0;
+    // anything worth reading next to the timing (bytes that went over the wire and the like), printed after iterations
+    std::string note;
+    // set by the runner, --quick shrinks the time budget so ctest can smoke test every benchmark
+    double min_seconds = 0.25;
+    int rounds = 3;
+    bool quick = false;
+
+    void run(const std::function<void()>& fn);
+};
+
+struct bench_case {
+    const char* name;
+    void (*fn)(bench_state&);
+};
+
+[[nodiscard]] std::vector<bench_case>& bench_registry();
+
+struct bench_register {
+    bench_register(const char* name, void (*fn)(bench_state&)) { bench_registry().push_back({ name, fn }); }
+};
+
+#define BENCH(name)                                                              \
+    static void bench_##name(bench_state& state);                                \
+    static const bench_register bench_reg_##name(#name, &bench_##name);          \
+    static void bench_##name(bench_state& state)
+
+// keeps the compiler from throwing away a result nobody reads
+template <class T>
+inline void bench_keep(const T& v) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(v) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &v;
+#endif
+}
\ No newline at end of file
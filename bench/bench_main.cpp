@@ -0,0 +1,169 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string_view>
+
+// SpectreLauncherBench [--filter substr] [--quick] [--json out.json] [--baseline old.json [--threshold 0.15]]
+// with a baseline every benchmark that got slower than baseline * (1 + threshold) is reported and the exit
+// code is 1, so a saved run from a known good build works as a regression gate
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    struct result {
+        std::string name;
+        double ns_per_op = 0;
+        double mb_per_sec = 0;
+        std::uint64_t iterations = 0;
+        std::string note;
+    };
+
+    [[nodiscard]] std::string json_of(const std::vector<result>& results) {
+        std::string out = "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            char line[768];
+            std::snprintf(line, sizeof(line), "    { \"name\": \"%s\", \"ns_per_op\": %.3f, \"mb_per_sec\": %.3f, \"iterations\": %llu, \"note\": \"%s\" }%s\n",
+                          r.name.c_str(), r.ns_per_op, r.mb_per_sec, static_cast<unsigned long long>(r.iterations),
+                          r.note.c_str(), i + 1 < results.size() ? "," : "");
+            out += line;
+        }
+        out += "  ]\n}\n";
+        return out;
+    }
+
+    // just enough json to read back what json_of wrote: name -> ns_per_op
+    [[nodiscard]] std::map<std::string, double> load_baseline(const char* path) {
+        std::map<std::string, double> out;
+        std::ifstream in(path);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        const std::string txt = ss.str();
+        static constexpr std::string_view NAME = "\"name\": \"";
+        static constexpr std::string_view NS = "\"ns_per_op\": ";
+        for (size_t at = txt.find(NAME); at != std::string::npos; at = txt.find(NAME, at)) {
+            at += NAME.size();
+            const size_t end = txt.find('"', at);
+            const size_t ns = txt.find(NS, end);
+            if (end == std::string::npos || ns == std::string::npos) break;
+            out[txt.substr(at, end - at)] = std::strtod(txt.c_str() + ns + NS.size(), nullptr);
+        }
+        return out;
+    }
+} // anon namespace
+
+void bench_state::run(const std::function<void()>& fn) {
+    // double the count until one round takes long enough to be worth timing
+    std::uint64_t n = 1;
+    for (;;) {
+        const auto start = clock_type::now();
+        for (std::uint64_t i = 0; i < n; ++i) fn();
+        const double s = std::chrono::duration<double>(clock_type::now() - start).count();
+        if (s >= min_seconds / 4 || n >= (1ull << 40)) {
+            // aim the measured rounds at min_seconds each
+            if (s > 0) n = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(static_cast<double>(n) * min_seconds / s));
+            break;
+        }
+        n *= 2;
+    }
+    double best = 0;
+    for (int r = 0; r < rounds; ++r) {
+        const auto start = clock_type::now();
+        for (std::uint64_t i = 0; i < n; ++i) fn();
+        const double ns = std::chrono::duration<double, std::nano>(clock_type::now() - start).count() / static_cast<double>(n);
+        if (r == 0 || ns < best) best = ns;
+    }
+    ns_per_op = best;
+    iterations = n;
+}
+
+[[nodiscard]] std::vector<bench_case>& bench_registry() {
+    static std::vector<bench_case> r;
+    return r;
+}
+
+int main(const int argc, char** argv) {
+    const char* filter = nullptr;
+    const char* jsonPath = nullptr;
+    const char* baselinePath = nullptr;
+    double threshold = 0.15;
+    bool quick = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view a = argv[i];
+        if (a == "--filter" && i + 1 < argc) filter = argv[++i];
+        else if (a == "--json" && i + 1 < argc) jsonPath = argv[++i];
+        else if (a == "--baseline" && i + 1 < argc) baselinePath = argv[++i];
+        else if (a == "--threshold" && i + 1 < argc) threshold = std::strtod(argv[++i], nullptr);
+        else if (a == "--quick") quick = true;
+        else {
+            std::fprintf(stderr, "Unknown argument %s.\n", argv[i]);
+            return 2;
+        }
+    }
+
+    // fixtures that go through the launcher data dir (hash cache, library index) land in a throwaway one
+    const temp_dir data("bench-data");
+    set_env("SPECTRE_DATA_DIR", data.path.string());
+
+    std::vector<result> results;
+    std::printf("%-40s %14s %12s %12s  %s\n", "benchmark", "ns/op", "MB/s", "iterations", "note");
+    for (const bench_case& b : bench_registry()) {
+        if (filter && !std::strstr(b.name, filter)) continue;
+        bench_state st;
+        if (quick) {
+            st.min_seconds = 0.002;
+            st.rounds = 1;
+            st.quick = true;
+        }
+        b.fn(st);
+        // a benchmark that never called run() had nothing to measure here (missing cpu feature and the like)
+        if (st.iterations == 0) {
+            std::printf("%-40s %14s\n", b.name, "skipped");
+            continue;
+        }
+        result r{ b.name, st.ns_per_op, 0, st.iterations, st.note };
+        if (st.bytes && st.ns_per_op > 0) r.mb_per_sec = static_cast<double>(st.bytes) / (1024.0 * 1024.0) / (st.ns_per_op * 1e-9);
+        std::printf("%-40s %14.1f %12.1f %12llu  %s\n", b.name, r.ns_per_op, r.mb_per_sec, static_cast<unsigned long long>(r.iterations), r.note.c_str());
+        std::fflush(stdout);
+        results.push_back(std::move(r));
+    }
+
+    if (jsonPath) {
+        std::ofstream out(jsonPath, std::ios::trunc);
+        out << json_of(results);
+        if (!out) {
+            std::fprintf(stderr, "Could not write %s.\n", jsonPath);
+            return 2;
+        }
+    }
+
+    if (!baselinePath) return 0;
+    const auto baseline = load_baseline(baselinePath);
+    if (baseline.empty()) {
+        std::fprintf(stderr, "Could not read a baseline from %s.\n", baselinePath);
+        return 2;
+    }
+    int regressions = 0;
+    for (const result& r : results) {
+        const auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0) continue;
+        const double ratio = r.ns_per_op / it->second;
+        if (ratio > 1.0 + threshold) {
+            ++regressions;
+            std::printf("REGRESSION %-29s %10.1f -> %10.1f ns/op (+%.0f%%)\n", r.name.c_str(), it->second, r.ns_per_op, (ratio - 1.0) * 100.0);
+        }
+    }
+    if (regressions) {
+        std::fprintf(stderr, "%d benchmark(s) regressed past %.0f%%.\n", regressions, threshold * 100.0);
+        return 1;
+    }
+    std::printf("no regressions past %.0f%% against %s\n", threshold * 100.0, baselinePath);
+    return 0;
+}
\ No newline at end of file
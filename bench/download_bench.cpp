@@ -0,0 +1,121 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include "support/loopback_server.h"
+#include "downloader.h"
+#include "file_utils.h"
+#include "http_client.h"
+#include <cstdio>
+#include <fstream>
+#ifdef SPECTRE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// the BEClient update off a loopback server: hashed while it streams to disk against the old way of writing
+// the temp file first and reading it all back through sha256_file. the gap is the second pass over the file.
+// the download_coding_ ones serve a code-like 3 mib dll as is, as Content-Encoding: zstd on the plain url and
+// as the pre-compressed .zst, the note column has the "downloaded wire bytes" one fetch cost
+
+namespace {
+    struct artifact_host {
+        std::string body;
+        loopback_server srv{ [this](const loopback_request&) {
+            loopback_reply rep;
+            rep.body = body;
+            return rep;
+        } };
+        explicit artifact_host(const size_t size) : body(random_bytes(size, 7)) {}
+    };
+
+    void fetch_streamed(bench_state& state, const size_t size) {
+        const artifact_host host(size);
+        const wstr url = host.srv.url(L"/BEClient_x64.dll");
+        const temp_dir dir("bench-dl");
+        const fs::path dst = dir.path / "BEClient_x64.dll.download";
+        state.bytes = size;
+        state.run([&] {
+            fetch_state st;
+            bench_keep(fetch_to_file(url.c_str(), dst, st));
+            bench_keep(st.sha256);
+        });
+    }
+
+    void fetch_two_pass(bench_state& state, const size_t size) {
+        const artifact_host host(size);
+        const wstr url = host.srv.url(L"/BEClient_x64.dll");
+        const temp_dir dir("bench-dl");
+        const fs::path dst = dir.path / "BEClient_x64.dll.download";
+        state.bytes = size;
+        state.run([&] {
+            http_request r;
+            r.url = url;
+            auto res = http_send(r);
+            if (!res) return;
+            {
+                std::ofstream ofs(dst, std::ios::binary | std::ios::trunc);
+                std::vector<char> buf(1 << 16);
+                size_t got = 0;
+                while (res->read(buf.data(), buf.size(), got) && got) ofs.write(buf.data(), static_cast<std::streamsize>(got));
+            }
+            bench_keep(sha256_file(dst));
+        });
+    }
+} // anon namespace
+
+BENCH(download_streamed_1mib) { fetch_streamed(state, 1 << 20); }
+BENCH(download_two_pass_1mib) { fetch_two_pass(state, 1 << 20); }
+BENCH(download_streamed_16mib) { fetch_streamed(state, 16 << 20); }
+BENCH(download_two_pass_16mib) { fetch_two_pass(state, 16 << 20); }
+BENCH(download_streamed_64mib) { fetch_streamed(state, 64 << 20); }
+BENCH(download_two_pass_64mib) { fetch_two_pass(state, 64 << 20); }
+
+
+namespace {
+    // one untimed fetch to read the wire bytes off the counters, then the timed ones
+    void fetch_coded(bench_state& state, const std::string& served, const std::string& coding, const wchar_t* path) {
+        loopback_server srv([&](const loopback_request&) {
+            loopback_reply rep;
+            rep.body = served;
+            if (!coding.empty()) rep.headers = { { "Content-Encoding", coding } };
+            return rep;
+        });
+        const wstr url = srv.url(path);
+        const temp_dir dir("bench-dl");
+        const fs::path dst = dir.path / "BEClient_x64.dll.download";
+        const download_counters before = download_get_counters();
+        fetch_state first;
+        if (fetch_to_file(url.c_str(), dst, first) != fetch_result::downloaded) return;
+        const download_counters after = download_get_counters();
+        char note[64];
+        std::snprintf(note, sizeof(note), "wire %llu of %llu", after.wire_bytes - before.wire_bytes, after.bytes - before.bytes);
+        state.note = note;
+        state.bytes = first.size;
+        state.run([&] {
+            fetch_state st;
+            bench_keep(fetch_to_file(url.c_str(), dst, st));
+            bench_keep(st.sha256);
+        });
+    }
+
+    [[nodiscard]] const std::string& dll_bytes() {
+        static const std::string body = code_like_bytes(3 << 20, 8);
+        return body;
+    }
+
+#ifdef SPECTRE_HAVE_ZSTD
+    [[nodiscard]] const std::string& dll_zst() {
+        static const std::string zst = [] {
+            const std::string& body = dll_bytes();
+            std::string out(ZSTD_compressBound(body.size()), '\0');
+            out.resize(ZSTD_compress(out.data(), out.size(), body.data(), body.size(), 19));
+            return out;
+        }();
+        return zst;
+    }
+#endif
+} // anon namespace
+
+BENCH(download_coding_identity_3mib) { fetch_coded(state, dll_bytes(), "", L"/BEClient_x64.dll"); }
+#ifdef SPECTRE_HAVE_ZSTD
+BENCH(download_coding_zstd_3mib) { fetch_coded(state, dll_zst(), "zstd", L"/BEClient_x64.dll"); }
+BENCH(download_coding_zst_url_3mib) { fetch_coded(state, dll_zst(), "", L"/BEClient_x64.dll.zst"); }
+#endif
\ No newline at end of file
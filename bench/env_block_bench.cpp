@@ -0,0 +1,16 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include "env_block.h"
+
+BENCH(env_block_merge_80_vars) {
+    // about what a desktop session has, plus the four the launcher injects
+    const auto current = make_env_block(80, 4);
+    const std::vector<std::pair<wstr, wstr>> overrides = {
+        { L"STEAMID", L"76561198000000000" },
+        { L"SteamGameId", APP_ID_STR },
+        { L"SteamAppId", APP_ID_STR },
+        { L"SteamOverlayGameId", APP_ID_STR },
+    };
+    state.bytes = current.size() * sizeof(wchar_t);
+    state.run([&] { bench_keep(merge_environment_block(current.data(), overrides)); });
+}
\ No newline at end of file
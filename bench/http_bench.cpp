@@ -0,0 +1,109 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include "support/loopback_server.h"
+#include "http_async.h"
+#include "http_client.h"
+#include "page_trigger.h"
+
+namespace {
+    void round_trip(const wstr& url, const size_t limit) {
+        http_request r;
+        r.url = url;
+        auto res = http_send(r);
+        std::string body;
+        if (res) (void)res->read_all(body, limit);
+        bench_keep(body);
+    }
+} // anon namespace
+
+BENCH(http_loopback_small_get) {
+    // keep-alive round trip on an already open socket, the floor for every backend call
+    loopback_server srv([](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = R"({"ok":true})";
+        return rep;
+    });
+    const wstr url = srv.url(L"/v1/ping");
+    state.run([&] { round_trip(url, 1 << 10); });
+}
+
+BENCH(http_loopback_1mib_get) {
+    const std::string payload = random_bytes(1 << 20, 8);
+    loopback_server srv([&](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = payload;
+        return rep;
+    });
+    const wstr url = srv.url(L"/BEClient_x64.dll");
+    state.bytes = payload.size();
+    state.run([&] { round_trip(url, 2 << 20); });
+}
+
+// 100 backend sized calls, one after another on the blocking client against all at once on the async one.
+// the gap is what the async client buys a burst of logins
+BENCH(http_loopback_100_gets_blocking) {
+    loopback_server srv([](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = R"({"ok":true})";
+        return rep;
+    });
+    const wstr url = srv.url(L"/v1/ping");
+    state.run([&] {
+        for (int i = 0; i < 100; ++i) round_trip(url, 1 << 10);
+    });
+}
+
+BENCH(http_loopback_100_gets_async) {
+    loopback_server srv([](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = R"({"ok":true})";
+        return rep;
+    });
+    http_request r;
+    r.url = srv.url(L"/v1/ping");
+    http_async client(8);
+    state.run([&] {
+        size_t bytes = 0;
+        for (int i = 0; i < 100; ++i) client.submit(r, [&bytes](http_async_result&& res) { bytes += res.body.size(); });
+        client.run();
+        bench_keep(bytes);
+    });
+}
+
+// the provider id post against a mock backend right after the trigger. cold is what RunPageTrigger paid before
+// it kept a warm socket (every post connects first), prewarmed is a backend_warmer having run during the wait
+BENCH(provider_submit_cold) {
+    loopback_server srv([](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = R"({"ok":true})";
+        rep.close = true;
+        return rep;
+    });
+    const std::string body = provider_id_body(L"76561198000000000");
+    http_request r = provider_id_request(body);
+    r.url = srv.url(L"/v1/submitproviderid");
+    state.run([&] {
+        auto res = http_send(r);
+        std::string reply;
+        if (res) (void)res->read_all(reply);
+        bench_keep(reply);
+    });
+}
+
+BENCH(provider_submit_prewarmed) {
+    loopback_server srv([](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = R"({"ok":true})";
+        return rep;
+    });
+    const std::string body = provider_id_body(L"76561198000000000");
+    http_request r = provider_id_request(body);
+    r.url = srv.url(L"/v1/submitproviderid");
+    (void)http_prewarm(r.url);
+    state.run([&] {
+        auto res = http_send(r);
+        std::string reply;
+        if (res) (void)res->read_all(reply);
+        bench_keep(reply);
+    });
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include "file_utils.h"
+#include "library_index.h"
+#include "steam_library.h"
+
+BENCH(library_roots_6_libraries) {
+    const temp_dir dir("bench-lib");
+    const steam_tree t = make_steam_tree(dir.path, 6, 4, 5);
+    const wstr steam = t.steam.wstring();
+    state.run([&] { bench_keep(get_library_roots(steam)); });
+}
+
+BENCH(library_scan_cold_6x40) {
+    // every manifest read and parsed again, what the first launch (or a changed library) pays
+    const temp_dir dir("bench-lib");
+    const steam_tree t = make_steam_tree(dir.path, 6, 40, 6);
+    const wstr steam = t.steam.wstring();
+    const fs::path index = get_launcher_data_dir() / "libraryindex.bin";
+    const int ids[] = { APP_ID, t.appids.back() };
+    state.run([&] {
+        std::error_code ec;
+        fs::remove(index, ec);
+        bench_keep(library_index_resolve(steam, ids));
+    });
+}
+
+BENCH(library_scan_warm_6x40) {
+    // nothing changed since the cached index was written, only mtimes get checked
+    const temp_dir dir("bench-lib");
+    const steam_tree t = make_steam_tree(dir.path, 6, 40, 7);
+    const wstr steam = t.steam.wstring();
+    const int ids[] = { APP_ID, t.appids.back() };
+    bench_keep(library_index_resolve(steam, ids));
+    state.run([&] { bench_keep(library_index_resolve(steam, ids)); });
+}
+
+// a machine with a lot of drives: 40 roots of 100 manifests, the game plus a server and a tool looked up at once.
+// cold is the parallel scan parsing all 4000 manifests, warm is 40 mtime checks and three hash lookups
+BENCH(library_resolve_cold_40x100) {
+    const temp_dir dir("bench-lib");
+    const steam_tree t = make_steam_tree(dir.path, 40, 100, 8);
+    const wstr steam = t.steam.wstring();
+    const fs::path index = get_launcher_data_dir() / "libraryindex.bin";
+    const int ids[] = { t.appids[5], t.appids[2000], t.appids.back() };
+    state.run([&] {
+        std::error_code ec;
+        fs::remove(index, ec);
+        bench_keep(library_index_resolve(steam, ids));
+    });
+}
+
+BENCH(library_resolve_warm_40x100) {
+    const temp_dir dir("bench-lib");
+    const steam_tree t = make_steam_tree(dir.path, 40, 100, 9);
+    const wstr steam = t.steam.wstring();
+    const int ids[] = { t.appids[5], t.appids[2000], t.appids.back() };
+    bench_keep(library_index_resolve(steam, ids));
+    state.run([&] { bench_keep(library_index_resolve(steam, ids)); });
+}
\ No newline at end of file
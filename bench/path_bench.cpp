@@ -0,0 +1,13 @@
+#include "bench.h"
+#include "file_utils.h"
+
+BENCH(path_trim_trailing_slash) {
+    const wstr paths[] = {
+        L"C:\\Program Files (x86)\\Steam\\",
+        L"D:\\SteamLibrary",
+        L"E:\\Games\\SteamLibrary\\\\",
+        L"/home/user/.local/share/Steam/",
+    };
+    size_t i = 0;
+    state.run([&] { bench_keep(wtrim_trailing_slash(paths[i++ & 3])); });
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "bench.h"
+#include "process_watcher.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+extern char** environ;
+
+namespace {
+    // about what a gaming box with a browser open has running
+    inline constexpr size_t CROWD = 2000;
+
+    [[nodiscard]] pid_t spawn_sleep(const char* name) {
+        pid_t pid = -1;
+        char* argv[] = { const_cast<char*>(name), const_cast<char*>("600"), nullptr };
+        if (::posix_spawnp(&pid, "sleep", nullptr, nullptr, argv, environ) != 0) return -1;
+        return pid;
+    }
+
+    void reap(const pid_t pid) {
+        ::kill(pid, SIGKILL);
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+    }
+
+    // CROWD idle processes on top of whatever the machine runs, started once and shared by the benchmarks here
+    struct crowd {
+        std::vector<pid_t> pids;
+        crowd() {
+            pids.reserve(CROWD);
+            for (size_t i = 0; i < CROWD; ++i) {
+                if (const pid_t p = spawn_sleep("spectre_bench_idle"); p > 0) pids.push_back(p);
+            }
+        }
+        ~crowd() {
+            for (const pid_t p : pids) ::kill(p, SIGKILL);
+            for (const pid_t p : pids) {
+                int status = 0;
+                ::waitpid(p, &status, 0);
+            }
+        }
+    };
+
+    void ensure_crowd() {
+        static crowd c;
+    }
+} // anon namespace
+
+BENCH(process_index_first_scan_2000) {
+    // every pid listed and named, what the first is_process_running of a launch pays
+    ensure_crowd();
+    state.run([] {
+        process_watch_reset();
+        process_watch_refresh();
+    });
+}
+
+BENCH(process_index_refresh_2000) {
+    // nothing new since last time, only the pid list gets read. what every poll of a waiter costs
+    ensure_crowd();
+    process_watch_reset();
+    process_watch_refresh();
+    state.run([] { process_watch_refresh(); });
+}
+
+BENCH(process_index_refresh_one_new_2000) {
+    // one process started and one gone per refresh, the new one named on its own
+    ensure_crowd();
+    process_watch_reset();
+    process_watch_refresh();
+    pid_t last = -1;
+    state.run([&last] {
+        const pid_t p = spawn_sleep("spectre_bench_churn");
+        process_watch_refresh();
+        if (last > 0) reap(last);
+        last = p;
+    });
+    if (last > 0) reap(last);
+}
+
+BENCH(process_detect_latency) {
+    // a waiter already sitting in process_watch_wait, then the process starts and the op ends once the waiter
+    // is awake. 2 ms of that is the head start, the rest is mostly how far into the poll interval the start landed
+    ensure_crowd();
+    process_watch_reset();
+    process_watch_refresh();
+    state.run([] {
+        std::atomic<bool> waiting{ false };
+        std::jthread waiter([&waiting] {
+            waiting = true;
+            bench_keep(process_watch_wait(L"spectre_bench_target", std::chrono::seconds(5)));
+        });
+        while (!waiting) std::this_thread::yield();
+        // let the waiter get past its first look
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        const pid_t p = spawn_sleep("spectre_bench_target");
+        waiter.join();
+        reap(p);
+    });
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include "file_utils.h"
+#include "sha256.h"
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+BENCH(sha256_64b) {
+    const std::string data = random_bytes(64, 1);
+    state.bytes = data.size();
+    state.run([&] { bench_keep(sha256_of(data.data(), data.size())); });
+}
+
+BENCH(sha256_1mib) {
+    const std::string data = random_bytes(1 << 20, 2);
+    state.bytes = data.size();
+    state.run([&] { bench_keep(sha256_of(data.data(), data.size())); });
+}
+
+BENCH(sha256_mapped_file_8mib) {
+    // warm page cache, so this is the hashing plus whatever the file read path costs on top
+    const temp_dir dir("bench-sha");
+    const fs::path p = dir.path / "BEClient_x64.dll";
+    const std::string data = code_like_bytes(8 << 20, 3);
+    write_file(p, data);
+    state.bytes = data.size();
+    state.run([&] { bench_keep(sha256_of_mapped_file(p)); });
+}
+
+// mapped against reading the same file through a 64 KiB ifstream buffer into sha256, the way it was done before
+// mapping. once at dll size and once big enough that the copy out of the page cache shows. warm cache for both,
+// the file was just written. SPECTRE_BENCH_LARGE_MB sets the big one (2 GiB by default), --quick skips it
+
+namespace {
+    [[nodiscard]] sha256_digest sha256_of_stream(const fs::path& p) {
+        std::ifstream in(p, std::ios::binary);
+        std::vector<char> buf(64 << 10);
+        sha256 h;
+        while (in.read(buf.data(), static_cast<std::streamsize>(buf.size())) || in.gcount() > 0) {
+            h.update(buf.data(), static_cast<size_t>(in.gcount()));
+        }
+        return h.finish();
+    }
+
+    // a file of size bytes, written a few mb at a time so the big one never has to sit in memory
+    struct sized_file {
+        temp_dir dir{ "bench-sha" };
+        fs::path path = dir.path / "pak0.pak";
+        explicit sized_file(const std::uint64_t size) {
+            const std::string block = code_like_bytes(4 << 20, 4);
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            for (std::uint64_t left = size; left > 0;) {
+                const auto n = static_cast<std::streamsize>(left < block.size() ? left : block.size());
+                out.write(block.data(), n);
+                left -= static_cast<std::uint64_t>(n);
+            }
+        }
+    };
+
+    [[nodiscard]] std::uint64_t large_size() {
+        const char* mb = std::getenv("SPECTRE_BENCH_LARGE_MB");
+        const std::uint64_t n = mb ? std::strtoull(mb, nullptr, 10) : 0;
+        return (n ? n : 2048) << 20;
+    }
+
+    void hash_mapped(bench_state& state, const std::uint64_t size) {
+        const sized_file f(size);
+        state.bytes = size;
+        state.run([&] { bench_keep(sha256_of_mapped_file(f.path)); });
+    }
+
+    void hash_stream(bench_state& state, const std::uint64_t size) {
+        const sized_file f(size);
+        state.bytes = size;
+        state.run([&] { bench_keep(sha256_of_stream(f.path)); });
+    }
+} // anon namespace
+
+BENCH(sha256_mapped_file_3mib) { hash_mapped(state, 3 << 20); }
+BENCH(sha256_stream_file_3mib) { hash_stream(state, 3 << 20); }
+
+BENCH(sha256_mapped_file_large) {
+    if (!state.quick) hash_mapped(state, large_size());
+}
+
+BENCH(sha256_stream_file_large) {
+    if (!state.quick) hash_stream(state, large_size());
+}
+
+namespace {
+    // same 1 MiB through one specific block function, skipped when this cpu cant run it
+    void bench_backend(bench_state& state, const char* name) {
+        if (!sha256_use_backend(name)) return;
+        const std::string data = random_bytes(1 << 20, 2);
+        state.bytes = data.size();
+        state.run([&] { bench_keep(sha256_of(data.data(), data.size())); });
+        (void)sha256_use_backend({});
+    }
+} // anon namespace
+
+BENCH(sha256_1mib_scalar) {
+    bench_backend(state, "scalar");
+}
+
+BENCH(sha256_1mib_shani) {
+    bench_backend(state, "sha-ni");
+}
\ No newline at end of file
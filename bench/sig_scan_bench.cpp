@@ -0,0 +1,38 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include "sig_scan.h"
+
+// the trigger signature over 64 MiB of code like bytes it doesnt occur in, so the whole buffer gets filtered.
+// thats a scan of a patched build before the cache knows it. MB/s is the number to read
+
+namespace {
+    inline constexpr const char* TRIGGER_SIG = "48 8D 0D ?? ?? ?? ?? E8 ?? ?? ?? ?? 84 C0 74 ?? 48 8B";
+
+    [[nodiscard]] const std::string& code_64mib() {
+        static const std::string hay = code_like_bytes(64 << 20, 9);
+        return hay;
+    }
+
+    // same scan through one specific backend, skipped when this cpu cant run it
+    void bench_backend(bench_state& state, const char* name) {
+        if (!sig_scan_use_backend(name)) return;
+        const std::string& hay = code_64mib();
+        const auto sig = parse_signature(TRIGGER_SIG);
+        const std::span<const unsigned char> view(reinterpret_cast<const unsigned char*>(hay.data()), hay.size());
+        state.bytes = hay.size();
+        state.run([&] { bench_keep(find_signature(view, *sig)); });
+        (void)sig_scan_use_backend({});
+    }
+} // anon namespace
+
+BENCH(sig_scan_64mib_scalar) {
+    bench_backend(state, "scalar");
+}
+
+BENCH(sig_scan_64mib_sse2) {
+    bench_backend(state, "sse2");
+}
+
+BENCH(sig_scan_64mib_avx2) {
+    bench_backend(state, "avx2");
+}
\ No newline at end of file
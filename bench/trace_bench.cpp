@@ -0,0 +1,51 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include "trace.h"
+
+// what a TRACE_SCOPE costs. off is the price every launch pays for the spans being compiled in, it should sit
+// right on top of the empty loop. on records 1024 spans per op and throws them away again so the buffer
+// doesnt grow for the length of the run
+
+namespace {
+    inline constexpr int SPANS = 1024;
+
+    // bench_keep so neither loop gets folded away, the only difference between the two is the span
+    inline void traced_leaf(const int i) {
+        TRACE_SCOPE("bench leaf");
+        bench_keep(i);
+    }
+
+    inline void plain_leaf(const int i) {
+        bench_keep(i);
+    }
+} // anon namespace
+
+BENCH(trace_baseline_x1024) {
+    state.run([] {
+        for (int i = 0; i < SPANS; ++i) plain_leaf(i);
+    });
+}
+
+BENCH(trace_scope_off_x1024) {
+    trace_stop();
+    state.run([] {
+        for (int i = 0; i < SPANS; ++i) traced_leaf(i);
+    });
+}
+
+BENCH(trace_counter_off_x1024) {
+    trace_stop();
+    state.run([] {
+        for (int i = 0; i < SPANS; ++i) trace_counter("bench counter", i);
+    });
+}
+
+BENCH(trace_scope_on_x1024) {
+    const temp_dir dir("bench-trace");
+    const fs::path out = dir.path / "trace.json";
+    state.run([&out] {
+        trace_start(out);
+        for (int i = 0; i < SPANS; ++i) traced_leaf(i);
+        trace_stop();
+    });
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include "utf.h"
+
+// 1000 mixed script library paths per op. the byte copy is what the finder used to do with
+// wstr(s.begin(), s.end()), only right for ascii but the floor for what a conversion can cost
+
+namespace {
+    [[nodiscard]] const std::vector<std::string>& corpus() {
+        static const std::vector<std::string> c = make_path_corpus(1000, 2);
+        return c;
+    }
+
+    [[nodiscard]] std::uint64_t corpus_bytes() {
+        std::uint64_t n = 0;
+        for (const auto& p : corpus()) n += p.size();
+        return n;
+    }
+} // anon namespace
+
+BENCH(utf_widen_paths_x1000) {
+    state.bytes = corpus_bytes();
+    state.run([] {
+        for (const auto& p : corpus()) bench_keep(widen_utf8(p));
+    });
+}
+
+BENCH(utf_widen_paths_no_alloc_x1000) {
+    std::vector<wchar_t> buf(4096);
+    state.bytes = corpus_bytes();
+    state.run([&buf] {
+        for (const auto& p : corpus()) bench_keep(utf8_to_utf16(p, buf));
+    });
+}
+
+BENCH(utf_byte_copy_paths_x1000) {
+    state.bytes = corpus_bytes();
+    state.run([] {
+        for (const auto& p : corpus()) bench_keep(std::wstring(p.begin(), p.end()));
+    });
+}
+
+BENCH(utf_narrow_paths_x1000) {
+    std::vector<std::wstring> wide;
+    for (const auto& p : corpus()) wide.push_back(widen_utf8(p).value_or(L""));
+    state.bytes = corpus_bytes();
+    state.run([&wide] {
+        for (const auto& w : wide) bench_keep(narrow_utf8(w));
+    });
+}
+
+BENCH(utf_widen_ascii_64kib) {
+    std::string s(64 << 10, 'a');
+    for (size_t i = 0; i < s.size(); ++i) s[i] = static_cast<char>('!' + i % 90);
+    std::vector<wchar_t> buf(s.size());
+    state.bytes = s.size();
+    state.run([&] { bench_keep(utf8_to_utf16(s, buf)); });
+}
\ No newline at end of file
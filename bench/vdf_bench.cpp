@@ -0,0 +1,88 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include "steam_library.h"
+#include "vdf.h"
+#include <regex>
+
+BENCH(vdf_parse_libraryfolders) {
+    std::vector<std::string> paths;
+    std::vector<std::vector<int>> apps;
+    for (int i = 0; i < 8; ++i) {
+        paths.push_back("D:\\SteamLibrary" + std::to_string(i));
+        auto& ids = apps.emplace_back();
+        for (int a = 0; a < 60; ++a) ids.push_back(1000 + i * 100 + a);
+    }
+    const std::string txt = make_libraryfolders_vdf(paths, apps);
+    state.bytes = txt.size();
+    state.run([&] { bench_keep(vdf_parse(txt)); });
+}
+
+BENCH(vdf_parse_appmanifest) {
+    const std::string txt = make_app_manifest(2641470, "Spectre Divide", 31'000'000'000ull, 15123456);
+    state.bytes = txt.size();
+    state.run([&] { bench_keep(vdf_parse(txt)); });
+}
+
+BENCH(acf_read_app_manifest) {
+    // the whole thing as a library scan does it: read off disk, parse, pull the fields out
+    const temp_dir dir("bench-acf");
+    const fs::path p = dir.path / "appmanifest_2641470.acf";
+    const std::string txt = make_app_manifest(2641470, "Spectre Divide", 31'000'000'000ull, 15123456);
+    write_file(p, txt);
+    state.bytes = txt.size();
+    state.run([&] { bench_keep(read_app_manifest(p)); });
+}
+
+// the regexes steam_finder used before the parser, kept here as the baseline the numbers above are read against
+
+BENCH(regex_libraryfolders_paths) {
+    std::vector<std::string> paths;
+    std::vector<std::vector<int>> apps;
+    for (int i = 0; i < 8; ++i) {
+        paths.push_back("D:\\SteamLibrary" + std::to_string(i));
+        auto& ids = apps.emplace_back();
+        for (int a = 0; a < 60; ++a) ids.push_back(1000 + i * 100 + a);
+    }
+    const std::string txt = make_libraryfolders_vdf(paths, apps);
+    state.bytes = txt.size();
+    state.run([&] {
+        const std::regex re(R"re("path"\s*"([^"]+)")re", std::regex::icase);
+        size_t n = 0;
+        for (std::sregex_iterator it(txt.begin(), txt.end(), re), end; it != end; ++it) n += (*it)[1].length();
+        bench_keep(n);
+    });
+}
+
+BENCH(regex_appmanifest_installdir) {
+    const std::string txt = make_app_manifest(2641470, "Spectre Divide", 31'000'000'000ull, 15123456);
+    state.bytes = txt.size();
+    state.run([&] {
+        const std::regex re(R"re("installdir"\s*"([^"]+)")re", std::regex::icase);
+        std::smatch m;
+        bench_keep(std::regex_search(txt, m, re) ? m[1].length() : 0);
+    });
+}
+
+BENCH(loginusers_most_recent) {
+    const std::string txt = make_loginusers_vdf(6, 4);
+    state.bytes = txt.size();
+    state.run([&] { bench_keep(most_recent_login(txt)); });
+}
+
+BENCH(regex_loginusers_most_recent) {
+    const std::string txt = make_loginusers_vdf(6, 4);
+    state.bytes = txt.size();
+    state.run([&] {
+        const std::regex block(R"re("(\d{17})"\s*\{([\s\S]*?)\})re", std::regex::icase);
+        const std::regex recent(R"re("mostrecent"\s*"\s*1")re", std::regex::icase);
+        std::string found;
+        for (std::sregex_iterator it(txt.begin(), txt.end(), block), end; it != end; ++it) {
+            const std::string body = (*it)[2];
+            if (std::regex_search(body, recent)) {
+                found = (*it)[1];
+                break;
+            }
+        }
+        bench_keep(found.size());
+    });
+}
\ No newline at end of file
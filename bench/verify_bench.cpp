@@ -0,0 +1,77 @@
+#include "bench.h"
+#include "support/fixtures.h"
+#include "verify.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+
+// a full verify of a synthetic install, a few big paks plus a spread of small files, from 1 to 16 threads.
+// how close it gets to linear up to the core count is how well the chunks and the stealing keep the threads
+// busy, past it should stay flat. SPECTRE_BENCH_VERIFY_MB sets the size of the tree (4 GiB by default, about
+// 100 MiB under --quick). caches are warm: the tree was just written and the manifest build already read it
+// once, so as long as it fits in free memory every round is hashing out of the page cache, not disk. drop the
+// cache between rounds (or make the tree bigger than ram) to see the cold numbers
+
+namespace {
+    inline constexpr unsigned long long PAK_SIZE = 1ull << 30;
+
+    struct install_tree {
+        temp_dir dir{ "bench-verify" };
+        fs::path root = dir.path / "game";
+        fs::path manifest = dir.path / "manifest.txt";
+        unsigned long long bytes = 0;
+
+        explicit install_tree(const unsigned long long size) {
+            // the paks get everything the small files dont, written a block at a time so none of it sits in memory
+            const unsigned long long smalls = 200ull << 16;
+            const std::string block = random_bytes(4 << 20, 20);
+            unsigned long long left = size > smalls ? size - smalls : block.size();
+            for (int n = 0; left > 0; ++n) {
+                const fs::path pak = root / "Spectre" / "Content" / "Paks" / ("pakchunk" + std::to_string(n) + "-Windows.pak");
+                fs::create_directories(pak.parent_path());
+                std::ofstream out(pak, std::ios::binary | std::ios::trunc);
+                for (unsigned long long in_pak = 0; left > 0 && in_pak < PAK_SIZE;) {
+                    const unsigned long long take = std::min<unsigned long long>({ left, block.size(), PAK_SIZE - in_pak });
+                    out.write(block.data(), static_cast<std::streamsize>(take));
+                    in_pak += take;
+                    left -= take;
+                    bytes += take;
+                }
+            }
+            for (int i = 0; i < 200; ++i) {
+                const std::string small = random_bytes(64 << 10, 21 + i);
+                write_file(root / "Engine" / "Content" / ("asset" + std::to_string(i) + ".uasset"), small);
+                bytes += small.size();
+            }
+            verify_options o;
+            o.progress = false;
+            o.chunk_size = 8 << 20;
+            (void)make_install_manifest(root, manifest, o);
+        }
+    };
+
+    [[nodiscard]] unsigned long long tree_size(const bool quick) {
+        const char* mb = std::getenv("SPECTRE_BENCH_VERIFY_MB");
+        const unsigned long long n = mb ? std::strtoull(mb, nullptr, 10) : 0;
+        if (n) return n << 20;
+        return quick ? 96ull << 20 : 4096ull << 20;
+    }
+
+    void verify_with(bench_state& state, const size_t threads) {
+        // built once for all the thread counts, at whatever size the first one asked for
+        static std::unique_ptr<install_tree> tree;
+        if (!tree) tree = std::make_unique<install_tree>(tree_size(state.quick));
+        verify_options o;
+        o.progress = false;
+        o.threads = threads;
+        state.bytes = tree->bytes;
+        state.run([&] { bench_keep(verify_install(tree->root, tree->manifest, o)); });
+    }
+} // anon namespace
+
+BENCH(verify_install_1_thread) { verify_with(state, 1); }
+BENCH(verify_install_2_threads) { verify_with(state, 2); }
+BENCH(verify_install_4_threads) { verify_with(state, 4); }
+BENCH(verify_install_8_threads) { verify_with(state, 8); }
+BENCH(verify_install_16_threads) { verify_with(state, 16); }
\ No newline at end of file
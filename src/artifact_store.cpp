@@ -0,0 +1,231 @@
+#include "artifact_store.h"
+#include "file_utils.h"
+#include "trace.h"
+#include "utf.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+    // a pin name or prefix shorter than this is too likely to mean something else
+    inline constexpr size_t MIN_PREFIX = 8;
+
+    std::atomic<unsigned long long> g_reflinks{ 0 };
+    std::atomic<unsigned long long> g_copies{ 0 };
+
+    [[nodiscard]] fs::path store_root() {
+        return get_launcher_data_dir() / L"store";
+    }
+
+    // digests and pin names are checked to be ascii before they get anywhere near a path
+    [[nodiscard]] fs::path entry_path(const wchar_t* dir, const std::string& name) {
+        return store_root() / dir / widen_utf8(name).value_or(L"");
+    }
+
+    [[nodiscard]] fs::path object_path(const std::string& hex) {
+        return entry_path(L"objects", hex);
+    }
+
+    [[nodiscard]] fs::path used_path(const std::string& hex) {
+        return entry_path(L"used", hex);
+    }
+
+    // filename().string() goes through the ansi codepage and throws on anything it cant map
+    [[nodiscard]] std::string name_of(const fs::path& p) {
+        return narrow_utf8(p.filename().wstring()).value_or("");
+    }
+
+    [[nodiscard]] bool is_digest(const std::string_view s) {
+        return s.size() == 64 && std::ranges::all_of(s, [](const char c) { return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F'); });
+    }
+
+    [[nodiscard]] bool is_pin_name(const std::string_view s) {
+        return !s.empty() && s.size() <= 64 && std::ranges::all_of(s, [](const char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '_' || c == '-';
+        });
+    }
+
+    [[nodiscard]] std::string upper(std::string s) {
+        for (char& c : s) if (c >= 'a' && c <= 'f') c = static_cast<char>(c - 'a' + 'A');
+        return s;
+    }
+
+    // unique per process and call, so two instances putting the same object never share a temp file
+    [[nodiscard]] fs::path temp_path(const std::string& hex) {
+        static std::atomic<unsigned> seq{ 0 };
+        const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+        return store_root() / L"tmp" / fs::path(widen_utf8(std::string_view(hex).substr(0, 16)).value_or(L"") + L"." + std::to_wstring(now) + L"." + std::to_wstring(seq++));
+    }
+
+    void touch_used(const std::string& hex) {
+        std::error_code ec;
+        const fs::path p = used_path(hex);
+        fs::create_directories(p.parent_path(), ec);
+        if (!fs::exists(p, ec)) {
+            (void)write_file_atomic(p, {});
+            return;
+        }
+        fs::last_write_time(p, fs::file_time_type::clock::now(), ec);
+    }
+
+    [[nodiscard]] std::unordered_set<std::string> pinned_digests() {
+        std::unordered_set<std::string> out;
+        std::error_code ec;
+        for (fs::directory_iterator it(store_root() / L"pins", ec), end; !ec && it != end; it.increment(ec)) {
+            if (auto txt = read_file_bytes(it->path())) {
+                while (!txt->empty() && (txt->back() == '\n' || txt->back() == '\r')) txt->pop_back();
+                if (is_digest(*txt)) out.insert(std::move(*txt));
+            }
+        }
+        return out;
+    }
+} // anon namespace
+
+[[nodiscard]] bool store_has(const std::string& hex) {
+    std::error_code ec;
+    return is_digest(hex) && fs::is_regular_file(object_path(hex), ec);
+}
+
+[[nodiscard]] bool store_put(const fs::path& file, const std::string& hex) {
+    TRACE_SCOPE("store_put");
+    std::error_code ec;
+    if (!is_digest(hex)) {
+        fs::remove(file, ec);
+        return false;
+    }
+    const fs::path dst = object_path(hex);
+    if (fs::is_regular_file(dst, ec)) {
+        fs::remove(file, ec);
+        return true;
+    }
+
+    // land it inside the store first so the publishing rename never crosses a volume
+    const fs::path tmp = temp_path(hex);
+    fs::create_directories(tmp.parent_path(), ec);
+    fs::create_directories(dst.parent_path(), ec);
+    fs::rename(file, tmp, ec);
+    if (ec) {
+        // a rename keeps the bytes the caller hashed on the way in, so hex is trusted as is. a copy to another
+        // volume is a fresh write that can go wrong on its own, that one gets checked
+        const bool copied = fs::copy_file(file, tmp, fs::copy_options::overwrite_existing, ec);
+        fs::remove(file, ec);
+        const auto digest = copied ? sha256_of_mapped_file(tmp) : std::nullopt;
+        if (!digest || to_hex(*digest) != hex) {
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    // whoever renames first wins. same name means same bytes, so losing the race is still a success
+    fs::rename(tmp, dst, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return fs::is_regular_file(dst, ec);
+    }
+    touch_used(hex);
+    return true;
+}
+
+[[nodiscard]] bool store_install(const std::string& hex, const fs::path& dst) {
+    TRACE_SCOPE("store_install");
+    if (!store_has(hex)) return false;
+    const fs::path obj = object_path(hex);
+    std::error_code ec;
+    if (sha256_file(obj) != hex) {
+        // bit rot or someone edited it, either way it isnt what its name says anymore
+        fs::remove(obj, ec);
+        fs::remove(used_path(hex), ec);
+        return false;
+    }
+
+    // a clone or a copy, never a hardlink. anything that rewrites the installed dll in place (battleye's own
+    // updater does) would otherwise be writing into the object and every other install linked to it. a clone
+    // shares extents only until that write, then the filesystem gives dst its own
+    fs::remove(dst, ec);
+    if (clone_file(obj, dst)) {
+        trace_counter("store install reflinks", static_cast<long long>(++g_reflinks));
+    } else {
+        if (!fs::copy_file(obj, dst, fs::copy_options::overwrite_existing, ec)) return false;
+        trace_counter("store install copies", static_cast<long long>(++g_copies));
+    }
+    touch_used(hex);
+    return true;
+}
+
+[[nodiscard]] store_install_counters store_get_install_counters() {
+    return { g_reflinks.load(), g_copies.load() };
+}
+
+[[nodiscard]] bool store_pin(const std::string& name, const std::string& hex) {
+    if (!is_pin_name(name) || !store_has(hex)) return false;
+    return write_file_atomic(entry_path(L"pins", name), hex + "\n");
+}
+
+[[nodiscard]] std::optional<std::string> store_resolve(const std::string& name_or_digest) {
+    if (is_pin_name(name_or_digest)) {
+        if (auto txt = read_file_bytes(entry_path(L"pins", name_or_digest))) {
+            while (!txt->empty() && (txt->back() == '\n' || txt->back() == '\r')) txt->pop_back();
+            if (store_has(*txt)) return txt;
+        }
+    }
+
+    const std::string want = upper(name_or_digest);
+    if (want.size() < MIN_PREFIX || !std::ranges::all_of(want, [](const char c) { return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F'); })) return std::nullopt;
+    if (store_has(want)) return want;
+    std::optional<std::string> found;
+    std::error_code ec;
+    for (fs::directory_iterator it(store_root() / L"objects", ec), end; !ec && it != end; it.increment(ec)) {
+        const std::string s = name_of(it->path());
+        if (!is_digest(s) || !s.starts_with(want)) continue;
+        // ambiguous, make them type more
+        if (found) return std::nullopt;
+        found = s;
+    }
+    return found;
+}
+
+void store_gc(const unsigned long long max_bytes) {
+    TRACE_SCOPE("store_gc");
+    // one collector at a time, the others can just skip it this run
+    const file_lock lock = try_lock_file(store_root() / L"gc.lock");
+    if (!lock) return;
+
+    struct object {
+        std::string hex;
+        unsigned long long size = 0;
+        fs::file_time_type used;
+    };
+    std::vector<object> objects;
+    unsigned long long total = 0;
+    std::error_code ec;
+    for (fs::directory_iterator it(store_root() / L"objects", ec), end; !ec && it != end; it.increment(ec)) {
+        std::string hex = name_of(it->path());
+        if (!is_digest(hex)) continue;
+        std::error_code ec2;
+        object o{ std::move(hex), it->file_size(ec2), it->last_write_time(ec2) };
+        if (const auto t = fs::last_write_time(used_path(o.hex), ec2); !ec2) o.used = t;
+        total += o.size;
+        objects.push_back(std::move(o));
+    }
+
+    // temp files from writers that died halfway, anything a live writer is using is a lot younger than this
+    const auto stale = fs::file_time_type::clock::now() - std::chrono::hours(1);
+    for (fs::directory_iterator it(store_root() / L"tmp", ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code ec2;
+        if (it->last_write_time(ec2) < stale) fs::remove(it->path(), ec2);
+    }
+
+    if (total <= max_bytes) return;
+    const auto pinned = pinned_digests();
+    std::ranges::sort(objects, {}, &object::used);
+    for (const auto& o : objects) {
+        if (total <= max_bytes) break;
+        if (pinned.contains(o.hex)) continue;
+        // installs are copies, so this never breaks the game
+        std::error_code ec2;
+        if (fs::remove(object_path(o.hex), ec2)) total -= o.size;
+        fs::remove(used_path(o.hex), ec2);
+    }
+    trace_counter("store bytes", static_cast<long long>(total));
+}
\ No newline at end of file
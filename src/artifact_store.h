@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common.h"
+
+// content addressed store for downloaded artifacts in %LOCALAPPDATA%\SpectreLauncher\store.
+//   objects\<SHA256>   the artifact itself, named by its uppercase hex digest, never modified after it lands
+//   used\<SHA256>      empty file whose mtime is the last time the object was installed, for the lru
+//   pins\<name>        holds a digest, pinned objects are never collected
+// writers publish with a rename so any number of launcher instances can add the same object at once.
+// only collection takes a lock (store\gc.lock) and just skips if another instance is already at it
+
+// moves file into the store. hex is the digest the caller already computed while writing file and is taken
+// as is, only a copy across volumes gets hashed again. file is gone afterwards either way. true if the store
+// has the object when this returns
+[[nodiscard]] bool store_put(const fs::path& file, const std::string& hex);
+
+[[nodiscard]] bool store_has(const std::string& hex);
+
+// clones the object to dst where the filesystem can (reflink, no bytes copied), copies it otherwise. either way
+// dst is its own file. the object is re-verified first (answered from the hash cache while it hasnt changed) and
+// dropped from the store if it doesnt match its name anymore
+[[nodiscard]] bool store_install(const std::string& hex, const fs::path& dst);
+
+// how the installs so far got their bytes, also traced as "store install reflinks" / "store install copies"
+struct store_install_counters {
+    unsigned long long reflinks = 0;
+    unsigned long long copies = 0;
+};
+
+[[nodiscard]] store_install_counters store_get_install_counters();
+
+// names are [A-Za-z0-9._-] only
+[[nodiscard]] bool store_pin(const std::string& name, const std::string& hex);
+
+// a pin name, a full digest or an unambiguous digest prefix (8+ chars) -> full digest of an object we have
+[[nodiscard]] std::optional<std::string> store_resolve(const std::string& name_or_digest);
+
+// removes least recently used unpinned objects until the store is at most max_bytes
+void store_gc(unsigned long long max_bytes);
\ No newline at end of file
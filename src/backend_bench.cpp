@@ -0,0 +1,218 @@
+#include "backend_bench.h"
+#include "http_async.h"
+#include "page_trigger.h"
+#include "steam_library.h"
+#include "trace.h"
+#include "utf.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cwctype>
+#include <memory>
+#include <thread>
+
+namespace {
+    using steady = std::chrono::steady_clock;
+
+    // completions per second of the run, for the throughput over time line
+    struct timeline {
+        std::unique_ptr<std::atomic<unsigned>[]> ok;
+        std::unique_ptr<std::atomic<unsigned>[]> bad;
+        size_t seconds = 0;
+
+        explicit timeline(const size_t n) : ok(new std::atomic<unsigned>[n]()), bad(new std::atomic<unsigned>[n]()), seconds(n) {}
+
+        void add(const steady::time_point start, const steady::time_point at, const bool good) {
+            const auto s = static_cast<size_t>(std::chrono::duration_cast<std::chrono::seconds>(at - start).count());
+            if (s >= seconds) return;
+            (good ? ok : bad)[s].fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    // what every event loop needs to know, shared read only apart from next and the timeline
+    struct run_plan {
+        const backend_bench_options& opts;
+        bool open_loop = false;
+        size_t threads = 1;
+        steady::time_point start;
+        steady::duration duration{};
+        std::chrono::duration<double> interval{ 0 };
+        unsigned long long planned = 0;
+        std::atomic<unsigned long long> next{ 0 };
+        timeline tl;
+    };
+
+    [[nodiscard]] long long us_between(const steady::time_point a, const steady::time_point b) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(b - a).count();
+    }
+
+    // queues the provider id post for synthetic account first_account + k
+    void submit_login(http_async& client, const backend_bench_options& opts, const unsigned long long k, http_async::callback done) {
+        // the request only points at the body, submit takes its own copy
+        const std::string body = provider_id_body(std::to_wstring(steamid64_from_account(opts.first_account + k)));
+        http_request req = provider_id_request(body);
+        req.url = opts.url;
+        // a retry would hide exactly the failures we're here to count
+        req.attempts = 1;
+        req.timeout = opts.timeout;
+        client.submit(req, std::move(done));
+    }
+
+    void record(run_plan& plan, backend_bench_report& st, const steady::time_point due, const http_async_result& r) {
+        const auto done = steady::now();
+        st.latency.record(static_cast<std::uint64_t>(std::max(0ll, us_between(due, done))));
+        const bool good = r.status >= 200 && r.status < 300;
+        if (good) ++st.ok;
+        else if (r.status) ++st.http_error;
+        else if (r.latency >= plan.opts.timeout) ++st.timed_out;
+        else ++st.failed;
+        plan.tl.add(plan.start, done, good);
+    }
+
+    // keeps inflight requests going until the duration is up, each completion sends the next one
+    void closed_loop(run_plan& plan, backend_bench_report& st, const size_t inflight) {
+        http_async client(inflight);
+        const auto send = [&](const auto& self) -> void {
+            const auto due = steady::now();
+            if (due - plan.start >= plan.duration) return;
+            const unsigned long long k = plan.next.fetch_add(1, std::memory_order_relaxed);
+            submit_login(client, plan.opts, k, [&plan, &st, &self, due](http_async_result&& r) {
+                record(plan, st, due, r);
+                self(self);
+            });
+        };
+        std::this_thread::sleep_until(plan.start);
+        for (size_t i = 0; i < inflight; ++i) send(send);
+        client.run();
+        st.connects = client.connects();
+    }
+
+    // every threads-th request of the schedule starting at w, sent when its due whatever is still in flight
+    void open_loop(run_plan& plan, backend_bench_report& st, const size_t w, const size_t inflight) {
+        http_async client(inflight);
+        for (unsigned long long k = w; k < plan.planned; k += plan.threads) {
+            const auto due = plan.start + std::chrono::duration_cast<steady::duration>(plan.interval * static_cast<double>(k));
+            // keep the ones in flight moving while we wait for the slot, sleep once there are none
+            if (!client.run_until(due)) std::this_thread::sleep_until(due);
+            st.max_lag_us = std::max(st.max_lag_us, us_between(due, steady::now()));
+            submit_login(client, plan.opts, k, [&plan, &st, due](http_async_result&& r) { record(plan, st, due, r); });
+        }
+        client.run();
+        st.connects = client.connects();
+    }
+
+    [[nodiscard]] wstr host_key(wstr host) {
+        for (auto& c : host) c = static_cast<wchar_t>(std::towlower(c));
+        // a trailing dot is the same host to dns
+        while (!host.empty() && host.back() == L'.') host.pop_back();
+        return host;
+    }
+
+    void print_summary(const backend_bench_report& r, const bool openLoop) {
+        const unsigned long long done = r.requests();
+        std::printf("\n%llu requests in %.1f s, %.0f req/s, %llu ok, %llu connects\n", done, r.seconds,
+                    r.seconds > 0 ? static_cast<double>(done) / r.seconds : 0.0, r.ok, r.connects);
+        std::printf("errors: %llu http, %llu timed out, %llu failed\n", r.http_error, r.timed_out, r.failed);
+        const auto ms = [&r](const double p) { return static_cast<double>(r.latency.percentile(p)) / 1000.0; };
+        std::printf("latency ms: p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n", ms(0.5), ms(0.9), ms(0.99), ms(0.999),
+                    static_cast<double>(r.latency.max) / 1000.0);
+        if (openLoop) {
+            // lag this big means the senders were the bottleneck, not the backend
+            std::printf("senders fell behind schedule by up to %.1f ms\n", static_cast<double>(r.max_lag_us) / 1000.0);
+        }
+    }
+} // anon namespace
+
+[[nodiscard]] std::optional<std::string> backend_bench_refusal(const wstr& url) {
+    if (url.empty()) return "Backend bench needs --bench-url, it never picks a target by itself.";
+    const auto u = parse_url(url);
+    if (!u || u->https) return "Backend bench only speaks plain http, --bench-url has to be http://.";
+    // the whole point is finding where the backend falls over, so never point that at the real one
+    if (const auto prod = parse_url(BACKEND_ADDRESS); prod && host_key(u->host) == host_key(prod->host)) {
+        return "Refusing to bench the production backend, point --bench-url at a stand-in.";
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] std::optional<backend_bench_report> backend_bench(const backend_bench_options& opts) {
+    TRACE_SCOPE("backend bench");
+    if (backend_bench_refusal(opts.url)) return std::nullopt;
+    const size_t concurrency = std::max<size_t>(opts.concurrency, 1);
+    size_t threads = opts.threads ? opts.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, concurrency);
+
+    const auto secs = [](const std::chrono::milliseconds d) { return static_cast<size_t>((d.count() + 999) / 1000); };
+    // room for the stragglers that finish after the last second
+    run_plan plan{ .opts = opts, .tl = timeline(secs(opts.duration) + secs(opts.timeout) + 2) };
+    plan.open_loop = opts.rate > 0;
+    plan.threads = threads;
+    plan.duration = std::chrono::duration_cast<steady::duration>(opts.duration);
+    // open loop sends exactly rate * duration, closed loop as many as fit
+    plan.planned = static_cast<unsigned long long>(opts.rate * std::chrono::duration<double>(opts.duration).count());
+    if (plan.open_loop) plan.interval = std::chrono::duration<double>(1.0 / opts.rate);
+    plan.start = steady::now() + std::chrono::milliseconds(100);
+
+    std::vector<backend_bench_report> stats(threads);
+    std::atomic<bool> finished{ false };
+    std::jthread reporter;
+    if (opts.progress) {
+        reporter = std::jthread([&] {
+            std::this_thread::sleep_until(plan.start);
+            for (size_t s = 1; !finished; ++s) {
+                std::this_thread::sleep_until(plan.start + std::chrono::seconds(s));
+                if (s - 1 >= plan.tl.seconds) continue;
+                const unsigned good = plan.tl.ok[s - 1].load(), bad = plan.tl.bad[s - 1].load();
+                std::printf("%4zu s  %6u ok/s  %6u errors/s\n", s, good, bad);
+                std::fflush(stdout);
+            }
+        });
+    }
+    {
+        std::vector<std::jthread> loops;
+        loops.reserve(threads);
+        for (size_t w = 0; w < threads; ++w) {
+            // the in flight budget split as evenly as it goes
+            const size_t inflight = concurrency / threads + (w < concurrency % threads ? 1 : 0);
+            loops.emplace_back([&plan, &st = stats[w], w, inflight] {
+                if (plan.open_loop) open_loop(plan, st, w, inflight);
+                else closed_loop(plan, st, inflight);
+            });
+        }
+    }
+    finished = true;
+
+    backend_bench_report total;
+    total.seconds = std::chrono::duration<double>(steady::now() - plan.start).count();
+    for (const auto& st : stats) {
+        total.latency.merge(st.latency);
+        total.ok += st.ok;
+        total.http_error += st.http_error;
+        total.timed_out += st.timed_out;
+        total.failed += st.failed;
+        total.max_lag_us = std::max(total.max_lag_us, st.max_lag_us);
+        total.connects += st.connects;
+    }
+    for (size_t s = 0; s < plan.tl.seconds; ++s) {
+        total.ok_per_second.push_back(plan.tl.ok[s].load());
+        total.errors_per_second.push_back(plan.tl.bad[s].load());
+    }
+    if (reporter.joinable()) reporter.join();
+    trace_counter("bench requests", static_cast<long long>(total.latency.total));
+    return total;
+}
+
+[[nodiscard]] int run_backend_bench(const backend_bench_options& opts) {
+    if (const auto why = backend_bench_refusal(opts.url)) {
+        std::fprintf(stderr, "%s\n", why->c_str());
+        return 16;
+    }
+    const bool openLoop = opts.rate > 0;
+    std::printf("%s loop against %s, %zu %s, %.1f s\n", openLoop ? "open" : "closed", narrow_utf8(opts.url).value_or("?").c_str(),
+                std::max<size_t>(opts.concurrency, 1), openLoop ? "at most in flight" : "in flight",
+                std::chrono::duration<double>(opts.duration).count());
+    if (openLoop) std::printf("%.0f req/s\n", opts.rate);
+    const auto report = backend_bench(opts);
+    if (!report) return 16;
+    print_summary(*report, openLoop);
+    return 0;
+}
\ No newline at end of file
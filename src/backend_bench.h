@@ -0,0 +1,54 @@
+#pragma once
+
+#include "common.h"
+#include "histogram.h"
+#include <chrono>
+#include <vector>
+
+// --bench-backend: load generator for the provider id endpoint, sending the same post RunPageTrigger makes
+// for synthetic steamids. open loop (fixed rate, latency counted from when each request was due so a
+// struggling backend cant hide behind a slow generator) or closed loop (fixed number in flight). every thread
+// runs its own http_async, so one box can keep thousands in flight without a thread each
+
+struct backend_bench_options {
+    // requests per second for open loop, 0 runs closed loop
+    double rate = 0;
+    // closed loop: requests in flight. open loop: the most that can be in flight, past that they queue and
+    // the wait shows up in the latency
+    size_t concurrency = 32;
+    // event loops, one thread and one set of sockets each. 0 is one per core
+    size_t threads = 0;
+    std::chrono::milliseconds duration{ std::chrono::seconds(30) };
+    std::chrono::milliseconds timeout{ 10000 };
+    // the stand-in to load. required, plain http, and never the production backend
+    wstr url;
+    // synthetic accounts are first_account, first_account + 1, ... turned into steamids like the real thing
+    unsigned long long first_account = 900000000;
+    // the per second throughput lines on stdout
+    bool progress = true;
+};
+
+struct backend_bench_report {
+    latency_histogram latency;
+    unsigned long long ok = 0;
+    unsigned long long http_error = 0;
+    unsigned long long timed_out = 0;
+    unsigned long long failed = 0;
+    long long max_lag_us = 0;  // open loop only, how far behind schedule a send went out
+    unsigned long long connects = 0;
+    double seconds = 0;
+    // completions per second of the run, stragglers past the end included
+    std::vector<unsigned> ok_per_second;
+    std::vector<unsigned> errors_per_second;
+
+    [[nodiscard]] unsigned long long requests() const { return ok + http_error + timed_out + failed; }
+};
+
+// why url cant be the target (missing, not plain http, or the production backend). nullopt if it can
+[[nodiscard]] std::optional<std::string> backend_bench_refusal(const wstr& url);
+
+// the run itself. nullopt if the url is refused
+[[nodiscard]] std::optional<backend_bench_report> backend_bench(const backend_bench_options& opts);
+
+// backend_bench plus the latency summary on stdout
+[[nodiscard]] int run_backend_bench(const backend_bench_options& opts);
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+// little helpers for the small binary cache files we keep in the launcher data dir.
+// everything is native (little) endian, strings are a u16 length followed by the wchar_ts
+
+[[nodiscard]] inline std::uint32_t crc32(const unsigned char* p, const size_t n) {
+    static const auto table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    std::uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; ++i) c = table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void bin_put(std::string& out, const T v) {
+    char b[sizeof(T)];
+    std::memcpy(b, &v, sizeof(T));
+    out.append(b, sizeof(T));
+}
+
+inline void bin_put_wstr(std::string& out, const wstr& s) {
+    bin_put(out, static_cast<std::uint16_t>(s.size()));
+    out.append(reinterpret_cast<const char*>(s.data()), s.size() * sizeof(wchar_t));
+}
+
+// appends the crc of everything written so far
+inline void bin_seal(std::string& out) {
+    bin_put(out, crc32(reinterpret_cast<const unsigned char*>(out.data()), out.size()));
+}
+
+struct bin_reader {
+    const std::string& buf;
+    size_t pos = 0;
+
+    template <typename T>
+    [[nodiscard]] bool get(T& v) {
+        if (buf.size() - pos < sizeof(T)) return false;
+        std::memcpy(&v, buf.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    [[nodiscard]] bool get_bytes(void* dst, const size_t n) {
+        if (buf.size() - pos < n) return false;
+        std::memcpy(dst, buf.data() + pos, n);
+        pos += n;
+        return true;
+    }
+
+    [[nodiscard]] bool get_wstr(wstr& s) {
+        std::uint16_t len = 0;
+        if (!get(len)) return false;
+        s.resize(len);
+        return get_bytes(s.data(), len * sizeof(wchar_t));
+    }
+};
+
+// checks the crc trailer and the magic + version header. on success the reader sits right after the header
+// and buf has the trailer still on it, so callers should stop at buf.size() - 4
+[[nodiscard]] inline bool bin_open(bin_reader& r, const char (&magic)[4], const std::uint16_t version) {
+    if (r.buf.size() < 12) return false;
+    std::uint32_t stored = 0;
+    std::memcpy(&stored, r.buf.data() + r.buf.size() - 4, 4);
+    if (crc32(reinterpret_cast<const unsigned char*>(r.buf.data()), r.buf.size() - 4) != stored) return false;
+    char m[4]{};
+    std::uint16_t v = 0, reserved = 0;
+    if (!r.get_bytes(m, 4) || std::memcmp(m, magic, 4) != 0) return false;
+    return r.get(v) && v == version && r.get(reserved);
+}
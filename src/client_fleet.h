@@ -0,0 +1,12 @@
+#pragma once
+
+#include "common.h"
+#include "fleet.h"
+#include <memory>
+
+// fleet_host for real game clients: same args and environment as launch_game_client, the processes themselves
+// to wait on, target_page_probe for the trigger and the same provider id post a normal launch makes. the
+// windows one (client_fleet_win.cpp) spawns through launch_game_client and holds the clients in a kill on close
+// job, the posix one (client_fleet_posix.cpp) uses posix_spawn and pidfds and kills what is left when it goes.
+// either way the fleet doesnt outlive the host
+[[nodiscard]] std::unique_ptr<fleet_host> make_client_fleet_host(const fs::path& clientExe, size_t members);
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "client_fleet.h"
+#include "page_trigger.h"
+#include "trace.h"
+#include "utf.h"
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <string>
+#include <thread>
+
+extern char** environ;
+
+namespace {
+    struct client {
+        pid_t pid = -1;
+        native_process process = NO_PROCESS;
+        target_page_probe probe;
+    };
+
+    // what launch_game_client puts in front of the extra args on windows
+    [[nodiscard]] std::vector<std::string> client_args(const std::string& exe, const wstr& extra) {
+        std::vector<std::string> args = { exe, "-PragmaEnvironment=live", "-PragmaBackendAddress=" + narrow_utf8(BACKEND_ADDRESS).value_or("") };
+        // no shell here to do the splitting, so plain whitespace separated words and no quoting
+        const std::string rest = narrow_utf8(extra).value_or("");
+        size_t pos = 0;
+        while ((pos = rest.find_first_not_of(" \t", pos)) != std::string::npos) {
+            const size_t end = std::min(rest.find_first_of(" \t", pos), rest.size());
+            args.push_back(rest.substr(pos, end - pos));
+            pos = end;
+        }
+        return args;
+    }
+
+    // our environment with the steam ids swapped in, same set launch_game_client uses
+    [[nodiscard]] std::vector<std::string> client_env(const wstr& steamId) {
+        const std::string app = narrow_utf8(APP_ID_STR).value_or("");
+        const std::pair<const char*, std::string> overrides[] = {
+            { "STEAMID", narrow_utf8(steamId).value_or("") },
+            { "SteamGameId", app },
+            { "SteamAppId", app },
+            { "SteamOverlayGameId", app },
+        };
+        std::vector<std::string> env;
+        for (char** e = environ; e && *e; ++e) {
+            const std::string_view kv = *e;
+            const std::string_view name = kv.substr(0, kv.find('='));
+            if (std::ranges::none_of(overrides, [name](const auto& o) { return name == o.first; })) env.emplace_back(kv);
+        }
+        for (const auto& [name, value] : overrides) env.push_back(std::string(name) + "=" + value);
+        return env;
+    }
+
+    [[nodiscard]] std::vector<char*> c_strings(std::vector<std::string>& v) {
+        std::vector<char*> out;
+        out.reserve(v.size() + 1);
+        for (auto& s : v) out.push_back(s.data());
+        out.push_back(nullptr);
+        return out;
+    }
+
+    struct client_fleet_host final : fleet_host {
+        fs::path exe;
+        // one slot per member, only ever touched for that member so no locking
+        std::vector<client> clients;
+
+        client_fleet_host(fs::path e, const size_t members) : exe(std::move(e)), clients(members) {}
+
+        // nothing like a windows job object to take the children along, so the fleet goes when the host does
+        ~client_fleet_host() override {
+            for (size_t i = 0; i < clients.size(); ++i) kill(i);
+        }
+
+        [[nodiscard]] bool spawn(const size_t i, const fleet_member& m) override {
+            TRACE_SCOPE("fleet spawn");
+            kill(i);
+            auto args = client_args(exe.string(), m.extra_args);
+            auto env = client_env(m.steam_id);
+            auto argv = c_strings(args);
+            auto envp = c_strings(env);
+
+            posix_spawn_file_actions_t actions;
+            if (::posix_spawn_file_actions_init(&actions) != 0) return false;
+            // the game looks for its content next to the exe, same as the cwd CreateProcessW gets
+            const std::string cwd = exe.parent_path().string();
+            if (!cwd.empty()) ::posix_spawn_file_actions_addchdir_np(&actions, cwd.c_str());
+            pid_t pid = -1;
+            const int rc = ::posix_spawn(&pid, args[0].c_str(), &actions, nullptr, argv.data(), envp.data());
+            ::posix_spawn_file_actions_destroy(&actions);
+            if (rc != 0) return false;
+
+            const native_process h = open_process(pid);
+            if (h == NO_PROCESS) {
+                ::kill(pid, SIGKILL);
+                int status = 0;
+                ::waitpid(pid, &status, 0);
+                return false;
+            }
+            clients[i] = { pid, h, make_trigger_probe(h, pid) };
+            return true;
+        }
+
+        [[nodiscard]] std::optional<size_t> wait_exit(const std::vector<size_t>& children, const std::chrono::milliseconds timeout) override {
+            if (children.empty()) {
+                std::this_thread::sleep_for(timeout);
+                return std::nullopt;
+            }
+            // no 64 handle limit like WaitForMultipleObjects, one poll covers everyone
+            std::vector<pollfd> fds(children.size());
+            for (size_t k = 0; k < children.size(); ++k) fds[k] = { clients[children[k]].process, POLLIN, 0 };
+            if (::poll(fds.data(), fds.size(), static_cast<int>(timeout.count())) <= 0) return std::nullopt;
+            for (size_t k = 0; k < children.size(); ++k) {
+                if (!fds[k].revents) continue;
+                // reaped here so it doesnt sit around as a zombie until the host goes
+                client& c = clients[children[k]];
+                int status = 0;
+                if (c.pid > 0 && ::waitpid(c.pid, &status, WNOHANG) == c.pid) c.pid = -1;
+                return children[k];
+            }
+            return std::nullopt;
+        }
+
+        [[nodiscard]] bool triggered(const size_t i) override {
+            return clients[i].probe.poll() == probe_state::ready;
+        }
+
+        [[nodiscard]] bool submit(size_t, const fleet_member& m) override {
+            return submit_steam_id(m.steam_id);
+        }
+
+        // the pidfd stays until kill or the next spawn for this slot, a shutdown still needs it
+        void release(const size_t i) override {
+            clients[i].probe = {};
+        }
+
+        void kill(const size_t i) override {
+            client& c = clients[i];
+            if (c.process != NO_PROCESS) {
+                // through the pidfd, the pid alone could belong to someone else by now if it was reaped already
+                ::syscall(SYS_pidfd_send_signal, c.process, SIGKILL, nullptr, 0);
+                close_process(c.process);
+            }
+            if (c.pid > 0) {
+                int status = 0;
+                while (::waitpid(c.pid, &status, 0) < 0 && errno == EINTR) {}
+            }
+            c = {};
+        }
+    };
+} // anon namespace
+
+[[nodiscard]] std::unique_ptr<fleet_host> make_client_fleet_host(const fs::path& clientExe, const size_t members) {
+    return std::make_unique<client_fleet_host>(clientExe, members);
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "client_fleet.h"
+#include "page_trigger.h"
+#include "process_utils.h"
+#include "trace.h"
+#include <windows.h>
+#include <algorithm>
+#include <thread>
+
+namespace {
+    struct client {
+        HANDLE process = nullptr;
+        target_page_probe probe;
+    };
+
+    struct client_fleet_host final : fleet_host {
+        fs::path exe;
+        // one slot per member, only ever touched for that member so no locking
+        std::vector<client> clients;
+        // every client goes in here and the job kills them all once its last handle is closed, so the fleet
+        // goes with us even when we dont get to shut it down ourselves
+        HANDLE job = nullptr;
+
+        client_fleet_host(fs::path e, const size_t members) : exe(std::move(e)), clients(members) {
+            job = CreateJobObjectW(nullptr, nullptr);
+            JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+            limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+            if (job && !SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits))) {
+                CloseHandle(job);
+                job = nullptr;
+            }
+        }
+
+        ~client_fleet_host() override {
+            for (auto& c : clients) if (c.process) CloseHandle(c.process);
+            if (job) CloseHandle(job);
+        }
+
+        [[nodiscard]] bool spawn(const size_t i, const fleet_member& m) override {
+            TRACE_SCOPE("fleet spawn");
+            const auto pi = launch_game_client(exe, m.steam_id, m.extra_args);
+            if (!pi) return false;
+            CloseHandle(pi->hThread);
+            if (job) AssignProcessToJobObject(job, pi->hProcess);
+            if (clients[i].process) CloseHandle(clients[i].process);
+            clients[i] = { pi->hProcess, make_trigger_probe(pi->hProcess, pi->dwProcessId) };
+            return true;
+        }
+
+        [[nodiscard]] std::optional<size_t> wait_exit(const std::vector<size_t>& children, const std::chrono::milliseconds timeout) override {
+            const auto ms = static_cast<DWORD>(timeout.count());
+            if (children.empty()) {
+                std::this_thread::sleep_for(timeout);
+                return std::nullopt;
+            }
+            // WaitForMultipleObjects tops out at 64 handles. every batch but the last is only checked,
+            // the last one carries the timeout
+            HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+            for (size_t first = 0; first < children.size(); first += MAXIMUM_WAIT_OBJECTS) {
+                const size_t n = std::min<size_t>(children.size() - first, MAXIMUM_WAIT_OBJECTS);
+                for (size_t k = 0; k < n; ++k) handles[k] = clients[children[first + k]].process;
+                const bool last = first + n == children.size();
+                const DWORD w = WaitForMultipleObjects(static_cast<DWORD>(n), handles, FALSE, last ? ms : 0);
+                if (w < WAIT_OBJECT_0 + n) return children[first + (w - WAIT_OBJECT_0)];
+            }
+            return std::nullopt;
+        }
+
+        [[nodiscard]] bool triggered(const size_t i) override {
+            return clients[i].probe.poll() == probe_state::ready;
+        }
+
+        [[nodiscard]] bool submit(size_t, const fleet_member& m) override {
+            return submit_steam_id(m.steam_id);
+        }
+
+        // the handle stays until kill or the next spawn for this slot, a shutdown still needs it
+        void release(const size_t i) override {
+            clients[i].probe = {};
+        }
+
+        void kill(const size_t i) override {
+            if (!clients[i].process) return;
+            TerminateProcess(clients[i].process, 1);
+            CloseHandle(clients[i].process);
+            clients[i] = {};
+        }
+    };
+} // anon namespace
+
+[[nodiscard]] std::unique_ptr<fleet_host> make_client_fleet_host(const fs::path& clientExe, const size_t members) {
+    return std::make_unique<client_fleet_host>(clientExe, members);
+}
\ No newline at end of file
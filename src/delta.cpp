@@ -0,0 +1,225 @@
+#include "delta.h"
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    inline constexpr char MAGIC[4] = { 'S', 'L', 'D', 'P' };
+    inline constexpr std::uint32_t VERSION = 1;
+    inline constexpr size_t HEADER_SIZE = 4 + 4 + 32 + 32 + 8;
+
+    enum : unsigned char { OP_END = 0, OP_COPY = 1, OP_INSERT = 2 };
+
+    // matching window for the generator. pe files have lots of short shifted runs so keep it small
+    inline constexpr size_t WINDOW = 32;
+    // source gets indexed every STRIDE bytes, the target is checked at every byte
+    inline constexpr size_t STRIDE = 16;
+    inline constexpr size_t MAX_CANDIDATES = 8;
+    inline constexpr std::uint64_t ROLL_MUL = 0x100000001B3ull;
+
+    template <typename T>
+    void put(std::string& out, const T v) {
+        char b[sizeof(T)];
+        std::memcpy(b, &v, sizeof(T));
+        out.append(b, sizeof(T));
+    }
+
+    template <typename T>
+    [[nodiscard]] bool get(std::istream& in, T& v) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+    }
+
+    [[nodiscard]] std::uint64_t window_hash(const unsigned char* p) {
+        std::uint64_t h = 0;
+        for (size_t i = 0; i < WINDOW; ++i) h = h * ROLL_MUL + p[i];
+        return h;
+    }
+
+    // ROLL_MUL^(WINDOW-1), what the outgoing byte was multiplied by
+    [[nodiscard]] std::uint64_t roll_out_factor() {
+        std::uint64_t f = 1;
+        for (size_t i = 1; i < WINDOW; ++i) f *= ROLL_MUL;
+        return f;
+    }
+
+    struct emitter {
+        std::string& out;
+        std::string_view target;
+        size_t literal_start = 0;
+
+        void flush_literal(const size_t upto) {
+            while (literal_start < upto) {
+                const size_t n = upto - literal_start < 0xFFFFFFFFu ? upto - literal_start : 0xFFFFFFFFu;
+                out.push_back(static_cast<char>(OP_INSERT));
+                put(out, static_cast<std::uint32_t>(n));
+                out.append(target.substr(literal_start, n));
+                literal_start += n;
+            }
+        }
+
+        void copy(std::uint64_t src, size_t len) {
+            while (len) {
+                const size_t n = len < 0xFFFFFFFFu ? len : 0xFFFFFFFFu;
+                out.push_back(static_cast<char>(OP_COPY));
+                put(out, src);
+                put(out, static_cast<std::uint32_t>(n));
+                src += n;
+                len -= n;
+            }
+        }
+    };
+} // anon namespace
+
+[[nodiscard]] std::string delta_generate(const std::string_view source, const std::string_view target) {
+    const auto* src = reinterpret_cast<const unsigned char*>(source.data());
+    const auto* tgt = reinterpret_cast<const unsigned char*>(target.data());
+
+    std::string out;
+    out.append(MAGIC, 4);
+    put(out, VERSION);
+    const sha256_digest sd = sha256_of(source.data(), source.size());
+    const sha256_digest td = sha256_of(target.data(), target.size());
+    out.append(reinterpret_cast<const char*>(sd.data()), sd.size());
+    out.append(reinterpret_cast<const char*>(td.data()), td.size());
+    put(out, static_cast<std::uint64_t>(target.size()));
+
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> index;
+    if (source.size() >= WINDOW) {
+        index.reserve(source.size() / STRIDE);
+        for (size_t off = 0; off + WINDOW <= source.size(); off += STRIDE) {
+            auto& slot = index[window_hash(src + off)];
+            if (slot.size() < MAX_CANDIDATES) slot.push_back(static_cast<std::uint32_t>(off));
+        }
+    }
+
+    emitter em{ out, target };
+    const std::uint64_t outFactor = roll_out_factor();
+    size_t pos = 0;
+    std::uint64_t h = target.size() >= WINDOW ? window_hash(tgt) : 0;
+    while (pos + WINDOW <= target.size()) {
+        size_t bestLen = 0, bestSrc = 0, bestBack = 0;
+        if (const auto it = index.find(h); it != index.end()) {
+            for (const std::uint32_t cand : it->second) {
+                if (std::memcmp(src + cand, tgt + pos, WINDOW) != 0) continue;
+                size_t len = WINDOW;
+                while (cand + len < source.size() && pos + len < target.size() && src[cand + len] == tgt[pos + len]) ++len;
+                // pull the match backwards into bytes we were about to emit as literals
+                size_t back = 0;
+                while (back < cand && back < pos - em.literal_start && src[cand - back - 1] == tgt[pos - back - 1]) ++back;
+                if (len + back > bestLen + bestBack) {
+                    bestLen = len;
+                    bestBack = back;
+                    bestSrc = cand;
+                }
+            }
+        }
+        if (bestLen) {
+            em.flush_literal(pos - bestBack);
+            em.copy(bestSrc - bestBack, bestLen + bestBack);
+            pos += bestLen;
+            em.literal_start = pos;
+            if (pos + WINDOW <= target.size()) h = window_hash(tgt + pos);
+            continue;
+        }
+        if (pos + WINDOW < target.size()) h = (h - tgt[pos] * outFactor) * ROLL_MUL + tgt[pos + WINDOW];
+        ++pos;
+    }
+    em.flush_literal(target.size());
+    out.push_back(static_cast<char>(OP_END));
+    return out;
+}
+
+[[nodiscard]] std::optional<sha256_digest> delta_source_digest(const fs::path& patch) {
+    std::ifstream in(patch, std::ios::binary);
+    char magic[4]{};
+    std::uint32_t version = 0;
+    sha256_digest sd{};
+    if (!in.read(magic, 4) || std::memcmp(magic, MAGIC, 4) != 0) return std::nullopt;
+    if (!get(in, version) || version != VERSION) return std::nullopt;
+    if (!in.read(reinterpret_cast<char*>(sd.data()), sd.size())) return std::nullopt;
+    return sd;
+}
+
+[[nodiscard]] delta_result delta_apply(const fs::path& patch, const fs::path& source, const fs::path& out, sha256_digest* target,
+                                       const bool source_checked) {
+    std::ifstream pin(patch, std::ios::binary);
+    std::ifstream sin(source, std::ios::binary | std::ios::ate);
+    if (!pin || !sin) return delta_result::io_error;
+    const auto sourceSize = static_cast<std::uint64_t>(sin.tellg());
+
+    char magic[4]{};
+    std::uint32_t version = 0;
+    sha256_digest sd{}, td{};
+    std::uint64_t targetSize = 0;
+    if (!pin.read(magic, 4) || std::memcmp(magic, MAGIC, 4) != 0) return delta_result::bad_patch;
+    if (!get(pin, version) || version != VERSION) return delta_result::bad_patch;
+    if (!pin.read(reinterpret_cast<char*>(sd.data()), sd.size()) || !pin.read(reinterpret_cast<char*>(td.data()), td.size()) ||
+        !get(pin, targetSize)) {
+        return delta_result::bad_patch;
+    }
+
+    // make sure we patch the file the patch was made for, otherwise the output is garbage
+    if (!source_checked) {
+        sha256 h;
+        std::vector<char> buf(1 << 16);
+        sin.seekg(0);
+        while (sin) {
+            sin.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+            if (const auto got = sin.gcount(); got > 0) h.update(buf.data(), static_cast<size_t>(got));
+        }
+        if (h.finish() != sd) return delta_result::wrong_source;
+        sin.clear();
+    }
+
+    delta_result res = delta_result::ok;
+    {
+        std::ofstream ofs(out, std::ios::binary | std::ios::trunc);
+        if (!ofs) return delta_result::io_error;
+        sha256 h;
+        std::uint64_t written = 0;
+        std::vector<char> buf(1 << 16);
+
+        // pumps len bytes from in to the output and the hasher
+        const auto pump = [&](std::istream& in, std::uint32_t len) {
+            while (len) {
+                const std::uint32_t n = len < buf.size() ? len : static_cast<std::uint32_t>(buf.size());
+                if (!in.read(buf.data(), n)) return false;
+                h.update(buf.data(), n);
+                ofs.write(buf.data(), n);
+                written += n;
+                len -= n;
+            }
+            return static_cast<bool>(ofs);
+        };
+
+        for (;;) {
+            unsigned char op = 0;
+            if (!get(pin, op)) { res = delta_result::bad_patch; break; }
+            if (op == OP_END) break;
+            std::uint32_t len = 0;
+            bool ok = false;
+            if (op == OP_COPY) {
+                std::uint64_t off = 0;
+                ok = get(pin, off) && get(pin, len) && off <= sourceSize && len <= sourceSize - off &&
+                     written + len <= targetSize && sin.seekg(static_cast<std::streamoff>(off)) && pump(sin, len);
+            } else if (op == OP_INSERT) {
+                ok = get(pin, len) && written + len <= targetSize && pump(pin, len);
+            }
+            // running out of patch mid op is a broken patch, only a stream that actually failed is an io error
+            if (!ok) { res = pin.bad() || sin.bad() || !ofs ? delta_result::io_error : delta_result::bad_patch; break; }
+        }
+
+        ofs.flush();
+        if (res == delta_result::ok && !ofs) res = delta_result::io_error;
+        if (res == delta_result::ok && (written != targetSize || h.finish() != td)) res = delta_result::target_mismatch;
+    }
+
+    if (res != delta_result::ok) {
+        std::error_code ec;
+        fs::remove(out, ec);
+        return res;
+    }
+    if (target) *target = td;
+    return res;
+}
\ No newline at end of file
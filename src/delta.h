@@ -0,0 +1,34 @@
+#pragma once
+
+#include "common.h"
+#include "sha256.h"
+#include <string_view>
+
+// binary patch format (little endian):
+//   "SLDP" u32 version
+//   u8[32] source sha256, u8[32] target sha256, u64 target size
+//   ops: u8 1 = copy   { u64 source offset, u32 len }
+//        u8 2 = insert { u32 len, u8[len] bytes }
+//        u8 0 = end
+// applying only needs the patch read front to back plus random reads of the source, so it streams
+
+enum class delta_result {
+    ok,
+    io_error,
+    bad_patch,       // not a patch, wrong version, or ops pointing outside the source
+    wrong_source,    // patch was made against a different source file
+    target_mismatch, // applied fine but the output doesnt hash to the target digest
+};
+
+// builds a patch turning source into target
+[[nodiscard]] std::string delta_generate(std::string_view source, std::string_view target);
+
+// reads the source digest out of a patch header without applying anything
+[[nodiscard]] std::optional<sha256_digest> delta_source_digest(const fs::path& patch);
+
+// applies patch to source and writes the result to out, hashing it on the way.
+// out is only left behind when the result is ok. source_checked skips hashing the source when the caller
+// already matched its digest against delta_source_digest, a source that isnt the right one after all still
+// ends in target_mismatch
+[[nodiscard]] delta_result delta_apply(const fs::path& patch, const fs::path& source, const fs::path& out, sha256_digest* target = nullptr,
+                                       bool source_checked = false);
\ No newline at end of file
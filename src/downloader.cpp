@@ -0,0 +1,513 @@
+#include "downloader.h"
+#include "file_utils.h"
+#include "http_client.h"
+#include "sha256.h"
+#include "trace.h"
+#include "utf.h"
+#include "zstd_stream.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cwchar>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+    inline constexpr int CHUNK_ATTEMPTS = 3;
+
+    std::atomic<unsigned long long> g_bytes{ 0 };
+    std::atomic<unsigned long long> g_wire{ 0 };
+
+    // the release artifacts are a few mb, this is only about noticing a dead connection
+    [[nodiscard]] http_request get_request(const wstr& url, wstr headers) {
+        http_request r;
+        r.url = url;
+        r.headers = std::move(headers);
+        r.timeout = std::chrono::seconds(30);
+        r.attempts = 3;
+        return r;
+    }
+
+    // paces reads so a download stays under a byte rate. shared by every connection of a ranged download
+    struct rate_limit {
+        unsigned long long bytes_per_sec = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::mutex lock;
+        unsigned long long taken = 0;
+
+        explicit rate_limit(const unsigned long long rate) : bytes_per_sec(rate) {}
+
+        // sleeps until n more bytes fit in the budget since start
+        void take(const unsigned long long n) {
+            if (!bytes_per_sec) return;
+            std::chrono::steady_clock::time_point due;
+            {
+                std::scoped_lock lk(lock);
+                taken += n;
+                due = start + std::chrono::microseconds(taken * 1'000'000 / bytes_per_sec);
+            }
+            std::this_thread::sleep_until(due);
+        }
+    };
+
+    // what read() is going to hand us. gzip and deflate are undone by the transport already (winhttp), zstd is
+    // ours to decode. unsupported is a coding nobody asked for that nothing here can undo
+    enum class body_coding { plain, decoded, zstd, unsupported };
+
+    [[nodiscard]] body_coding coding_of(const std::wstring_view url, const http_response& r) {
+        const wstr enc = r.header(http_header::content_encoding);
+        if (enc == L"zstd" || url.ends_with(L".zst")) return body_coding::zstd;
+        if (enc.empty() || enc == L"identity") return body_coding::plain;
+        return http_builtin_codings().find(enc) != std::wstring_view::npos ? body_coding::decoded : body_coding::unsupported;
+    }
+
+    // winhttp only adds gzip/deflate on its own, this one replaces it when we can take zstd too
+    [[nodiscard]] wstr accept_encoding() {
+        if (!zstd_available()) return L"";
+        wstr out = L"Accept-Encoding: zstd";
+        if (const auto builtin = http_builtin_codings(); !builtin.empty()) out += L", " + wstr(builtin);
+        return out + L"\r\n";
+    }
+
+    [[nodiscard]] wstr conditional_headers(const fetch_state& state) {
+        wstr out;
+        if (!state.etag.empty()) out += L"If-None-Match: " + state.etag + L"\r\n";
+        if (!state.last_modified.empty()) out += L"If-Modified-Since: " + state.last_modified + L"\r\n";
+        return out;
+    }
+
+    // one pass over the body: every chunk is decoded (if it has to be) straight into the file and the hasher,
+    // so theres no reread afterwards and never more than a buffer of it in memory
+    [[nodiscard]] fetch_result read_body_to_file(http_response& r, const fs::path& dst, const fetch_options& opts,
+                                                 const body_coding coding, sha256_digest& digest) {
+        // an encoded body's content-length is what comes over the wire, the limits are about what we end up with
+        if (coding == body_coding::unsupported) return fetch_result::failed;
+        const bool plain = coding == body_coding::plain;
+        const auto length = r.content_length();
+        if (plain && length && opts.max_bytes && *length > opts.max_bytes) return fetch_result::too_large;
+        if (plain && length && opts.expected_size && *length != opts.expected_size) return fetch_result::size_mismatch;
+
+        std::ofstream ofs(dst, std::ios::binary | std::ios::trunc);
+        if (!ofs) return fetch_result::failed;
+        rate_limit pace(opts.max_bytes_per_sec);
+        sha256 h;
+        unsigned long long total = 0, wire = 0;
+        fetch_result err = fetch_result::downloaded;
+        const auto take = [&](const char* data, const size_t len) {
+            total += len;
+            if (opts.max_bytes && total > opts.max_bytes) err = fetch_result::too_large;
+            else if (opts.expected_size && total > opts.expected_size) err = fetch_result::size_mismatch;
+            else {
+                h.update(data, len);
+                ofs.write(data, static_cast<std::streamsize>(len));
+                if (!ofs) err = fetch_result::failed;
+            }
+            return err == fetch_result::downloaded;
+        };
+        zstd_stream unzst;
+        std::vector<char> buf(1 << 16);
+        for (;;) {
+            size_t got = 0;
+            if (!r.read(buf.data(), buf.size(), got)) return fetch_result::failed;
+            if (got == 0) break;
+            wire += got;
+            // the cap is on what we pull off the network, not what it decodes to
+            pace.take(got);
+            const bool ok = coding == body_coding::zstd ? unzst.feed({ buf.data(), got }, take) : take(buf.data(), got);
+            if (!ok) return err != fetch_result::downloaded ? err : fetch_result::failed;
+        }
+        ofs.flush();
+        if (!ofs) return fetch_result::failed;
+        // connection dropped early or the server lied about the length
+        if (coding == body_coding::zstd && !unzst.complete()) return fetch_result::size_mismatch;
+        if ((plain && length && total != *length) || (opts.expected_size && total != opts.expected_size)) return fetch_result::size_mismatch;
+        // the transport decodes gzip before we see it, so the header is all there is to go on for those
+        if (coding == body_coding::decoded) wire = length.value_or(wire);
+        g_bytes += total;
+        g_wire += wire;
+        trace_counter("downloaded bytes", static_cast<long long>(total));
+        trace_counter("downloaded wire bytes", static_cast<long long>(wire));
+        digest = h.finish();
+        return fetch_result::downloaded;
+    }
+
+    // reads a 200 body into dst and records the validators that came with it
+    [[nodiscard]] fetch_result take_full_body(http_response& r, const fs::path& dst, fetch_state& state, const fetch_options& opts,
+                                              const body_coding coding) {
+        const fs::path parent = dst.parent_path();
+        std::error_code ec;
+        if (!parent.empty()) fs::create_directories(parent, ec);
+        sha256_digest digest{};
+        if (const fetch_result res = read_body_to_file(r, dst, opts, coding, digest); res != fetch_result::downloaded) return res;
+
+        state.etag = r.header(http_header::etag);
+        state.last_modified = r.header(http_header::last_modified);
+        state.final_url = r.url;
+        state.sha256 = to_hex(digest);
+        state.size = fs::file_size(dst, ec);
+        return fetch_result::downloaded;
+    }
+
+    // total size out of "Content-Range: bytes 0-0/12345"
+    [[nodiscard]] std::optional<unsigned long long> content_range_total(const http_response& r) {
+        const wstr v = r.header(http_header::content_range);
+        const auto slash = v.find(L'/');
+        if (slash == wstr::npos || slash + 1 >= v.size() || v[slash + 1] == L'*') return std::nullopt;
+        return std::wcstoull(v.c_str() + slash + 1, nullptr, 10);
+    }
+
+    // "sha-256=:<base64>:" (Repr-Digest) or "SHA-256=<base64>" (Digest), possibly among other algorithms.
+    // uppercase hex like sha256_file, empty if theres no sha-256 in there
+    [[nodiscard]] std::string sha256_from_digest_header(const std::wstring_view v) {
+        static constexpr std::string_view B64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (size_t at = 0; at < v.size();) {
+            size_t end = v.find(L',', at);
+            if (end == std::wstring_view::npos) end = v.size();
+            std::wstring_view item = v.substr(at, end - at);
+            at = end + 1;
+            while (!item.empty() && item.front() == L' ') item.remove_prefix(1);
+            const auto eq = item.find(L'=');
+            if (eq == std::wstring_view::npos) continue;
+            const std::wstring_view alg = item.substr(0, eq);
+            if (alg.size() != 7 || !std::equal(alg.begin(), alg.end(), L"sha-256", [](const wchar_t a, const wchar_t b) {
+                    return (a | 0x20) == b;
+                })) {
+                continue;
+            }
+            std::wstring_view val = item.substr(eq + 1);
+            if (val.starts_with(L':')) val.remove_prefix(1);
+            if (val.ends_with(L':')) val.remove_suffix(1);
+            std::vector<unsigned char> bytes;
+            unsigned acc = 0;
+            int bits = 0;
+            for (const wchar_t c : val) {
+                if (c == L'=') break;
+                const auto idx = c < 128 ? B64.find(static_cast<char>(c)) : std::string_view::npos;
+                if (idx == std::string_view::npos) return {};
+                acc = (acc << 6) | static_cast<unsigned>(idx);
+                bits += 6;
+                if (bits >= 8) {
+                    bits -= 8;
+                    bytes.push_back(static_cast<unsigned char>(acc >> bits));
+                }
+            }
+            return bytes.size() == 32 ? to_hex(bytes) : std::string{};
+        }
+        return {};
+    }
+
+    [[nodiscard]] std::string published_digest(const http_response& r) {
+        if (auto d = sha256_from_digest_header(r.header(http_header::repr_digest)); !d.empty()) return d;
+        return sha256_from_digest_header(r.header(http_header::digest));
+    }
+
+    // <url>.sha256 in sha256sum format ("<hex>  <name>"), what release pages usually publish next to the artifact.
+    // a 404 or anything that doesnt start with 64 hex digits just means there isnt one
+    [[nodiscard]] std::string sidecar_digest(const wchar_t* url) {
+        TRACE_SCOPE("sidecar_digest");
+        http_request req = get_request(wstr(url) + L".sha256", L"");
+        req.attempts = 1;
+        auto r = http_send(req);
+        std::string body;
+        if (!r || r->status != 200 || !r->read_all(body, 4096) || body.size() < 64) return {};
+        std::string hex = body.substr(0, 64);
+        for (char& c : hex) {
+            if (!std::isxdigit(static_cast<unsigned char>(c))) return {};
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        return hex;
+    }
+
+    // sidecar journal for ranged downloads. first line pins what the ranges belong to,
+    // then one "done <index>" line gets appended per finished chunk
+    struct journal {
+        fs::path path;
+        std::mutex lock;
+        std::ofstream out;
+
+        [[nodiscard]] static std::string header(const unsigned long long size, const unsigned long long chunk, const wstr& etag) {
+            return "v1 " + std::to_string(size) + " " + std::to_string(chunk) + " " + narrow_utf8(etag).value_or("");
+        }
+
+        // returns the chunks a previous run already finished, empty if the journal is for something else
+        [[nodiscard]] std::vector<bool> load(const std::string& expectHeader, const size_t chunks) const {
+            std::vector<bool> done(chunks, false);
+            std::ifstream in(path);
+            std::string line;
+            if (!in || !std::getline(in, line) || line != expectHeader) return std::vector<bool>(chunks, false);
+            while (std::getline(in, line)) {
+                if (!line.starts_with("done ")) continue;
+                if (const unsigned long long idx = std::strtoull(line.c_str() + 5, nullptr, 10); idx < chunks) done[idx] = true;
+            }
+            return done;
+        }
+
+        [[nodiscard]] bool start(const std::string& hdr, const bool resume) {
+            out.open(path, resume ? std::ios::app : std::ios::trunc);
+            if (!out) return false;
+            if (!resume) out << hdr << "\n";
+            out.flush();
+            return static_cast<bool>(out);
+        }
+
+        void mark_done(const size_t idx) {
+            std::scoped_lock lk(lock);
+            out << "done " << idx << "\n";
+            out.flush();
+        }
+    };
+
+    // fetches [first, last] of url into file at the same offset. If-Range makes the server send the whole
+    // thing (200) instead of 206 if the artifact changed under us, which we treat as a failure
+    [[nodiscard]] bool fetch_range(const wstr& url, const wstr& etag, positional_file& file,
+                                   const unsigned long long first, const unsigned long long last, rate_limit& pace) {
+        TRACE_SCOPE("fetch_range");
+        wstr headers = L"Range: bytes=" + std::to_wstring(first) + L"-" + std::to_wstring(last) + L"\r\n";
+        if (!etag.empty()) headers += L"If-Range: " + etag + L"\r\n";
+        auto r = http_send(get_request(url, std::move(headers)));
+        if (!r || r->status != 206) return false;
+
+        std::vector<char> buf(1 << 16);
+        unsigned long long off = first;
+        for (;;) {
+            size_t got = 0;
+            if (!r->read(buf.data(), buf.size(), got)) return false;
+            if (got == 0) break;
+            if (off + got > last + 1) return false;
+            pace.take(got);
+            if (!file.write_at(off, buf.data(), got)) return false;
+            g_bytes += got;
+            g_wire += got;
+            off += got;
+        }
+        return off == last + 1;
+    }
+
+    // <url>.zst is the same artifact compressed ahead of time, a 404 just means nobody published one. the
+    // validators come from the probe of the plain url, which happened first, so if the release changes in
+    // between the worst case is downloading it again next time
+    [[nodiscard]] fetch_result fetch_precompressed(const wchar_t* url, const fs::path& dst, fetch_state& state,
+                                                   const http_response& probe, const fetch_options& opts) {
+        TRACE_SCOPE("fetch_precompressed");
+        const wstr etag = probe.header(http_header::etag);
+        // a 404 is remembered against the build it was for, retries of that build dont need to ask again
+        fs::path absent = dst;
+        absent += L".nozst";
+        const std::string etagBytes = narrow_utf8(etag).value_or("");
+        if (!etag.empty() && read_file_bytes(absent) == etagBytes) return fetch_result::failed;
+
+        const wstr zstUrl = wstr(url) + L".zst";
+        http_request req = get_request(zstUrl, accept_encoding());
+        req.decompress = true;
+        auto r = http_send(req);
+        if (!r) return fetch_result::failed;
+        if (r->status == 404 && !etag.empty()) (void)write_file_atomic(absent, etagBytes);
+        if (r->status != 200) return fetch_result::failed;
+
+        // decoded next to dst and only moved over it once the whole frame checked out, a corrupt or short
+        // .zst must not leave a half written dst behind for the fallback (or the next resume) to trip over
+        fs::path part = dst;
+        part += L".zst.part";
+        fetch_state zst;
+        std::error_code ec;
+        if (const fetch_result res = take_full_body(*r, part, zst, opts, coding_of(zstUrl, *r)); res != fetch_result::downloaded) {
+            fs::remove(part, ec);
+            return res;
+        }
+        fs::rename(part, dst, ec);
+        if (ec) {
+            fs::remove(part, ec);
+            return fetch_result::failed;
+        }
+        state.etag = etag;
+        state.last_modified = probe.header(http_header::last_modified);
+        state.final_url = probe.url;
+        state.sha256 = zst.sha256;
+        state.size = zst.size;
+        return fetch_result::downloaded;
+    }
+} // anon namespace
+
+[[nodiscard]] fetch_result fetch_to_file(const wchar_t* url, const fs::path& dst, fetch_state& state, const fetch_options& opts) {
+    TRACE_SCOPE("fetch_to_file");
+    http_request req = get_request(url, conditional_headers(state) + accept_encoding());
+    req.decompress = true;
+    auto r = http_send(req);
+    if (!r) return fetch_result::failed;
+    if (r->status == 304) return fetch_result::not_modified;
+    if (r->status != 200) return fetch_result::failed;
+    return take_full_body(*r, dst, state, opts, coding_of(url, *r));
+}
+
+[[nodiscard]] fetch_result probe_remote(const wchar_t* url, const fetch_state& state, fetch_state& fresh) {
+    TRACE_SCOPE("probe_remote");
+    auto r = http_send(get_request(url, L"Range: bytes=0-0\r\n" + conditional_headers(state)));
+    if (!r) return fetch_result::failed;
+    if (r->status == 304) return fetch_result::not_modified;
+    if (r->status != 200 && r->status != 206) return fetch_result::failed;
+    fresh.etag = r->header(http_header::etag);
+    fresh.last_modified = r->header(http_header::last_modified);
+    // a 200 means the range was ignored, then content-length is the whole thing (unless its encoded)
+    if (r->status == 206) fresh.size = content_range_total(*r).value_or(0);
+    else fresh.size = r->header(http_header::content_encoding).empty() ? r->content_length().value_or(0) : 0;
+    fresh.sha256 = published_digest(*r);
+    // drain the byte so the socket goes back to the pool for the download that usually follows
+    std::string rest;
+    (void)r->read_all(rest, 16);
+    fresh.final_url = r->url;
+    if (fresh.sha256.empty()) fresh.sha256 = sidecar_digest(url);
+    return fetch_result::downloaded;
+}
+
+[[nodiscard]] fetch_result fetch_ranged_to_file(const wchar_t* url, const fs::path& dst, fetch_state& state, const ranged_options& opts) {
+    TRACE_SCOPE("fetch_ranged_to_file");
+    // probe with a 1 byte range instead of a HEAD, signed object store urls are usually only valid for GET.
+    // a 206 tells us ranges work and the total size, a 200 means the server ignored the range so we just take the body
+    auto probe = http_send(get_request(url, L"Range: bytes=0-0\r\n" + conditional_headers(state)));
+    if (!probe) return fetch_result::failed;
+    if (probe->status == 304) return fetch_result::not_modified;
+    // single stream results still have to match the digest we were told to expect
+    const auto checked = [&](const fetch_result res) {
+        if (res == fetch_result::downloaded && !opts.expected_sha256.empty() && state.sha256 != opts.expected_sha256) {
+            std::error_code ec;
+            fs::remove(dst, ec);
+            return fetch_result::hash_mismatch;
+        }
+        return res;
+    };
+    // ranges never go through content decoding, so this body is exactly what the server has
+    if (probe->status == 200) return checked(take_full_body(*probe, dst, state, opts.limits, body_coding::plain));
+    if (probe->status != 206) return fetch_result::failed;
+
+    // the compressed copy is a fraction of the bytes, worth the one extra request it costs when there isnt one.
+    // not when a ranged download is half done though, finishing that is cheaper than starting over
+    fs::path journalPath = dst;
+    journalPath += L".journal";
+    if (std::error_code ec; zstd_available() && !fs::exists(journalPath, ec)) {
+        if (const fetch_result res = fetch_precompressed(url, dst, state, *probe, opts.limits); res == fetch_result::downloaded) {
+            return checked(res);
+        }
+    }
+
+    const auto length = content_range_total(*probe);
+    const wstr etag = probe->header(http_header::etag);
+    std::string probeByte;
+    (void)probe->read_all(probeByte, 16);
+    const unsigned long long chunk = opts.chunk_size ? opts.chunk_size : 1;
+    if (!length) return fetch_result::failed;
+    if (opts.limits.max_bytes && *length > opts.limits.max_bytes) return fetch_result::too_large;
+    if (opts.limits.expected_size && *length != opts.limits.expected_size) return fetch_result::size_mismatch;
+    const unsigned long long minSize = opts.min_size ? opts.min_size : 2 * chunk;
+    if (*length < minSize || opts.connections < 2) {
+        // small enough that splitting it up costs more than it saves
+        return checked(fetch_to_file(url, dst, state, opts.limits));
+    }
+
+    const unsigned long long size = *length;
+    const size_t chunks = static_cast<size_t>((size + chunk - 1) / chunk);
+
+    const fs::path parent = dst.parent_path();
+    std::error_code ec;
+    if (!parent.empty()) fs::create_directories(parent, ec);
+
+    journal j;
+    j.path = journalPath;
+    const std::string hdr = journal::header(size, chunk, etag);
+    // no etag means we cant tell if the artifact changed, so never resume without one
+    std::vector<bool> done = etag.empty() ? std::vector<bool>(chunks, false) : j.load(hdr, chunks);
+    bool resume = false;
+    for (const bool d : done) resume = resume || d;
+    if (resume && fs::file_size(dst, ec) != size) {
+        done.assign(chunks, false);
+        resume = false;
+    }
+
+    positional_file file = open_positional(dst, size, resume);
+    if (!file || !j.start(hdr, resume)) return fetch_result::failed;
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<bool> failed{ false };
+    rate_limit pace(opts.limits.max_bytes_per_sec);
+    const wstr rangeUrl = probe->url;
+    const auto worker = [&] {
+        for (size_t idx = next++; idx < chunks && !failed; idx = next++) {
+            if (done[idx]) continue;
+            const unsigned long long first = idx * chunk;
+            const unsigned long long last = (first + chunk < size ? first + chunk : size) - 1;
+            bool ok = false;
+            for (int attempt = 0; attempt < CHUNK_ATTEMPTS && !ok && !failed; ++attempt) {
+                ok = fetch_range(rangeUrl, etag, file, first, last, pace);
+            }
+            if (!ok) {
+                failed = true;
+                return;
+            }
+            j.mark_done(idx);
+        }
+    };
+    {
+        std::vector<std::jthread> pool;
+        const int n = opts.connections < static_cast<int>(chunks) ? opts.connections : static_cast<int>(chunks);
+        for (int i = 0; i < n; ++i) pool.emplace_back(worker);
+    }
+    file = {};
+    j.out.close();
+    // on failure leave the file and journal alone so the next run picks up where we stopped
+    if (failed) return fetch_result::failed;
+
+    const auto digest = sha256_of_mapped_file(dst);
+    if (!digest) return fetch_result::failed;
+    const std::string hex = to_hex(*digest);
+    fs::remove(j.path, ec);
+    if (!opts.expected_sha256.empty() && hex != opts.expected_sha256) {
+        fs::remove(dst, ec);
+        return fetch_result::hash_mismatch;
+    }
+
+    state.etag = etag;
+    state.last_modified = probe->header(http_header::last_modified);
+    state.final_url = probe->url;
+    state.sha256 = hex;
+    state.size = size;
+    return fetch_result::downloaded;
+}
+
+[[nodiscard]] download_counters download_get_counters() {
+    return { g_bytes.load(), g_wire.load() };
+}
+
+[[nodiscard]] std::optional<fetch_state> load_fetch_state(const fs::path& p) {
+    const auto txt = read_file_bytes(p);
+    if (!txt) return std::nullopt;
+    fetch_state s;
+    std::istringstream in(*txt);
+    // plain key=value lines, everything in here is ascii (header values and urls)
+    for (std::string line; std::getline(in, line); ) {
+        const auto eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        const std::string key = line.substr(0, eq);
+        const std::string val = line.substr(eq + 1);
+        if (key == "etag") s.etag = widen_utf8(val).value_or(L"");
+        else if (key == "last_modified") s.last_modified = widen_utf8(val).value_or(L"");
+        else if (key == "final_url") s.final_url = widen_utf8(val).value_or(L"");
+        else if (key == "sha256") s.sha256 = val;
+        else if (key == "size") s.size = std::strtoull(val.c_str(), nullptr, 10);
+    }
+    return s;
+}
+
+[[nodiscard]] bool save_fetch_state(const fs::path& p, const fetch_state& s) {
+    std::string out;
+    out += "etag=" + narrow_utf8(s.etag).value_or("") + "\n";
+    out += "last_modified=" + narrow_utf8(s.last_modified).value_or("") + "\n";
+    out += "final_url=" + narrow_utf8(s.final_url).value_or("") + "\n";
+    out += "sha256=" + s.sha256 + "\n";
+    out += "size=" + std::to_string(s.size) + "\n";
+    return write_file_atomic(p, out);
+}
\ No newline at end of file
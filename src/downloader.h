@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common.h"
+
+// validators from the last good download so the next check can be conditional
+struct fetch_state {
+    wstr etag;
+    wstr last_modified;
+    // where the redirect chain ended up last time (github latest/download bounces through 2 hops)
+    wstr final_url;
+    // digest of the body we got back then, validators are only trusted while the installed file still matches it.
+    // after a probe its the digest the server publishes for the new body instead, empty if it doesnt
+    std::string sha256;
+    // size of the whole body, 0 when we dont know
+    unsigned long long size = 0;
+};
+
+enum class fetch_result {
+    downloaded,
+    not_modified,
+    failed,
+    too_large,      // body went over fetch_options::max_bytes, we bailed as soon as we knew
+    size_mismatch,  // content-length (or expected_size) didnt match what actually arrived
+    hash_mismatch,  // ranged download finished but the digest isnt the one we were told to expect
+};
+
+struct fetch_options {
+    // 0 means no limit
+    unsigned long long max_bytes = 0;
+    // 0 means we dont know, otherwise the body has to be exactly this big
+    unsigned long long expected_size = 0;
+    // 0 means as fast as it comes, otherwise the cap for the whole download (all ranges together)
+    unsigned long long max_bytes_per_sec = 0;
+};
+
+// GETs url following redirects, sends If-None-Match / If-Modified-Since from state.
+// gzip/deflate (and zstd when built with it, or any url ending in .zst) bodies are decoded as they stream in,
+// and the decoded bytes are hashed while theyre written out so on downloaded state.sha256 is already filled in.
+// the size limits in opts apply to the decoded body. on not_modified dst is untouched, on any error dst may hold a partial body
+[[nodiscard]] fetch_result fetch_to_file(const wchar_t* url, const fs::path& dst, fetch_state& state, const fetch_options& opts = {});
+
+// cheap "did it change" check: a conditional 1 byte range GET through the redirect chain.
+// not_modified means state still holds, downloaded means it changed and fresh has the new validators, the new size
+// and the published digest (Repr-Digest / Digest header, or a <url>.sha256 sidecar) when there is one. hand those
+// to the download as expected_size / expected_sha256 so a body that doesnt match is never installed
+[[nodiscard]] fetch_result probe_remote(const wchar_t* url, const fetch_state& state, fetch_state& fresh);
+
+struct ranged_options {
+    int connections = 4;
+    unsigned long long chunk_size = 1ull << 20;
+    // anything smaller just goes through fetch_to_file, a single range isnt worth the extra handshakes.
+    // 0 means two chunks, so it follows --chunk-mb
+    unsigned long long min_size = 0;
+    // uppercase hex like sha256_file, empty means we just report whatever we got
+    std::string expected_sha256;
+    fetch_options limits;
+};
+
+// like fetch_to_file but splits the body into byte ranges fetched over several connections into a
+// preallocated dst. progress goes to a dst.journal sidecar so a dropped download resumes where it stopped
+// (only while the etag still matches). falls back to a single stream when the server doesnt do ranges.
+// with zstd built in, a pre-compressed <url>.zst is tried first and the ranges are only the fallback. thats
+// skipped while a journal exists, and a 404 for it is remembered per etag in dst.nozst
+[[nodiscard]] fetch_result fetch_ranged_to_file(const wchar_t* url, const fs::path& dst, fetch_state& state, const ranged_options& opts);
+
+struct download_counters {
+    unsigned long long bytes = 0;       // decoded body bytes written out, every download since start
+    unsigned long long wire_bytes = 0;  // what came over the network for them, smaller when the body was compressed
+};
+
+// same numbers the "downloaded bytes" / "downloaded wire bytes" trace counters show, plus what ranged chunks pulled
+[[nodiscard]] download_counters download_get_counters();
+
+[[nodiscard]] std::optional<fetch_state> load_fetch_state(const fs::path& p);
+[[nodiscard]] bool save_fetch_state(const fs::path& p, const fetch_state& s);
\ No newline at end of file
@@ -0,0 +1,31 @@
+#include "env_block.h"
+#include <map>
+
+[[nodiscard]] std::vector<wchar_t> merge_environment_block(const wchar_t* current, const std::vector<std::pair<wstr, wstr>>& overrides) {
+    std::map<wstr, wstr, std::less<>> env;
+    // copy current environment
+    if (current) {
+        for (const wchar_t* p = current; *p; ) {
+            const std::wstring_view entry = p;
+            p += entry.size() + 1;
+            if (const auto pos = entry.find(L'='); pos != std::wstring_view::npos && pos != 0) {
+                env.insert_or_assign(wstr(entry.substr(0, pos)), wstr(entry.substr(pos + 1)));
+            }
+        }
+    }
+    // apply our overrides
+    for (const auto& [k, v] : overrides) env[k] = v;
+    // build the environment block (null terminated strings followed by a final null). sized up front, its one allocation
+    size_t total = 1;
+    for (const auto& [k, v] : env) total += k.size() + v.size() + 2;
+    std::vector<wchar_t> out;
+    out.reserve(total);
+    for (const auto& [k, v] : env) {
+        out.insert(out.end(), k.begin(), k.end());
+        out.push_back(L'=');
+        out.insert(out.end(), v.begin(), v.end());
+        out.push_back(L'\0');
+    }
+    out.push_back(L'\0');
+    return out;
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "common.h"
+#include <utility>
+#include <vector>
+
+// merges overrides into an environment block in the GetEnvironmentStringsW layout (name=value strings, each null
+// terminated, then one more null) and returns the new block sorted by name. current can be null for an empty
+// environment. entries without a name (the =C:=C:\ drive ones) dont survive the trip
+[[nodiscard]] std::vector<wchar_t> merge_environment_block(const wchar_t* current, const std::vector<std::pair<wstr, wstr>>& overrides);
\ No newline at end of file
@@ -1,23 +1,91 @@
 #pragma once
 
 #include "common.h"
+#include "sha256.h"
+#include <chrono>
 #include <vector>
-#include <istream>
+#include <span>
+#include <string_view>
+
+// what the file wrappers below hold on to, a HANDLE on windows and an fd everywhere else
+#ifdef _WIN32
+using native_file = void*;
+inline constexpr native_file NO_FILE = nullptr;
+#else
+using native_file = int;
+inline constexpr native_file NO_FILE = -1;
+#endif
 
 // just trims trail slashes from paths cause windows is shit
 [[nodiscard]] wstr wtrim_trailing_slash(wstr s);
 
-// computes sha256 hash of a stream using bcrypt api
-[[nodiscard]] std::optional<std::vector<unsigned char>> sha256_bytes_of_stream(std::istream& is);
+// reads a whole file into memory in one go, returns nullopt if it cant be opened
+[[nodiscard]] std::optional<std::string> read_file_bytes(const fs::path& p);
+
+// writes to a temp file next to dst and renames it over dst so readers never see half a file
+[[nodiscard]] bool write_file_atomic(const fs::path& dst, std::string_view data);
+
+// %LOCALAPPDATA%\SpectreLauncher ($XDG_DATA_HOME/SpectreLauncher off windows), created on first use.
+// SPECTRE_DATA_DIR replaces it when set. falls back to the temp dir
+[[nodiscard]] fs::path get_launcher_data_dir();
+
+// what we key a cached digest on. if any of this changes the file gets rehashed
+struct file_identity {
+    unsigned long long size = 0;
+    unsigned long long mtime = 0;       // raw FILETIME of the last write (st_mtim in ns off windows)
+    unsigned long long volume = 0;      // volume serial (st_dev)
+    unsigned long long file_index = 0;  // ntfs file id (inode), survives renames but not rewrites-by-replace
+};
+
+// size/mtime/file id in one metadata call (GetFileInformationByHandle / stat)
+[[nodiscard]] std::optional<file_identity> get_file_identity(const fs::path& p);
+
+// hashes a file straight out of a read-only mapping, no copying into a stream buffer. if the mapping cant be
+// read (file truncated under us, network drive gone) it falls back to plain reads
+[[nodiscard]] std::optional<sha256_digest> sha256_of_mapped_file(const fs::path& p);
 
-// wrapper around sha256_bytes_of_stream that returns a hex string
+// uppercase hex, same format sha256_file has always returned
+[[nodiscard]] std::string to_hex(std::span<const unsigned char> bytes);
+
+// hashes a file and returns the digest as a hex string. unchanged files are answered from the hash cache
 [[nodiscard]] std::optional<std::string> sha256_file(const fs::path& p);
 
-// downloads a file from url to dst using urlmon (old school windows api lol)
-[[nodiscard]] bool download_to_file(const wchar_t* url, const fs::path& dst);
+// exclusive lock on a file shared by every launcher instance, released when this goes away (or the process dies)
+struct file_lock {
+    native_file h = NO_FILE;
+    file_lock() = default;
+    explicit file_lock(native_file v) : h(v) {}
+    file_lock(file_lock&& o) noexcept;
+    file_lock& operator=(file_lock&& o) noexcept;
+    ~file_lock();
+    explicit operator bool() const { return h != NO_FILE; }
+};
+
+// doesnt wait, an empty lock means someone else holds it
+[[nodiscard]] file_lock try_lock_file(const fs::path& p);
+
+// keeps trying for up to timeout, for locks that are only ever held for a moment. empty if it never came free
+[[nodiscard]] file_lock lock_file(const fs::path& p, std::chrono::milliseconds timeout);
+
+// a file several threads write into at once, each at its own offset (ranged downloads)
+struct positional_file {
+    native_file h = NO_FILE;
+    positional_file() = default;
+    explicit positional_file(native_file v) : h(v) {}
+    positional_file(positional_file&& o) noexcept;
+    positional_file& operator=(positional_file&& o) noexcept;
+    ~positional_file();
+    explicit operator bool() const { return h != NO_FILE; }
+
+    // all of data lands at offset or false
+    [[nodiscard]] bool write_at(unsigned long long offset, const char* data, size_t len);
+};
 
-// del everything in a directory but keeps the directory itself
-[[nodiscard]] bool clear_directory(const fs::path& dir);
+// dst as a copy-on-write clone of src, sharing its extents until either side is written (FICLONE on btrfs/xfs,
+// FSCTL_DUPLICATE_EXTENTS_TO_FILE on ReFS / Dev Drive). dst must not exist yet. false when the filesystem cant
+// do it (ntfs, ext4, across volumes), then nothing is left behind at dst and the caller copies instead
+[[nodiscard]] bool clone_file(const fs::path& src, const fs::path& dst);
 
-// generates a temp file path using a guid
-[[nodiscard]] wstr get_temp_file_guid();
\ No newline at end of file
+// creates p at exactly size bytes so every range can write straight to its offset. keep reopens what is
+// already there instead (resuming), the caller checked it has the right size. empty on failure
+[[nodiscard]] positional_file open_positional(const fs::path& p, unsigned long long size, bool keep);
\ No newline at end of file
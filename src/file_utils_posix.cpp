@@ -0,0 +1,185 @@
+#include "file_utils.h"
+#include "trace.h"
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+    std::atomic<unsigned> g_tmp_seq{ 0 };
+
+    [[nodiscard]] bool write_all(const int fd, const char* data, size_t len) {
+        while (len) {
+            const ssize_t n = ::write(fd, data, len);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+} // anon namespace
+
+[[nodiscard]] bool write_file_atomic(const fs::path& dst, const std::string_view data) {
+    std::error_code ec;
+    if (const fs::path parent = dst.parent_path(); !parent.empty()) fs::create_directories(parent, ec);
+    // a name nobody else is writing to, two writers sharing one temp file would truncate each others bytes
+    // and could rename a mix of both over dst
+    fs::path tmp;
+    int fd = -1;
+    for (int attempt = 0; fd < 0 && attempt < 16; ++attempt) {
+        tmp = dst;
+        tmp += "." + std::to_string(::getpid()) + "." + std::to_string(++g_tmp_seq) + ".tmp";
+        fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        // a leftover from a crashed run that had our pid, just take the next number
+        if (fd < 0 && errno != EEXIST) return false;
+    }
+    if (fd < 0) return false;
+    const bool ok = write_all(fd, data.data(), data.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp.c_str(), dst.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+[[nodiscard]] fs::path get_launcher_data_dir() {
+    fs::path dir;
+    if (const char* o = std::getenv("SPECTRE_DATA_DIR"); o && *o) {
+        dir = o;
+    } else if (const char* x = std::getenv("XDG_DATA_HOME"); x && *x) {
+        dir = fs::path(x) / "SpectreLauncher";
+    } else if (const char* home = std::getenv("HOME"); home && *home) {
+        dir = fs::path(home) / ".local" / "share" / "SpectreLauncher";
+    } else {
+        std::error_code ec;
+        dir = fs::temp_directory_path(ec) / "SpectreLauncher";
+    }
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    return dir;
+}
+
+[[nodiscard]] std::optional<file_identity> get_file_identity(const fs::path& p) {
+    struct stat st{};
+    if (::stat(p.c_str(), &st) != 0) return std::nullopt;
+    file_identity id;
+    id.size = static_cast<unsigned long long>(st.st_size);
+    id.mtime = static_cast<unsigned long long>(st.st_mtim.tv_sec) * 1'000'000'000ull + static_cast<unsigned long long>(st.st_mtim.tv_nsec);
+    id.volume = static_cast<unsigned long long>(st.st_dev);
+    id.file_index = static_cast<unsigned long long>(st.st_ino);
+    return id;
+}
+
+[[nodiscard]] std::optional<sha256_digest> sha256_of_mapped_file(const fs::path& p) {
+    TRACE_SCOPE("sha256_of_mapped_file");
+    // a mapping of a file that shrinks under us is a SIGBUS here, theres nothing like an in-page exception
+    // to catch it with. one big reused buffer gets within a few percent of the mapping anyway
+    const int fd = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return std::nullopt;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    thread_local std::vector<char> buf(1 << 20);
+    sha256 h;
+    for (;;) {
+        const ssize_t n = ::read(fd, buf.data(), buf.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            ::close(fd);
+            return std::nullopt;
+        }
+        if (n == 0) break;
+        h.update(buf.data(), static_cast<size_t>(n));
+    }
+    ::close(fd);
+    return h.finish();
+}
+
+file_lock& file_lock::operator=(file_lock&& o) noexcept {
+    if (this != &o) {
+        if (h != NO_FILE) ::close(h);
+        h = std::exchange(o.h, NO_FILE);
+    }
+    return *this;
+}
+
+file_lock::~file_lock() {
+    if (h != NO_FILE) ::close(h);
+}
+
+[[nodiscard]] file_lock try_lock_file(const fs::path& p) {
+    std::error_code ec;
+    if (const fs::path parent = p.parent_path(); !parent.empty()) fs::create_directories(parent, ec);
+    const int fd = ::open(p.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return {};
+    // flock goes with the open file, so the kernel drops it when we die
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        ::close(fd);
+        return {};
+    }
+    return file_lock(fd);
+}
+
+positional_file& positional_file::operator=(positional_file&& o) noexcept {
+    if (this != &o) {
+        if (h != NO_FILE) ::close(h);
+        h = std::exchange(o.h, NO_FILE);
+    }
+    return *this;
+}
+
+positional_file::~positional_file() {
+    if (h != NO_FILE) ::close(h);
+}
+
+[[nodiscard]] bool positional_file::write_at(unsigned long long offset, const char* data, size_t len) {
+    while (len) {
+        const ssize_t n = ::pwrite(h, data, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<unsigned long long>(n);
+    }
+    return true;
+}
+
+[[nodiscard]] positional_file open_positional(const fs::path& p, const unsigned long long size, const bool keep) {
+    const int fd = ::open(p.c_str(), keep ? O_RDWR | O_CLOEXEC : O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return {};
+    positional_file out(fd);
+    // preallocate so every range can just write at its own offset
+    if (!keep && ::ftruncate(fd, static_cast<off_t>(size)) != 0) return {};
+    return out;
+}
+
+[[nodiscard]] bool clone_file(const fs::path& src, const fs::path& dst) {
+#ifdef FICLONE
+    const int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    const int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+    const bool ok = ::ioctl(out, FICLONE, in) == 0;
+    ::close(in);
+    ::close(out);
+    if (!ok) ::unlink(dst.c_str());
+    return ok;
+#else
+    (void)src;
+    (void)dst;
+    return false;
+#endif
+}
\ No newline at end of file
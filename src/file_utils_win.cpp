@@ -0,0 +1,256 @@
+#include "file_utils.h"
+#include "trace.h"
+#include <windows.h>
+#include <winioctl.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+    std::atomic<unsigned> g_tmp_seq{ 0 };
+} // anon namespace
+
+[[nodiscard]] bool write_file_atomic(const fs::path& dst, const std::string_view data) {
+    std::error_code ec;
+    if (const fs::path parent = dst.parent_path(); !parent.empty()) fs::create_directories(parent, ec);
+    // a name nobody else is writing to, two writers sharing one temp file would truncate each others bytes
+    // and could rename a mix of both over dst
+    fs::path tmp;
+    HANDLE h = INVALID_HANDLE_VALUE;
+    for (int attempt = 0; h == INVALID_HANDLE_VALUE && attempt < 16; ++attempt) {
+        tmp = dst;
+        tmp += L"." + std::to_wstring(GetCurrentProcessId()) + L"." + std::to_wstring(++g_tmp_seq) + L".tmp";
+        h = CreateFileW(tmp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+        // a leftover from a crashed run that had our pid, just take the next number
+        if (h == INVALID_HANDLE_VALUE && GetLastError() != ERROR_FILE_EXISTS) return false;
+    }
+    if (h == INVALID_HANDLE_VALUE) return false;
+    DWORD written = 0;
+    const BOOL ok = WriteFile(h, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) &&
+                    written == data.size() && FlushFileBuffers(h);
+    CloseHandle(h);
+    if (!ok || !MoveFileExW(tmp.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileW(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+[[nodiscard]] fs::path get_launcher_data_dir() {
+    fs::path dir;
+    wchar_t buf[MAX_PATH];
+    if (const DWORD o = GetEnvironmentVariableW(L"SPECTRE_DATA_DIR", buf, MAX_PATH); o > 0 && o < MAX_PATH) {
+        dir = buf;
+    } else if (const DWORD n = GetEnvironmentVariableW(L"LOCALAPPDATA", buf, MAX_PATH); n > 0 && n < MAX_PATH) {
+        dir = fs::path(buf) / L"SpectreLauncher";
+    } else if (const DWORD t = GetTempPathW(MAX_PATH, buf); t > 0 && t <= MAX_PATH) {
+        dir = fs::path(buf) / L"SpectreLauncher";
+    } else {
+        dir = L".\\SpectreLauncher";
+    }
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    return dir;
+}
+
+[[nodiscard]] std::optional<file_identity> get_file_identity(const fs::path& p) {
+    // no access rights needed just to read the metadata
+    HANDLE h = CreateFileW(p.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                           OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return std::nullopt;
+    BY_HANDLE_FILE_INFORMATION info{};
+    const BOOL ok = GetFileInformationByHandle(h, &info);
+    CloseHandle(h);
+    if (!ok) return std::nullopt;
+
+    file_identity id;
+    id.size = (static_cast<unsigned long long>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    id.mtime = (static_cast<unsigned long long>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+    id.volume = info.dwVolumeSerialNumber;
+    id.file_index = (static_cast<unsigned long long>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    return id;
+}
+
+namespace {
+    // reading a mapped page can fault if the file shrinks or its volume goes away while we hash it. that surfaces
+    // as EXCEPTION_IN_PAGE_ERROR instead of a failed read, so this is the one spot we catch it. kept apart from
+    // anything with a destructor because __try cant live in a function that unwinds objects
+    [[nodiscard]] bool hash_view(sha256* h, const void* view, const size_t len) {
+#ifdef _MSC_VER
+        __try {
+            h->update(view, len);
+        } __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+            return false;
+        }
+#else
+        h->update(view, len);
+#endif
+        return true;
+    }
+
+    // the slow path for when the mapping didnt work out, plain sequential reads
+    [[nodiscard]] std::optional<sha256_digest> sha256_of_read_file(const fs::path& p) {
+        HANDLE file = CreateFileW(p.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return std::nullopt;
+        std::vector<char> buf(1 << 20);
+        sha256 h;
+        for (;;) {
+            DWORD got = 0;
+            if (!ReadFile(file, buf.data(), static_cast<DWORD>(buf.size()), &got, nullptr)) {
+                CloseHandle(file);
+                return std::nullopt;
+            }
+            if (got == 0) break;
+            h.update(buf.data(), got);
+        }
+        CloseHandle(file);
+        return h.finish();
+    }
+} // anon namespace
+
+[[nodiscard]] std::optional<sha256_digest> sha256_of_mapped_file(const fs::path& p) {
+    TRACE_SCOPE("sha256_of_mapped_file");
+    HANDLE file = CreateFileW(p.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return std::nullopt;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return std::nullopt;
+    }
+
+    sha256 h;
+    // cant map an empty file, its just the empty digest anyway
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return h.finish();
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) return std::nullopt;
+
+    // map in big windows so multi gb files dont need one giant view
+    constexpr unsigned long long VIEW = 256ull << 20;
+    const auto total = static_cast<unsigned long long>(size.QuadPart);
+    for (unsigned long long off = 0; off < total; off += VIEW) {
+        const size_t len = static_cast<size_t>(total - off < VIEW ? total - off : VIEW);
+        const void* view = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(off >> 32), static_cast<DWORD>(off), len);
+        if (!view) {
+            CloseHandle(mapping);
+            return std::nullopt;
+        }
+        const bool ok = hash_view(&h, view, len);
+        UnmapViewOfFile(view);
+        if (!ok) {
+            CloseHandle(mapping);
+            trace_counter("mapped hash fallbacks", 1);
+            return sha256_of_read_file(p);
+        }
+    }
+    CloseHandle(mapping);
+    return h.finish();
+}
+
+file_lock& file_lock::operator=(file_lock&& o) noexcept {
+    if (this != &o) {
+        if (h) CloseHandle(h);
+        h = std::exchange(o.h, NO_FILE);
+    }
+    return *this;
+}
+
+file_lock::~file_lock() {
+    if (h) CloseHandle(h);
+}
+
+[[nodiscard]] file_lock try_lock_file(const fs::path& p) {
+    std::error_code ec;
+    if (const fs::path parent = p.parent_path(); !parent.empty()) fs::create_directories(parent, ec);
+    // no sharing at all, so a second open fails for as long as we hold the handle
+    HANDLE h = CreateFileW(p.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return {};
+    return file_lock(h);
+}
+
+positional_file& positional_file::operator=(positional_file&& o) noexcept {
+    if (this != &o) {
+        if (h) CloseHandle(h);
+        h = std::exchange(o.h, NO_FILE);
+    }
+    return *this;
+}
+
+positional_file::~positional_file() {
+    if (h) CloseHandle(h);
+}
+
+[[nodiscard]] bool positional_file::write_at(const unsigned long long offset, const char* data, const size_t len) {
+    OVERLAPPED ov{};
+    ov.Offset = static_cast<DWORD>(offset);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD written = 0;
+    return WriteFile(h, data, static_cast<DWORD>(len), &written, &ov) && written == len;
+}
+
+[[nodiscard]] positional_file open_positional(const fs::path& p, const unsigned long long size, const bool keep) {
+    HANDLE h = CreateFileW(p.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                           keep ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return {};
+    positional_file out(h);
+    // preallocate so every range can just write at its own offset
+    LARGE_INTEGER end{};
+    end.QuadPart = static_cast<LONGLONG>(size);
+    if (!keep && (!SetFilePointerEx(h, end, nullptr, FILE_BEGIN) || !SetEndOfFile(h))) return {};
+    return out;
+}
+
+[[nodiscard]] bool clone_file(const fs::path& src, const fs::path& dst) {
+    HANDLE in = CreateFileW(src.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (in == INVALID_HANDLE_VALUE) return false;
+    HANDLE out = CreateFileW(dst.c_str(), GENERIC_READ | GENERIC_WRITE | DELETE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (out == INVALID_HANDLE_VALUE) {
+        CloseHandle(in);
+        return false;
+    }
+
+    // only ReFS answers this, and it gives us the cluster size the duplicated ranges have to be aligned to.
+    // the integrity setting has to match on both sides or the duplicate is refused
+    FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity{};
+    DWORD got = 0;
+    LARGE_INTEGER size{};
+    bool ok = DeviceIoControl(in, FSCTL_GET_INTEGRITY_INFORMATION, nullptr, 0, &integrity, sizeof(integrity), &got, nullptr) &&
+              integrity.ClusterSizeInBytes && GetFileSizeEx(in, &size);
+    if (ok && integrity.ChecksumAlgorithm != 0) {
+        FSCTL_SET_INTEGRITY_INFORMATION_BUFFER set{ integrity.ChecksumAlgorithm, 0, integrity.Flags };
+        ok = DeviceIoControl(out, FSCTL_SET_INTEGRITY_INFORMATION, &set, sizeof(set), nullptr, 0, &got, nullptr);
+    }
+    if (ok) {
+        FILE_END_OF_FILE_INFO eof{ size };
+        ok = SetFileInformationByHandle(out, FileEndOfFileInfo, &eof, sizeof(eof));
+    }
+    // the last cluster may run past the end of the file, the end of file set above still holds
+    const long long cluster = integrity.ClusterSizeInBytes;
+    const long long total = ok ? (size.QuadPart + cluster - 1) / cluster * cluster : 0;
+    for (long long off = 0; ok && off < total;) {
+        const long long n = std::min<long long>(total - off, 1ll << 30);
+        DUPLICATE_EXTENTS_DATA dx{};
+        dx.FileHandle = in;
+        dx.SourceFileOffset.QuadPart = off;
+        dx.TargetFileOffset.QuadPart = off;
+        dx.ByteCount.QuadPart = n;
+        ok = DeviceIoControl(out, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &dx, sizeof(dx), nullptr, 0, &got, nullptr);
+        off += n;
+    }
+    if (!ok) {
+        FILE_DISPOSITION_INFO gone{ TRUE };
+        (void)SetFileInformationByHandle(out, FileDispositionInfo, &gone, sizeof(gone));
+    }
+    CloseHandle(in);
+    CloseHandle(out);
+    return ok;
+}
\ No newline at end of file
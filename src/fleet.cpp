@@ -0,0 +1,199 @@
+#include "fleet.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "utf.h"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+
+namespace {
+    using steady = std::chrono::steady_clock;
+
+    [[nodiscard]] double ms_between(const steady::time_point a, const steady::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    }
+
+    [[nodiscard]] const char* outcome_name(const fleet_outcome o) {
+        switch (o) {
+            case fleet_outcome::pending:       return "pending";
+            case fleet_outcome::spawn_failed:  return "spawn failed";
+            case fleet_outcome::exited:        return "exited";
+            case fleet_outcome::timed_out:     return "timed out";
+            case fleet_outcome::submit_failed: return "submit failed";
+            case fleet_outcome::submitted:     return "submitted";
+            case fleet_outcome::stopped:       return "stopped";
+        }
+        return "?";
+    }
+
+    [[nodiscard]] double percentile(std::vector<double> v, const double p) {
+        if (v.empty()) return 0;
+        std::ranges::sort(v);
+        return v[static_cast<size_t>(p * static_cast<double>(v.size() - 1) + 0.5)];
+    }
+} // anon namespace
+
+[[nodiscard]] std::optional<std::vector<fleet_member>> parse_fleet_list(const std::string_view text) {
+    std::vector<fleet_member> out;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+
+        if (const auto hash = line.find('#'); hash != std::string_view::npos) line = line.substr(0, hash);
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) line.remove_suffix(1);
+        while (!line.empty() && (line.front() == ' ' || line.front() == '\t')) line.remove_prefix(1);
+        if (line.empty()) continue;
+
+        const size_t idEnd = std::min(line.find_first_of(" \t"), line.size());
+        const std::string_view id = line.substr(0, idEnd);
+        if (id.size() != 17 || id.find_first_not_of("0123456789") != std::string_view::npos) return std::nullopt;
+        std::string_view rest = line.substr(idEnd);
+        while (!rest.empty() && (rest.front() == ' ' || rest.front() == '\t')) rest.remove_prefix(1);
+
+        auto wid = widen_utf8(id);
+        auto args = widen_utf8(rest);
+        if (!wid || !args) return std::nullopt;
+        out.push_back({ std::move(*wid), std::move(*args) });
+    }
+    return out;
+}
+
+[[nodiscard]] std::vector<fleet_result> run_fleet(fleet_host& host, const std::vector<fleet_member>& members, const fleet_options& opts,
+                                                  const std::stop_token stop) {
+    TRACE_SCOPE("run_fleet");
+    std::vector<fleet_result> results(members.size());
+    std::vector<steady::time_point> spawned(members.size());
+    // spawned and not seen gone yet, triggered ones included. what a shutdown has to kill
+    std::vector<char> alive(members.size(), 0);
+    // written by the submit workers, read by the supervisor only after wait_idle
+    std::mutex resultLock;
+    thread_pool submitters(std::max<size_t>(opts.submitters, 1));
+
+    std::vector<size_t> starting;
+    // members waiting out their backoff, with when they may go again
+    std::vector<std::pair<steady::time_point, size_t>> retries;
+    size_t next = 0;
+    // so the first one goes right away (time_point::min would overflow the subtraction below)
+    auto lastSpawn = steady::now() - opts.stagger;
+    const size_t maxStarting = std::max<size_t>(opts.max_starting, 1);
+
+    // exited or timed out before the trigger: another go after the backoff, or that was the last one
+    const auto failed = [&](const size_t i, const fleet_outcome o, const steady::time_point now) {
+        alive[i] = 0;
+        std::erase(starting, i);
+        host.release(i);
+        fleet_result& r = results[i];
+        if (r.restarts >= opts.restarts) {
+            r.outcome = o;
+            return;
+        }
+        const std::chrono::milliseconds backoff = std::min<std::chrono::milliseconds>(opts.backoff * (1ll << std::min(r.restarts, 20u)), opts.max_backoff);
+        ++r.restarts;
+        retries.emplace_back(now + backoff, i);
+    };
+    const auto firstRetry = [&] { return std::ranges::min_element(retries); };
+
+    while (next < members.size() || !starting.empty() || !retries.empty()) {
+        if (stop.stop_requested()) break;
+        auto now = steady::now();
+        // at most one spawn per round, the stagger is the whole point. restarts that are due go before new members
+        if (starting.size() < maxStarting && now - lastSpawn >= opts.stagger) {
+            std::optional<size_t> pick;
+            if (const auto r = firstRetry(); r != retries.end() && r->first <= now) {
+                pick = r->second;
+                retries.erase(r);
+            } else if (next < members.size()) {
+                pick = next++;
+            }
+            if (pick) {
+                const size_t i = *pick;
+                lastSpawn = now;
+                if (host.spawn(i, members[i])) {
+                    spawned[i] = now;
+                    alive[i] = 1;
+                    starting.push_back(i);
+                } else {
+                    // a spawn that fails once fails again, no point backing off for it
+                    results[i].outcome = fleet_outcome::spawn_failed;
+                }
+            }
+        }
+
+        // sleep on the children themselves so an exit is noticed right away, but no longer than
+        // the next poll or the next spawn slot
+        auto wait = opts.poll;
+        if (starting.size() < maxStarting && (next < members.size() || !retries.empty())) {
+            auto at = lastSpawn + opts.stagger;
+            if (next >= members.size()) at = std::max(at, firstRetry()->first);
+            const auto untilSpawn = std::chrono::duration_cast<std::chrono::milliseconds>(at - now);
+            wait = std::clamp(untilSpawn, std::chrono::milliseconds(0), wait);
+        }
+        if (const auto gone = host.wait_exit(starting, wait)) failed(*gone, fleet_outcome::exited, steady::now());
+
+        now = steady::now();
+        for (size_t k = 0; k < starting.size(); ) {
+            const size_t i = starting[k];
+            if (host.triggered(i)) {
+                const auto fired = steady::now();
+                results[i].trigger_ms = ms_between(spawned[i], fired);
+                starting.erase(starting.begin() + static_cast<std::ptrdiff_t>(k));
+                submitters.submit([&, i, fired] {
+                    const bool ok = host.submit(i, members[i]);
+                    const double ms = ms_between(fired, steady::now());
+                    host.release(i);
+                    std::scoped_lock lk(resultLock);
+                    results[i].submit_ms = ms;
+                    results[i].outcome = ok ? fleet_outcome::submitted : fleet_outcome::submit_failed;
+                });
+                continue;
+            }
+            if (now - spawned[i] > opts.trigger_timeout) {
+                // left alone it would keep a starting slot busy forever and come up at some random point later
+                host.kill(i);
+                failed(i, fleet_outcome::timed_out, now);
+                continue;
+            }
+            ++k;
+        }
+    }
+
+    if (stop.stop_requested()) {
+        TRACE_SCOPE("fleet shutdown");
+        // the starting ones first, nothing but the supervisor touches those
+        for (const size_t i : starting) {
+            host.kill(i);
+            host.release(i);
+            alive[i] = 0;
+            results[i].outcome = fleet_outcome::stopped;
+        }
+        for (const auto& r : retries) results[r.second].outcome = fleet_outcome::stopped;
+        for (; next < members.size(); ++next) results[next].outcome = fleet_outcome::stopped;
+    }
+    submitters.wait_idle();
+    if (stop.stop_requested()) {
+        // and the ones in the game, once no submit is holding on to them
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (alive[i]) host.kill(i);
+        }
+    }
+    std::scoped_lock lk(resultLock);
+    return results;
+}
+
+void print_fleet_report(const std::vector<fleet_member>& members, const std::vector<fleet_result>& results) {
+    std::vector<double> triggers;
+    size_t ok = 0;
+    std::puts("  #  steamid            outcome         trigger ms   submit ms  restarts");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const fleet_result& r = results[i];
+        std::printf("%3zu  %-17s  %-14s  %10.0f  %10.1f  %8u\n", i, narrow_utf8(members[i].steam_id).value_or("?").c_str(),
+                    outcome_name(r.outcome), r.trigger_ms, r.submit_ms, r.restarts);
+        if (r.outcome == fleet_outcome::submitted || r.outcome == fleet_outcome::submit_failed) triggers.push_back(r.trigger_ms);
+        if (r.outcome == fleet_outcome::submitted) ++ok;
+    }
+    std::printf("%zu/%zu submitted, time to trigger p50 %.0f ms  p95 %.0f ms  max %.0f ms\n", ok, results.size(),
+                percentile(triggers, 0.5), percentile(triggers, 0.95), triggers.empty() ? 0.0 : std::ranges::max(triggers));
+}
\ No newline at end of file
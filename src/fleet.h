@@ -0,0 +1,82 @@
+#pragma once
+
+#include "common.h"
+#include <chrono>
+#include <stop_token>
+#include <string_view>
+#include <vector>
+
+// --fleet: launches one client per identity for load and soak tests against the backend. a single
+// supervisor thread watches every child for both exit and the trigger page, where a normal launch
+// would sit in one RunPageTrigger loop per client. the platform side sits behind fleet_host so the
+// supervisor itself doesnt care whether its children are real clients or stubs
+
+struct fleet_member {
+    wstr steam_id;
+    // appended to the usual backend args
+    wstr extra_args;
+};
+
+struct fleet_options {
+    // children still starting up (spawned, no trigger yet) at once. triggered ones dont count, they're
+    // just sitting in the game by then
+    size_t max_starting = 8;
+    std::chrono::milliseconds stagger{ 2000 };
+    // how often the trigger pages get checked, same job as trigger_wait_policy::max_interval_ms
+    std::chrono::milliseconds poll{ 25 };
+    std::chrono::milliseconds trigger_timeout{ std::chrono::minutes(10) };
+    // parallel provider id posts
+    size_t submitters = 4;
+    // how often a member that exits or times out before its trigger gets started again. a crash on startup
+    // under load is usually worth another go, a broken exe or arg list isnt worth more than a few
+    unsigned restarts = 2;
+    // wait before the first restart of a member, doubled for each one after that up to max_backoff
+    std::chrono::milliseconds backoff{ 5000 };
+    std::chrono::milliseconds max_backoff{ std::chrono::minutes(2) };
+};
+
+enum class fleet_outcome {
+    pending,
+    spawn_failed,
+    exited,         // went away before the trigger page showed up
+    timed_out,
+    submit_failed,
+    submitted,
+    stopped,        // still starting or waiting for a restart when the fleet was shut down
+};
+
+struct fleet_result {
+    fleet_outcome outcome = fleet_outcome::pending;
+    double trigger_ms = 0;  // spawn -> trigger page, as seen by the supervisor
+    double submit_ms = 0;   // trigger -> backend answered
+    unsigned restarts = 0;
+};
+
+// what the supervisor needs from the platform
+struct fleet_host {
+    virtual ~fleet_host() = default;
+    [[nodiscard]] virtual bool spawn(size_t i, const fleet_member& m) = 0;
+    // blocks until one of children exits or timeout passes. the index of the exited child, or nullopt
+    [[nodiscard]] virtual std::optional<size_t> wait_exit(const std::vector<size_t>& children, std::chrono::milliseconds timeout) = 0;
+    [[nodiscard]] virtual bool triggered(size_t i) = 0;
+    // tells the backend about child i. runs on a worker thread, not the supervisor
+    [[nodiscard]] virtual bool submit(size_t i, const fleet_member& m) = 0;
+    // done watching child i, it keeps running. can be called from a worker thread
+    virtual void release(size_t i) = 0;
+    // ends child i for good, whether it is still starting or was released already. a child that is gone
+    // by now is fine, same for one that was never spawned
+    virtual void kill(size_t i) = 0;
+};
+
+// one member per line: "<steamid64> [extra client args]". blank lines and # comments are skipped.
+// nullopt if a line doesnt start with a steamid or the text isnt utf8
+[[nodiscard]] std::optional<std::vector<fleet_member>> parse_fleet_list(std::string_view text);
+
+// spawns and supervises every member, returns once each one was submitted or failed. members that exit or
+// time out before their trigger get restarted up to opts.restarts times. a stop request kills the whole fleet,
+// the submitted ones included, and returns with whatever was still going marked stopped
+[[nodiscard]] std::vector<fleet_result> run_fleet(fleet_host& host, const std::vector<fleet_member>& members, const fleet_options& opts,
+                                                  std::stop_token stop = {});
+
+// per instance table plus a trigger time summary on stdout
+void print_fleet_report(const std::vector<fleet_member>& members, const std::vector<fleet_result>& results);
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "hash_cache.h"
+#include "bin_io.h"
+#include "file_utils.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace {
+    // file layout (little endian):
+    //   "SLHC" u16 version u16 reserved u32 count
+    //   count * { u64 size, u64 mtime, u64 volume, u64 file_index, u8[32] digest, u16 path_len, wchar_t[path_len] path }
+    //   u32 crc32 of everything above
+    inline constexpr char MAGIC[4] = { 'S', 'L', 'H', 'C' };
+    inline constexpr std::uint16_t VERSION = 1;
+    // we only ever hash a handful of files, this just stops temp files piling up forever
+    inline constexpr size_t MAX_ENTRIES = 256;
+
+    struct entry {
+        wstr path;
+        file_identity id;
+        sha256_digest digest;
+    };
+
+    std::mutex g_lock;
+    std::vector<entry> g_entries;
+    bool g_loaded = false;
+    std::atomic<bool> g_revalidate{ false };
+    std::atomic<unsigned long long> g_hits{ 0 };
+    std::atomic<unsigned long long> g_misses{ 0 };
+
+    [[nodiscard]] fs::path cache_file() {
+        return get_launcher_data_dir() / L"hashcache.bin";
+    }
+
+    // anything off (bad magic, old version, bad crc, truncated) just means we start with an empty cache
+    [[nodiscard]] std::vector<entry> load_entries() {
+        std::vector<entry> out;
+        const auto buf = read_file_bytes(cache_file());
+        if (!buf) return out;
+
+        bin_reader r{ *buf };
+        std::uint32_t count = 0;
+        if (!bin_open(r, MAGIC, VERSION) || !r.get(count) || count > MAX_ENTRIES) return out;
+
+        for (std::uint32_t i = 0; i < count; ++i) {
+            entry e;
+            if (!r.get(e.id.size) || !r.get(e.id.mtime) || !r.get(e.id.volume) || !r.get(e.id.file_index) ||
+                !r.get_bytes(e.digest.data(), e.digest.size()) || !r.get_wstr(e.path)) {
+                return {};
+            }
+            out.push_back(std::move(e));
+        }
+        if (r.pos != buf->size() - 4) return {};
+        return out;
+    }
+
+    [[nodiscard]] bool save_entries(const std::vector<entry>& entries) {
+        std::string out;
+        out.append(MAGIC, 4);
+        bin_put(out, VERSION);
+        bin_put(out, std::uint16_t{ 0 });
+        bin_put(out, static_cast<std::uint32_t>(entries.size()));
+        for (const auto& e : entries) {
+            bin_put(out, e.id.size);
+            bin_put(out, e.id.mtime);
+            bin_put(out, e.id.volume);
+            bin_put(out, e.id.file_index);
+            out.append(reinterpret_cast<const char*>(e.digest.data()), e.digest.size());
+            bin_put_wstr(out, e.path);
+        }
+        bin_seal(out);
+        return write_file_atomic(cache_file(), out);
+    }
+
+    void ensure_loaded() {
+        if (g_loaded) return;
+        g_entries = load_entries();
+        g_loaded = true;
+    }
+} // anon namespace
+
+[[nodiscard]] std::optional<sha256_digest> hash_cache_lookup(const fs::path& canonical, const file_identity& id) {
+    if (g_revalidate) {
+        ++g_misses;
+        return std::nullopt;
+    }
+    const wstr key = canonical.wstring();
+    std::scoped_lock lk(g_lock);
+    ensure_loaded();
+    for (const auto& e : g_entries) {
+        if (e.path == key && e.id.size == id.size && e.id.mtime == id.mtime &&
+            e.id.volume == id.volume && e.id.file_index == id.file_index) {
+            ++g_hits;
+            return e.digest;
+        }
+    }
+    ++g_misses;
+    return std::nullopt;
+}
+
+void hash_cache_store(const fs::path& canonical, const file_identity& id, const sha256_digest& digest) {
+    const wstr key = canonical.wstring();
+    std::scoped_lock lk(g_lock);
+    // other launcher instances (the prefetcher, a --verify run) write this file too. under the lock we start from
+    // whatever is on disk right now so their entries survive ours, and nobody writes in between
+    fs::path lockPath = cache_file();
+    lockPath += L".lock";
+    const file_lock disk = lock_file(lockPath, std::chrono::seconds(2));
+    if (disk) g_entries = load_entries();
+    else ensure_loaded();
+    g_loaded = true;
+    // only the entry being replaced is looked at, stale ones for files that are gone age out through MAX_ENTRIES
+    std::erase_if(g_entries, [&](const entry& e) { return e.path == key; });
+    g_entries.push_back({ key, id, digest });
+    if (g_entries.size() > MAX_ENTRIES) g_entries.erase(g_entries.begin(), g_entries.end() - MAX_ENTRIES);
+    // without the lock we keep it in memory for this run rather than clobber someone elses write
+    if (disk) (void)save_entries(g_entries);
+}
+
+void hash_cache_force_revalidate(const bool on) {
+    g_revalidate = on;
+}
+
+[[nodiscard]] hash_cache_counters hash_cache_get_counters() {
+    return { g_hits.load(), g_misses.load() };
+}
\ No newline at end of file
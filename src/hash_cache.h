@@ -0,0 +1,22 @@
+#pragma once
+
+#include "common.h"
+#include "file_utils.h"
+#include "sha256.h"
+
+struct hash_cache_counters {
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+};
+
+// returns the cached digest if the path is known and its identity still matches
+[[nodiscard]] std::optional<sha256_digest> hash_cache_lookup(const fs::path& canonical, const file_identity& id);
+
+// remembers a digest and rewrites the cache file (atomically, via temp + rename), merged with what other
+// instances wrote since we loaded it
+void hash_cache_store(const fs::path& canonical, const file_identity& id, const sha256_digest& digest);
+
+// when set every lookup misses so everything gets rehashed (and the cache refreshed)
+void hash_cache_force_revalidate(bool on);
+
+[[nodiscard]] hash_cache_counters hash_cache_get_counters();
\ No newline at end of file
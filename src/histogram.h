@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+
+// hdr style latency histogram over microseconds. values below 128 get a bucket each, above that every
+// power of two is split into 64 buckets, so anything up to ~25 days lands within 1.6% of its real value
+// in a fixed 18kb. one per thread and merge at the end, recording never touches shared state
+struct latency_histogram {
+    static constexpr int SUB = 64;
+    static constexpr int BUCKETS = SUB * 36;
+
+    std::array<std::uint64_t, BUCKETS> counts{};
+    std::uint64_t total = 0;
+    std::uint64_t max = 0;
+
+    [[nodiscard]] static int bucket_of(const std::uint64_t us) {
+        if (us < 2 * SUB) return static_cast<int>(us);
+        const int shift = std::bit_width(us) - 7;  // leaves us >> shift in [64, 128)
+        return std::min(shift * SUB + static_cast<int>(us >> shift), BUCKETS - 1);
+    }
+
+    // largest value that lands in bucket b
+    [[nodiscard]] static std::uint64_t upper_of(const int b) {
+        if (b < 2 * SUB) return static_cast<std::uint64_t>(b);
+        const int shift = b / SUB - 1;
+        return ((static_cast<std::uint64_t>(b - shift * SUB) + 1) << shift) - 1;
+    }
+
+    void record(const std::uint64_t us) {
+        ++counts[static_cast<size_t>(bucket_of(us))];
+        ++total;
+        max = std::max(max, us);
+    }
+
+    void merge(const latency_histogram& o) {
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += o.counts[i];
+        total += o.total;
+        max = std::max(max, o.max);
+    }
+
+    // p in [0, 1]. reports the top of the bucket so it never understates
+    [[nodiscard]] std::uint64_t percentile(const double p) const {
+        if (!total) return 0;
+        const auto rank = static_cast<std::uint64_t>(p * static_cast<double>(total - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen += counts[static_cast<size_t>(b)];
+            if (seen >= rank) return std::min(upper_of(b), max);
+        }
+        return max;
+    }
+};
\ No newline at end of file
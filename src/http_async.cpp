@@ -0,0 +1,455 @@
+#include "http_async.h"
+#include "http_async_io.h"
+#include "http_transport.h"
+#include "trace.h"
+#include "utf.h"
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// the sockets and the poller live in http_async_win.cpp / http_async_posix.cpp, everything here is just
+// bytes in, bytes out and a state machine per request
+
+namespace {
+    using steady = std::chrono::steady_clock;
+
+    inline constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+    // backend replies are a few hundred bytes, this is only there so a broken server cant eat all our memory
+    inline constexpr size_t MAX_BODY_BYTES = 64ull << 20;
+    // how long a wait can go without us looking at the deadlines
+    inline constexpr auto MAX_WAIT = std::chrono::milliseconds(250);
+
+    enum class phase { connecting, sending, receiving };
+    enum class framing { none, length, chunked, until_close };
+    enum class chunk_step { size_line, data, data_end, trailers };
+    enum class parsed { more, done, bad };
+
+    [[nodiscard]] bool iequals(const std::string_view a, const std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const char x, const char y) {
+            return (x | 0x20) == (y | 0x20);
+        });
+    }
+
+    [[nodiscard]] std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+        return s;
+    }
+
+    struct job {
+        std::string key;
+        std::string host;
+        unsigned short port = 80;
+        std::string wire;
+        bool head_only = false;
+        steady::time_point start;
+        steady::time_point deadline;
+        int connect_tries = 1;
+        http_async::callback done;
+
+        async_socket s = NO_SOCKET;
+        phase ph = phase::connecting;
+        bool reused = false;
+        size_t sent = 0;
+
+        // response so far, pos is how far the parser got
+        std::string in;
+        size_t pos = 0;
+        bool head_done = false;
+        unsigned status = 0;
+        framing frame = framing::none;
+        chunk_step chunk = chunk_step::size_line;
+        unsigned long long left = 0;
+        bool keep_alive = true;
+        std::string body;
+
+        // back to how it was before it went out, for another go on a different connection
+        void rewind() {
+            s = NO_SOCKET;
+            reused = false;
+            sent = 0;
+            in.clear();
+            pos = 0;
+            head_done = false;
+            status = 0;
+            frame = framing::none;
+            chunk = chunk_step::size_line;
+            left = 0;
+            keep_alive = true;
+            body.clear();
+        }
+
+        [[nodiscard]] parsed parse_head(const bool eof) {
+            const auto end = in.find("\r\n\r\n", pos);
+            if (end == std::string::npos) return in.size() - pos > MAX_HEADER_BYTES || eof ? parsed::bad : parsed::more;
+            const std::string_view head = std::string_view(in).substr(pos, end + 2 - pos);
+            pos = end + 4;
+            // HTTP/1.1 200 OK
+            if (!head.starts_with("HTTP/1.") || head.size() < 12) return parsed::bad;
+            const bool http10 = head[7] == '0';
+            status = static_cast<unsigned>(std::strtoul(std::string(head.substr(9, 3)).c_str(), nullptr, 10));
+            // 1xx before the real answer
+            if (status >= 100 && status < 200) return parse_head(eof);
+
+            std::optional<std::string_view> connection, te, cl;
+            for (size_t at = head.find("\r\n") + 2; at < head.size();) {
+                const size_t eol = head.find("\r\n", at);
+                const std::string_view line = head.substr(at, eol - at);
+                at = eol + 2;
+                const auto colon = line.find(':');
+                if (colon == std::string_view::npos) continue;
+                const std::string_view name = trim(line.substr(0, colon));
+                const std::string_view value = trim(line.substr(colon + 1));
+                if (iequals(name, "Connection")) connection = value;
+                else if (iequals(name, "Transfer-Encoding")) te = value;
+                else if (iequals(name, "Content-Length")) cl = value;
+            }
+            keep_alive = connection ? !iequals(*connection, "close") : !http10;
+            if (head_only || status == 204 || status == 304) {
+                frame = framing::none;
+            } else if (te && !iequals(*te, "identity")) {
+                frame = framing::chunked;
+            } else if (cl) {
+                char* stop = nullptr;
+                const std::string v(*cl);
+                left = std::strtoull(v.c_str(), &stop, 10);
+                if (stop == v.c_str() || left > MAX_BODY_BYTES) return parsed::bad;
+                frame = left ? framing::length : framing::none;
+            } else {
+                frame = framing::until_close;
+            }
+            head_done = true;
+            return parsed::more;
+        }
+
+        [[nodiscard]] parsed take_data() {
+            const size_t n = static_cast<size_t>(std::min<unsigned long long>(left, in.size() - pos));
+            body.append(in, pos, n);
+            pos += n;
+            left -= n;
+            return body.size() > MAX_BODY_BYTES ? parsed::bad : parsed::more;
+        }
+
+        [[nodiscard]] parsed parse_chunked(const bool eof) {
+            for (;;) {
+                if (chunk == chunk_step::data) {
+                    if (take_data() == parsed::bad) return parsed::bad;
+                    if (left) return eof ? parsed::bad : parsed::more;
+                    chunk = chunk_step::data_end;
+                }
+                const size_t eol = in.find("\r\n", pos);
+                if (eol == std::string::npos) return eof ? parsed::bad : parsed::more;
+                const std::string line = in.substr(pos, eol - pos);
+                pos = eol + 2;
+                switch (chunk) {
+                    case chunk_step::size_line: {
+                        char* stop = nullptr;
+                        left = std::strtoull(line.c_str(), &stop, 16);
+                        if (stop == line.c_str()) return parsed::bad;
+                        chunk = left ? chunk_step::data : chunk_step::trailers;
+                        break;
+                    }
+                    case chunk_step::data_end:
+                        if (!line.empty()) return parsed::bad;
+                        chunk = chunk_step::size_line;
+                        break;
+                    case chunk_step::trailers:
+                        // the empty line ends the message
+                        if (line.empty()) return parsed::done;
+                        break;
+                    case chunk_step::data:
+                        break;
+                }
+            }
+        }
+
+        // eats whatever arrived. eof means the peer closed after it
+        [[nodiscard]] parsed parse(const bool eof) {
+            if (!head_done) {
+                if (const parsed p = parse_head(eof); p != parsed::more) return p;
+            }
+            parsed p = parsed::bad;
+            switch (frame) {
+                case framing::none:
+                    p = parsed::done;
+                    break;
+                case framing::length:
+                    p = take_data();
+                    if (p == parsed::more && left == 0) p = parsed::done;
+                    else if (p == parsed::more && eof) p = parsed::bad;
+                    break;
+                case framing::chunked:
+                    p = parse_chunked(eof);
+                    break;
+                case framing::until_close:
+                    body.append(in, pos, in.size() - pos);
+                    pos = in.size();
+                    p = body.size() > MAX_BODY_BYTES ? parsed::bad : eof ? parsed::done : parsed::more;
+                    break;
+            }
+            // dont let the buffer grow with bytes that are already in body
+            if (pos == in.size()) {
+                in.clear();
+                pos = 0;
+            }
+            return p;
+        }
+    };
+
+    [[nodiscard]] std::optional<std::string> request_bytes(const http_request& r, const url_parts& u) {
+        const auto host = narrow_utf8(u.host);
+        const auto path = narrow_utf8(u.path);
+        const auto extra = narrow_utf8(r.headers);
+        const auto verb = narrow_utf8(r.verb);
+        if (!host || !path || !extra || !verb) return std::nullopt;
+        std::string out = *verb + " " + *path + " HTTP/1.1\r\nHost: ";
+        out += u.host.find(L':') != wstr::npos ? "[" + *host + "]" : *host;
+        if (u.port != 80) out += ":" + std::to_string(u.port);
+        out += "\r\nUser-Agent: SpectreLauncher/1.0\r\n";
+        out += *extra;
+        if (!r.body.empty() || *verb == "POST" || *verb == "PUT") out += "Content-Length: " + std::to_string(r.body.size()) + "\r\n";
+        out += "\r\n";
+        out += r.body;
+        return out;
+    }
+} // anon namespace
+
+struct http_async::state {
+    size_t max_per_host = 8;
+    async_poller poller;
+    std::deque<std::unique_ptr<job>> waiting;
+    std::unordered_map<async_socket, std::unique_ptr<job>> active;
+    std::map<std::string, size_t> busy;
+    std::map<std::string, std::vector<async_socket>> idle;
+    unsigned long long connects = 0;
+    std::vector<async_event> events;
+
+    ~state() {
+        for (const auto& [s, j] : active) async_close(s);
+        for (const auto& [key, socks] : idle) {
+            for (const async_socket s : socks) async_close(s);
+        }
+    }
+
+    // an idle socket that has something to read was closed by the server (or is talking out of turn)
+    [[nodiscard]] async_socket take_idle(const std::string& key) {
+        auto& socks = idle[key];
+        while (!socks.empty()) {
+            const async_socket s = socks.back();
+            socks.pop_back();
+            char probe = 0;
+            if (async_recv(s, &probe, 1) == -2) return s;
+            async_close(s);
+        }
+        return NO_SOCKET;
+    }
+
+    void finish(std::unique_ptr<job> j, const bool ok) {
+        --busy[j->key];
+        if (j->s != NO_SOCKET) {
+            poller.forget(j->s);
+            // only a socket that ended exactly on the body can carry the next request
+            const bool reusable = ok && j->keep_alive && j->frame != framing::until_close && j->in.empty();
+            if (reusable && idle[j->key].size() < max_per_host) idle[j->key].push_back(j->s);
+            else async_close(j->s);
+        }
+        http_async_result res;
+        res.status = ok ? j->status : 0;
+        res.body = ok ? std::move(j->body) : std::string{};
+        res.latency = std::chrono::duration_cast<std::chrono::microseconds>(steady::now() - j->start);
+        res.reused = j->reused;
+        if (j->done) j->done(std::move(res));
+    }
+
+    // gives up on the socket. a connect that failed gets another try if it has any left, and so does a request
+    // on a pooled socket the server had already closed (nothing came back, so it never got to act on it)
+    void drop(std::unique_ptr<job> j, const bool connectFailed) {
+        const bool stale = j->reused && !j->head_done && j->in.empty();
+        if (connectFailed || stale) {
+            poller.forget(j->s);
+            async_close(j->s);
+            if (connectFailed) --j->connect_tries;
+            if (j->connect_tries > 0 && steady::now() < j->deadline) {
+                --busy[j->key];
+                j->rewind();
+                waiting.push_front(std::move(j));
+                return;
+            }
+            j->s = NO_SOCKET;
+        }
+        finish(std::move(j), false);
+    }
+
+    void start_waiting() {
+        for (size_t i = 0; i < waiting.size();) {
+            job& j = *waiting[i];
+            if (busy[j.key] >= max_per_host) {
+                ++i;
+                continue;
+            }
+            std::unique_ptr<job> owned = std::move(waiting[i]);
+            waiting.erase(waiting.begin() + static_cast<std::ptrdiff_t>(i));
+            ++busy[owned->key];
+            owned->s = take_idle(owned->key);
+            if (owned->s != NO_SOCKET) {
+                owned->reused = true;
+                owned->ph = phase::sending;
+            } else {
+                owned->s = async_connect(owned->host, owned->port);
+                if (owned->s == NO_SOCKET) {
+                    finish(std::move(owned), false);
+                    continue;
+                }
+                ++connects;
+                owned->ph = phase::connecting;
+            }
+            poller.watch(owned->s, true);
+            const async_socket s = owned->s;
+            active[s] = std::move(owned);
+        }
+    }
+
+    // false when the job is done with this socket (finished or dropped)
+    [[nodiscard]] bool send_some(job& j) {
+        while (j.sent < j.wire.size()) {
+            const long long n = async_send(j.s, j.wire.data() + j.sent, j.wire.size() - j.sent);
+            if (n < 0) return false;
+            if (n == 0) return true;
+            j.sent += static_cast<size_t>(n);
+        }
+        j.ph = phase::receiving;
+        poller.watch(j.s, false);
+        return true;
+    }
+
+    void on_event(const async_event& e) {
+        const auto it = active.find(e.s);
+        if (it == active.end()) return;
+        job& j = *it->second;
+        const auto take = [&] {
+            std::unique_ptr<job> owned = std::move(it->second);
+            active.erase(it);
+            return owned;
+        };
+
+        if (j.ph == phase::connecting) {
+            if (!e.out && !e.err) return;
+            if (!async_connected(j.s)) return drop(take(), true);
+            j.ph = phase::sending;
+        }
+        if (j.ph == phase::sending) {
+            if (!e.out && !e.err) return;
+            if (!send_some(j)) return drop(take(), false);
+            if (j.ph == phase::sending) return;
+        }
+        if (!e.in && !e.err) return;
+        char buf[16 * 1024];
+        bool eof = false;
+        for (;;) {
+            const long long n = async_recv(j.s, buf, sizeof(buf));
+            if (n == -2) break;
+            if (n < 0) return drop(take(), false);
+            if (n == 0) {
+                eof = true;
+                break;
+            }
+            j.in.append(buf, static_cast<size_t>(n));
+        }
+        const parsed p = j.parse(eof);
+        if (p == parsed::done) return finish(take(), true);
+        if (p == parsed::bad || eof) return drop(take(), false);
+    }
+
+    void expire() {
+        const auto now = steady::now();
+        for (auto it = active.begin(); it != active.end();) {
+            if (it->second->deadline > now) {
+                ++it;
+                continue;
+            }
+            std::unique_ptr<job> j = std::move(it->second);
+            it = active.erase(it);
+            poller.forget(j->s);
+            async_close(j->s);
+            j->s = NO_SOCKET;
+            finish(std::move(j), false);
+        }
+        for (size_t i = 0; i < waiting.size();) {
+            if (waiting[i]->deadline > now) {
+                ++i;
+                continue;
+            }
+            std::unique_ptr<job> j = std::move(waiting[i]);
+            waiting.erase(waiting.begin() + static_cast<std::ptrdiff_t>(i));
+            // never started, so it doesnt hold a slot
+            ++busy[j->key];
+            finish(std::move(j), false);
+        }
+    }
+
+    [[nodiscard]] std::chrono::milliseconds next_wait() const {
+        auto soonest = steady::now() + MAX_WAIT;
+        for (const auto& [s, j] : active) soonest = std::min(soonest, j->deadline);
+        for (const auto& j : waiting) soonest = std::min(soonest, j->deadline);
+        const auto ms = std::chrono::ceil<std::chrono::milliseconds>(soonest - steady::now());
+        return std::max(ms, std::chrono::milliseconds(0));
+    }
+};
+
+http_async::http_async(const size_t max_per_host) : s_(std::make_unique<state>()) {
+    s_->max_per_host = max_per_host ? max_per_host : 1;
+}
+
+http_async::~http_async() = default;
+
+void http_async::submit(const http_request& r, callback done) {
+    auto j = std::make_unique<job>();
+    j->start = steady::now();
+    j->deadline = j->start + r.timeout;
+    j->done = std::move(done);
+    const auto u = parse_url(r.url);
+    const auto wire = u && !u->https ? request_bytes(r, *u) : std::nullopt;
+    const auto host = u ? narrow_utf8(u->host) : std::nullopt;
+    if (!wire || !host) {
+        // nothing we can send, answer it right away like any other failure
+        if (j->done) j->done(http_async_result{});
+        return;
+    }
+    j->host = *host;
+    j->port = u->port;
+    j->key = *host + ":" + std::to_string(u->port);
+    j->wire = std::move(*wire);
+    j->head_only = std::wstring_view(r.verb) == L"HEAD";
+    j->connect_tries = std::max(r.attempts, 1);
+    s_->waiting.push_back(std::move(j));
+}
+
+void http_async::run() {
+    TRACE_SCOPE("http_async run");
+    const unsigned long long before = s_->connects;
+    run_until(steady::time_point::max());
+    trace_counter("http async connects", static_cast<long long>(s_->connects - before));
+}
+
+bool http_async::run_until(const steady::time_point until) {
+    while (!s_->waiting.empty() || !s_->active.empty()) {
+        s_->start_waiting();
+        if (s_->active.empty() && s_->waiting.empty()) break;
+        const auto now = steady::now();
+        if (now >= until) break;
+        auto wait = s_->next_wait();
+        if (until - now < wait) wait = std::chrono::ceil<std::chrono::milliseconds>(until - now);
+        s_->poller.wait(wait, s_->events);
+        // on_event can finish jobs whose callbacks submit more, thats fine, they only go into waiting
+        for (const async_event& e : s_->events) s_->on_event(e);
+        s_->expire();
+    }
+    return !s_->waiting.empty() || !s_->active.empty();
+}
+
+[[nodiscard]] unsigned long long http_async::connects() const {
+    return s_->connects;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common.h"
+#include "http_client.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+
+// many requests in flight from one thread. non-blocking sockets on one poller (epoll off windows, WSAPoll on it),
+// idle keep-alive connections pooled per host:port and addresses resolved once per process, same as
+// http_client does for its single blocking requests. http only and whole bodies only, its for talking to the
+// backend (plain http) and for load testing it. the release downloads stay on http_send
+
+struct http_async_result {
+    // 0 when no response came back (connect failed, deadline passed, connection dropped)
+    unsigned status = 0;
+    std::string body;
+    // submit to the last body byte, including time spent waiting for a free connection
+    std::chrono::microseconds latency{ 0 };
+    // went out on a connection an earlier request had opened
+    bool reused = false;
+};
+
+class http_async {
+public:
+    using callback = std::function<void(http_async_result&&)>;
+
+    // max_per_host caps the connections open to one host:port at a time, requests past it wait their turn
+    explicit http_async(size_t max_per_host = 8);
+    ~http_async();
+    http_async(const http_async&) = delete;
+    http_async& operator=(const http_async&) = delete;
+
+    // queues r (the body is copied). verb, url, headers, body and timeout are used, redirects are never followed
+    // and attempts only ever repeat a connect that failed, so its safe for a POST. done runs inside run()
+    void submit(const http_request& r, callback done);
+
+    // drives everything queued to completion or its deadline, including whatever the callbacks submit
+    void run();
+
+    // same, but hands control back once until passes so the caller can submit on a schedule (the open loop
+    // backend bench). true while requests are still in flight
+    bool run_until(std::chrono::steady_clock::time_point until);
+
+    // sockets opened so far, against requests answered it says how much keep-alive saved
+    [[nodiscard]] unsigned long long connects() const;
+
+private:
+    struct state;
+    std::unique_ptr<state> s_;
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "common.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// the platform half of http_async, only http_async*.cpp include this
+
+// a SOCKET on windows, an fd everywhere else
+using async_socket = std::intptr_t;
+inline constexpr async_socket NO_SOCKET = -1;
+
+// starts a non-blocking connect to host (resolved once per process, later calls reuse the addresses).
+// NO_SOCKET when it doesnt resolve or no socket could be made. it finishes once the socket turns writable
+[[nodiscard]] async_socket async_connect(const std::string& host, unsigned short port);
+
+// after the socket turned writable, whether the connect actually worked
+[[nodiscard]] bool async_connected(async_socket s);
+
+// bytes sent, 0 when it would block, -1 on error
+[[nodiscard]] long long async_send(async_socket s, const char* data, size_t len);
+
+// bytes read, 0 when the peer closed, -2 when it would block, -1 on error
+[[nodiscard]] long long async_recv(async_socket s, char* buf, size_t cap);
+
+void async_close(async_socket s);
+
+struct async_event {
+    async_socket s = NO_SOCKET;
+    bool in = false;
+    bool out = false;
+    bool err = false;  // hung up or errored, a read tells which
+};
+
+class async_poller {
+public:
+    async_poller();
+    ~async_poller();
+    async_poller(const async_poller&) = delete;
+    async_poller& operator=(const async_poller&) = delete;
+
+    // readable always, writable too while write is set. calling it again just changes write
+    void watch(async_socket s, bool write);
+    void forget(async_socket s);
+
+    // waits up to timeout for any watched socket to get ready, those land in out
+    void wait(std::chrono::milliseconds timeout, std::vector<async_event>& out);
+
+private:
+    struct state;
+    std::unique_ptr<state> s_;
+};
\ No newline at end of file
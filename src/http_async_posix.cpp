@@ -0,0 +1,167 @@
+#include "http_async_io.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+namespace {
+    std::mutex g_dns_lock;
+    std::map<std::string, std::vector<sockaddr_storage>> g_dns;
+
+    [[nodiscard]] std::vector<sockaddr_storage> resolve(const std::string& host, const unsigned short port) {
+        const std::string key = host + ":" + std::to_string(port);
+        {
+            std::scoped_lock lk(g_dns_lock);
+            if (const auto it = g_dns.find(key); it != g_dns.end()) return it->second;
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = nullptr;
+        if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) return {};
+        std::vector<sockaddr_storage> out;
+        for (const addrinfo* a = res; a; a = a->ai_next) {
+            sockaddr_storage s{};
+            std::memcpy(&s, a->ai_addr, std::min<size_t>(a->ai_addrlen, sizeof(s)));
+            out.push_back(s);
+        }
+        ::freeaddrinfo(res);
+        std::scoped_lock lk(g_dns_lock);
+        if (!out.empty()) g_dns[key] = out;
+        return out;
+    }
+} // anon namespace
+
+[[nodiscard]] async_socket async_connect(const std::string& host, const unsigned short port) {
+    for (const sockaddr_storage& addr : resolve(host, port)) {
+        const int fd = ::socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) continue;
+        const socklen_t len = addr.ss_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), len) != 0 && errno != EINPROGRESS) {
+            ::close(fd);
+            continue;
+        }
+        const int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+    return NO_SOCKET;
+}
+
+[[nodiscard]] bool async_connected(const async_socket s) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    return ::getsockopt(static_cast<int>(s), SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+}
+
+[[nodiscard]] long long async_send(const async_socket s, const char* data, const size_t len) {
+    for (;;) {
+        const ssize_t n = ::send(static_cast<int>(s), data, len, MSG_NOSIGNAL);
+        if (n >= 0) return n;
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+}
+
+[[nodiscard]] long long async_recv(const async_socket s, char* buf, const size_t cap) {
+    for (;;) {
+        const ssize_t n = ::recv(static_cast<int>(s), buf, cap, 0);
+        if (n >= 0) return n;
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? -2 : -1;
+    }
+}
+
+void async_close(const async_socket s) {
+    ::close(static_cast<int>(s));
+}
+
+#ifdef __linux__
+// epoll, so a wait costs the same with a thousand sockets open as with one
+struct async_poller::state {
+    int ep = -1;
+    std::vector<epoll_event> ready = std::vector<epoll_event>(256);
+    std::map<async_socket, bool> watched;
+};
+
+async_poller::async_poller() : s_(std::make_unique<state>()) {
+    s_->ep = ::epoll_create1(EPOLL_CLOEXEC);
+}
+
+async_poller::~async_poller() {
+    if (s_->ep >= 0) ::close(s_->ep);
+}
+
+void async_poller::watch(const async_socket s, const bool write) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | (write ? EPOLLOUT : 0u);
+    ev.data.fd = static_cast<int>(s);
+    const auto it = s_->watched.find(s);
+    if (it == s_->watched.end()) {
+        ::epoll_ctl(s_->ep, EPOLL_CTL_ADD, static_cast<int>(s), &ev);
+        s_->watched.emplace(s, write);
+    } else if (it->second != write) {
+        ::epoll_ctl(s_->ep, EPOLL_CTL_MOD, static_cast<int>(s), &ev);
+        it->second = write;
+    }
+}
+
+void async_poller::forget(const async_socket s) {
+    if (s_->watched.erase(s)) ::epoll_ctl(s_->ep, EPOLL_CTL_DEL, static_cast<int>(s), nullptr);
+}
+
+void async_poller::wait(const std::chrono::milliseconds timeout, std::vector<async_event>& out) {
+    out.clear();
+    const int ms = static_cast<int>(std::clamp<long long>(timeout.count(), 0, INT_MAX));
+    const int n = ::epoll_wait(s_->ep, s_->ready.data(), static_cast<int>(s_->ready.size()), ms);
+    for (int i = 0; i < n; ++i) {
+        const epoll_event& e = s_->ready[static_cast<size_t>(i)];
+        out.push_back({ e.data.fd, (e.events & (EPOLLIN | EPOLLRDHUP)) != 0, (e.events & EPOLLOUT) != 0, (e.events & (EPOLLERR | EPOLLHUP)) != 0 });
+    }
+}
+#else
+struct async_poller::state {
+    std::vector<pollfd> fds;
+};
+
+async_poller::async_poller() : s_(std::make_unique<state>()) {}
+
+async_poller::~async_poller() = default;
+
+void async_poller::watch(const async_socket s, const bool write) {
+    const short events = static_cast<short>(POLLIN | (write ? POLLOUT : 0));
+    for (pollfd& p : s_->fds) {
+        if (p.fd == static_cast<int>(s)) {
+            p.events = events;
+            return;
+        }
+    }
+    s_->fds.push_back({ static_cast<int>(s), events, 0 });
+}
+
+void async_poller::forget(const async_socket s) {
+    std::erase_if(s_->fds, [s](const pollfd& p) { return p.fd == static_cast<int>(s); });
+}
+
+void async_poller::wait(const std::chrono::milliseconds timeout, std::vector<async_event>& out) {
+    out.clear();
+    const int ms = static_cast<int>(std::clamp<long long>(timeout.count(), 0, INT_MAX));
+    if (::poll(s_->fds.data(), static_cast<nfds_t>(s_->fds.size()), ms) <= 0) return;
+    for (const pollfd& p : s_->fds) {
+        if (p.revents) out.push_back({ p.fd, (p.revents & POLLIN) != 0, (p.revents & POLLOUT) != 0, (p.revents & (POLLERR | POLLHUP)) != 0 });
+    }
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "http_async_io.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#pragma comment(lib, "ws2_32.lib")
+
+namespace {
+    std::mutex g_dns_lock;
+    std::map<std::string, std::vector<sockaddr_storage>> g_dns;
+
+    [[nodiscard]] bool net_init() {
+        static const bool ok = [] {
+            WSADATA d;
+            return WSAStartup(MAKEWORD(2, 2), &d) == 0;
+        }();
+        return ok;
+    }
+
+    [[nodiscard]] std::vector<sockaddr_storage> resolve(const std::string& host, const unsigned short port) {
+        const std::string key = host + ":" + std::to_string(port);
+        {
+            std::scoped_lock lk(g_dns_lock);
+            if (const auto it = g_dns.find(key); it != g_dns.end()) return it->second;
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = nullptr;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) return {};
+        std::vector<sockaddr_storage> out;
+        for (const addrinfo* a = res; a; a = a->ai_next) {
+            sockaddr_storage s{};
+            std::memcpy(&s, a->ai_addr, std::min<size_t>(a->ai_addrlen, sizeof(s)));
+            out.push_back(s);
+        }
+        freeaddrinfo(res);
+        std::scoped_lock lk(g_dns_lock);
+        if (!out.empty()) g_dns[key] = out;
+        return out;
+    }
+} // anon namespace
+
+[[nodiscard]] async_socket async_connect(const std::string& host, const unsigned short port) {
+    if (!net_init()) return NO_SOCKET;
+    for (const sockaddr_storage& addr : resolve(host, port)) {
+        const SOCKET s = socket(addr.ss_family, SOCK_STREAM, IPPROTO_TCP);
+        if (s == INVALID_SOCKET) continue;
+        u_long nonblocking = 1;
+        ioctlsocket(s, FIONBIO, &nonblocking);
+        const int len = addr.ss_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+        if (connect(s, reinterpret_cast<const sockaddr*>(&addr), len) != 0 && WSAGetLastError() != WSAEWOULDBLOCK) {
+            closesocket(s);
+            continue;
+        }
+        const BOOL one = TRUE;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+        return static_cast<async_socket>(s);
+    }
+    return NO_SOCKET;
+}
+
+[[nodiscard]] bool async_connected(const async_socket s) {
+    int err = 0;
+    int len = sizeof(err);
+    return getsockopt(static_cast<SOCKET>(s), SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &len) == 0 && err == 0;
+}
+
+[[nodiscard]] long long async_send(const async_socket s, const char* data, const size_t len) {
+    const int n = send(static_cast<SOCKET>(s), data, static_cast<int>(std::min<size_t>(len, INT_MAX)), 0);
+    if (n >= 0) return n;
+    return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+}
+
+[[nodiscard]] long long async_recv(const async_socket s, char* buf, const size_t cap) {
+    const int n = recv(static_cast<SOCKET>(s), buf, static_cast<int>(std::min<size_t>(cap, INT_MAX)), 0);
+    if (n >= 0) return n;
+    return WSAGetLastError() == WSAEWOULDBLOCK ? -2 : -1;
+}
+
+void async_close(const async_socket s) {
+    closesocket(static_cast<SOCKET>(s));
+}
+
+// WSAPoll, theres no epoll here and iocp would mean a different design. a launcher never has more than a few
+// hundred sockets open so a linear scan per wait is fine
+struct async_poller::state {
+    std::vector<WSAPOLLFD> fds;
+};
+
+async_poller::async_poller() : s_(std::make_unique<state>()) {}
+
+async_poller::~async_poller() = default;
+
+void async_poller::watch(const async_socket s, const bool write) {
+    const SHORT events = static_cast<SHORT>(POLLRDNORM | (write ? POLLWRNORM : 0));
+    for (WSAPOLLFD& p : s_->fds) {
+        if (p.fd == static_cast<SOCKET>(s)) {
+            p.events = events;
+            return;
+        }
+    }
+    s_->fds.push_back({ static_cast<SOCKET>(s), events, 0 });
+}
+
+void async_poller::forget(const async_socket s) {
+    std::erase_if(s_->fds, [s](const WSAPOLLFD& p) { return p.fd == static_cast<SOCKET>(s); });
+}
+
+void async_poller::wait(const std::chrono::milliseconds timeout, std::vector<async_event>& out) {
+    out.clear();
+    const int ms = static_cast<int>(std::clamp<long long>(timeout.count(), 0, INT_MAX));
+    if (s_->fds.empty()) {
+        Sleep(static_cast<DWORD>(ms));
+        return;
+    }
+    if (WSAPoll(s_->fds.data(), static_cast<ULONG>(s_->fds.size()), ms) <= 0) return;
+    for (const WSAPOLLFD& p : s_->fds) {
+        if (p.revents) {
+            out.push_back({ static_cast<async_socket>(p.fd), (p.revents & POLLRDNORM) != 0, (p.revents & POLLWRNORM) != 0,
+                            (p.revents & (POLLERR | POLLHUP)) != 0 });
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "http_client.h"
+#include "http_transport.h"
+#include "trace.h"
+#include <algorithm>
+#include <climits>
+#include <cwchar>
+#include <random>
+#include <thread>
+
+// the transport lives in http_client_win.cpp (winhttp) / http_client_posix.cpp (plain sockets)
+
+namespace {
+    inline constexpr int MAX_REDIRECTS = 10;
+    inline constexpr unsigned BACKOFF_BASE_MS = 250;
+    inline constexpr unsigned BACKOFF_MAX_MS = 4000;
+
+    using steady = std::chrono::steady_clock;
+
+    // location can be relative so resolve it against the url that sent it
+    [[nodiscard]] wstr resolve_location(const url_parts& from, const wstr& loc) {
+        if (loc.starts_with(L"http://") || loc.starts_with(L"https://")) return loc;
+        wstr base = from.https ? L"https://" : L"http://";
+        base += from.host.find(L':') != wstr::npos ? L"[" + from.host + L"]" : from.host;
+        if ((from.https && from.port != 443) || (!from.https && from.port != 80)) base += L":" + std::to_wstring(from.port);
+        if (loc.starts_with(L"/")) return base + loc;
+        const auto slash = from.path.rfind(L'/');
+        return base + from.path.substr(0, slash == wstr::npos ? 0 : slash + 1) + loc;
+    }
+
+    [[nodiscard]] int ms_left(const steady::time_point deadline) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - steady::now()).count();
+        return left > 0 ? static_cast<int>(std::min<long long>(left, INT_MAX)) : 0;
+    }
+
+    [[nodiscard]] bool retryable(const unsigned status, const bool unsentOnly) {
+        // a gateway error can come after the upstream already acted on the request
+        if (unsentOnly) return status == 429 || status == 503;
+        return status == 429 || status == 502 || status == 503 || status == 504;
+    }
+
+    // the request for the next hop. 303 always means "go GET it", 301/302 turning a POST into a GET is what
+    // every browser does and what servers expect, 307/308 repeat the request as is
+    [[nodiscard]] bool switches_to_get(const unsigned status, const std::wstring_view verb) {
+        if (status == 303) return verb != L"GET" && verb != L"HEAD";
+        return (status == 301 || status == 302) && verb == L"POST";
+    }
+
+    // the Content-* lines describe the body we just dropped
+    [[nodiscard]] wstr without_content_headers(const wstr& headers) {
+        wstr out;
+        for (size_t at = 0; at < headers.size();) {
+            size_t end = headers.find(L"\r\n", at);
+            end = end == wstr::npos ? headers.size() : end + 2;
+            const std::wstring_view line = std::wstring_view(headers).substr(at, end - at);
+            at = end;
+            if (line.size() >= 8 && std::equal(line.begin(), line.begin() + 8, L"content-", [](const wchar_t a, const wchar_t b) {
+                    return (a | 0x20) == b;
+                })) {
+                continue;
+            }
+            out += line;
+        }
+        return out;
+    }
+
+    // full jitter: anywhere between 0 and the exponential step so a bunch of clients dont retry in lockstep
+    [[nodiscard]] unsigned backoff_ms(const int attempt) {
+        thread_local std::minstd_rand rng{ std::random_device{}() };
+        const unsigned cap = std::min<unsigned>(BACKOFF_MAX_MS, BACKOFF_BASE_MS << std::min(attempt, 4));
+        return std::uniform_int_distribution<unsigned>(0, cap)(rng);
+    }
+} // anon namespace
+
+[[nodiscard]] std::optional<url_parts> parse_url(const wstr& url) {
+    url_parts out;
+    std::wstring_view rest = url;
+    if (rest.starts_with(L"https://")) {
+        out.https = true;
+        rest.remove_prefix(8);
+    } else if (rest.starts_with(L"http://")) {
+        rest.remove_prefix(7);
+    } else {
+        return std::nullopt;
+    }
+    const auto pathStart = rest.find_first_of(L"/?");
+    std::wstring_view authority = rest.substr(0, pathStart);
+    out.path = pathStart == std::wstring_view::npos ? L"/" : wstr(rest.substr(pathStart));
+    if (out.path.starts_with(L"?")) out.path.insert(out.path.begin(), L'/');
+    // user:pass@ isnt something we ever send, but dont mistake it for the host either
+    if (const auto at = authority.rfind(L'@'); at != std::wstring_view::npos) authority.remove_prefix(at + 1);
+
+    std::wstring_view port;
+    if (authority.starts_with(L"[")) {
+        // [v6 literal]:port
+        const auto close = authority.find(L']');
+        if (close == std::wstring_view::npos) return std::nullopt;
+        out.host = authority.substr(1, close - 1);
+        if (close + 1 < authority.size()) {
+            if (authority[close + 1] != L':') return std::nullopt;
+            port = authority.substr(close + 2);
+        }
+    } else {
+        const auto colon = authority.rfind(L':');
+        out.host = authority.substr(0, colon);
+        if (colon != std::wstring_view::npos) port = authority.substr(colon + 1);
+    }
+    if (out.host.empty()) return std::nullopt;
+    out.port = out.https ? 443 : 80;
+    if (!port.empty()) {
+        unsigned long n = 0;
+        for (const wchar_t c : port) {
+            if (c < L'0' || c > L'9') return std::nullopt;
+            n = n * 10 + static_cast<unsigned long>(c - L'0');
+            if (n > 65535) return std::nullopt;
+        }
+        if (n == 0) return std::nullopt;
+        out.port = static_cast<unsigned short>(n);
+    }
+    return out;
+}
+
+[[nodiscard]] wstr http_response::header(const http_header which) const {
+    return body ? body->header(which) : wstr{};
+}
+
+[[nodiscard]] std::optional<unsigned long long> http_response::content_length() const {
+    const wstr v = header(http_header::content_length);
+    if (v.empty()) return std::nullopt;
+    wchar_t* end = nullptr;
+    const unsigned long long n = std::wcstoull(v.c_str(), &end, 10);
+    if (end == v.c_str()) return std::nullopt;
+    return n;
+}
+
+[[nodiscard]] bool http_response::read(void* buf, const size_t cap, size_t& got) {
+    got = 0;
+    return body && body->read(buf, cap, got);
+}
+
+[[nodiscard]] bool http_response::read_all(std::string& out, const size_t limit) {
+    char buf[4096];
+    for (;;) {
+        size_t got = 0;
+        if (!read(buf, sizeof(buf), got)) return false;
+        if (got == 0) return true;
+        if (out.size() + got > limit) return false;
+        out.append(buf, got);
+    }
+}
+
+[[nodiscard]] std::optional<http_response> http_send(const http_request& r) {
+    TRACE_SCOPE("http_send");
+    const auto deadline = steady::now() + r.timeout;
+    const int attempts = r.attempts > 0 ? r.attempts : 1;
+    for (int attempt = 0; attempt < attempts; ++attempt) {
+        if (attempt > 0) {
+            const int left = ms_left(deadline);
+            if (left == 0) break;
+            trace_counter("http retries", attempt);
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min<unsigned>(backoff_ms(attempt - 1), static_cast<unsigned>(left))));
+        }
+
+        http_request hop = r;
+        std::optional<http_response> res;
+        bool sent = false;
+        for (int n = 0; n <= MAX_REDIRECTS; ++n) {
+            const auto u = parse_url(hop.url);
+            // a url we cant even parse wont get better by retrying
+            if (!u) return std::nullopt;
+            res = http_send_once(hop, *u, hop.url, deadline, sent);
+            if (!res) break;
+            const unsigned st = res->status;
+            if (!r.follow_redirects || !(st == 301 || st == 302 || st == 303 || st == 307 || st == 308)) break;
+            const wstr loc = res->header(http_header::location);
+            if (loc.empty()) return std::nullopt;
+            hop.url = resolve_location(*u, loc);
+            if (switches_to_get(st, hop.verb)) {
+                hop.verb = L"GET";
+                hop.body = {};
+                hop.headers = without_content_headers(hop.headers);
+            }
+            res.reset();
+        }
+        if (!res) {
+            if (r.retry_unsent_only && sent) return std::nullopt;
+            continue;
+        }
+        if (retryable(res->status, r.retry_unsent_only) && attempt + 1 < attempts) continue;
+        return res;
+    }
+    return std::nullopt;
+}
+
+bool http_prewarm(const wstr& url, const std::chrono::milliseconds timeout) {
+    TRACE_SCOPE("http_prewarm");
+    const auto u = parse_url(url);
+    if (!u) return false;
+    http_request r;
+    r.verb = L"HEAD";
+    r.url = resolve_location(*u, L"/");
+    r.timeout = timeout;
+    r.read_timeout = timeout;
+    r.follow_redirects = false;
+    auto res = http_send(r);
+    if (!res) return false;
+    // whatever the status, the socket is open. only a fully read response goes back to the pool though
+    std::string rest;
+    return res->read_all(rest);
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common.h"
+#include <chrono>
+#include <memory>
+#include <string_view>
+
+// thin layer over one process wide connection pool. on windows thats a winhttp session, which already keeps
+// idle keep-alive sockets pooled per host and caches dns per session. elsewhere its our own plain socket pool
+// (http only, its there for tests and benchmarks against a local server). on top of that we keep one
+// connection per host:port, follow redirects ourselves and do deadlines + retries
+
+// the response headers anything in here looks at
+enum class http_header { content_length, content_range, content_encoding, etag, last_modified, location, digest, repr_digest };
+
+// one response on whatever transport sent it, closing it hands the socket back to the pool if the body was read
+struct http_transport {
+    virtual ~http_transport() = default;
+    // empty when the header wasnt there
+    [[nodiscard]] virtual wstr header(http_header which) const = 0;
+    [[nodiscard]] virtual bool read(void* buf, size_t cap, size_t& got) = 0;
+};
+
+struct http_request {
+    const wchar_t* verb = L"GET";
+    wstr url;
+    // extra "Name: value\r\n" lines
+    wstr headers;
+    std::string_view body;
+    // deadline for getting the response headers back, across every attempt and redirect hop
+    std::chrono::milliseconds timeout{ 30000 };
+    // how long a single body read can stall before we give up on it
+    std::chrono::milliseconds read_timeout{ 30000 };
+    // total tries. transport errors, 429 and 502/503/504 are retried with jittered exponential backoff
+    int attempts = 1;
+    // for requests that must not land twice (a POST with side effects). retries then only cover a request
+    // that never left (dns or connect failed) or one the server says it didnt act on (429, 503)
+    bool retry_unsent_only = false;
+    bool follow_redirects = true;
+    // let the transport ask for what http_builtin_codings lists and decode it on the fly, read() then hands
+    // out the decoded bytes. content_length() is still what came over the wire. only for whole bodies, never byte ranges
+    bool decompress = false;
+};
+
+struct http_response {
+    std::unique_ptr<http_transport> body;
+    unsigned status = 0;
+    wstr url;  // the url that actually answered
+
+    [[nodiscard]] wstr header(http_header which) const;
+    [[nodiscard]] std::optional<unsigned long long> content_length() const;
+
+    // streams the body, got == 0 means its done. false on a transport error
+    [[nodiscard]] bool read(void* buf, size_t cap, size_t& got);
+
+    // whole body into out, false on error or if it goes past limit. reading to the end is also what
+    // hands the socket back to the pool, so small responses we dont care about should still go through here
+    [[nodiscard]] bool read_all(std::string& out, size_t limit = 1 << 20);
+};
+
+struct url_parts {
+    bool https = false;
+    wstr host;
+    unsigned short port = 0;
+    wstr path;  // path + query
+};
+
+// scheme://host[:port]/path?query, nullopt for anything that isnt http or https
+[[nodiscard]] std::optional<url_parts> parse_url(const wstr& url);
+
+// the content codings the transport decodes by itself with decompress set ("gzip, deflate" through winhttp),
+// empty when it doesnt do any
+[[nodiscard]] std::wstring_view http_builtin_codings();
+
+// sends the request, chasing redirects (except 304) if asked. 303 continues as a GET, and so do 301/302 for a
+// POST like browsers do, the body is dropped then. nullopt when nothing usable came back in time
+[[nodiscard]] std::optional<http_response> http_send(const http_request& r);
+
+// HEAD / against the host of url and drains it, which leaves an open keep-alive socket in the pool so the
+// next real request to that host skips dns, connect and tls. false if the host didnt answer
+bool http_prewarm(const wstr& url, std::chrono::milliseconds timeout = std::chrono::seconds(5));
\ No newline at end of file
@@ -0,0 +1,388 @@
+#include "http_transport.h"
+#include "utf.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// plain sockets, http only. theres no tls here, an https url just fails to send. whats pooled and cached
+// mirrors what winhttp does for us on windows: idle keep-alive sockets per host:port and resolved addresses
+
+namespace {
+    using steady = std::chrono::steady_clock;
+
+    inline constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+    inline constexpr size_t MAX_IDLE_PER_HOST = 8;
+
+    std::mutex g_lock;
+    std::map<std::string, std::vector<int>> g_idle;
+    // resolved once per process, same as a winhttp session does
+    std::map<std::string, std::vector<sockaddr_storage>> g_dns;
+
+    [[nodiscard]] int ms_until(const steady::time_point deadline) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - steady::now()).count();
+        return left > 0 ? static_cast<int>(std::min<long long>(left, INT_MAX)) : 0;
+    }
+
+    // false once deadline passes without the socket getting ready
+    [[nodiscard]] bool wait_ready(const int fd, const short events, const steady::time_point deadline) {
+        for (;;) {
+            pollfd p{ fd, events, 0 };
+            const int n = ::poll(&p, 1, ms_until(deadline));
+            if (n < 0 && errno == EINTR) continue;
+            return n > 0;
+        }
+    }
+
+    [[nodiscard]] std::vector<sockaddr_storage> resolve(const std::string& host, const unsigned short port) {
+        const std::string key = host + ":" + std::to_string(port);
+        {
+            std::scoped_lock lk(g_lock);
+            if (const auto it = g_dns.find(key); it != g_dns.end()) return it->second;
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = nullptr;
+        if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) return {};
+        std::vector<sockaddr_storage> out;
+        for (const addrinfo* a = res; a; a = a->ai_next) {
+            sockaddr_storage s{};
+            std::memcpy(&s, a->ai_addr, std::min<size_t>(a->ai_addrlen, sizeof(s)));
+            out.push_back(s);
+        }
+        ::freeaddrinfo(res);
+        std::scoped_lock lk(g_lock);
+        if (!out.empty()) g_dns[key] = out;
+        return out;
+    }
+
+    [[nodiscard]] int connect_to(const std::string& host, const unsigned short port, const steady::time_point deadline) {
+        for (const sockaddr_storage& addr : resolve(host, port)) {
+            const int fd = ::socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) continue;
+            const socklen_t len = addr.ss_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+            int err = 0;
+            if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), len) != 0) {
+                socklen_t errLen = sizeof(err);
+                if (errno != EINPROGRESS || !wait_ready(fd, POLLOUT, deadline) ||
+                    ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errLen) != 0) {
+                    err = -1;
+                }
+            }
+            if (err != 0) {
+                ::close(fd);
+                continue;
+            }
+            // requests go out in one send, theres nothing for nagle to coalesce
+            const int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+        return -1;
+    }
+
+    // an idle socket the server already closed (or sent something unasked on) is readable, those get dropped
+    [[nodiscard]] int take_idle(const std::string& key) {
+        std::scoped_lock lk(g_lock);
+        auto& idle = g_idle[key];
+        while (!idle.empty()) {
+            const int fd = idle.back();
+            idle.pop_back();
+            pollfd p{ fd, POLLIN, 0 };
+            if (::poll(&p, 1, 0) == 0) return fd;
+            ::close(fd);
+        }
+        return -1;
+    }
+
+    void give_back(const std::string& key, const int fd) {
+        std::scoped_lock lk(g_lock);
+        auto& idle = g_idle[key];
+        if (idle.size() < MAX_IDLE_PER_HOST) idle.push_back(fd);
+        else ::close(fd);
+    }
+
+    [[nodiscard]] bool send_all(const int fd, const std::string_view data, const steady::time_point deadline) {
+        size_t off = 0;
+        while (off < data.size()) {
+            const ssize_t n = ::send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+            if (n > 0) {
+                off += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && wait_ready(fd, POLLOUT, deadline)) continue;
+            return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool iequals(const std::string_view a, const std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const char x, const char y) {
+            return (x | 0x20) == (y | 0x20);
+        });
+    }
+
+    [[nodiscard]] std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+        return s;
+    }
+
+    struct socket_transport final : http_transport {
+        enum class framing { none, length, chunked, until_close };
+
+        int fd = -1;
+        std::string key;
+        // bytes off the socket we havent handed out yet, starting at pos
+        std::string buf;
+        size_t pos = 0;
+        std::vector<std::pair<std::string, std::string>> headers;
+        framing frame = framing::none;
+        // body bytes left (length) or bytes left in the current chunk (chunked)
+        unsigned long long left = 0;
+        bool done = false;
+        bool keep_alive = true;
+        std::chrono::milliseconds read_timeout{ 30000 };
+
+        ~socket_transport() override {
+            if (fd >= 0) ::close(fd);
+        }
+
+        [[nodiscard]] std::optional<std::string_view> find(const std::string_view name) const {
+            for (const auto& [k, v] : headers) {
+                if (iequals(k, name)) return std::string_view(v);
+            }
+            return std::nullopt;
+        }
+
+        [[nodiscard]] wstr header(const http_header which) const override {
+            std::string_view name;
+            switch (which) {
+                case http_header::content_length: name = "Content-Length"; break;
+                case http_header::content_range: name = "Content-Range"; break;
+                case http_header::content_encoding: name = "Content-Encoding"; break;
+                case http_header::etag: name = "ETag"; break;
+                case http_header::last_modified: name = "Last-Modified"; break;
+                case http_header::location: name = "Location"; break;
+                case http_header::digest: name = "Digest"; break;
+                case http_header::repr_digest: name = "Repr-Digest"; break;
+            }
+            const auto v = find(name);
+            return v ? widen_utf8(*v).value_or(L"") : wstr{};
+        }
+
+        // appends whatever the socket has next, false on error, timeout or the peer closing
+        [[nodiscard]] bool fill(const steady::time_point deadline) {
+            if (pos == buf.size()) {
+                buf.clear();
+                pos = 0;
+            }
+            char tmp[16 * 1024];
+            for (;;) {
+                const ssize_t n = ::recv(fd, tmp, sizeof(tmp), 0);
+                if (n > 0) {
+                    buf.append(tmp, static_cast<size_t>(n));
+                    return true;
+                }
+                if (n == 0) return false;
+                if (errno == EINTR) continue;
+                if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_ready(fd, POLLIN, deadline)) continue;
+                return false;
+            }
+        }
+
+        // one crlf terminated line without the crlf
+        [[nodiscard]] bool line(std::string& out, const steady::time_point deadline) {
+            for (;;) {
+                if (const auto eol = buf.find("\r\n", pos); eol != std::string::npos) {
+                    out.assign(buf, pos, eol - pos);
+                    pos = eol + 2;
+                    return true;
+                }
+                if (buf.size() - pos > MAX_HEADER_BYTES || !fill(deadline)) return false;
+            }
+        }
+
+        // up to cap bytes of the body, buffered ones first. got == 0 is the peer closing
+        [[nodiscard]] bool pull(char* out, const size_t cap, size_t& got) {
+            if (pos < buf.size()) {
+                got = std::min(cap, buf.size() - pos);
+                std::memcpy(out, buf.data() + pos, got);
+                pos += got;
+                return true;
+            }
+            const auto deadline = steady::now() + read_timeout;
+            for (;;) {
+                const ssize_t n = ::recv(fd, out, cap, 0);
+                if (n >= 0) {
+                    got = static_cast<size_t>(n);
+                    return true;
+                }
+                if (errno == EINTR) continue;
+                if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_ready(fd, POLLIN, deadline)) continue;
+                return false;
+            }
+        }
+
+        void finish() {
+            done = true;
+            // anything left over belongs to nobody, the socket only goes back if it ended exactly on the body
+            if (fd >= 0 && keep_alive && frame != framing::until_close && pos == buf.size()) {
+                give_back(key, fd);
+                fd = -1;
+            }
+        }
+
+        [[nodiscard]] bool read(void* out, const size_t cap, size_t& got) override {
+            got = 0;
+            if (done || cap == 0) return true;
+            char* dst = static_cast<char*>(out);
+            switch (frame) {
+                case framing::none:
+                    finish();
+                    return true;
+                case framing::until_close:
+                    if (!pull(dst, cap, got)) return false;
+                    if (got == 0) finish();
+                    return true;
+                case framing::length:
+                    if (!pull(dst, static_cast<size_t>(std::min<unsigned long long>(cap, left)), got) || got == 0) return false;
+                    left -= got;
+                    if (left == 0) finish();
+                    return true;
+                case framing::chunked: {
+                    const auto deadline = steady::now() + read_timeout;
+                    if (left == 0) {
+                        std::string l;
+                        if (!line(l, deadline)) return false;
+                        char* end = nullptr;
+                        left = std::strtoull(l.c_str(), &end, 16);
+                        if (end == l.c_str()) return false;
+                        if (left == 0) {
+                            // trailers, then the empty line that ends the message
+                            do {
+                                if (!line(l, deadline)) return false;
+                            } while (!l.empty());
+                            finish();
+                            return true;
+                        }
+                    }
+                    if (!pull(dst, static_cast<size_t>(std::min<unsigned long long>(cap, left)), got) || got == 0) return false;
+                    left -= got;
+                    if (left == 0) {
+                        std::string crlf;
+                        if (!line(crlf, deadline) || !crlf.empty()) return false;
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    // status line and headers, then works out how the body is framed
+    [[nodiscard]] bool read_head(socket_transport& t, const std::string_view verb, unsigned& status, const steady::time_point deadline) {
+        std::string l;
+        if (!t.line(l, deadline)) return false;
+        // HTTP/1.1 200 OK
+        if (!l.starts_with("HTTP/1.") || l.size() < 12) return false;
+        const bool http10 = l[7] == '0';
+        status = static_cast<unsigned>(std::strtoul(l.c_str() + 9, nullptr, 10));
+        size_t total = 0;
+        for (;;) {
+            if (!t.line(l, deadline)) return false;
+            if (l.empty()) break;
+            total += l.size();
+            if (total > MAX_HEADER_BYTES) return false;
+            const auto colon = l.find(':');
+            if (colon == std::string::npos) continue;
+            t.headers.emplace_back(std::string(trim(std::string_view(l).substr(0, colon))),
+                                   std::string(trim(std::string_view(l).substr(colon + 1))));
+        }
+        // 1xx before the real answer, skip it
+        if (status >= 100 && status < 200) {
+            t.headers.clear();
+            return read_head(t, verb, status, deadline);
+        }
+
+        const auto connection = t.find("Connection");
+        t.keep_alive = connection ? !iequals(*connection, "close") : !http10;
+        const auto te = t.find("Transfer-Encoding");
+        const auto cl = t.find("Content-Length");
+        if (verb == "HEAD" || status == 204 || status == 304) {
+            t.frame = socket_transport::framing::none;
+        } else if (te && !iequals(*te, "identity")) {
+            t.frame = socket_transport::framing::chunked;
+        } else if (cl) {
+            char* end = nullptr;
+            const std::string v(*cl);
+            t.left = std::strtoull(v.c_str(), &end, 10);
+            if (end == v.c_str()) return false;
+            t.frame = t.left ? socket_transport::framing::length : socket_transport::framing::none;
+        } else {
+            t.frame = socket_transport::framing::until_close;
+        }
+        return true;
+    }
+} // anon namespace
+
+[[nodiscard]] std::wstring_view http_builtin_codings() {
+    return {};
+}
+
+[[nodiscard]] std::optional<http_response> http_send_once(const http_request& r, const url_parts& u, const wstr& url,
+                                                          const steady::time_point deadline, bool& sent) {
+    sent = false;
+    if (u.https) return std::nullopt;
+    const auto host = narrow_utf8(u.host);
+    const auto path = narrow_utf8(u.path);
+    const auto extra = narrow_utf8(r.headers);
+    const auto verb = narrow_utf8(r.verb);
+    if (!host || !path || !extra || !verb) return std::nullopt;
+
+    std::string head = *verb + " " + *path + " HTTP/1.1\r\nHost: ";
+    head += u.host.find(L':') != wstr::npos ? "[" + *host + "]" : *host;
+    if (u.port != 80) head += ":" + std::to_string(u.port);
+    head += "\r\nUser-Agent: SpectreLauncher/1.0\r\n";
+    head += *extra;
+    if (!r.body.empty() || *verb == "POST" || *verb == "PUT") head += "Content-Length: " + std::to_string(r.body.size()) + "\r\n";
+    head += "\r\n";
+    head += r.body;
+
+    auto t = std::make_unique<socket_transport>();
+    t->key = *host + ":" + std::to_string(u.port);
+    t->read_timeout = r.read_timeout;
+    // a pooled socket can still have been closed by the server in the meantime. if the send fails the server
+    // never saw the request, so thats the one case worth another go on a fresh connection
+    t->fd = take_idle(t->key);
+    if (t->fd >= 0 && !send_all(t->fd, head, deadline)) {
+        ::close(t->fd);
+        t->fd = -1;
+    }
+    if (t->fd < 0) {
+        t->fd = connect_to(*host, u.port, deadline);
+        if (t->fd < 0) return std::nullopt;
+        sent = true;
+        if (!send_all(t->fd, head, deadline)) return std::nullopt;
+    }
+    sent = true;
+
+    http_response out;
+    if (!read_head(*t, *verb, out.status, deadline)) return std::nullopt;
+    if (t->frame == socket_transport::framing::none) t->finish();
+    out.body = std::move(t);
+    out.url = url;
+    return out;
+}
\ No newline at end of file
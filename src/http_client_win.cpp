@@ -0,0 +1,146 @@
+#include "http_transport.h"
+#include <windows.h>
+#include <winhttp.h>
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#pragma comment(lib, "winhttp.lib")
+
+namespace {
+    using steady = std::chrono::steady_clock;
+
+    // movable owner for any HINTERNET
+    struct http_handle {
+        HINTERNET h = nullptr;
+        http_handle() = default;
+        explicit http_handle(HINTERNET v) : h(v) {}
+        http_handle(http_handle&& o) noexcept : h(std::exchange(o.h, nullptr)) {}
+        http_handle& operator=(http_handle&& o) noexcept {
+            if (this != &o) {
+                if (h) WinHttpCloseHandle(h);
+                h = std::exchange(o.h, nullptr);
+            }
+            return *this;
+        }
+        ~http_handle() {
+            if (h) WinHttpCloseHandle(h);
+        }
+        explicit operator bool() const { return h != nullptr; }
+    };
+
+    struct winhttp_transport final : http_transport {
+        http_handle req;
+
+        [[nodiscard]] wstr header(const http_header which) const override {
+            DWORD query = 0;
+            // the digest ones arent in winhttps table, those go by name
+            const wchar_t* name = WINHTTP_HEADER_NAME_BY_INDEX;
+            switch (which) {
+                case http_header::content_length: query = WINHTTP_QUERY_CONTENT_LENGTH; break;
+                case http_header::content_range: query = WINHTTP_QUERY_CONTENT_RANGE; break;
+                case http_header::content_encoding: query = WINHTTP_QUERY_CONTENT_ENCODING; break;
+                case http_header::etag: query = WINHTTP_QUERY_ETAG; break;
+                case http_header::last_modified: query = WINHTTP_QUERY_LAST_MODIFIED; break;
+                case http_header::location: query = WINHTTP_QUERY_LOCATION; break;
+                case http_header::digest: query = WINHTTP_QUERY_CUSTOM; name = L"Digest"; break;
+                case http_header::repr_digest: query = WINHTTP_QUERY_CUSTOM; name = L"Repr-Digest"; break;
+            }
+            DWORD size = 0;
+            WinHttpQueryHeaders(req.h, query, name, nullptr, &size, WINHTTP_NO_HEADER_INDEX);
+            if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || size == 0) return {};
+            wstr out(size / sizeof(wchar_t), L'\0');
+            if (!WinHttpQueryHeaders(req.h, query, name, out.data(), &size, WINHTTP_NO_HEADER_INDEX)) return {};
+            out.resize(size / sizeof(wchar_t));
+            return out;
+        }
+
+        [[nodiscard]] bool read(void* buf, const size_t cap, size_t& got) override {
+            DWORD n = 0;
+            const bool ok = WinHttpReadData(req.h, buf, static_cast<DWORD>(std::min<size_t>(cap, MAXDWORD)), &n) == TRUE;
+            got = n;
+            return ok;
+        }
+    };
+
+    [[nodiscard]] HINTERNET session() {
+        static const http_handle s = [] {
+            http_handle h(WinHttpOpen(L"SpectreLauncher/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, nullptr, nullptr, 0));
+            if (h) {
+                // we follow redirects ourselves so we know where we ended up and can keep our headers on every hop
+                DWORD policy = WINHTTP_OPTION_REDIRECT_POLICY_NEVER;
+                WinHttpSetOption(h.h, WINHTTP_OPTION_REDIRECT_POLICY, &policy, sizeof(policy));
+            }
+            return h;
+        }();
+        return s.h;
+    }
+
+    // connect handles dont open sockets by themselves, theyre just what requests to one host hang off.
+    // keeping them around is what lets winhttp hand later requests an already open socket
+    [[nodiscard]] HINTERNET connection(const url_parts& u) {
+        static std::mutex lock;
+        static std::map<wstr, http_handle> conns;
+        const HINTERNET s = session();
+        if (!s) return nullptr;
+        wstr key = u.host + L":" + std::to_wstring(u.port);
+        std::scoped_lock lk(lock);
+        auto& c = conns[std::move(key)];
+        if (!c) c = http_handle(WinHttpConnect(s, u.host.c_str(), u.port, 0));
+        return c.h;
+    }
+} // anon namespace
+
+[[nodiscard]] std::wstring_view http_builtin_codings() {
+    return L"gzip, deflate";
+}
+
+[[nodiscard]] std::optional<http_response> http_send_once(const http_request& r, const url_parts& u, const wstr& url,
+                                                          const steady::time_point deadline, bool& sent) {
+    sent = false;
+    const HINTERNET conn = connection(u);
+    if (!conn) return std::nullopt;
+    auto t = std::make_unique<winhttp_transport>();
+    t->req = http_handle(WinHttpOpenRequest(conn, r.verb, u.path.c_str(), nullptr, WINHTTP_NO_REFERER,
+                                            WINHTTP_DEFAULT_ACCEPT_TYPES, u.https ? WINHTTP_FLAG_SECURE : 0));
+    if (!t->req) return std::nullopt;
+    const HINTERNET req = t->req.h;
+
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - steady::now()).count();
+    if (left <= 0) return std::nullopt;
+    const int ms = static_cast<int>(std::min<long long>(left, INT_MAX));
+    WinHttpSetTimeouts(req, ms, ms, ms, ms);
+    if (r.decompress) {
+        DWORD flags = WINHTTP_DECOMPRESSION_FLAG_ALL;
+        WinHttpSetOption(req, WINHTTP_OPTION_DECOMPRESSION, &flags, sizeof(flags));
+    }
+
+    const wchar_t* extra = r.headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : r.headers.c_str();
+    const DWORD extraLen = r.headers.empty() ? 0 : static_cast<DWORD>(-1L);
+    void* body = r.body.empty() ? WINHTTP_NO_REQUEST_DATA : const_cast<char*>(r.body.data());
+    const DWORD bodyLen = static_cast<DWORD>(r.body.size());
+    if (!WinHttpSendRequest(req, extra, extraLen, body, bodyLen, bodyLen, 0)) {
+        // those two mean nothing went out, anything else might have been halfway through the send
+        const DWORD err = GetLastError();
+        sent = err != ERROR_WINHTTP_NAME_NOT_RESOLVED && err != ERROR_WINHTTP_CANNOT_CONNECT;
+        return std::nullopt;
+    }
+    sent = true;
+    if (!WinHttpReceiveResponse(req, nullptr)) return std::nullopt;
+
+    DWORD status = 0, size = sizeof(status);
+    if (!WinHttpQueryHeaders(req, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX,
+                             &status, &size, WINHTTP_NO_HEADER_INDEX)) {
+        return std::nullopt;
+    }
+    // from here on the deadline is done with, the body gets the per read stall limit instead
+    DWORD readTimeout = static_cast<DWORD>(r.read_timeout.count());
+    WinHttpSetOption(req, WINHTTP_OPTION_RECEIVE_TIMEOUT, &readTimeout, sizeof(readTimeout));
+    http_response out;
+    out.body = std::move(t);
+    out.status = status;
+    out.url = url;
+    return out;
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "http_client.h"
+
+// the platform half of http_client, only http_client*.cpp include this
+
+// one request to one url, no redirect handling and no retries. nullopt on any transport error or once
+// deadline passes before the response headers are in. sent says whether the server may have seen any of the
+// request by then, false only when it never got past dns or connect
+[[nodiscard]] std::optional<http_response> http_send_once(const http_request& r, const url_parts& u, const wstr& url,
+                                                          std::chrono::steady_clock::time_point deadline, bool& sent);
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "library_index.h"
+#include "bin_io.h"
+#include "file_utils.h"
+#include "steam_library.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "utf.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace {
+    // file layout (little endian):
+    //   "SLLI" u16 version u16 reserved, wstr steam_path, u64 vdf_mtime, u32 library_count
+    //   library_count * { wstr root, u64 steamapps_mtime, u32 app_count,
+    //                     app_count * { u32 appid, wstr installdir, u64 size_on_disk, u64 buildid, u32 state_flags } }
+    //   u32 crc32 of everything above
+    inline constexpr char MAGIC[4] = { 'S', 'L', 'L', 'I' };
+    inline constexpr std::uint16_t VERSION = 2;
+    // way more than anyone has, just so a corrupt count cant make us allocate forever
+    inline constexpr std::uint32_t MAX_LIBRARIES = 256;
+    inline constexpr std::uint32_t MAX_APPS = 1 << 16;
+    // scanning is mostly waiting on the disk, but past this many threads were just queueing on the same drives
+    inline constexpr size_t MAX_SCAN_THREADS = 8;
+
+    struct app_record {
+        wstr installdir;
+        unsigned long long size_on_disk = 0;
+        unsigned long long buildid = 0;
+        std::uint32_t state_flags = 0;
+    };
+
+    struct library {
+        wstr root;
+        unsigned long long mtime = 0;  // of root\steamapps when it was scanned
+        std::unordered_map<int, app_record> apps;
+    };
+
+    struct library_set {
+        wstr steam;
+        unsigned long long vdf_mtime = 0;
+        std::vector<library> libs;
+    };
+
+    std::mutex g_lock;
+    std::atomic<unsigned long long> g_rescans{ 0 };
+
+    [[nodiscard]] fs::path cache_file() {
+        return get_launcher_data_dir() / L"libraryindex.bin";
+    }
+
+    // 0 when it doesnt exist, which never matches a real scan so a library that comes back gets rescanned
+    [[nodiscard]] unsigned long long mtime_of(const fs::path& p) {
+        std::error_code ec;
+        const auto t = fs::last_write_time(p, ec);
+        return ec ? 0 : static_cast<unsigned long long>(t.time_since_epoch().count());
+    }
+
+    // appmanifest_<digits>.acf -> appid
+    [[nodiscard]] std::optional<int> manifest_appid(const wstr& name) {
+        static constexpr std::wstring_view PREFIX = L"appmanifest_";
+        static constexpr std::wstring_view SUFFIX = L".acf";
+        if (name.size() <= PREFIX.size() + SUFFIX.size() || !name.starts_with(PREFIX) || !name.ends_with(SUFFIX)) return std::nullopt;
+        const std::wstring_view digits = std::wstring_view(name).substr(PREFIX.size(), name.size() - PREFIX.size() - SUFFIX.size());
+        if (digits.size() > 9) return std::nullopt;
+        int id = 0;
+        for (const wchar_t c : digits) {
+            if (c < L'0' || c > L'9') return std::nullopt;
+            id = id * 10 + (c - L'0');
+        }
+        return id;
+    }
+
+    [[nodiscard]] library scan_library(const wstr& root) {
+        TRACE_SCOPE("scan_library");
+        ++g_rescans;
+        library lib;
+        lib.root = root;
+        const fs::path steamapps = fs::path(root) / L"steamapps";
+        // take the mtime first, anything that changes while we scan just gets picked up next time
+        lib.mtime = mtime_of(steamapps);
+        std::error_code ec;
+        for (fs::directory_iterator it(steamapps, ec), end; !ec && it != end; it.increment(ec)) {
+            const auto id = manifest_appid(it->path().filename().wstring());
+            if (!id) continue;
+            auto m = read_app_manifest(it->path());
+            if (!m) continue;
+            if (auto dir = widen_utf8(m->installdir)) lib.apps[*id] = { std::move(*dir), m->size_on_disk, m->buildid, m->state_flags };
+        }
+        return lib;
+    }
+
+    // anything off (bad magic, old version, bad crc, truncated) just means a cold rebuild
+    [[nodiscard]] library_set load_index() {
+        library_set out;
+        const auto buf = read_file_bytes(cache_file());
+        if (!buf) return out;
+        bin_reader r{ *buf };
+        std::uint32_t libCount = 0;
+        if (!bin_open(r, MAGIC, VERSION) || !r.get_wstr(out.steam) || !r.get(out.vdf_mtime) || !r.get(libCount) ||
+            libCount > MAX_LIBRARIES) {
+            return {};
+        }
+        out.libs.resize(libCount);
+        for (auto& lib : out.libs) {
+            std::uint32_t appCount = 0;
+            if (!r.get_wstr(lib.root) || !r.get(lib.mtime) || !r.get(appCount) || appCount > MAX_APPS) return {};
+            lib.apps.reserve(appCount);
+            for (std::uint32_t i = 0; i < appCount; ++i) {
+                std::uint32_t id = 0;
+                app_record a;
+                if (!r.get(id) || !r.get_wstr(a.installdir) || !r.get(a.size_on_disk) || !r.get(a.buildid) ||
+                    !r.get(a.state_flags)) {
+                    return {};
+                }
+                lib.apps.emplace(static_cast<int>(id), std::move(a));
+            }
+        }
+        if (r.pos != buf->size() - 4) return {};
+        return out;
+    }
+
+    [[nodiscard]] bool save_index(const library_set& idx) {
+        std::string out;
+        out.append(MAGIC, 4);
+        bin_put(out, VERSION);
+        bin_put(out, std::uint16_t{ 0 });
+        bin_put_wstr(out, idx.steam);
+        bin_put(out, idx.vdf_mtime);
+        bin_put(out, static_cast<std::uint32_t>(idx.libs.size()));
+        for (const auto& lib : idx.libs) {
+            bin_put_wstr(out, lib.root);
+            bin_put(out, lib.mtime);
+            bin_put(out, static_cast<std::uint32_t>(lib.apps.size()));
+            for (const auto& [id, a] : lib.apps) {
+                bin_put(out, static_cast<std::uint32_t>(id));
+                bin_put_wstr(out, a.installdir);
+                bin_put(out, a.size_on_disk);
+                bin_put(out, a.buildid);
+                bin_put(out, a.state_flags);
+            }
+        }
+        bin_seal(out);
+        return write_file_atomic(cache_file(), out);
+    }
+
+    // brings idx up to date, returns whether anything changed
+    [[nodiscard]] bool refresh(library_set& idx, const wstr& steam_path) {
+        bool dirty = false;
+        if (idx.steam != steam_path) {
+            idx = {};
+            idx.steam = steam_path;
+            dirty = true;
+        }
+
+        const unsigned long long vdfMtime = mtime_of(fs::path(steam_path) / L"steamapps" / L"libraryfolders.vdf");
+        if (dirty || vdfMtime != idx.vdf_mtime) {
+            // the library list changed, but libraries we already know keep their scans
+            std::vector<library> libs;
+            for (auto& root : get_library_roots(steam_path)) {
+                const auto old = std::ranges::find(idx.libs, root, &library::root);
+                libs.push_back(old != idx.libs.end() ? std::move(*old) : library{ .root = std::move(root) });
+            }
+            idx.libs = std::move(libs);
+            idx.vdf_mtime = vdfMtime;
+            dirty = true;
+        }
+
+        // the mtime check goes in the task too, a sleeping usb drive can take a while just to answer that
+        std::atomic<bool> rescanned{ false };
+        const auto check = [&rescanned](library& lib) {
+            const unsigned long long m = mtime_of(fs::path(lib.root) / L"steamapps");
+            if (m == lib.mtime && m != 0) return;
+            lib = scan_library(lib.root);
+            rescanned = true;
+        };
+        if (idx.libs.size() < 2) {
+            for (auto& lib : idx.libs) check(lib);
+        } else {
+            thread_pool pool(std::min(idx.libs.size(), MAX_SCAN_THREADS));
+            for (auto& lib : idx.libs) pool.submit([&check, &lib] { check(lib); });
+            pool.wait_idle();
+        }
+        return dirty || rescanned;
+    }
+} // anon namespace
+
+[[nodiscard]] std::unordered_map<int, app_install> library_index_resolve(const wstr& steam_path, const std::span<const int> appids) {
+    TRACE_SCOPE("library_index_resolve");
+    std::scoped_lock lk(g_lock);
+    library_set idx = load_index();
+    bool dirty = refresh(idx, steam_path);
+
+    std::unordered_map<int, app_install> found;
+    std::vector<bool> rescanned(idx.libs.size(), false);
+    for (const int appid : appids) {
+        for (size_t i = 0; i < idx.libs.size() && !found.contains(appid); ++i) {
+            library& lib = idx.libs[i];
+            auto it = lib.apps.find(appid);
+            if (it == lib.apps.end()) continue;
+            fs::path candidate = fs::path(lib.root) / L"steamapps" / L"common" / it->second.installdir;
+            std::error_code ec;
+            if (!fs::exists(candidate, ec)) {
+                // manifest says its here but the folder isnt, the manifest might have been rewritten in place.
+                // one rescan of just this library settles it
+                if (rescanned[i]) continue;
+                lib = scan_library(lib.root);
+                rescanned[i] = true;
+                dirty = true;
+                it = lib.apps.find(appid);
+                if (it == lib.apps.end()) continue;
+                candidate = fs::path(lib.root) / L"steamapps" / L"common" / it->second.installdir;
+                if (!fs::exists(candidate, ec)) continue;
+            }
+            const app_record& a = it->second;
+            found.emplace(appid, app_install{ candidate.wstring(), a.size_on_disk, a.buildid, a.state_flags });
+        }
+    }
+    if (dirty) (void)save_index(idx);
+    return found;
+}
+
+[[nodiscard]] op library_index_find(const wstr& steam_path, const int appid) {
+    auto found = library_index_resolve(steam_path, std::span(&appid, 1));
+    const auto it = found.find(appid);
+    if (it == found.end()) return std::nullopt;
+    return std::move(it->second.path);
+}
+
+[[nodiscard]] library_index_counters library_index_get_counters() {
+    return { g_rescans.load() };
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "common.h"
+#include <span>
+#include <unordered_map>
+
+// cached appid -> install map over every steam library, kept in the launcher data dir so game
+// discovery doesnt reparse libraryfolders.vdf and every manifest on each launch.
+// the library list is only reread when libraryfolders.vdf changes, and a library is only rescanned when
+// its steamapps dir changes (steam writes manifests via temp + rename, which bumps the dir mtime).
+// stale libraries are rescanned in parallel, one task per root, each manifest parsed once
+
+struct app_install {
+    wstr path;  // the app's folder under steamapps/common
+    unsigned long long size_on_disk = 0;
+    unsigned long long buildid = 0;
+    unsigned state_flags = 0;
+};
+
+struct library_index_counters {
+    unsigned long long rescans = 0;  // libraries whose manifests had to be read again
+};
+
+// answers every id in one pass over the index. ids that arent installed anywhere are just missing from the result.
+// if an app shows up in several libraries the first one in libraryfolders order wins
+[[nodiscard]] std::unordered_map<int, app_install> library_index_resolve(const wstr& steam_path, std::span<const int> appids);
+
+// single id version of the above
+[[nodiscard]] op library_index_find(const wstr& steam_path, int appid);
+
+[[nodiscard]] library_index_counters library_index_get_counters();
@@ -1,177 +1,482 @@
 #include "common.h"
 #include "steam_finder.h"
 #include "process_utils.h"
+#include "process_watcher.h"
 #include "file_utils.h"
 #include "page_trigger.h"
+#include "hash_cache.h"
+#include "library_index.h"
+#include "downloader.h"
+#include "delta.h"
+#include "staged_install.h"
+#include "artifact_store.h"
+#include "prefetch.h"
+#include "task_graph.h"
+#include "verify.h"
+#include "fleet.h"
+#include "client_fleet.h"
+#include "backend_bench.h"
+#include "trace.h"
+#include "utf.h"
 #include <windows.h>
+#include <shellapi.h>
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
 #include <cstdio>
+#include <mutex>
+#include <stop_token>
+#include <string_view>
 
 #pragma comment(lib, "advapi32.lib")
+#pragma comment(lib, "shell32.lib")
 #pragma comment(lib, "winhttp.lib")
 
-int wmain() {
-    // init com for urlmon
-    if (HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED); FAILED(hr)) {
-        std::fprintf(stderr, "Failed to initialize COM: 0x%08lX\n", hr);
-        return 1;
-    }
+// the real dll is a few mb, anything way past that is not something we want to install
+inline constexpr unsigned long long MAX_BECLIENT_BYTES = 64ull << 20;
 
-    // find steam installation
-    auto steamOpt = get_steam_path();
-    if (!steamOpt) {
-        std::puts("Steam not installed.");
-        CoUninitialize();
-        return 1;
-    }
-    const wstr& steam = *steamOpt;
-
-    // find game installation (try the uninstall registry first then manifests)
-    auto gameRoot = get_app_install_from_uninstall(APP_ID);
-    if (!gameRoot) gameRoot = get_app_install_by_manifests(steam, APP_ID);
-    if (!gameRoot) {
-        std::puts("Game not installed.");
-        CoUninitialize();
-        return 2;
-    }
+namespace {
+    // asks the latest release for a patch from the installed dll to the new one and applies it into out.
+    // patches are published as BEClient_x64.dll.<first 16 hex of the source sha256>.patch
+    [[nodiscard]] std::optional<std::string> try_delta_update(const std::string& installedHash, const fs::path& installed, const fs::path& out) {
+        TRACE_SCOPE("try_delta_update");
+        std::string prefix = installedHash.substr(0, 16);
+        for (char& c : prefix) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        const wstr patchUrl = wstr(RELEASE_URL) + L"." + widen_utf8(prefix).value_or(L"") + L".patch";
+
+        const fs::path patchFile = get_launcher_data_dir() / L"BEClient_x64.dll.patch";
+        fetch_state patchState;
+        // a 404 here is normal, it just means theres no patch from our version
+        if (fetch_to_file(patchUrl.c_str(), patchFile, patchState, { .max_bytes = MAX_BECLIENT_BYTES }) != fetch_result::downloaded) {
+            std::error_code ec;
+            fs::remove(patchFile, ec);
+            return std::nullopt;
+        }
 
-    // setup paths to game exe and BE directory
-    fs::path binDir = fs::path(*gameRoot) / L"Spectre" / L"Binaries" / L"Win64";
-    fs::path beDir = binDir / L"BattlEye";
-    fs::path beClient = beDir / L"BEClient_x64.dll";
-    fs::path clientExe = binDir / L"SpectreClient-Win64-Shipping.exe";
+        // the name only carries a prefix of the digest, the header has all of it. checked against the installed
+        // hash we already have, so applying doesnt need to read the whole dll once more just to hash it
+        const auto source = delta_source_digest(patchFile);
+        if (!source || to_hex(*source) != installedHash) {
+            std::error_code ec;
+            fs::remove(patchFile, ec);
+            std::fprintf(stderr, "Delta patch is not for the installed BEClient, falling back to full download.\n");
+            return std::nullopt;
+        }
 
-    if (!fs::exists(clientExe)) {
-        std::puts("Client executable not found.");
-        CoUninitialize();
-        return 3;
+        sha256_digest target{};
+        const delta_result res = delta_apply(patchFile, installed, out, &target, true);
+        std::error_code ec;
+        fs::remove(patchFile, ec);
+        if (res != delta_result::ok) {
+            std::fprintf(stderr, "Delta update failed (%d), falling back to full download.\n", static_cast<int>(res));
+            return std::nullopt;
+        }
+        return to_hex(target);
     }
-    if (std::error_code ec; !fs::exists(beDir) && !fs::create_directories(beDir, ec)) {
-        std::fprintf(stderr, "Failed to create BattlEye directory: %s\n", ec.message().c_str());
-        CoUninitialize();
-        return 4;
+
+    // --use / --pin / --store-limit-mb
+    struct store_settings {
+        // install this pin name or digest straight from the store, no network at all
+        std::string use;
+        // extra pin for whatever ends up installed, on top of "current" and "previous"
+        std::string pin;
+        unsigned long long limit_bytes = 256ull << 20;
+    };
+
+    // puts a stored BEClient in place. copied into the staging dir, the object itself is never handed out
+    [[nodiscard]] bool install_from_store(const fs::path& beDir, const std::string& hex, const store_settings& storeOpts) {
+        const auto current = store_resolve("current");
+        if (!staged_install(beDir, [&hex](const fs::path& staging) { return store_install(hex, staging / L"BEClient_x64.dll"); })) return false;
+        // keep the one we just replaced around for a --use previous rollback
+        if (current && *current != hex) (void)store_pin("previous", *current);
+        (void)store_pin("current", hex);
+        if (!storeOpts.pin.empty() && !store_pin(storeOpts.pin, hex)) std::fprintf(stderr, "Could not pin BEClient as %s.\n", storeOpts.pin.c_str());
+        store_gc(storeOpts.limit_bytes);
+        return true;
     }
 
-    // check if we need to download / update the patched BE dll
-    std::optional<std::string> installedHash;
-    if (fs::exists(beClient)) installedHash = sha256_file(beClient);
+    // the bits of the game install the later stages need
+    struct game_paths {
+        fs::path root;
+        fs::path beDir;
+        fs::path beClient;
+        fs::path clientExe;
+    };
 
-    fs::path tempFile = get_temp_file_guid();
-    std::optional<std::string> downloadHash;
-    if (!download_to_file(RELEASE_URL, tempFile)) {
-        std::fprintf(stderr, "Download failed.\n");
-        if (fs::exists(tempFile)) {
-            std::error_code ec2;
-            fs::remove(tempFile, ec2);
+    [[nodiscard]] stage_result<wstr> find_steam() {
+        TRACE_SCOPE("stage: find steam");
+        auto steamOpt = get_steam_path();
+        if (!steamOpt) {
+            std::puts("Steam not installed.");
+            return std::unexpected(1);
         }
-        CoUninitialize();
-        return 5;
+        return *steamOpt;
     }
-    downloadHash = sha256_file(tempFile);
-    if (!downloadHash) {
-        std::fprintf(stderr, "Hash failed.\n");
-        if (fs::exists(tempFile)) {
-            std::error_code ec2;
-            fs::remove(tempFile, ec2);
-        }
-        CoUninitialize();
-        return 5;
+
+    [[nodiscard]] stage_result<game_paths> find_game(const wstr& steam) {
+        TRACE_SCOPE("stage: find game");
+        // find game installation (try the uninstall registry first then manifests)
+        auto gameRoot = get_app_install_from_uninstall(APP_ID);
+        if (!gameRoot) gameRoot = get_app_install_by_manifests(steam, APP_ID);
+        if (!gameRoot) {
+            std::puts("Game not installed.");
+            return std::unexpected(2);
+        }
+
+        // setup paths to game exe and BE directory
+        const fs::path binDir = fs::path(*gameRoot) / L"Spectre" / L"Binaries" / L"Win64";
+        game_paths game;
+        game.root = *gameRoot;
+        game.beDir = binDir / L"BattlEye";
+        game.beClient = game.beDir / L"BEClient_x64.dll";
+        game.clientExe = binDir / L"SpectreClient-Win64-Shipping.exe";
+
+        if (!fs::exists(game.clientExe)) {
+            std::puts("Client executable not found.");
+            return std::unexpected(3);
+        }
+        if (std::error_code ec; !fs::exists(game.beDir) && !fs::create_directories(game.beDir, ec)) {
+            std::fprintf(stderr, "Failed to create BattlEye directory: %s\n", ec.message().c_str());
+            return std::unexpected(4);
+        }
+        return game;
     }
 
-    // only replace BE dll if hash differs
-    if (installedHash && *installedHash == *downloadHash) {
-        std::error_code ec2;
-        fs::remove(tempFile, ec2);
-    } else {
-        // del the old BE dir and install the new dll
-        if (!clear_directory(beDir)) {
-            std::fprintf(stderr, "Failed to clear BattlEye directory.\n");
-            if (fs::exists(tempFile)) {
+    [[nodiscard]] stage_result<bool> update_beclient(const game_paths& game, const ranged_options& rangedOpts, const store_settings& storeOpts) {
+        TRACE_SCOPE("stage: update BEClient");
+        const fs::path& beDir = game.beDir;
+        const fs::path& beClient = game.beClient;
+
+        // finish (or clean up after) a swap an earlier run didnt get to complete
+        (void)staged_recover(beDir);
+
+        // check if we need to download / update the patched BE dll
+        std::optional<std::string> installedHash;
+        if (fs::exists(beClient)) installedHash = sha256_file(beClient);
+
+        // a build we already have, no network involved
+        const auto install_stored = [&](const std::string& hex) -> stage_result<bool> {
+            if (installedHash && *installedHash == hex) {
+                if (!storeOpts.pin.empty()) (void)store_pin(storeOpts.pin, hex);
+                return true;
+            }
+            if (!install_from_store(beDir, hex, storeOpts)) {
+                std::fprintf(stderr, "Failed to install BEClient.\n");
+                return std::unexpected(6);
+            }
+            return true;
+        };
+        if (!storeOpts.use.empty()) {
+            const auto wanted = store_resolve(storeOpts.use);
+            if (!wanted) {
+                std::fprintf(stderr, "No stored BEClient matches %s.\n", storeOpts.use.c_str());
+                return std::unexpected(11);
+            }
+            return install_stored(*wanted);
+        }
+        // a resident --prefetch already has the latest build in the store, one 304 says it still is
+        if (const auto staged = prefetch_staged()) return install_stored(*staged);
+
+        // validators from the last download, only worth sending if we still have what we got back then
+        // (installed, or sitting in the store after a --use switched to something else)
+        const fs::path fetchStatePath = get_launcher_data_dir() / L"beclient.fetch";
+        fetch_state fetchState = load_fetch_state(fetchStatePath).value_or(fetch_state{});
+        if ((!installedHash || fetchState.sha256 != *installedHash) && !store_has(fetchState.sha256)) fetchState = {};
+
+        // fixed name (not a guid temp) so an interrupted ranged download can resume next launch
+        fs::path tempFile = get_launcher_data_dir() / L"BEClient_x64.dll.download";
+        std::optional<std::string> downloadHash;
+        // cheap conditional check first, then a delta from what we have, then the full download as the last resort
+        fetch_state fresh;
+        fetch_result fetched = probe_remote(RELEASE_URL, fetchState, fresh);
+        bool patched = false;
+        if (fetched == fetch_result::downloaded && installedHash) {
+            // separate output so a half finished ranged download in tempFile doesnt get clobbered
+            const fs::path patchedFile = get_launcher_data_dir() / L"BEClient_x64.dll.patched";
+            // a patch that doesnt produce the build the server says is current is no good to us
+            if (auto target = try_delta_update(*installedHash, beClient, patchedFile); target && (fresh.sha256.empty() || *target == fresh.sha256)) {
+                tempFile = patchedFile;
+                fetchState = fresh;
+                fetchState.sha256 = *target;
+                patched = true;
+            }
+        }
+        if (fetched != fetch_result::not_modified && !patched) {
+            // whatever the probe learned about the new build, the download has to match it
+            ranged_options opts = rangedOpts;
+            if (opts.expected_sha256.empty()) opts.expected_sha256 = fresh.sha256;
+            if (!opts.limits.expected_size) opts.limits.expected_size = fresh.size;
+            fetched = fetch_ranged_to_file(RELEASE_URL, tempFile, fetchState, opts);
+        }
+        if (fetched != fetch_result::downloaded && fetched != fetch_result::not_modified) {
+            if (fetched == fetch_result::too_large) std::fprintf(stderr, "Download failed: BEClient is bigger than expected.\n");
+            else if (fetched == fetch_result::size_mismatch) std::fprintf(stderr, "Download failed: incomplete transfer.\n");
+            else if (fetched == fetch_result::hash_mismatch) std::fprintf(stderr, "Download failed: hash mismatch.\n");
+            else std::fprintf(stderr, "Download failed.\n");
+            // a plain failure keeps the partial file around, the journal next to it lets the next run resume
+            if (fetched != fetch_result::failed && fs::exists(tempFile)) {
                 std::error_code ec2;
                 fs::remove(tempFile, ec2);
             }
-            CoUninitialize();
-            return 6;
-        }
-        std::error_code ec3;
-        fs::create_directories(beDir, ec3);
-        std::error_code ec4;
-        fs::rename(tempFile, beClient, ec4);
-        if (ec4) {
-            // rename failed so fallback to copy + delete
-            std::error_code ec5;
-            fs::copy_file(tempFile, beClient, fs::copy_options::overwrite_existing, ec5);
-            std::error_code ec6;
-            fs::remove(tempFile, ec6);
-            if (ec5) {
-                std::fprintf(stderr, "Failed to install BEClient: %s\n", ec4.message().c_str());
-                if (fs::exists(tempFile)) {
-                    std::error_code ec7;
-                    fs::remove(tempFile, ec7);
-                }
-                CoUninitialize();
-                return 6;
+            return std::unexpected(5);
+        }
+        // hashed on the way in (or on an earlier run for a 304), no need to read anything back
+        downloadHash = fetchState.sha256;
+        if (fetched == fetch_result::downloaded) {
+            (void)save_fetch_state(fetchStatePath, fetchState);
+            // every download lands in the store first, the install is just a link to it
+            if (!store_put(tempFile, *downloadHash)) {
+                std::fprintf(stderr, "Failed to store BEClient.\n");
+                return std::unexpected(6);
             }
         }
+
+        // only replace BE dll if hash differs
+        if (installedHash && *installedHash == *downloadHash) {
+            if (!storeOpts.pin.empty()) (void)store_pin(storeOpts.pin, *downloadHash);
+            return true;
+        }
+
+        // swap in a BE dir holding just the new dll. the old one is only deleted once the new one is in place
+        if (!install_from_store(beDir, *downloadHash, storeOpts)) {
+            std::fprintf(stderr, "Failed to install BEClient.\n");
+            return std::unexpected(6);
+        }
+        return true;
+    }
+
+    [[nodiscard]] stage_result<bool> start_steam(const wstr& steam, const std::stop_token& stop) {
+        TRACE_SCOPE("stage: start steam");
+        // ensure steam is running (needed for auth and overlay bs)
+        if (!ensure_steam_running(steam, 30, stop)) {
+            if (!stop.stop_requested()) std::puts("Steam failed to start.");
+            return std::unexpected(7);
+        }
+        return true;
+    }
+
+    [[nodiscard]] stage_result<PROCESS_INFORMATION> launch_client(const game_paths& game, const wstr& steamId) {
+        TRACE_SCOPE("stage: launch client");
+        const auto pi = launch_game_client(game.clientExe, steamId);
+        if (!pi) {
+            DWORD err = GetLastError();
+            std::fprintf(stderr, "Failed to launch Spectre client: WinErr %lu\n", err);
+            return std::unexpected(8);
+        }
+        return *pi;
+    }
+
+    // --verify / --make-manifest: check the whole install against a manifest instead of launching
+    [[nodiscard]] int run_verify(const fs::path& manifest, const bool make, const bool repair, const verify_options& opts) {
+        TRACE_SCOPE("verify mode");
+        const auto steam = find_steam();
+        if (!steam) return steam.error();
+        const auto game = find_game(*steam);
+        if (!game) return game.error();
+
+        if (make) {
+            if (!make_install_manifest(game->root, manifest, opts)) {
+                std::puts("Failed to write verify manifest.");
+                return 9;
+            }
+            return 0;
+        }
+
+        const auto rep = verify_install(game->root, manifest, opts);
+        if (!rep) {
+            std::puts("Could not read verify manifest.");
+            return 9;
+        }
+        const auto list = [](const char* what, const std::vector<fs::path>& paths) {
+            for (const auto& p : paths) std::printf("  %s: %s\n", what, reinterpret_cast<const char*>(p.generic_u8string().c_str()));
+        };
+        list("missing", rep->missing);
+        list("wrong size", rep->wrong_size);
+        list("corrupt", rep->corrupt);
+        const double mb = static_cast<double>(rep->bytes) / (1 << 20);
+        std::printf("%llu files, %.0f MiB hashed in %.1f s (%.0f MiB/s), %zu bad\n", rep->files, mb, rep->seconds,
+                    rep->seconds > 0 ? mb / rep->seconds : 0.0, rep->missing.size() + rep->wrong_size.size() + rep->corrupt.size());
+        if (rep->ok()) return 0;
+        if (repair) {
+            // steam knows how to fetch the right files, we just point it at them
+            std::puts("Asking Steam to repair the install...");
+            ShellExecuteW(nullptr, L"open", (wstr(L"steam://validate/") + APP_ID_STR).c_str(), nullptr, nullptr, SW_SHOWNORMAL);
+        }
+        return 10;
     }
 
-    // ensure steam is running (needed for auth and overlay bs)
-    if (!ensure_steam_running(steam, 30)) {
-        std::puts("Steam failed to start.");
-        CoUninitialize();
-        return 7;
+    // ctrl+c, ctrl+break or closing the console while a fleet runs
+    std::stop_source g_fleetStop;
+
+    BOOL WINAPI on_fleet_console(const DWORD event) {
+        if (event != CTRL_C_EVENT && event != CTRL_BREAK_EVENT && event != CTRL_CLOSE_EVENT) return FALSE;
+        g_fleetStop.request_stop();
+        return TRUE;
     }
 
-    // get current steam user's id
-    auto steamIdOpt = get_current_steamid64(steam);
-    wstr steamId = steamIdOpt.value_or(L"0");
+    // --fleet: one client per identity in the list, supervised together instead of one RunPageTrigger each
+    [[nodiscard]] int run_fleet_mode(const fs::path& list, const ranged_options& rangedOpts, const store_settings& storeOpts, const fleet_options& opts) {
+        TRACE_SCOPE("fleet mode");
+        const auto txt = read_file_bytes(list);
+        const auto members = txt ? parse_fleet_list(*txt) : std::nullopt;
+        if (!members || members->empty()) {
+            std::puts("Could not read fleet list.");
+            return 13;
+        }
+        // same preparation a single launch does, just once for everyone
+        const auto steam = find_steam();
+        if (!steam) return steam.error();
+        const auto game = find_game(*steam);
+        if (!game) return game.error();
+        if (const auto up = update_beclient(*game, rangedOpts, storeOpts); !up) return up.error();
+        if (const auto st = start_steam(*steam, {}); !st) return st.error();
+
+        std::printf("launching %zu clients, %zu starting at a time\n", members->size(), opts.max_starting);
+        SetConsoleCtrlHandler(on_fleet_console, TRUE);
+        const auto host = make_client_fleet_host(game->clientExe, members->size());
+        const auto results = run_fleet(*host, *members, opts, g_fleetStop.get_token());
+        print_fleet_report(*members, results);
+        const bool allGood = std::ranges::all_of(results, [](const fleet_result& r) { return r.outcome == fleet_outcome::submitted; });
+        // the clients are the load, so they stay up until asked and then go together with the host
+        if (!g_fleetStop.stop_requested()) {
+            std::puts("Fleet is running, Ctrl+C stops every client.");
+            std::mutex lock;
+            std::condition_variable_any cv;
+            std::unique_lock lk(lock);
+            cv.wait(lk, g_fleetStop.get_token(), [] { return false; });
+        }
+        return allGood ? 0 : 14;
+    }
+} // anon namespace
 
-    // setup env vars for steam overlay and our backend
-    std::vector<std::pair<wstr, wstr>> overrides = {
-        { L"STEAMID",            steamId },
-        { L"SteamGameId",        APP_ID_STR },
-        { L"SteamAppId",         APP_ID_STR },
-        { L"SteamOverlayGameId", APP_ID_STR },
+int wmain(int argc, wchar_t** argv) {
+    ranged_options rangedOpts{ .limits = { .max_bytes = MAX_BECLIENT_BYTES } };
+    trigger_wait_policy triggerPolicy;
+    // our patched dll never matches what steam shipped, so its not part of the install check
+    // BattlEye.* covers what staged_install leaves next to it (.staging, .swap, .old.<ts>)
+    verify_options verifyOpts{ .skip = { fs::path(L"Spectre") / L"Binaries" / L"Win64" / L"BattlEye",
+                                         fs::path(L"Spectre") / L"Binaries" / L"Win64" / L"BattlEye.*" } };
+    fs::path verifyManifest;
+    bool makeManifest = false, repair = false, prefetch = false;
+    fs::path fleetList;
+    fleet_options fleetOpts;
+    bool benchBackend = false;
+    backend_bench_options benchOpts;
+    prefetch_options prefetchOpts;
+    // background downloads shouldnt be noticeable in a game or a call
+    unsigned long long prefetchRate = 1ull << 20;
+    store_settings storeOpts;
+    std::string triggerSig;
+    std::optional<size_t> triggerSigRel32;
+    long long triggerSigOffset = 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::wstring_view arg = argv[i];
+        // ignore the hash cache and rehash everything we look at
+        if (arg == L"--rehash") hash_cache_force_revalidate(true);
+        // tuning for the ranged downloader, only kicks in for big artifacts on servers that support ranges
+        else if (arg == L"--connections" && i + 1 < argc) rangedOpts.connections = _wtoi(argv[++i]);
+        else if (arg == L"--chunk-mb" && i + 1 < argc) rangedOpts.chunk_size = static_cast<unsigned long long>(_wtoi(argv[++i])) << 20;
+        // upper bound on how long after the trigger page shows up we notice it
+        else if (arg == L"--trigger-latency-ms" && i + 1 < argc) triggerPolicy.max_interval_ms = static_cast<unsigned long>(_wtoi(argv[++i]));
+        // find the trigger page by byte signature ("48 8D 0D ?? ?? ?? ??") instead of the built in offset. the
+        // match can be an instruction whose rip relative disp32 (at the given offset into the match) points at it
+        else if (arg == L"--trigger-sig" && i + 1 < argc) triggerSig = narrow_utf8(argv[++i]).value_or("");
+        else if (arg == L"--trigger-sig-rel32" && i + 1 < argc) triggerSigRel32 = static_cast<size_t>(std::max(0, _wtoi(argv[++i])));
+        else if (arg == L"--trigger-sig-offset" && i + 1 < argc) triggerSigOffset = _wtoi64(argv[++i]);
+        // chrome://tracing / perfetto json of where the launch time goes
+        else if (arg == L"--trace" && i + 1 < argc) trace_start(argv[++i]);
+        // hash the whole install against a manifest (or write one from a known good install) and exit
+        else if (arg == L"--verify" && i + 1 < argc) verifyManifest = argv[++i];
+        else if (arg == L"--make-manifest" && i + 1 < argc) { verifyManifest = argv[++i]; makeManifest = true; }
+        else if (arg == L"--repair") repair = true;
+        else if (arg == L"--verify-threads" && i + 1 < argc) verifyOpts.threads = static_cast<size_t>(_wtoi(argv[++i]));
+        // launch with a BEClient we already have (pin name or digest prefix) without touching the network
+        else if (arg == L"--use" && i + 1 < argc) storeOpts.use = narrow_utf8(argv[++i]).value_or("");
+        // keep whatever this run installs out of the store gc under a name of our own
+        else if (arg == L"--pin" && i + 1 < argc) storeOpts.pin = narrow_utf8(argv[++i]).value_or("");
+        else if (arg == L"--store-limit-mb" && i + 1 < argc) storeOpts.limit_bytes = static_cast<unsigned long long>(_wtoi(argv[++i])) << 20;
+        // stay resident and fetch new releases ahead of time, the launches after that skip the download
+        else if (arg == L"--prefetch") prefetch = true;
+        else if (arg == L"--prefetch-once") prefetch = prefetchOpts.once = true;
+        else if (arg == L"--prefetch-interval-min" && i + 1 < argc) prefetchOpts.interval = std::chrono::minutes(std::max(1, _wtoi(argv[++i])));
+        else if (arg == L"--prefetch-kbps" && i + 1 < argc) prefetchRate = static_cast<unsigned long long>(_wtoi(argv[++i])) << 10;
+        // load testing: launch a client per identity in the list ("<steamid64> [extra args]" per line)
+        else if (arg == L"--fleet" && i + 1 < argc) fleetList = argv[++i];
+        else if (arg == L"--fleet-concurrency" && i + 1 < argc) fleetOpts.max_starting = static_cast<size_t>(std::max(1, _wtoi(argv[++i])));
+        else if (arg == L"--fleet-stagger-ms" && i + 1 < argc) fleetOpts.stagger = std::chrono::milliseconds(std::max(0, _wtoi(argv[++i])));
+        // how often a client that dies before its trigger gets started again, and the first wait before that
+        else if (arg == L"--fleet-restarts" && i + 1 < argc) fleetOpts.restarts = static_cast<unsigned>(std::max(0, _wtoi(argv[++i])));
+        else if (arg == L"--fleet-backoff-ms" && i + 1 < argc) fleetOpts.backoff = std::chrono::milliseconds(std::max(0, _wtoi(argv[++i])));
+        // hammer the provider id endpoint with synthetic logins and report latency, nothing gets launched
+        else if (arg == L"--bench-backend") benchBackend = true;
+        else if (arg == L"--bench-rate" && i + 1 < argc) benchOpts.rate = _wtof(argv[++i]);
+        else if (arg == L"--bench-concurrency" && i + 1 < argc) benchOpts.concurrency = static_cast<size_t>(std::max(1, _wtoi(argv[++i])));
+        else if (arg == L"--bench-threads" && i + 1 < argc) benchOpts.threads = static_cast<size_t>(std::max(0, _wtoi(argv[++i])));
+        else if (arg == L"--bench-seconds" && i + 1 < argc) benchOpts.duration = std::chrono::seconds(std::max(1, _wtoi(argv[++i])));
+        // required, a local or staging stand-in. the production backend is refused
+        else if (arg == L"--bench-url" && i + 1 < argc) benchOpts.url = argv[++i];
+    }
+    if (!trace_enabled()) {
+        wchar_t tracePath[MAX_PATH];
+        if (const DWORD n = GetEnvironmentVariableW(L"SPECTRE_TRACE", tracePath, MAX_PATH); n > 0 && n < MAX_PATH) trace_start(tracePath);
+    }
+    // flush the trace on every way out of here
+    const auto finish = [](const int rc) {
+        const hash_cache_counters hc = hash_cache_get_counters();
+        trace_counter("hash cache hits", static_cast<long long>(hc.hits));
+        trace_counter("hash cache misses", static_cast<long long>(hc.misses));
+        const process_watch_counters pw = process_watch_get_counters();
+        trace_counter("process refreshes", static_cast<long long>(pw.refreshes));
+        trace_counter("process snapshots", static_cast<long long>(pw.snapshots));
+        trace_counter("library rescans", static_cast<long long>(library_index_get_counters().rescans));
+        // the old BattlEye tree may still be getting deleted, and that thread traces too
+        staged_wait_cleanup();
+        trace_write();
+        return rc;
     };
-    auto envBlock = make_environment_with_overrides(overrides);
-
-    // point the game at our pragmabackend
-    wstr args = L"-PragmaEnvironment=live -PragmaBackendAddress=";
-    args.append(BACKEND_ADDRESS);
-    wstr cmd = L"\"";
-
-    cmd.append(clientExe.wstring());
-    cmd.append(L"\" ");
-    cmd.append(args);
-
-    std::vector cmdBuf(cmd.begin(), cmd.end());
-    cmdBuf.push_back(L'\0');
-    wstr cwd = clientExe.parent_path().wstring();
-
-    // launch the game with our envs
-    STARTUPINFOW si{ .cb = sizeof(si) };
-    PROCESS_INFORMATION pi{};
-    BOOL ok = CreateProcessW(
-        nullptr,
-        cmdBuf.data(),
-        nullptr, nullptr, FALSE,
-        CREATE_UNICODE_ENVIRONMENT,
-        envBlock.data(),
-        cwd.c_str(),
-        &si, &pi
-    );
-
-    if (!ok) {
-        DWORD err = GetLastError();
-        std::fprintf(stderr, "Failed to launch Spectre client: WinErr %lu\n", err);
-        CoUninitialize();
-        return 8;
+
+    if (!triggerSig.empty()) {
+        auto sig = make_trigger_signature(triggerSig, triggerSigRel32, triggerSigOffset);
+        if (!sig) {
+            std::fprintf(stderr, "Invalid trigger signature: %s\n", triggerSig.c_str());
+            return finish(15);
+        }
+        set_trigger_signature(std::move(*sig));
     }
 
-    RunPageTrigger(pi.hProcess, pi.dwProcessId, steamId);
+    if (!verifyManifest.empty()) return finish(run_verify(verifyManifest, makeManifest, repair, verifyOpts));
+    if (benchBackend) return finish(run_backend_bench(benchOpts));
+    if (!fleetList.empty()) return finish(run_fleet_mode(fleetList, rangedOpts, storeOpts, fleetOpts));
+    if (prefetch) {
+        prefetchOpts.download = rangedOpts;
+        prefetchOpts.download.limits.max_bytes_per_sec = prefetchRate;
+        prefetchOpts.store_limit_bytes = storeOpts.limit_bytes;
+        return finish(run_prefetch(prefetchOpts));
+    }
+
+    // steam startup, game discovery + the BEClient update and the steamid lookup dont depend on each other,
+    // so they run side by side and only the launch waits for all of them. stages are added in the order
+    // the old sequential flow ran them so the exit code on failure stays the same
+    task_graph graph(4);
+    const auto steam = graph.add([](std::stop_token) { return find_steam(); });
+    const auto game = graph.add([steam](std::stop_token) { return find_game(steam.get()); }, { steam.id });
+    const auto update = graph.add([game, &rangedOpts, &storeOpts](std::stop_token) { return update_beclient(game.get(), rangedOpts, storeOpts); }, { game.id });
+    const auto steamUp = graph.add([steam](const std::stop_token& st) { return start_steam(steam.get(), st); }, { steam.id });
+    // get current steam user's id, the registry only has it once steam is up
+    const auto steamId = graph.add([steam](std::stop_token) {
+        return stage_result<wstr>(get_current_steamid64(steam.get()).value_or(L"0"));
+    }, { steamUp.id });
+    const auto launch = graph.add([game, steamId](std::stop_token) {
+        return launch_client(game.get(), steamId.get());
+    }, { game.id, update.id, steamId.id });
+
+    if (const int rc = graph.run(); rc != 0) return finish(rc);
+
+    const PROCESS_INFORMATION& pi = launch.get();
+    RunPageTrigger(pi.hProcess, pi.dwProcessId, steamId.get(), triggerPolicy);
 
     CloseHandle(pi.hThread);
     CloseHandle(pi.hProcess);
 
-    CoUninitialize();
-    return 0;
+    return finish(0);
 }
\ No newline at end of file
@@ -1,162 +1,217 @@
 #include "page_trigger.h"
+#include "http_client.h"
+#include "trace.h"
+#include "utf.h"
+#include <chrono>
 #include <iostream>
-#include <tlhelp32.h>
-#include <winhttp.h>
+#include <mutex>
+#include <thread>
 #include <optional>
 #include <string>
 
 namespace {
     inline constexpr std::uintptr_t TARGET_RVA = 0x320B000;
+    // a packed exe only has its real code once it has unpacked itself, so a miss gets retried for a while
+    inline constexpr int MAX_SCANS = 60;
+    inline constexpr auto SCAN_RETRY = std::chrono::milliseconds(500);
 
-    [[nodiscard]] std::string narrow_ascii(const wstr& w) {
-        std::string s;
-        s.reserve(w.size());
-        for (wchar_t ch : w) {
-            s.push_back(static_cast<char>(ch));
-        }
-        return s;
-    }
+    std::optional<trigger_signature> g_signature;
 
-    [[nodiscard]] std::optional<std::uintptr_t> get_main_module_base(DWORD pid) {
-        HANDLE snap = CreateToolhelp32Snapshot(
-            TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32,
-            pid
-        );
-        if (snap == INVALID_HANDLE_VALUE) {
-            return std::nullopt;
-        }
+    [[nodiscard]] bool wait_for_target_rva_readable(const native_process process, const process_id pid, const trigger_wait_policy& policy,
+                                                    backend_warmer& warmer) {
+        TRACE_SCOPE("wait_for_target_rva_readable");
+        std::cout << "waiting for player to press start in-game..." << std::endl;
 
-        MODULEENTRY32W me{};
-        me.dwSize = sizeof(me);
+        target_page_probe probe = make_trigger_probe(process, pid);
+        trigger_wait_stats stats;
+        const wait_outcome res = wait_adaptive(process, [&] {
+            const probe_state st = probe.poll();
+            // the game is getting somewhere, so the trigger may not be far off
+            if (st == probe_state::progress) warmer.nudge();
+            return st;
+        }, policy, stats);
+        trace_counter("trigger polls", static_cast<long long>(stats.polls));
+        trace_counter("trigger wait cpu us", static_cast<long long>(stats.cpu_us));
+
+        if (res != wait_outcome::ready) return false;
+        std::cout << "player pressed start" << std::endl;
+        return true;
+    }
 
-        std::optional<std::uintptr_t> base;
-        if (Module32FirstW(snap, &me)) {
-            base = reinterpret_cast<std::uintptr_t>(me.modBaseAddr);
-        }
+    inline constexpr auto SUBMIT_URL = L"http://game.spectre.astro-dev.uk/v1/submitproviderid";
 
-        CloseHandle(snap);
-        return base;
+    [[nodiscard]] bool submit_provider_id(const std::string& body) {
+        TRACE_SCOPE("submit_provider_id");
+        auto res = http_send(provider_id_request(body));
+        if (!res) {
+            return false;
+        }
+        std::string reply;
+        (void)res->read_all(reply);
+        return true;
     }
+} // anon namespace
 
-    [[nodiscard]] bool wait_for_target_rva_readable(HANDLE process, DWORD pid) {
-        constexpr std::uintptr_t rva = TARGET_RVA;
+backend_warmer::backend_warmer(wstr url, const std::chrono::milliseconds rewarm, const unsigned max_warms)
+    : url_(std::move(url)), rewarm_(rewarm), max_(max_warms), thread_([this](const std::stop_token st) { run(st); }) {}
 
-        std::cout << "waiting for player to press start in-game..." << std::endl;
-        Sleep(5000);
-
-        std::optional<std::uintptr_t> base;
-
-        for (;;) {
-            DWORD code = 0;
-            if (GetExitCodeProcess(process, &code) && code != STILL_ACTIVE) {
-                return false;
-            }
-
-            if (!base) {
-                base = get_main_module_base(pid);
-            }
-
-            if (base) {
-                const void* addr = reinterpret_cast<const void*>(*base + rva);
-                MEMORY_BASIC_INFORMATION mbi{};
-                if (VirtualQueryEx(process, addr, &mbi, sizeof(mbi)) == sizeof(mbi)) {
-                    if (mbi.State == MEM_COMMIT &&
-                        !(mbi.Protect & PAGE_GUARD) &&
-                        !(mbi.Protect & PAGE_NOACCESS)) {
-
-                        const DWORD prot = mbi.Protect & 0xffu;
-                        if (prot == PAGE_READONLY ||
-                            prot == PAGE_READWRITE ||
-                            prot == PAGE_WRITECOPY ||
-                            prot == PAGE_EXECUTE_READ ||
-                            prot == PAGE_EXECUTE_READWRITE ||
-                            prot == PAGE_EXECUTE_WRITECOPY) {
-                            std::cout << "player pressed start" << std::endl;
-                            return true;
-                        }
-                    }
-                }
-            }
-
-            Sleep(1);
+void backend_warmer::stop() {
+    thread_.request_stop();
+}
+
+void backend_warmer::nudge() {
+    {
+        std::scoped_lock lk(lock_);
+        nudged_ = true;
+    }
+    cv_.notify_one();
+}
+
+[[nodiscard]] unsigned backend_warmer::warms() const {
+    std::scoped_lock lk(lock_);
+    return warms_;
+}
+
+void backend_warmer::run(const std::stop_token st) {
+    TRACE_SCOPE("backend warmer");
+    std::unique_lock lk(lock_);
+    auto last = std::chrono::steady_clock::time_point{};
+    bool first = true;
+    while (warms_ < max_) {
+        if (!first) {
+            // a nudge just after the last warm is nothing the pooled socket cant cover
+            if (!cv_.wait(lk, st, [this] { return nudged_; })) return;
+            nudged_ = false;
+            if (std::chrono::steady_clock::now() - last < rewarm_) continue;
         }
+        first = false;
+        ++warms_;
+        lk.unlock();
+        (void)http_prewarm(url_);
+        last = std::chrono::steady_clock::now();
+        lk.lock();
+    }
+}
+
+[[nodiscard]] std::string provider_id_body(const wstr& steamId) {
+    return std::string(R"({"providerId":")") + narrow_utf8(steamId).value_or("") + R"("})";
+}
+
+[[nodiscard]] http_request provider_id_request(const std::string_view body) {
+    http_request req;
+    req.verb = L"POST";
+    req.url = SUBMIT_URL;
+    req.headers = L"Content-Type: application/json\r\n";
+    req.body = body;
+    // the player is sitting on the title screen at this point, dont leave them hanging on a dead backend
+    req.timeout = std::chrono::seconds(10);
+    req.attempts = 3;
+    // a submit that timed out after going out may well have been recorded, sending it again would log the
+    // player in twice. only a connect that never happened is safe to repeat
+    req.retry_unsent_only = true;
+    req.follow_redirects = false;
+    return req;
+}
+
+[[nodiscard]] target_page_probe make_trigger_probe(const native_process process, const process_id pid) {
+    return { .process = { process, pid }, .rva = TARGET_RVA, .locate = g_signature ? &*g_signature : nullptr };
+}
+
+void set_trigger_signature(trigger_signature sig) {
+    g_signature = std::move(sig);
+}
+
+[[nodiscard]] bool submit_steam_id(const wstr& steamId) {
+    return !steamId.empty() && submit_provider_id(provider_id_body(steamId));
+}
+
+[[nodiscard]] probe_state target_page_probe::poll() {
+    probe_state res = probe_state::waiting;
+    if (!base) {
+        base = remote_main_module_base(process);
+        if (!base) return probe_state::waiting;
+        res = probe_state::progress;
     }
 
-    [[nodiscard]] bool submit_provider_id(const wstr& steamId) {
-        static constexpr wchar_t HOST[] = L"game.spectre.astro-dev.uk";
-        static constexpr wchar_t PATH[] = L"/v1/submitproviderid";
-        static constexpr INTERNET_PORT PORT = 80;
-        static constexpr DWORD REQUEST_FLAGS = 0;
-
-        HINTERNET hSession = WinHttpOpen(
-            L"SpectreLauncher/1.0",
-            WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-            nullptr,
-            nullptr,
-            0
-        );
-        if (!hSession) {
-            return false;
+    if (locate) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now < next_scan) return res;
+        const auto found = locate_trigger_rva(process, *base, *locate);
+        if (found) {
+            rva = *found;
+        } else if (found.error() != locate_error::ambiguous && ++scans < MAX_SCANS) {
+            next_scan = now + SCAN_RETRY;
+            return res;
+        } else {
+            std::cout << "trigger signature " << (found.error() == locate_error::ambiguous ? "is ambiguous" : "not found")
+                      << ", using the built in offset" << std::endl;
         }
+        locate = nullptr;
+        res = probe_state::progress;
+    }
 
-        HINTERNET hConnect = WinHttpConnect(hSession, HOST, PORT, 0);
-        if (!hConnect) {
-            WinHttpCloseHandle(hSession);
-            return false;
-        }
+    const auto page = remote_query(process, *base + rva);
+    if (!page) return res;
 
-        HINTERNET hRequest = WinHttpOpenRequest(
-            hConnect,
-            L"POST",
-            PATH,
-            nullptr,
-            nullptr,
-            WINHTTP_DEFAULT_ACCEPT_TYPES,
-            REQUEST_FLAGS
-        );
-        if (!hRequest) {
-            WinHttpCloseHandle(hConnect);
-            WinHttpCloseHandle(hSession);
-            return false;
+    // any change in the region (reserved -> committed, protection flips) means the game is getting there
+    if (page->state != last_state || page->protect != last_protect) {
+        last_state = page->state;
+        last_protect = page->protect;
+        res = probe_state::progress;
+    }
+    return page->readable ? probe_state::ready : res;
+}
+
+[[nodiscard]] wait_outcome wait_adaptive(const native_process process, const std::function<probe_state()>& probe,
+                                         const trigger_wait_policy& policy, trigger_wait_stats& stats) {
+    const unsigned long long cpuStart = thread_cpu_us();
+    const unsigned long minInterval = policy.min_interval_ms ? policy.min_interval_ms : 1;
+    const unsigned long maxInterval = policy.max_interval_ms > minInterval ? policy.max_interval_ms : minInterval;
+    unsigned long interval = minInterval;
+
+    wait_outcome out = wait_outcome::failed;
+    for (;;) {
+        ++stats.polls;
+        const probe_state st = probe();
+        if (st == probe_state::ready) {
+            out = wait_outcome::ready;
+            break;
         }
+        interval = st == probe_state::progress ? minInterval : (interval * 2 < maxInterval ? interval * 2 : maxInterval);
 
-        const std::string id   = narrow_ascii(steamId);
-        const std::string body = std::string(R"({"providerId":")") + id + R"("})";
-
-        BOOL ok = WinHttpSendRequest(
-            hRequest,
-            L"Content-Type: application/json\r\n",
-            -1L,
-            const_cast<void*>(static_cast<const void*>(body.data())),
-            static_cast<DWORD>(body.size()),
-            static_cast<DWORD>(body.size()),
-            0
-        );
-        if (!ok) {
-            WinHttpCloseHandle(hRequest);
-            WinHttpCloseHandle(hConnect);
-            WinHttpCloseHandle(hSession);
-            return false;
+        // sleeping on the process itself doubles as the exit check, no polling for an exit code
+        const process_wait w = wait_process_exit(process, std::chrono::milliseconds(interval));
+        if (w == process_wait::exited) {
+            out = wait_outcome::process_exited;
+            break;
         }
-
-        ok = WinHttpReceiveResponse(hRequest, nullptr);
-
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return ok == TRUE;
+        if (w != process_wait::timed_out) break;
     }
-} // anon namespace
+    stats.cpu_us += thread_cpu_us() - cpuStart;
+    return out;
+}
 
-bool RunPageTrigger(HANDLE processHandle, DWORD pid, const wstr& steamId) {
-    if (!processHandle || steamId.empty()) {
+bool RunPageTrigger(const native_process processHandle, const process_id pid, const wstr& steamId, const trigger_wait_policy& policy) {
+    TRACE_SCOPE("RunPageTrigger");
+    if (processHandle == NO_PROCESS || steamId.empty()) {
         return false;
     }
 
-    const bool rva_ok = wait_for_target_rva_readable(processHandle, pid);
+    // everything the post needs is ready before the trigger, so all thats left after it is the send itself
+    const std::string body = provider_id_body(steamId);
+    backend_warmer warmer(SUBMIT_URL);
+
+    const bool rva_ok = wait_for_target_rva_readable(processHandle, pid, policy, warmer);
+    warmer.stop();
+    trace_counter("backend warms", warmer.warms());
     if (!rva_ok) {
         return false;
     }
 
-    return submit_provider_id(steamId);
+    const auto fired = std::chrono::steady_clock::now();
+    const bool ok = submit_provider_id(body);
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - fired);
+    trace_counter("trigger to response us", latency.count());
+    std::cout << "provider id " << (ok ? "submitted" : "submit failed") << " in " << latency.count() / 1000.0 << " ms" << std::endl;
+    return ok;
 }
\ No newline at end of file
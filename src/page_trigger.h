@@ -1,6 +1,104 @@
 #pragma once
 
 #include "common.h"
-#include "registry_utils.h"
+#include "http_client.h"
+#include "remote_process.h"
+#include "trigger_locator.h"
 
-bool RunPageTrigger(HANDLE processHandle, DWORD pid, const wstr& steamId);
\ No newline at end of file
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// how the trigger wait backs off. polls start at min_interval_ms and double on every miss up to
+// max_interval_ms, so max_interval_ms is the worst case latency once the player has been idle a while
+struct trigger_wait_policy {
+    unsigned long min_interval_ms = 1;
+    unsigned long max_interval_ms = 25;
+};
+
+struct trigger_wait_stats {
+    unsigned long long polls = 0;
+    unsigned long long cpu_us = 0;  // cpu time this thread spent in the wait (user + kernel)
+};
+
+enum class probe_state {
+    waiting,   // nothing new
+    progress,  // something moved (module showed up, region changed), poll fast again
+    ready,
+};
+
+enum class wait_outcome { ready, process_exited, failed };
+
+// polls probe with adaptive backoff. between polls it waits on the process handle itself so
+// an exiting game wakes us right away instead of on the next poll
+[[nodiscard]] wait_outcome wait_adaptive(native_process process, const std::function<probe_state()>& probe,
+                                         const trigger_wait_policy& policy, trigger_wait_stats& stats);
+
+// probe for "the page at main module base + rva is committed and readable". keeps the module base
+// once it has it so the expensive lookup only happens until the exe is mapped. with a signature the rva
+// comes from scanning the image once it is mapped, and stays at what it was set to if that never works out
+struct target_page_probe {
+    remote_process process;
+    std::uintptr_t rva = 0;
+    std::optional<std::uintptr_t> base;
+    unsigned long last_state = 0;
+    unsigned long last_protect = 0;
+    const trigger_signature* locate = nullptr;
+    int scans = 0;
+    std::chrono::steady_clock::time_point next_scan{};
+
+    [[nodiscard]] probe_state poll();
+};
+
+// the probe for the page that means the player pressed start
+[[nodiscard]] target_page_probe make_trigger_probe(native_process process, process_id pid);
+
+// find the trigger page with this signature from now on, the built in rva is only the fallback
+void set_trigger_signature(trigger_signature sig);
+
+// keeps a socket to the backend open while RunPageTrigger waits so the post doesnt pay for dns + connect. warms
+// once when it starts, then again only when nudged (the probe saw the game move towards the title screen) and
+// the last warm is old enough for the socket to have gone idle. max_warms caps the whole thing, a player
+// sitting in a menu for an hour shouldnt mean a HEAD to production every few seconds
+struct backend_warmer {
+    // servers tend to drop idle keep-alive sockets after 30-60s, so refresh well before that
+    static constexpr auto REWARM_INTERVAL = std::chrono::seconds(15);
+    static constexpr unsigned MAX_WARMS = 4;
+
+    explicit backend_warmer(wstr url, std::chrono::milliseconds rewarm = REWARM_INTERVAL, unsigned max_warms = MAX_WARMS);
+
+    backend_warmer(const backend_warmer&) = delete;
+    backend_warmer& operator=(const backend_warmer&) = delete;
+
+    void nudge();
+    // no more warms from here on. doesnt wait for one thats in flight, that happens when this goes away
+    void stop();
+    // HEADs sent so far
+    [[nodiscard]] unsigned warms() const;
+
+private:
+    void run(std::stop_token st);
+
+    wstr url_;
+    std::chrono::milliseconds rewarm_;
+    unsigned max_;
+    mutable std::mutex lock_;
+    std::condition_variable_any cv_;
+    bool nudged_ = false;
+    unsigned warms_ = 0;
+    std::jthread thread_;
+};
+
+// {"providerId":"<steamid64>"}
+[[nodiscard]] std::string provider_id_body(const wstr& steamId);
+
+// the provider id post exactly as RunPageTrigger sends it. the request only views body, so keep it alive
+[[nodiscard]] http_request provider_id_request(std::string_view body);
+
+// posts steamId to the backend as the provider id, what RunPageTrigger does once the page is up
+[[nodiscard]] bool submit_steam_id(const wstr& steamId);
+
+bool RunPageTrigger(native_process processHandle, process_id pid, const wstr& steamId, const trigger_wait_policy& policy = {});
\ No newline at end of file
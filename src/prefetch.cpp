@@ -0,0 +1,144 @@
+#include "prefetch.h"
+#include "artifact_store.h"
+#include "file_utils.h"
+#include "trace.h"
+#include "utf.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+
+namespace {
+    using sys = std::chrono::system_clock;
+
+    // what the last good check found, key=value lines like the fetch state next to it
+    struct prefetch_state {
+        long long checked = 0;  // unix seconds, only for people reading the file
+        std::string sha256;
+        // what the release answered with for that build, the launch sends them back to see if it still is
+        std::string etag;
+        std::string last_modified;
+    };
+
+    [[nodiscard]] fs::path state_path() {
+        return get_launcher_data_dir() / L"prefetch.state";
+    }
+
+    [[nodiscard]] std::optional<prefetch_state> load_state() {
+        const auto txt = read_file_bytes(state_path());
+        if (!txt) return std::nullopt;
+        prefetch_state s;
+        std::istringstream in(*txt);
+        for (std::string line; std::getline(in, line); ) {
+            const auto eq = line.find('=');
+            if (eq == std::string::npos) continue;
+            const std::string key = line.substr(0, eq);
+            const std::string val = line.substr(eq + 1);
+            if (key == "checked") s.checked = std::strtoll(val.c_str(), nullptr, 10);
+            else if (key == "sha256") s.sha256 = val;
+            else if (key == "etag") s.etag = val;
+            else if (key == "last_modified") s.last_modified = val;
+        }
+        return s;
+    }
+
+    [[nodiscard]] bool save_state(const prefetch_state& s) {
+        std::string out;
+        out += "checked=" + std::to_string(s.checked) + "\n";
+        out += "sha256=" + s.sha256 + "\n";
+        out += "etag=" + s.etag + "\n";
+        out += "last_modified=" + s.last_modified + "\n";
+        return write_file_atomic(state_path(), out);
+    }
+
+    [[nodiscard]] long long now_seconds() {
+        return std::chrono::duration_cast<std::chrono::seconds>(sys::now().time_since_epoch()).count();
+    }
+
+    // one conditional check against the release, new builds go straight into the store.
+    // returns the latest build's digest and validators, nullopt if we couldnt find out
+    [[nodiscard]] std::optional<fetch_state> check_release(const wchar_t* url, const ranged_options& download) {
+        TRACE_SCOPE("prefetch check");
+        // shared with the launcher, whoever downloads a build first saves everyone else the trip
+        const fs::path fetchStatePath = get_launcher_data_dir() / L"beclient.fetch";
+        fetch_state state = load_fetch_state(fetchStatePath).value_or(fetch_state{});
+        if (!store_has(state.sha256)) state = {};
+
+        fetch_state fresh;
+        fetch_result res = probe_remote(url, state, fresh);
+        if (res == fetch_result::not_modified) return state;
+        if (res != fetch_result::downloaded) return std::nullopt;
+
+        // not the launcher's .download file, a launch while we're mid download must not trip over us
+        const fs::path tempFile = get_launcher_data_dir() / L"BEClient_x64.dll.prefetch";
+        ranged_options opts = download;
+        if (opts.expected_sha256.empty()) opts.expected_sha256 = fresh.sha256;
+        if (!opts.limits.expected_size) opts.limits.expected_size = fresh.size;
+        res = fetch_ranged_to_file(url, tempFile, state, opts);
+        if (res == fetch_result::not_modified) return state;
+        if (res != fetch_result::downloaded) {
+            // plain failures keep the partial file and journal so the next round resumes
+            if (res != fetch_result::failed) {
+                std::error_code ec;
+                fs::remove(tempFile, ec);
+            }
+            return std::nullopt;
+        }
+        if (!store_put(tempFile, state.sha256)) return std::nullopt;
+        (void)save_fetch_state(fetchStatePath, state);
+        return state;
+    }
+} // anon namespace
+
+[[nodiscard]] int run_prefetch(const prefetch_options& opts) {
+    TRACE_SCOPE("prefetch mode");
+    const file_lock lock = try_lock_file(get_launcher_data_dir() / L"prefetch.lock");
+    if (!lock) {
+        std::puts("Another prefetcher is already running.");
+        return 12;
+    }
+    // cpu and disk both yield to whatever the user is actually doing
+    if (!opts.once) {
+#ifdef _WIN32
+        SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN);
+#else
+        (void)setpriority(PRIO_PROCESS, 0, 19);
+#endif
+    }
+
+    for (;;) {
+        const auto latest = check_release(opts.url.c_str(), opts.download);
+        if (latest) {
+            // keeps the gc off it until a newer one takes the name
+            (void)store_pin("latest", latest->sha256);
+            (void)save_state({ now_seconds(), latest->sha256, narrow_utf8(latest->etag).value_or(""),
+                               narrow_utf8(latest->last_modified).value_or("") });
+            store_gc(opts.store_limit_bytes);
+            std::printf("prefetch: latest BEClient is %.16s\n", latest->sha256.c_str());
+        } else {
+            std::fprintf(stderr, "prefetch: release check failed, trying again next round\n");
+        }
+        if (opts.once) return latest ? 0 : 5;
+        std::fflush(stdout);
+        std::this_thread::sleep_for(opts.interval);
+    }
+}
+
+[[nodiscard]] std::optional<std::string> prefetch_staged(const wchar_t* url) {
+    TRACE_SCOPE("prefetch_staged");
+    const auto s = load_state();
+    if (!s || s->sha256.empty() || !store_has(s->sha256)) return std::nullopt;
+    // without validators there is nothing to ask about, and how old the check is says nothing about whether
+    // a release went out since
+    if (s->etag.empty() && s->last_modified.empty()) return std::nullopt;
+    const fetch_state staged{ .etag = widen_utf8(s->etag).value_or(L""), .last_modified = widen_utf8(s->last_modified).value_or(L""),
+                              .sha256 = s->sha256 };
+    fetch_state fresh;
+    if (probe_remote(url, staged, fresh) != fetch_result::not_modified) return std::nullopt;
+    return s->sha256;
+}
\ No newline at end of file
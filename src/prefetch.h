@@ -0,0 +1,29 @@
+#pragma once
+
+#include "common.h"
+#include "downloader.h"
+#include <chrono>
+
+// --prefetch: stays resident and checks RELEASE_URL on a schedule, pulling new BEClient builds into the
+// artifact store at a throttled rate. it leaves what it found in prefetch.state (digest plus the validators
+// the release had then), so the next launch only needs one conditional request to know the stored build is
+// still current before it swaps it in, instead of downloading anything.
+// one prefetcher per user at a time, the rest bail out on prefetch.lock
+
+struct prefetch_options {
+    std::chrono::minutes interval{ 30 };
+    // one check and exit, for running it from task scheduler instead of leaving it resident
+    bool once = false;
+    ranged_options download;
+    unsigned long long store_limit_bytes = 256ull << 20;
+    // where releases come from, a local stand-in for the tests
+    wstr url = RELEASE_URL;
+};
+
+// returns the exit code: 0, 5 when a --prefetch-once check failed, 12 if another prefetcher holds the lock
+[[nodiscard]] int run_prefetch(const prefetch_options& opts);
+
+// digest of the build the prefetcher staged, once a conditional probe of url came back 304 for the
+// validators it was staged under and the store still has it. a newer release, a server that doesnt send
+// validators or no answer at all means nullopt, and the launch goes through the usual update check
+[[nodiscard]] std::optional<std::string> prefetch_staged(const wchar_t* url = RELEASE_URL);
\ No newline at end of file
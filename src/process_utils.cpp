@@ -1,87 +1,102 @@
 #include "process_utils.h"
+#include "env_block.h"
+#include "process_watcher.h"
+#include "trace.h"
 #include <windows.h>
-#include <tlhelp32.h>
-#include <map>
 #include <chrono>
 
-[[nodiscard]] bool is_process_running(const std::wstring_view exe_name) {
-    HANDLE snap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (snap == INVALID_HANDLE_VALUE) return false;
-    PROCESSENTRY32W pe{ .dwSize = sizeof(pe) };
-    bool found = false;
-    if (Process32FirstW(snap, &pe)) {
-        do {
-            if (_wcsicmp(pe.szExeFile, wstr(exe_name).c_str()) == 0) { 
-                found = true; 
-                break; 
-            }
-        } while (Process32NextW(snap, &pe));
+namespace {
+    // CreateProcessW with the quoted exe + args. returns the process handle (or null), caller closes it
+    [[nodiscard]] HANDLE spawn(const fs::path& exe, const wstr& args, const fs::path& cwd) {
+        wstr cmd = L"\"";
+        cmd.append(exe.wstring());
+        cmd.append(L"\" ");
+        cmd.append(args);
+
+        std::vector cmdBuf(cmd.begin(), cmd.end());
+        cmdBuf.push_back(L'\0');
+
+        STARTUPINFOW si{ .cb = sizeof(si) };
+        PROCESS_INFORMATION pi{};
+        const wstr cwdW = cwd.wstring();
+        if (!CreateProcessW(nullptr, cmdBuf.data(), nullptr, nullptr, FALSE, 0, nullptr, cwdW.c_str(), &si, &pi)) return nullptr;
+        CloseHandle(pi.hThread);
+        return pi.hProcess;
     }
-    CloseHandle(snap);
-    return found;
+} // anon namespace
+
+[[nodiscard]] bool is_process_running(const std::wstring_view exe_name) {
+    TRACE_SCOPE("is_process_running");
+    return process_watch_find(exe_name).has_value();
 }
 
 [[nodiscard]] bool start_process(const fs::path& exe, const wstr& args, const fs::path& cwd) {
-    wstr cmd = L"\"";
-    cmd.append(exe.wstring());
-    cmd.append(L"\" ");
-    cmd.append(args);
-    
-    std::vector cmdBuf(cmd.begin(), cmd.end());
-    cmdBuf.push_back(L'\0');
-
-    STARTUPINFOW si{ .cb = sizeof(si) };
-    PROCESS_INFORMATION pi{};
-    const wstr cwdW = cwd.wstring();
-    BOOL ok = CreateProcessW(nullptr, cmdBuf.data(), nullptr, nullptr, FALSE, 0, nullptr, cwdW.c_str(), &si, &pi);
-    if (ok) { 
-        CloseHandle(pi.hThread); 
-        CloseHandle(pi.hProcess); 
-    }
-    return ok == TRUE;
+    TRACE_SCOPE("start_process");
+    HANDLE h = spawn(exe, args, cwd);
+    if (!h) return false;
+    CloseHandle(h);
+    return true;
 }
 
-[[nodiscard]] bool ensure_steam_running(const wstr& steam_path, const int timeout_sec) {
+[[nodiscard]] bool ensure_steam_running(const wstr& steam_path, const int timeout_sec, const std::stop_token stop) {
+    TRACE_SCOPE("ensure_steam_running");
     if (is_process_running(L"steam.exe")) return true;
     const fs::path steam_exe = fs::path(steam_path) / L"steam.exe";
     // launch steam in silent mode so it doesnt spam the user with windows
-    (void)start_process(steam_exe, L"-silent", fs::path(steam_path));
-    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_sec);
-    while (std::chrono::steady_clock::now() < deadline) {
-        if (is_process_running(L"steam.exe")) return true;
-        Sleep(500);
-    }
-    return false;
+    HANDLE child = spawn(steam_exe, L"-silent", fs::path(steam_path));
+    const bool up = process_watch_wait(L"steam.exe", std::chrono::seconds(timeout_sec), stop, child);
+    if (child) CloseHandle(child);
+    return up;
 }
 
 [[nodiscard]] std::vector<wchar_t> make_environment_with_overrides(const std::vector<std::pair<wstr, wstr>>& overrides) {
-    std::map<wstr, wstr, std::less<>> env;
-    // copy current environment
-    if (LPWCH block = GetEnvironmentStringsW()) {
-        for (const wchar_t* p = block; *p; ) {
-            wstr entry = p;
-            p += entry.size() + 1;
-            if (const auto pos = entry.find(L'='); pos != wstr::npos && pos != 0) {
-                wstr key = entry.substr(0, pos);
-                const wstr val = entry.substr(pos + 1);
-                env[key] = val;
-            }
-        }
-        FreeEnvironmentStringsW(block);
-    }
-    // apply our overrides
-    for (const auto& [k, v] : overrides) env[k] = v;
-    // build the environment block (null terminated strings followed by a final null)
-    std::vector<wchar_t> out;
-    for (const auto& [k, v] : env) {
-        wstr line;
-        line.reserve(k.size() + 1 + v.size());
-        line = k;
-        line += L"=";
-        line += v;
-        out.insert(out.end(), line.begin(), line.end());
-        out.push_back(L'\0');
-    }
-    out.push_back(L'\0');
+    TRACE_SCOPE("make_environment_with_overrides");
+    LPWCH block = GetEnvironmentStringsW();
+    auto out = merge_environment_block(block, overrides);
+    if (block) FreeEnvironmentStringsW(block);
     return out;
+}
+
+[[nodiscard]] std::optional<PROCESS_INFORMATION> launch_game_client(const fs::path& exe, const wstr& steamId, const wstr& extra_args) {
+    TRACE_SCOPE("launch_game_client");
+    // setup env vars for steam overlay and our backend
+    std::vector<std::pair<wstr, wstr>> overrides = {
+        { L"STEAMID",            steamId },
+        { L"SteamGameId",        APP_ID_STR },
+        { L"SteamAppId",         APP_ID_STR },
+        { L"SteamOverlayGameId", APP_ID_STR },
+    };
+    auto envBlock = make_environment_with_overrides(overrides);
+
+    // point the game at our pragmabackend
+    wstr args = L"-PragmaEnvironment=live -PragmaBackendAddress=";
+    args.append(BACKEND_ADDRESS);
+    if (!extra_args.empty()) {
+        args.append(L" ");
+        args.append(extra_args);
+    }
+    wstr cmd = L"\"";
+
+    cmd.append(exe.wstring());
+    cmd.append(L"\" ");
+    cmd.append(args);
+
+    std::vector cmdBuf(cmd.begin(), cmd.end());
+    cmdBuf.push_back(L'\0');
+    wstr cwd = exe.parent_path().wstring();
+
+    // launch the game with our envs
+    STARTUPINFOW si{ .cb = sizeof(si) };
+    PROCESS_INFORMATION pi{};
+    const BOOL ok = CreateProcessW(
+        nullptr,
+        cmdBuf.data(),
+        nullptr, nullptr, FALSE,
+        CREATE_UNICODE_ENVIRONMENT,
+        envBlock.data(),
+        cwd.c_str(),
+        &si, &pi
+    );
+    if (!ok) return std::nullopt;
+    return pi;
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common.h"
+#include <windows.h>
+#include <stop_token>
 #include <string_view>
 #include <vector>
 
@@ -10,8 +12,12 @@
 // spawns a new process with the given args and working dir
 [[nodiscard]] bool start_process(const fs::path& exe, const wstr& args, const fs::path& cwd);
 
-// makes sure steam is running before we launch the game
-[[nodiscard]] bool ensure_steam_running(const wstr& steam_path, int timeout_sec);
+// makes sure steam is running before we launch the game. gives up early if stop is requested
+[[nodiscard]] bool ensure_steam_running(const wstr& steam_path, int timeout_sec, std::stop_token stop = {});
+
+// starts the game client pointed at our backend, with steamId and the app ids in its environment. extra_args
+// go after the backend args. nullopt on failure with GetLastError still set, otherwise the caller closes both handles
+[[nodiscard]] std::optional<PROCESS_INFORMATION> launch_game_client(const fs::path& exe, const wstr& steamId, const wstr& extra_args = {});
 
 // builds a new environment block with our custom vars injected
 [[nodiscard]] std::vector<wchar_t> make_environment_with_overrides(const std::vector<std::pair<wstr, wstr>>& overrides);
\ No newline at end of file
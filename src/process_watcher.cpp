@@ -0,0 +1,126 @@
+#include "process_watcher_os.h"
+#include "trace.h"
+#include <algorithm>
+#include <cwctype>
+#include <iterator>
+#include <mutex>
+
+// the os specific half lives in process_watcher_win.cpp / process_watcher_posix.cpp
+
+namespace {
+    using steady = std::chrono::steady_clock;
+
+    // how long a new pid gets named again on every refresh where NAMES_SETTLE, fork to exec is well under this
+    inline constexpr auto SETTLE_TIME = std::chrono::seconds(1);
+
+    std::mutex g_lock;
+    bool g_primed = false;
+    // names are stored lowercased, empty means we couldnt find out (protected/system stuff)
+    std::unordered_map<process_id, wstr> g_names;
+    std::vector<process_id> g_pids;
+    // pids seen recently enough that their name may still change, with when they showed up
+    std::vector<std::pair<process_id, steady::time_point>> g_settling;
+    process_watch_counters g_counters;
+
+    void name_from_snapshot() {
+        TRACE_SCOPE("process snapshot");
+        ++g_counters.snapshots;
+        os_name_all(g_names);
+    }
+
+    // names of pids that only just showed up, in case they exec'd into something else since
+    void rename_settling(const steady::time_point now) {
+        std::erase_if(g_settling, [now](const auto& s) {
+            const auto it = g_names.find(s.first);
+            if (it == g_names.end() || now - s.second > SETTLE_TIME) return true;
+            if (auto name = os_image_name(s.first)) it->second = std::move(*name);
+            return false;
+        });
+    }
+
+    void refresh_locked() {
+        ++g_counters.refreshes;
+        std::vector<process_id> now;
+        now.reserve(g_pids.size() + 64);
+        if (!os_read_pids(now)) return;
+        std::ranges::sort(now);
+
+        // gone
+        for (auto it = g_names.begin(); it != g_names.end();) {
+            if (!std::ranges::binary_search(now, it->first)) it = g_names.erase(it);
+            else ++it;
+        }
+
+        // new
+        std::vector<process_id> fresh;
+        std::ranges::set_difference(now, g_pids, std::back_inserter(fresh));
+        g_pids = std::move(now);
+        const auto at = steady::now();
+        if constexpr (NAMES_SETTLE) rename_settling(at);
+        if (fresh.empty()) return;
+
+        for (const process_id pid : fresh) g_names.emplace(pid, wstr{});
+        // whatever was there before the first refresh has long had its final name
+        if constexpr (NAMES_SETTLE) {
+            if (g_primed) for (const process_id pid : fresh) g_settling.emplace_back(pid, at);
+        }
+        if (!g_primed || fresh.size() > SNAPSHOT_THRESHOLD) {
+            g_primed = true;
+            name_from_snapshot();
+            return;
+        }
+        bool missing = false;
+        for (const process_id pid : fresh) {
+            if (auto name = os_image_name(pid)) {
+                g_names[pid] = std::move(*name);
+                ++g_counters.names_resolved;
+            } else {
+                missing = true;
+            }
+        }
+        // something we cant open, toolhelp still knows its name
+        if (missing) name_from_snapshot();
+    }
+} // anon namespace
+
+[[nodiscard]] wstr lowered(const std::wstring_view s) {
+    wstr out(s);
+    for (auto& c : out) c = static_cast<wchar_t>(std::towlower(c));
+    return out;
+}
+
+void process_watch_refresh() {
+    TRACE_SCOPE("process_watch_refresh");
+    std::scoped_lock lk(g_lock);
+    refresh_locked();
+}
+
+[[nodiscard]] std::optional<process_id> process_watch_find(const std::wstring_view exe_name) {
+    const wstr want = lowered(exe_name);
+    std::scoped_lock lk(g_lock);
+    refresh_locked();
+    for (auto& [pid, name] : g_names) {
+        if (name != want) continue;
+        // the pid could have been reused by something else between two refreshes, so double check hits
+        if (auto current = os_image_name(pid); current && *current != want) {
+            name = std::move(*current);
+            continue;
+        }
+        return pid;
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] process_watch_counters process_watch_get_counters() {
+    std::scoped_lock lk(g_lock);
+    return g_counters;
+}
+
+void process_watch_reset() {
+    std::scoped_lock lk(g_lock);
+    g_primed = false;
+    g_names.clear();
+    g_pids.clear();
+    g_settling.clear();
+    g_counters = {};
+}
\ No newline at end of file
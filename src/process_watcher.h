@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common.h"
+#include "remote_process.h"
+#include <chrono>
+#include <stop_token>
+#include <string_view>
+
+// keeps a pid -> exe name index of whats running so we dont have to snapshot the whole system on every check.
+// the first refresh takes one toolhelp snapshot, after that only the pid list is read and just the new pids get
+// their names looked up. off windows the pid list is /proc and a name is argv[0] out of /proc/<pid>/cmdline
+
+struct process_watch_counters {
+    unsigned long long refreshes = 0;
+    unsigned long long snapshots = 0;      // full toolhelp snapshots (first run, or lots of new/unnameable pids)
+    unsigned long long names_resolved = 0; // new pids named one at a time
+};
+
+// brings the index up to date. cheap when nothing started since the last call
+void process_watch_refresh();
+
+// refreshes and returns the pid of a running process with this exe name (case insensitive), if any
+[[nodiscard]] std::optional<process_id> process_watch_find(std::wstring_view exe_name);
+
+// waits until a process with this exe name shows up. also wakes straight away when stop is requested or when
+// spawned (optional, a process we started ourselves) exits, since thats usually the bootstrapper handing over
+[[nodiscard]] bool process_watch_wait(std::wstring_view exe_name, std::chrono::milliseconds timeout,
+                                      std::stop_token stop = {}, native_process spawned = NO_PROCESS);
+
+[[nodiscard]] process_watch_counters process_watch_get_counters();
+
+// forgets everything, the next refresh starts from scratch like the first one did
+void process_watch_reset();
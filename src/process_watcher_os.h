@@ -0,0 +1,34 @@
+#pragma once
+
+#include "process_watcher.h"
+#include <unordered_map>
+#include <vector>
+
+// the platform half of process_watcher, only process_watcher*.cpp include this
+
+// how often a waiter re-reads the pid list. a refresh with nothing new is one pass over the pid list
+inline constexpr auto POLL_INTERVAL = std::chrono::milliseconds(50);
+// past this many new pids in one go a single snapshot is cheaper than naming each of them
+inline constexpr size_t SNAPSHOT_THRESHOLD = 64;
+
+// lowercased, how names are kept in the index
+[[nodiscard]] wstr lowered(std::wstring_view s);
+
+// every pid running right now, any order. false if the list couldnt be read
+[[nodiscard]] bool os_read_pids(std::vector<process_id>& out);
+
+// just the file name part of the exe, lowercased. nullopt if pid is gone or we cant look at it
+[[nodiscard]] std::optional<wstr> os_image_name(process_id pid);
+
+// names every pid in names in one pass over the system (a toolhelp snapshot on windows), only touches pids
+// that are already in there
+void os_name_all(std::unordered_map<process_id, wstr>& names);
+
+// whether a pid can change its name after we saw it. a forked child has its parent's name until it execs, so
+// off windows new pids get named again for a little while
+inline constexpr bool NAMES_SETTLE =
+#ifdef _WIN32
+    false;
+#else
+    true;
+#endif
\ No newline at end of file
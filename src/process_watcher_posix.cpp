@@ -0,0 +1,102 @@
+#include "process_watcher_os.h"
+#include "trace.h"
+#include "utf.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+
+namespace {
+    // the start of a small /proc file, empty if it couldnt be read
+    [[nodiscard]] std::string read_proc(const process_id pid, const char* what) {
+        const std::string file = "/proc/" + std::to_string(pid) + "/" + what;
+        const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return {};
+        char buf[512];
+        ssize_t n;
+        do n = ::read(fd, buf, sizeof(buf));
+        while (n < 0 && errno == EINTR);
+        ::close(fd);
+        return n > 0 ? std::string(buf, static_cast<size_t>(n)) : std::string();
+    }
+} // anon namespace
+
+[[nodiscard]] std::optional<wstr> os_image_name(const process_id pid) {
+    // argv[0] rather than the exe link: under wine every process is the preloader, but argv[0] is the windows
+    // path of the game or steam.exe. kernel threads, zombies and a process halfway through exec have no cmdline,
+    // comm names those (the last one gets named again once it settles)
+    std::string cmd = read_proc(pid, "cmdline");
+    std::string_view name(cmd.c_str());
+    if (const auto slash = name.find_last_of("/\\"); slash != std::string_view::npos) name.remove_prefix(slash + 1);
+    if (name.empty()) {
+        cmd = read_proc(pid, "comm");
+        if (cmd.empty()) return std::nullopt;
+        if (cmd.back() == '\n') cmd.pop_back();
+        name = cmd;
+    }
+    const auto wide = widen_utf8(name);
+    if (!wide) return std::nullopt;
+    return lowered(*wide);
+}
+
+void os_name_all(std::unordered_map<process_id, wstr>& names) {
+    // nothing like a toolhelp snapshot here, one pass over the ones we dont have a name for yet
+    for (auto& [pid, name] : names) {
+        if (!name.empty()) continue;
+        if (auto n = os_image_name(pid)) name = std::move(*n);
+    }
+}
+
+[[nodiscard]] bool os_read_pids(std::vector<process_id>& out) {
+    out.clear();
+    DIR* proc = ::opendir("/proc");
+    if (!proc) return false;
+    while (const dirent* e = ::readdir(proc)) {
+        const char* p = e->d_name;
+        if (*p < '1' || *p > '9') continue;
+        process_id pid = 0;
+        for (; *p >= '0' && *p <= '9'; ++p) pid = pid * 10 + (*p - '0');
+        if (!*p) out.push_back(pid);
+    }
+    ::closedir(proc);
+    return true;
+}
+
+[[nodiscard]] bool process_watch_wait(const std::wstring_view exe_name, const std::chrono::milliseconds timeout,
+                                      const std::stop_token stop, native_process spawned) {
+    TRACE_SCOPE("process_watch_wait");
+    if (process_watch_find(exe_name)) return true;
+
+    const int wake = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake < 0) return false;
+    bool found = false;
+    {
+        // scoped so the callback is unregistered before the eventfd gets closed
+        std::stop_callback onStop(stop, [wake] {
+            const std::uint64_t one = 1;
+            (void)!::write(wake, &one, sizeof(one));
+        });
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!stop.stop_requested()) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) break;
+            pollfd fds[2] = { { wake, POLLIN, 0 }, { spawned, POLLIN, 0 } };
+            const int r = ::poll(fds, spawned != NO_PROCESS ? 2 : 1, static_cast<int>(std::min(POLL_INTERVAL, left).count()));
+            if (r > 0 && fds[0].revents) break;
+            // our child is gone, look right away and stop watching it
+            if (r > 0 && fds[1].revents) spawned = NO_PROCESS;
+            else if (r < 0 && errno != EINTR) ::usleep(static_cast<useconds_t>(POLL_INTERVAL.count() * 1000));
+            if (process_watch_find(exe_name)) {
+                found = true;
+                break;
+            }
+        }
+    }
+    ::close(wake);
+    return found;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "process_watcher_os.h"
+#include "trace.h"
+#include <windows.h>
+#include <tlhelp32.h>
+#include <psapi.h>
+#include <algorithm>
+#include <iterator>
+
+[[nodiscard]] std::optional<wstr> os_image_name(const process_id pid) {
+    HANDLE h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!h) return std::nullopt;
+    wchar_t buf[MAX_PATH * 2];
+    DWORD len = static_cast<DWORD>(std::size(buf));
+    const BOOL ok = QueryFullProcessImageNameW(h, 0, buf, &len);
+    CloseHandle(h);
+    if (!ok) return std::nullopt;
+    std::wstring_view full(buf, len);
+    if (const auto slash = full.find_last_of(L"\\/"); slash != std::wstring_view::npos) full.remove_prefix(slash + 1);
+    return lowered(full);
+}
+
+void os_name_all(std::unordered_map<process_id, wstr>& names) {
+    HANDLE snap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (snap == INVALID_HANDLE_VALUE) return;
+    PROCESSENTRY32W pe{ .dwSize = sizeof(pe) };
+    if (Process32FirstW(snap, &pe)) {
+        do {
+            if (const auto it = names.find(pe.th32ProcessID); it != names.end()) it->second = lowered(pe.szExeFile);
+        } while (Process32NextW(snap, &pe));
+    }
+    CloseHandle(snap);
+}
+
+[[nodiscard]] bool os_read_pids(std::vector<process_id>& out) {
+    if (out.size() < 1024) out.resize(1024);
+    for (;;) {
+        DWORD needed = 0;
+        const DWORD bytes = static_cast<DWORD>(out.size() * sizeof(DWORD));
+        if (!K32EnumProcesses(out.data(), bytes, &needed)) return false;
+        // a full buffer means there might be more, the api doesnt tell us how many
+        if (needed < bytes) {
+            out.resize(needed / sizeof(DWORD));
+            return true;
+        }
+        out.resize(out.size() * 2);
+    }
+}
+
+[[nodiscard]] bool process_watch_wait(const std::wstring_view exe_name, const std::chrono::milliseconds timeout,
+                                      const std::stop_token stop, native_process spawned) {
+    TRACE_SCOPE("process_watch_wait");
+    if (process_watch_find(exe_name)) return true;
+
+    HANDLE wake = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!wake) return false;
+    bool found = false;
+    {
+        // scoped so the callback is unregistered before the event gets closed
+        std::stop_callback onStop(stop, [wake] { SetEvent(wake); });
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!stop.stop_requested()) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) break;
+            const HANDLE handles[2] = { wake, spawned };
+            const DWORD count = spawned ? 2 : 1;
+            const DWORD r = WaitForMultipleObjects(count, handles, FALSE, static_cast<DWORD>(std::min(POLL_INTERVAL, left).count()));
+            if (r == WAIT_OBJECT_0) break;
+            // our child is gone, look right away and stop watching it
+            if (r == WAIT_OBJECT_0 + 1) spawned = nullptr;
+            else if (r == WAIT_FAILED) Sleep(static_cast<DWORD>(POLL_INTERVAL.count()));
+            if (process_watch_find(exe_name)) {
+                found = true;
+                break;
+            }
+        }
+    }
+    CloseHandle(wake);
+    return found;
+}
\ No newline at end of file
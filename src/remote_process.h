@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common.h"
+#include <chrono>
+#include <cstdint>
+
+// looking at another process from the outside: waiting for it to exit, finding its exe, reading its memory and
+// asking what is mapped where. remote_process_win.cpp does it with the process HANDLE, remote_process_posix.cpp
+// with a pidfd plus /proc/<pid>/maps and process_vm_readv
+
+// a HANDLE and a DWORD pid on windows, a pidfd and a pid_t everywhere else
+#ifdef _WIN32
+using native_process = void*;
+inline constexpr native_process NO_PROCESS = nullptr;
+using process_id = unsigned long;
+#else
+using native_process = int;
+inline constexpr native_process NO_PROCESS = -1;
+using process_id = int;
+#endif
+
+// the process we are watching. doesnt own handle, whoever opened it closes it
+struct remote_process {
+    native_process handle = NO_PROCESS;
+    process_id pid = 0;
+};
+
+// a handle good for waiting on and reading from. NO_PROCESS if pid is gone or not ours to look at
+[[nodiscard]] native_process open_process(process_id pid);
+void close_process(native_process h);
+
+enum class process_wait { exited, timed_out, failed };
+
+// blocks until h exits or timeout passes
+[[nodiscard]] process_wait wait_process_exit(native_process h, std::chrono::milliseconds timeout);
+
+// where the exe is mapped. nullopt while the process is too early in its startup to tell
+[[nodiscard]] std::optional<std::uintptr_t> remote_main_module_base(const remote_process& p);
+
+// all n bytes at addr or false
+[[nodiscard]] bool remote_read(const remote_process& p, std::uintptr_t addr, void* dst, size_t n);
+
+struct remote_page {
+    // raw MEM_* state and PAGE_* protection on windows. elsewhere state is 1 when something is mapped there
+    // and protect the rwx bits of the mapping, so a change in either still means the page moved
+    unsigned long state = 0;
+    unsigned long protect = 0;
+    bool readable = false;  // committed and readable without tripping a guard page
+};
+
+// what the page holding addr looks like right now. nullopt if the process couldnt be asked
+[[nodiscard]] std::optional<remote_page> remote_query(const remote_process& p, std::uintptr_t addr);
+
+// cpu time the calling thread has used so far (user + kernel), in microseconds
+[[nodiscard]] unsigned long long thread_cpu_us();
\ No newline at end of file
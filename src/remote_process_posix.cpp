@@ -0,0 +1,166 @@
+#include "remote_process.h"
+#include "trace.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+namespace {
+    struct mapping {
+        std::uintptr_t start = 0;
+        std::uintptr_t end = 0;
+        unsigned long perms = 0;  // 1 r, 2 w, 4 x
+        unsigned long long offset = 0;
+        std::string_view path;
+    };
+
+    [[nodiscard]] std::uintptr_t parse_hex(std::string_view& s) {
+        std::uintptr_t v = 0;
+        while (!s.empty()) {
+            const char c = s.front();
+            unsigned d;
+            if (c >= '0' && c <= '9') d = static_cast<unsigned>(c - '0');
+            else if (c >= 'a' && c <= 'f') d = static_cast<unsigned>(c - 'a' + 10);
+            else break;
+            v = v << 4 | d;
+            s.remove_prefix(1);
+        }
+        return v;
+    }
+
+    // past the next space separated field and the spaces after it
+    void skip_field(std::string_view& s) {
+        while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+        while (!s.empty() && s.front() != ' ') s.remove_prefix(1);
+        while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+    }
+
+    // "start-end perms offset dev inode   path"
+    [[nodiscard]] bool parse_mapping(std::string_view line, mapping& m) {
+        m.start = parse_hex(line);
+        if (line.empty() || line.front() != '-') return false;
+        line.remove_prefix(1);
+        m.end = parse_hex(line);
+        if (line.size() < 5 || line.front() != ' ') return false;
+        m.perms = (line[1] == 'r' ? 1ul : 0ul) | (line[2] == 'w' ? 2ul : 0ul) | (line[3] == 'x' ? 4ul : 0ul);
+        skip_field(line);
+        m.offset = parse_hex(line);
+        skip_field(line);
+        skip_field(line);
+        m.path = line;
+        return true;
+    }
+
+    // calls fn for every mapping in address order until it returns false. reads in pieces so a lookup near the
+    // bottom of a big address space doesnt pull the whole maps file in
+    template <typename Fn>
+    bool for_each_mapping(const process_id pid, Fn&& fn) {
+        const std::string file = "/proc/" + std::to_string(pid) + "/maps";
+        const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        std::string buf;
+        char chunk[16 << 10];
+        bool ok = true;
+        for (;;) {
+            const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) ok = false;
+            if (n <= 0) break;
+            buf.append(chunk, static_cast<size_t>(n));
+            size_t pos = 0;
+            for (size_t nl; (nl = buf.find('\n', pos)) != std::string::npos; pos = nl + 1) {
+                mapping m;
+                if (parse_mapping(std::string_view(buf).substr(pos, nl - pos), m) && !fn(m)) {
+                    ::close(fd);
+                    return true;
+                }
+            }
+            buf.erase(0, pos);
+        }
+        ::close(fd);
+        return ok;
+    }
+
+    [[nodiscard]] bool ends_with_exe(const std::string_view path) {
+        if (path.size() < 4) return false;
+        const std::string_view ext = path.substr(path.size() - 4);
+        return ext[0] == '.' && (ext[1] | 0x20) == 'e' && (ext[2] | 0x20) == 'x' && (ext[3] | 0x20) == 'e';
+    }
+} // anon namespace
+
+[[nodiscard]] native_process open_process(const process_id pid) {
+    // a pidfd turns readable once the process exits, whether or not its our child
+    return static_cast<native_process>(::syscall(SYS_pidfd_open, pid, 0));
+}
+
+void close_process(const native_process h) {
+    if (h != NO_PROCESS) ::close(h);
+}
+
+[[nodiscard]] process_wait wait_process_exit(const native_process h, const std::chrono::milliseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd p{ h, POLLIN, 0 };
+        const int r = ::poll(&p, 1, static_cast<int>(std::clamp<long long>(left.count(), 0, INT_MAX)));
+        if (r > 0) return p.revents & POLLNVAL ? process_wait::failed : process_wait::exited;
+        if (r == 0) return process_wait::timed_out;
+        if (errno != EINTR) return process_wait::failed;
+    }
+}
+
+[[nodiscard]] std::optional<std::uintptr_t> remote_main_module_base(const remote_process& p) {
+    TRACE_SCOPE("get_main_module_base");
+    const std::string proc = "/proc/" + std::to_string(p.pid);
+    char exe[PATH_MAX];
+    const ssize_t len = ::readlink((proc + "/exe").c_str(), exe, sizeof(exe));
+    const std::string_view exePath(exe, len > 0 ? static_cast<size_t>(len) : 0);
+
+    // under wine/proton the process is the preloader and the game exe is just another mapped file, which wins.
+    // a native process is the first mapping of its own binary
+    std::optional<std::uintptr_t> native, pe;
+    if (!for_each_mapping(p.pid, [&](const mapping& m) {
+            if (ends_with_exe(m.path)) {
+                pe = m.start;
+                return false;
+            }
+            if (!native && m.offset == 0 && !exePath.empty() && m.path == exePath) native = m.start;
+            return true;
+        })) {
+        return std::nullopt;
+    }
+    return pe ? pe : native;
+}
+
+[[nodiscard]] bool remote_read(const remote_process& p, const std::uintptr_t addr, void* dst, const size_t n) {
+    iovec local{ dst, n };
+    iovec remote{ reinterpret_cast<void*>(addr), n };
+    // stops at the first page it cant read, same as ReadProcessMemory
+    return ::process_vm_readv(p.pid, &local, 1, &remote, 1, 0) == static_cast<ssize_t>(n);
+}
+
+[[nodiscard]] std::optional<remote_page> remote_query(const remote_process& p, const std::uintptr_t addr) {
+    remote_page out;
+    if (!for_each_mapping(p.pid, [&](const mapping& m) {
+            if (m.start > addr) return false;
+            if (addr >= m.end) return true;
+            out = { 1, m.perms, (m.perms & 1) != 0 };
+            return false;
+        })) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+[[nodiscard]] unsigned long long thread_cpu_us() {
+    timespec ts{};
+    if (::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return static_cast<unsigned long long>(ts.tv_sec) * 1'000'000ull + static_cast<unsigned long long>(ts.tv_nsec) / 1000;
+}
\ No newline at end of file
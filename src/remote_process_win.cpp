@@ -0,0 +1,84 @@
+#include "remote_process.h"
+#include "trace.h"
+#include <windows.h>
+#include <tlhelp32.h>
+#include <psapi.h>
+
+[[nodiscard]] native_process open_process(const process_id pid) {
+    return OpenProcess(SYNCHRONIZE | PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
+}
+
+void close_process(const native_process h) {
+    if (h) CloseHandle(h);
+}
+
+[[nodiscard]] process_wait wait_process_exit(const native_process h, const std::chrono::milliseconds timeout) {
+    // sleeping on the process handle doubles as the exit check, no GetExitCodeProcess polling
+    const DWORD w = WaitForSingleObject(h, static_cast<DWORD>(timeout.count()));
+    if (w == WAIT_OBJECT_0) return process_wait::exited;
+    return w == WAIT_TIMEOUT ? process_wait::timed_out : process_wait::failed;
+}
+
+[[nodiscard]] std::optional<std::uintptr_t> remote_main_module_base(const remote_process& p) {
+    TRACE_SCOPE("get_main_module_base");
+    // first module in the loader list is the exe, way cheaper than a toolhelp snapshot.
+    // fails with ERROR_PARTIAL_COPY while the process is still starting up
+    HMODULE first = nullptr;
+    DWORD needed = 0;
+    if (K32EnumProcessModules(p.handle, &first, sizeof(first), &needed) && first) {
+        return reinterpret_cast<std::uintptr_t>(first);
+    }
+
+    HANDLE snap = CreateToolhelp32Snapshot(
+        TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32,
+        p.pid
+    );
+    if (snap == INVALID_HANDLE_VALUE) {
+        return std::nullopt;
+    }
+
+    MODULEENTRY32W me{};
+    me.dwSize = sizeof(me);
+
+    std::optional<std::uintptr_t> base;
+    if (Module32FirstW(snap, &me)) {
+        base = reinterpret_cast<std::uintptr_t>(me.modBaseAddr);
+    }
+
+    CloseHandle(snap);
+    return base;
+}
+
+[[nodiscard]] bool remote_read(const remote_process& p, const std::uintptr_t addr, void* dst, const size_t n) {
+    SIZE_T got = 0;
+    return ReadProcessMemory(p.handle, reinterpret_cast<LPCVOID>(addr), dst, n, &got) && got == n;
+}
+
+[[nodiscard]] std::optional<remote_page> remote_query(const remote_process& p, const std::uintptr_t addr) {
+    MEMORY_BASIC_INFORMATION mbi{};
+    if (VirtualQueryEx(p.handle, reinterpret_cast<LPCVOID>(addr), &mbi, sizeof(mbi)) != sizeof(mbi)) return std::nullopt;
+
+    remote_page out{ mbi.State, mbi.Protect, false };
+    if (mbi.State == MEM_COMMIT &&
+        !(mbi.Protect & PAGE_GUARD) &&
+        !(mbi.Protect & PAGE_NOACCESS)) {
+
+        const DWORD prot = mbi.Protect & 0xffu;
+        out.readable = prot == PAGE_READONLY ||
+                       prot == PAGE_READWRITE ||
+                       prot == PAGE_WRITECOPY ||
+                       prot == PAGE_EXECUTE_READ ||
+                       prot == PAGE_EXECUTE_READWRITE ||
+                       prot == PAGE_EXECUTE_WRITECOPY;
+    }
+    return out;
+}
+
+[[nodiscard]] unsigned long long thread_cpu_us() {
+    FILETIME created{}, exited{}, kernel{}, user{};
+    if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) return 0;
+    const auto to_us = [](const FILETIME& ft) {
+        return ((static_cast<unsigned long long>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 10;
+    };
+    return to_us(kernel) + to_us(user);
+}
\ No newline at end of file
@@ -0,0 +1,267 @@
+#include "sha256.h"
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SHA256_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SHA_NI_TARGET
+#else
+#include <cpuid.h>
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1")))
+#endif
+#endif
+
+namespace {
+    using block_fn = void (*)(std::uint32_t state[8], const unsigned char* data, size_t blocks);
+
+    inline constexpr std::uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    inline constexpr std::uint32_t H0[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    [[nodiscard]] constexpr std::uint32_t rotr(const std::uint32_t x, const int n) {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    [[nodiscard]] std::uint32_t load_be32(const unsigned char* p) {
+        return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+               (static_cast<std::uint32_t>(p[2]) << 8)  |  static_cast<std::uint32_t>(p[3]);
+    }
+
+    void blocks_scalar(std::uint32_t state[8], const unsigned char* data, size_t blocks) {
+        std::uint32_t w[64];
+        for (; blocks; --blocks, data += 64) {
+            for (int i = 0; i < 16; ++i) w[i] = load_be32(data + 4 * i);
+            for (int i = 16; i < 64; ++i) {
+                const std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; ++i) {
+                const std::uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+                const std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+    }
+
+#ifdef SHA256_X86
+    // intel sha extensions, 4 rounds per sha256rnds2 pair. layout follows intel's reference code
+    SHA_NI_TARGET void blocks_shani(std::uint32_t state[8], const unsigned char* data, size_t blocks) {
+        const __m128i BSWAP = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+        __m128i tmp    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+        __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+        tmp    = _mm_shuffle_epi32(tmp, 0xB1);          // cdab
+        state1 = _mm_shuffle_epi32(state1, 0x1B);       // efgh
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // abef
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);    // cdgh
+
+        for (; blocks; --blocks, data += 64) {
+            const __m128i abef_save = state0;
+            const __m128i cdgh_save = state1;
+
+            __m128i msg0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0)), BSWAP);
+            __m128i msg1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)), BSWAP);
+            __m128i msg2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)), BSWAP);
+            __m128i msg3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)), BSWAP);
+            __m128i msg;
+
+            // rounds 0-15 just consume the message words
+            msg = _mm_add_epi32(msg0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K[0])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+
+            msg = _mm_add_epi32(msg1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K[4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+            msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+            msg = _mm_add_epi32(msg2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K[8])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+            msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+
+            // rounds 12-63 all look the same, the message schedule just rotates through msg0..msg3
+            __m128i* m[4] = { &msg0, &msg1, &msg2, &msg3 };
+            for (int r = 3; r < 16; ++r) {
+                __m128i& cur  = *m[r & 3];
+                __m128i& prev = *m[(r + 3) & 3];
+                __m128i& next = *m[(r + 1) & 3];
+                msg = _mm_add_epi32(cur, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K[4 * r])));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                if (r < 15) {
+                    next = _mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4));
+                    next = _mm_sha256msg2_epu32(next, cur);
+                }
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+                if (r < 13) prev = _mm_sha256msg1_epu32(prev, cur);
+            }
+
+            state0 = _mm_add_epi32(state0, abef_save);
+            state1 = _mm_add_epi32(state1, cdgh_save);
+        }
+
+        tmp    = _mm_shuffle_epi32(state0, 0x1B);       // feba
+        state1 = _mm_shuffle_epi32(state1, 0xB1);       // dchg
+        state0 = _mm_blend_epi16(tmp, state1, 0xF0);    // dcba
+        state1 = _mm_alignr_epi8(state1, tmp, 8);       // abef
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+    }
+
+    [[nodiscard]] bool cpu_has_shani() {
+        // need sha (leaf 7 ebx bit 29) plus ssse3/sse4.1 for the shuffles and blends
+#if defined(_MSC_VER)
+        int r[4]{};
+        __cpuid(r, 0);
+        if (r[0] < 7) return false;
+        __cpuid(r, 1);
+        const bool sse = (r[2] & (1 << 9)) && (r[2] & (1 << 19));
+        __cpuidex(r, 7, 0);
+        return sse && (r[1] & (1 << 29));
+#else
+        unsigned a = 0, b = 0, c = 0, d = 0;
+        if (!__get_cpuid(1, &a, &b, &c, &d)) return false;
+        const bool sse = (c & (1u << 9)) && (c & (1u << 19));
+        if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return false;
+        return sse && (b & (1u << 29));
+#endif
+    }
+#endif
+
+    struct backend {
+        block_fn fn;
+        const char* name;
+    };
+
+    // everything this build can run on this cpu, best first
+    [[nodiscard]] const std::vector<backend>& available() {
+        static const std::vector<backend> all = [] {
+            std::vector<backend> out;
+#ifdef SHA256_X86
+            if (cpu_has_shani()) out.push_back({ blocks_shani, "sha-ni" });
+#endif
+            out.push_back({ blocks_scalar, "scalar" });
+            return out;
+        }();
+        return all;
+    }
+
+    // null means the best one, only tests and benchmarks ever set it
+    std::atomic<const backend*> g_forced{ nullptr };
+
+    [[nodiscard]] const backend& pick_backend() {
+        if (const backend* f = g_forced.load(std::memory_order_relaxed)) return *f;
+        return available().front();
+    }
+} // anon namespace
+
+sha256::sha256() {
+    reset();
+}
+
+void sha256::reset() {
+    std::memcpy(state_, H0, sizeof(state_));
+    buf_len_ = 0;
+    total_ = 0;
+}
+
+void sha256::update(const void* data, size_t len) {
+    const block_fn blocks = pick_backend().fn;
+    auto p = static_cast<const unsigned char*>(data);
+    total_ += len;
+
+    // top up a partial block first
+    if (buf_len_) {
+        const size_t take = len < 64 - buf_len_ ? len : 64 - buf_len_;
+        std::memcpy(buf_ + buf_len_, p, take);
+        buf_len_ += take;
+        p += take;
+        len -= take;
+        if (buf_len_ < 64) return;
+        blocks(state_, buf_, 1);
+        buf_len_ = 0;
+    }
+
+    // then hash whole blocks straight out of the callers buffer, no copy
+    if (const size_t n = len / 64) {
+        blocks(state_, p, n);
+        p += n * 64;
+        len -= n * 64;
+    }
+
+    if (len) {
+        std::memcpy(buf_, p, len);
+        buf_len_ = len;
+    }
+}
+
+[[nodiscard]] sha256_digest sha256::finish() {
+    const std::uint64_t bits = total_ * 8;
+    unsigned char pad[72]{};
+    pad[0] = 0x80;
+    // pad to 56 mod 64 then append the bit length big endian
+    const size_t padLen = (buf_len_ < 56 ? 56 - buf_len_ : 120 - buf_len_);
+    for (int i = 0; i < 8; ++i) pad[padLen + i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+    update(pad, padLen + 8);
+
+    sha256_digest out{};
+    for (int i = 0; i < 8; ++i) {
+        out[4 * i + 0] = static_cast<unsigned char>(state_[i] >> 24);
+        out[4 * i + 1] = static_cast<unsigned char>(state_[i] >> 16);
+        out[4 * i + 2] = static_cast<unsigned char>(state_[i] >> 8);
+        out[4 * i + 3] = static_cast<unsigned char>(state_[i]);
+    }
+    reset();
+    return out;
+}
+
+[[nodiscard]] sha256_digest sha256_of(const void* data, const size_t len) {
+    sha256 h;
+    h.update(data, len);
+    return h.finish();
+}
+
+[[nodiscard]] const char* sha256_backend_name() {
+    return pick_backend().name;
+}
+
+[[nodiscard]] std::vector<const char*> sha256_backends() {
+    std::vector<const char*> out;
+    for (const backend& b : available()) out.push_back(b.name);
+    return out;
+}
+
+bool sha256_use_backend(const std::string_view name) {
+    if (name.empty()) {
+        g_forced = nullptr;
+        return true;
+    }
+    for (const backend& b : available()) {
+        if (name == b.name) {
+            g_forced = &b;
+            return true;
+        }
+    }
+    return false;
+}
\ No newline at end of file
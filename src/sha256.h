@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+using sha256_digest = std::array<unsigned char, 32>;
+
+// incremental sha256. the block function is picked once at startup (sha-ni if the cpu has it, scalar otherwise)
+struct sha256 {
+    sha256();
+
+    void update(const void* data, size_t len);
+
+    // pads and returns the digest, the object is reset afterwards so it can be reused
+    [[nodiscard]] sha256_digest finish();
+
+    void reset();
+
+private:
+    std::uint32_t state_[8];
+    unsigned char buf_[64];
+    size_t buf_len_ = 0;
+    std::uint64_t total_ = 0;
+};
+
+// one shot helper for stuff thats already in memory
+[[nodiscard]] sha256_digest sha256_of(const void* data, size_t len);
+
+// which block function got picked, just for logging
+[[nodiscard]] const char* sha256_backend_name();
+
+// names of every block function this build can run on this cpu, the one sha256 picks by default first
+[[nodiscard]] std::vector<const char*> sha256_backends();
+
+// forces one of sha256_backends for everything hashed from now on, process wide. empty goes back to the default.
+// for tests and benchmarks comparing them, false if that one isnt available here
+bool sha256_use_backend(std::string_view name);
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "sig_scan.h"
+#include <atomic>
+#include <bit>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SIG_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#include <cpuid.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+    using find_fn = std::optional<size_t> (*)(const unsigned char* hay, size_t n, const byte_signature& sig, size_t from);
+
+    // rough guess at how often a byte shows up in x64 code and data. padding, zero fill, rex.w and the mov
+    // opcodes are everywhere, filtering on them lets nearly every position through to the full compare
+    [[nodiscard]] int commonness(const unsigned char b) {
+        switch (b) {
+            case 0x00: case 0xFF: case 0xCC: return 3;
+            case 0x48: case 0x8B: case 0x89: case 0x4C: case 0x0F: case 0xE8: case 0x24: case 0x01: return 2;
+            case 0x8D: case 0x83: case 0xC0: case 0x44: case 0x85: case 0x74: case 0x75: case 0x10: return 1;
+            default: return 0;
+        }
+    }
+
+    [[nodiscard]] bool matches_at(const unsigned char* p, const byte_signature& sig) {
+        const unsigned char* b = sig.bytes.data();
+        const unsigned char* m = sig.mask.data();
+        for (size_t i = 0, n = sig.bytes.size(); i < n; ++i) {
+            if ((p[i] ^ b[i]) & m[i]) return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] std::optional<size_t> find_scalar(const unsigned char* hay, const size_t n, const byte_signature& sig, size_t from) {
+        const size_t len = sig.bytes.size();
+        const unsigned char a = sig.bytes[sig.first];
+        const unsigned char c = sig.bytes[sig.second];
+        for (; from + len <= n; ++from) {
+            if (hay[from + sig.first] == a && hay[from + sig.second] == c && matches_at(hay + from, sig)) return from;
+        }
+        return std::nullopt;
+    }
+
+#ifdef SIG_SCAN_X86
+    // both loads stay inside the buffer: the last position a block looks at still has the whole signature after it
+    [[nodiscard]] std::optional<size_t> find_sse2(const unsigned char* hay, const size_t n, const byte_signature& sig, size_t from) {
+        const size_t len = sig.bytes.size();
+        const __m128i a = _mm_set1_epi8(static_cast<char>(sig.bytes[sig.first]));
+        const __m128i c = _mm_set1_epi8(static_cast<char>(sig.bytes[sig.second]));
+        for (; from + 16 + len - 1 <= n; from += 16) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + from + sig.first));
+            const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + from + sig.second));
+            auto bits = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(x, a), _mm_cmpeq_epi8(y, c))));
+            for (; bits; bits &= bits - 1) {
+                const size_t p = from + static_cast<size_t>(std::countr_zero(bits));
+                if (matches_at(hay + p, sig)) return p;
+            }
+        }
+        return find_scalar(hay, n, sig, from);
+    }
+
+    [[nodiscard]] AVX2_TARGET std::optional<size_t> find_avx2(const unsigned char* hay, const size_t n, const byte_signature& sig, size_t from) {
+        const size_t len = sig.bytes.size();
+        const __m256i a = _mm256_set1_epi8(static_cast<char>(sig.bytes[sig.first]));
+        const __m256i c = _mm256_set1_epi8(static_cast<char>(sig.bytes[sig.second]));
+        for (; from + 32 + len - 1 <= n; from += 32) {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + from + sig.first));
+            const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + from + sig.second));
+            auto bits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(x, a), _mm256_cmpeq_epi8(y, c))));
+            for (; bits; bits &= bits - 1) {
+                const size_t p = from + static_cast<size_t>(std::countr_zero(bits));
+                if (matches_at(hay + p, sig)) return p;
+            }
+        }
+        return find_sse2(hay, n, sig, from);
+    }
+
+    [[nodiscard]] bool cpu_has_avx2() {
+        // avx2 (leaf 7 ebx bit 5), and the os has to be saving the ymm registers (osxsave + xcr0 bits 1 and 2)
+#if defined(_MSC_VER)
+        int r[4]{};
+        __cpuid(r, 0);
+        if (r[0] < 7) return false;
+        __cpuid(r, 1);
+        if (!(r[2] & (1 << 27)) || !(r[2] & (1 << 28))) return false;
+        if ((_xgetbv(0) & 6) != 6) return false;
+        __cpuidex(r, 7, 0);
+        return r[1] & (1 << 5);
+#else
+        unsigned a = 0, b = 0, c = 0, d = 0;
+        if (!__get_cpuid(1, &a, &b, &c, &d)) return false;
+        if (!(c & (1u << 27)) || !(c & (1u << 28))) return false;
+        unsigned lo = 0, hi = 0;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        if ((lo & 6) != 6) return false;
+        if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return false;
+        return b & (1u << 5);
+#endif
+    }
+#endif
+
+    struct backend {
+        find_fn fn;
+        const char* name;
+    };
+
+    // everything this build can run on this cpu, best first
+    [[nodiscard]] const std::vector<backend>& available() {
+        static const std::vector<backend> all = [] {
+            std::vector<backend> out;
+#ifdef SIG_SCAN_X86
+            if (cpu_has_avx2()) out.push_back({ find_avx2, "avx2" });
+            out.push_back({ find_sse2, "sse2" });
+#endif
+            out.push_back({ find_scalar, "scalar" });
+            return out;
+        }();
+        return all;
+    }
+
+    // null means the best one, only tests and benchmarks ever set it
+    std::atomic<const backend*> g_forced{ nullptr };
+
+    [[nodiscard]] const backend& pick_backend() {
+        if (const backend* f = g_forced.load(std::memory_order_relaxed)) return *f;
+        return available().front();
+    }
+
+    [[nodiscard]] int hex_digit(const char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+} // anon namespace
+
+[[nodiscard]] std::optional<byte_signature> parse_signature(const std::string_view text) {
+    byte_signature sig;
+    for (size_t i = 0; i < text.size(); ) {
+        if (text[i] == ' ' || text[i] == '\t') {
+            ++i;
+            continue;
+        }
+        size_t end = i;
+        while (end < text.size() && text[end] != ' ' && text[end] != '\t') ++end;
+        const std::string_view tok = text.substr(i, end - i);
+        i = end;
+
+        if (tok == "?" || tok == "??") {
+            sig.bytes.push_back(0);
+            sig.mask.push_back(0);
+            continue;
+        }
+        const int hi = tok.size() == 2 ? hex_digit(tok[0]) : -1;
+        const int lo = tok.size() == 2 ? hex_digit(tok[1]) : -1;
+        if (hi < 0 || lo < 0) return std::nullopt;
+        sig.bytes.push_back(static_cast<unsigned char>(hi << 4 | lo));
+        sig.mask.push_back(0xFF);
+    }
+
+    // rarest fixed byte first, then the rarest one at another position. a signature with a single fixed
+    // byte just compares it twice
+    std::optional<size_t> first, second;
+    for (size_t i = 0; i < sig.bytes.size(); ++i) {
+        if (!sig.mask[i]) continue;
+        if (!first || commonness(sig.bytes[i]) < commonness(sig.bytes[*first])) {
+            second = first;
+            first = i;
+        } else if (!second || commonness(sig.bytes[i]) < commonness(sig.bytes[*second])) {
+            second = i;
+        }
+    }
+    if (!first) return std::nullopt;
+    sig.first = *first;
+    sig.second = second.value_or(*first);
+    return sig;
+}
+
+[[nodiscard]] std::optional<size_t> find_signature(const std::span<const unsigned char> hay, const byte_signature& sig, const size_t from) {
+    if (sig.bytes.empty() || hay.size() < sig.bytes.size()) return std::nullopt;
+    return pick_backend().fn(hay.data(), hay.size(), sig, from);
+}
+
+[[nodiscard]] const char* sig_scan_backend() {
+    return pick_backend().name;
+}
+
+[[nodiscard]] std::vector<const char*> sig_scan_backends() {
+    std::vector<const char*> out;
+    for (const backend& b : available()) out.push_back(b.name);
+    return out;
+}
+
+bool sig_scan_use_backend(const std::string_view name) {
+    if (name.empty()) {
+        g_forced = nullptr;
+        return true;
+    }
+    for (const backend& b : available()) {
+        if (name == b.name) {
+            g_forced = &b;
+            return true;
+        }
+    }
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// byte signatures with wildcards, written the way every disassembler prints them:
+//   "48 8D 0D ?? ?? ?? ?? E8 ?? ?? ?? ?? 84 C0"
+// the search filters 16 (sse2) or 32 (avx2) positions at a time on two of the fixed bytes and only runs the full
+// compare where both hit, so it goes at close to memory speed on code that doesnt look like the signature
+struct byte_signature {
+    std::vector<unsigned char> bytes;
+    std::vector<unsigned char> mask;  // 0xFF where the byte has to match, 0 for a wildcard
+    // positions of the two fixed bytes the vector filter looks at, picked to be the least common we can tell
+    size_t first = 0;
+    size_t second = 0;
+};
+
+// nullopt unless it is whitespace separated hex bytes and "??" (or "?") wildcards with at least one fixed byte
+[[nodiscard]] std::optional<byte_signature> parse_signature(std::string_view text);
+
+// offset of the first match starting at or after from
+[[nodiscard]] std::optional<size_t> find_signature(std::span<const unsigned char> hay, const byte_signature& sig, size_t from = 0);
+
+// "avx2", "sse2" or "scalar", whichever find_signature is using right now
+[[nodiscard]] const char* sig_scan_backend();
+
+// names of every search this build can run on this cpu, the one find_signature picks by default first
+[[nodiscard]] std::vector<const char*> sig_scan_backends();
+
+// forces one of sig_scan_backends for every search from now on, process wide. empty goes back to the default.
+// for tests and benchmarks comparing them, false if that one isnt available here
+bool sig_scan_use_backend(std::string_view name);
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "staged_install.h"
+#include "file_utils.h"
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    // antivirus likes to hold freshly written files open for a moment, so a failed rename gets a couple more tries
+    inline constexpr int RENAME_ATTEMPTS = 5;
+    inline constexpr auto RENAME_RETRY_DELAY = std::chrono::milliseconds(50);
+
+    std::atomic<void (*)(const char*)> g_step_hook{ nullptr };
+
+    // every delete still running, staged_wait_cleanup joins them
+    std::mutex g_cleanup_lock;
+    std::vector<std::jthread> g_cleanups;
+
+    void step(const char* name) {
+        if (const auto hook = g_step_hook.load()) hook(name);
+    }
+
+    [[nodiscard]] fs::path sibling(const fs::path& dir, const wchar_t* suffix) {
+        fs::path p = dir;
+        p += suffix;
+        return p;
+    }
+
+    [[nodiscard]] bool rename_retrying(const fs::path& from, const fs::path& to) {
+        for (int i = 0; i < RENAME_ATTEMPTS; ++i) {
+            std::error_code ec;
+            fs::rename(from, to, ec);
+            if (!ec) return true;
+            std::this_thread::sleep_for(RENAME_RETRY_DELAY);
+        }
+        return false;
+    }
+
+    [[nodiscard]] bool present(const fs::path& p) {
+        std::error_code ec;
+        return fs::exists(p, ec);
+    }
+
+    void remove_async(const fs::path& p) {
+        std::scoped_lock lk(g_cleanup_lock);
+        g_cleanups.emplace_back([p] {
+            TRACE_SCOPE("staged cleanup");
+            std::error_code ec;
+            fs::remove_all(p, ec);
+        });
+    }
+
+    // the slow part (remove_all on a big or av scanned tree) stays off the launch path, its only waited for
+    // on the way out. if we get killed before its done whatever is left gets picked up by the next staged_recover
+    void remove_in_background(const fs::path& p) {
+        if (!present(p)) return;
+        // park it under a unique name first so a new swap can reuse <dir>.old right away
+        fs::path doomed = p;
+        doomed += L"." + std::to_wstring(std::chrono::steady_clock::now().time_since_epoch().count());
+        remove_async(rename_retrying(p, doomed) ? doomed : p);
+    }
+
+    // marker says staging is complete, so from here on the only way is forward
+    [[nodiscard]] bool commit(const fs::path& dir) {
+        const fs::path staging = sibling(dir, L".staging");
+        const fs::path old = sibling(dir, L".old");
+        const fs::path marker = sibling(dir, L".swap");
+        if (present(staging)) {
+            if (present(dir)) {
+                // a cleanup that never got parked can still be sitting on the name
+                remove_in_background(old);
+                step("park");
+                if (!rename_retrying(dir, old)) return false;
+            }
+            step("swap");
+            if (!rename_retrying(staging, dir)) {
+                // put the old contents back so the game still has something, the marker stays so we retry next start
+                if (!present(dir) && present(old)) (void)rename_retrying(old, dir);
+                return false;
+            }
+        }
+        step("unmark");
+        std::error_code ec;
+        fs::remove(marker, ec);
+        remove_in_background(old);
+        return true;
+    }
+} // anon namespace
+
+[[nodiscard]] bool staged_recover(const fs::path& dir) {
+    TRACE_SCOPE("staged_recover");
+    if (present(sibling(dir, L".swap"))) return commit(dir);
+
+    // no marker means no swap was under way, anything next to dir is junk from an earlier run
+    std::error_code ec;
+    fs::remove_all(sibling(dir, L".staging"), ec);
+    // parked cleanups that never finished
+    std::vector<fs::path> parked;
+    const wstr prefix = dir.filename().wstring() + L".old.";
+    for (fs::directory_iterator it(dir.parent_path(), ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().filename().wstring().starts_with(prefix)) parked.push_back(it->path());
+    }
+    for (const auto& p : parked) remove_async(p);
+    remove_in_background(sibling(dir, L".old"));
+    return true;
+}
+
+[[nodiscard]] bool staged_install(const fs::path& dir, const std::function<bool(const fs::path& staging)>& fill) {
+    TRACE_SCOPE("staged_install");
+    if (!staged_recover(dir)) return false;
+    const fs::path staging = sibling(dir, L".staging");
+
+    std::error_code ec;
+    fs::remove_all(staging, ec);
+    if (!fs::create_directories(staging, ec) || !fill(staging)) {
+        fs::remove_all(staging, ec);
+        return false;
+    }
+    step("mark");
+    if (!write_file_atomic(sibling(dir, L".swap"), "staged\n")) {
+        fs::remove_all(staging, ec);
+        return false;
+    }
+    return commit(dir);
+}
+
+
+void staged_wait_cleanup() {
+    std::vector<std::jthread> running;
+    {
+        std::scoped_lock lk(g_cleanup_lock);
+        running.swap(g_cleanups);
+    }
+    for (auto& t : running) t.join();
+}
+
+void staged_set_step_hook(void (*hook)(const char* step)) {
+    g_step_hook = hook;
+}
\ No newline at end of file
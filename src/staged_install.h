@@ -0,0 +1,28 @@
+#pragma once
+
+#include "common.h"
+#include <functional>
+
+// replaces the contents of a directory as one step. the new contents are built in a sibling
+// "<dir>.staging" on the same volume, then "<dir>.swap" is written to say staging is complete and
+// two directory renames put it in place (dir -> "<dir>.old", staging -> dir). the old tree gets
+// deleted on a background thread (parked as "<dir>.old.<ts>" first). a crash anywhere in there leaves
+// either the old or the new contents reachable, and staged_recover finishes the job on the next start
+
+// finishes a swap that was cut short (rolls forward if the marker is there) and clears leftover
+// staging/old trees. call it before looking at dir
+[[nodiscard]] bool staged_recover(const fs::path& dir);
+
+// makes dir hold exactly what fill puts into the (empty) staging directory it gets handed. fill
+// returning false abandons the swap and leaves dir untouched, same as any other failure
+[[nodiscard]] bool staged_install(const fs::path& dir, const std::function<bool(const fs::path& staging)>& fill);
+
+
+// waits for the background deletes started so far. call it before anything that tears down state they
+// touch on their way out (the trace buffer), and before exiting if they should actually get to finish
+void staged_wait_cleanup();
+
+// test seam: called with the name of each step of a swap right before it happens ("mark" the marker write,
+// "park" dir -> old, "swap" staging -> dir, "unmark" removing the marker), so a test can die in between.
+// nullptr (the default) for none
+void staged_set_step_hook(void (*hook)(const char* step));
\ No newline at end of file
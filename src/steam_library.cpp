@@ -0,0 +1,85 @@
+#include "steam_library.h"
+#include "file_utils.h"
+#include "trace.h"
+#include "utf.h"
+#include "vdf.h"
+#include <cstdlib>
+#include <map>
+
+[[nodiscard]] std::optional<app_manifest> read_app_manifest(const fs::path& manifest) {
+    const auto txt = read_file_bytes(manifest);
+    if (!txt) return std::nullopt;
+    const auto root = vdf_parse(*txt);
+    if (!root) return std::nullopt;
+    // "AppState" { "installdir" "..." "SizeOnDisk" "..." "buildid" "..." "StateFlags" "..." }
+    const vdf_node* state = root->find("AppState");
+    if (!state || !state->is_block) return std::nullopt;
+    app_manifest out;
+    if (auto dir = state->get("installdir"); dir && !dir->empty()) out.installdir = std::move(*dir);
+    else return std::nullopt;
+    const auto number = [&](const std::string_view key) {
+        const auto v = state->get(key);
+        return v ? std::strtoull(v->c_str(), nullptr, 10) : 0ull;
+    };
+    out.size_on_disk = number("SizeOnDisk");
+    out.buildid = number("buildid");
+    out.state_flags = static_cast<unsigned>(number("StateFlags"));
+    return out;
+}
+
+[[nodiscard]] std::optional<std::string> get_install_dir_from_manifest(const fs::path& manifest) {
+    TRACE_SCOPE("get_install_dir_from_manifest");
+    if (std::error_code ec; !fs::exists(manifest, ec)) return std::nullopt;
+    if (auto m = read_app_manifest(manifest)) return std::move(m->installdir);
+    return std::nullopt;
+}
+
+[[nodiscard]] std::vector<wstr> get_library_roots(const wstr& steam_path) {
+    TRACE_SCOPE("get_library_roots");
+    std::vector<wstr> roots;
+    roots.push_back(wtrim_trailing_slash(steam_path));
+    fs::path vdf = fs::path(steam_path) / L"steamapps" / L"libraryfolders.vdf";
+    if (std::error_code ec; fs::exists(vdf, ec)) {
+        const auto txt = read_file_bytes(vdf);
+        const auto root = txt ? vdf_parse(*txt) : std::nullopt;
+        const vdf_node* folders = root ? root->find("libraryfolders") : nullptr;
+        if (folders && folders->is_block) {
+            for (const auto& lib : folders->children) {
+                std::string path;
+                if (lib.is_block) {
+                    // new format: "0" { "path" "D:\\SteamLibrary" ... }
+                    if (auto p = lib.get("path")) path = std::move(*p);
+                } else if (!lib.key.empty() && lib.key.find_first_not_of("0123456789") == std::string_view::npos) {
+                    // old format: "1" "D:\\SteamLibrary"
+                    path = vdf_unescape(lib.value);
+                }
+                // vdf is utf8, a library on a non ascii path has to survive the trip
+                const auto w = widen_utf8(path);
+                if (!w) continue;
+                if (auto t = wtrim_trailing_slash(*w); !t.empty()) roots.push_back(t);
+            }
+        }
+    }
+    // dedupe the roots just in case
+    std::vector<wstr> out;
+    std::map<wstr, bool, std::less<>> seen;
+    for (auto& r : roots) if (!seen.contains(r)) { seen[r] = true; out.push_back(r); }
+    return out;
+}
+
+[[nodiscard]] std::optional<std::string> most_recent_login(const std::string_view loginusers) {
+    const auto root = vdf_parse(loginusers);
+    const vdf_node* users = root ? root->find("users") : nullptr;
+    if (!users || !users->is_block) return std::nullopt;
+    // look for user blocks and check if they have mostrecent flag set
+    std::string_view firstId;
+    for (const auto& user : users->children) {
+        if (!user.is_block || user.key.size() != 17) continue;
+        if (user.key.find_first_not_of("0123456789") != std::string_view::npos) continue;
+        if (firstId.empty()) firstId = user.key;
+        if (auto recent = user.get("mostrecent"); recent && *recent == "1") return std::string(user.key);
+    }
+    // if no mostrecent user just return the first one we found
+    if (!firstId.empty()) return std::string(firstId);
+    return std::nullopt;
+}
\ No newline at end of file
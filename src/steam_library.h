@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common.h"
+#include <string_view>
+#include <vector>
+
+// the parts of steam discovery that are just files (libraryfolders.vdf, appmanifest_<id>.acf), no registry involved
+
+// steamid64 of an individual account on the public universe, the account id is what the registry stores
+[[nodiscard]] constexpr unsigned long long steamid64_from_account(const unsigned long long account) {
+    return 76561197960265728ULL + account;
+}
+
+// reads libraryfolders.vdf to find all steam library locations
+[[nodiscard]] std::vector<wstr> get_library_roots(const wstr& steam_path);
+
+// the bits of an appmanifest_<id>.acf we care about
+struct app_manifest {
+    std::string installdir;
+    unsigned long long size_on_disk = 0;
+    unsigned long long buildid = 0;
+    unsigned state_flags = 0;  // 4 is fully installed, anything else means updating/downloading/etc
+};
+
+// parses a steam manifest file (.acf) in one read. nullopt if its missing, broken or has no installdir
+[[nodiscard]] std::optional<app_manifest> read_app_manifest(const fs::path& manifest);
+
+// parses steam manifest files (.acf) to get the install directory name
+[[nodiscard]] std::optional<std::string> get_install_dir_from_manifest(const fs::path& manifest);
+
+// the account in a loginusers.vdf that steam marked "mostrecent", or the first one listed if none is.
+// the steamid64 as written there, nullopt if the file lists nobody
+[[nodiscard]] std::optional<std::string> most_recent_login(std::string_view loginusers);
\ No newline at end of file
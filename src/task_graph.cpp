@@ -0,0 +1,51 @@
+#include "task_graph.h"
+
+void task_graph::start(const size_t id) {
+    pool_.submit([this, id] {
+        const int rc = nodes_[id].body(stop_.get_token());
+        finish(id, rc);
+    });
+}
+
+void task_graph::finish(const size_t id, const int rc) {
+    std::vector<size_t> ready;
+    {
+        std::scoped_lock lk(lock_);
+        nodes_[id].rc = rc;
+        if (rc != 0) stop_.request_stop();
+        ++finished_;
+
+        // walk the dependents, anything that cant run anymore is finished right here without running
+        std::vector<size_t> stack{ id };
+        while (!stack.empty()) {
+            const size_t cur = stack.back();
+            stack.pop_back();
+            for (const size_t d : nodes_[cur].dependents) {
+                if (--nodes_[d].pending != 0) continue;
+                if (stop_.stop_requested()) {
+                    ++finished_;
+                    stack.push_back(d);
+                } else {
+                    ready.push_back(d);
+                }
+            }
+        }
+    }
+    for (const size_t d : ready) start(d);
+    done_cv_.notify_all();
+}
+
+[[nodiscard]] int task_graph::run() {
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        if (nodes_[i].pending == 0) start(i);
+    }
+    {
+        std::unique_lock lk(lock_);
+        done_cv_.wait(lk, [this] { return finished_ == nodes_.size(); });
+    }
+    pool_.wait_idle();
+    for (const auto& n : nodes_) {
+        if (n.rc != 0) return n.rc;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "thread_pool.h"
+#include <expected>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <vector>
+
+// a stage either produces its value or fails with the exit code wmain should return
+template <typename T>
+using stage_result = std::expected<T, int>;
+
+// small dependency graph on top of thread_pool. stages start as soon as everything they depend on
+// finished, and the first failure cancels everything that hasnt started yet (running stages see it
+// through their stop_token)
+struct task_graph {
+    template <typename T>
+    struct task {
+        size_t id = 0;
+        std::shared_ptr<std::optional<T>> value;
+
+        // only valid from a stage that depends on this one, or after run() succeeded
+        [[nodiscard]] const T& get() const { return **value; }
+    };
+
+    explicit task_graph(size_t threads) : pool_(threads) {}
+
+    // fn is called as fn(std::stop_token) and returns stage_result<T>
+    template <typename F>
+    [[nodiscard]] auto add(F fn, const std::vector<size_t>& deps = {}) {
+        using T = typename std::invoke_result_t<F, std::stop_token>::value_type;
+        task<T> t{ nodes_.size(), std::make_shared<std::optional<T>>() };
+        node& n = nodes_.emplace_back();
+        n.body = [fn = std::move(fn), value = t.value](const std::stop_token st) mutable -> int {
+            auto r = fn(st);
+            if (!r) return r.error();
+            value->emplace(std::move(*r));
+            return 0;
+        };
+        n.pending = deps.size();
+        for (const size_t d : deps) nodes_[d].dependents.push_back(t.id);
+        return t;
+    }
+
+    // runs the whole graph and blocks until its done. returns 0, or the exit code of the failed stage that
+    // was added first, so the result matches what running the stages one after another would have given
+    [[nodiscard]] int run();
+
+private:
+    struct node {
+        std::function<int(std::stop_token)> body;
+        std::vector<size_t> dependents;
+        size_t pending = 0;
+        int rc = 0;
+    };
+
+    void start(size_t id);
+    void finish(size_t id, int rc);
+
+    std::vector<node> nodes_;
+    thread_pool pool_;
+    std::stop_source stop_;
+    std::mutex lock_;
+    std::condition_variable done_cv_;
+    size_t finished_ = 0;
+};
\ No newline at end of file
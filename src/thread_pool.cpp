@@ -0,0 +1,104 @@
+#include "thread_pool.h"
+#include <memory>
+#include <optional>
+
+thread_pool::thread_pool(size_t threads) {
+    if (threads == 0) threads = 1;
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this](const std::stop_token st) { worker(st); });
+    }
+}
+
+thread_pool::~thread_pool() {
+    for (auto& t : threads_) t.request_stop();
+    cv_.notify_all();
+    // jthread joins on destruction
+}
+
+void thread_pool::submit(std::function<void()> job) {
+    {
+        std::scoped_lock lk(lock_);
+        jobs_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+void thread_pool::wait_idle() {
+    std::unique_lock lk(lock_);
+    idle_cv_.wait(lk, [this] { return jobs_.empty() && running_ == 0; });
+}
+
+void thread_pool::worker(const std::stop_token st) {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock lk(lock_);
+            if (!cv_.wait(lk, st, [this] { return !jobs_.empty(); })) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+            ++running_;
+        }
+        job();
+        {
+            std::scoped_lock lk(lock_);
+            --running_;
+            if (jobs_.empty() && running_ == 0) idle_cv_.notify_all();
+        }
+    }
+}
+void parallel_for_stealing(const size_t count, size_t threads, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+    if (threads == 0) threads = 1;
+    if (threads > count) threads = count;
+
+    // [next, end) per worker. the owner takes from next, thieves take from end
+    struct slice {
+        std::mutex lock;
+        size_t next = 0;
+        size_t end = 0;
+    };
+    const auto slices = std::make_unique<slice[]>(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        slices[i].next = count * i / threads;
+        slices[i].end = count * (i + 1) / threads;
+    }
+
+    const auto take_own = [&](const size_t self) -> std::optional<size_t> {
+        std::scoped_lock lk(slices[self].lock);
+        if (slices[self].next == slices[self].end) return std::nullopt;
+        return slices[self].next++;
+    };
+    const auto steal = [&](const size_t self) -> std::optional<size_t> {
+        for (;;) {
+            // pick whoever has the most left, it can run dry before we get its lock so recheck there
+            size_t victim = threads, most = 0;
+            for (size_t i = 0; i < threads; ++i) {
+                if (i == self) continue;
+                std::scoped_lock lk(slices[i].lock);
+                if (const size_t left = slices[i].end - slices[i].next; left > most) {
+                    most = left;
+                    victim = i;
+                }
+            }
+            if (victim == threads) return std::nullopt;
+            std::scoped_lock lk(slices[victim].lock);
+            if (slices[victim].next == slices[victim].end) continue;
+            return --slices[victim].end;
+        }
+    };
+
+    const auto worker = [&](const size_t self) {
+        for (;;) {
+            auto idx = take_own(self);
+            if (!idx) idx = steal(self);
+            if (!idx) return;
+            fn(*idx);
+        }
+    };
+    std::vector<std::jthread> pool;
+    pool.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) pool.emplace_back(worker, i);
+    // the caller works too instead of just blocking
+    worker(0);
+}
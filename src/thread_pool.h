@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// plain fixed size pool with one shared queue. jobs run in submit order (not completion order)
+struct thread_pool {
+    explicit thread_pool(size_t threads);
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    void submit(std::function<void()> job);
+
+    // blocks until the queue is empty and nothing is running
+    void wait_idle();
+
+private:
+    void worker(std::stop_token st);
+
+    std::mutex lock_;
+    std::condition_variable_any cv_;
+    std::condition_variable idle_cv_;
+    std::deque<std::function<void()>> jobs_;
+    size_t running_ = 0;
+    std::vector<std::jthread> threads_;
+};
+// runs fn(0..count-1) on threads workers and returns when all of them are done. every worker starts on its
+// own contiguous slice and once thats empty steals from the far end of whoever still has the most left,
+// so a few slow items (big files, a cold disk) dont leave the other threads idle
+void parallel_for_stealing(size_t count, size_t threads, const std::function<void(size_t)>& fn);
@@ -0,0 +1,108 @@
+#include "trace.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+    struct event {
+        const char* name;
+        char phase;       // 'X' complete span, 'C' counter
+        long long ts;
+        long long value;  // duration for spans, the value for counters
+    };
+
+    // every thread appends to its own buffer so recording never takes a lock,
+    // buffers get registered once per thread and merged when we write
+    struct thread_buffer {
+        unsigned tid = 0;
+        std::vector<event> events;
+    };
+
+    std::mutex g_lock;
+    std::vector<std::unique_ptr<thread_buffer>> g_buffers;
+    fs::path g_out;
+    std::atomic<unsigned> g_next_tid{ 1 };
+    const auto g_epoch = std::chrono::steady_clock::now();
+
+    [[nodiscard]] thread_buffer& local_buffer() {
+        thread_local thread_buffer* buf = [] {
+            auto b = std::make_unique<thread_buffer>();
+            b->tid = g_next_tid++;
+            b->events.reserve(256);
+            std::scoped_lock lk(g_lock);
+            return g_buffers.emplace_back(std::move(b)).get();
+        }();
+        return *buf;
+    }
+
+    void append_escaped(std::string& out, const char* s) {
+        for (; *s; ++s) {
+            if (*s == '"' || *s == '\\') out.push_back('\\');
+            out.push_back(*s);
+        }
+    }
+} // anon namespace
+
+namespace trace_detail {
+    [[nodiscard]] long long now_us() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_epoch).count();
+    }
+
+    void complete(const char* name, const long long start_us) {
+        local_buffer().events.push_back({ name, 'X', start_us, now_us() - start_us });
+    }
+
+    void counter(const char* name, const long long value) {
+        local_buffer().events.push_back({ name, 'C', now_us(), value });
+    }
+}
+
+void trace_start(const fs::path& out) {
+    {
+        std::scoped_lock lk(g_lock);
+        g_out = out;
+    }
+    // register the calling thread first so it ends up as tid 1 ("main")
+    (void)local_buffer();
+    trace_detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void trace_stop() {
+    trace_detail::enabled.store(false, std::memory_order_relaxed);
+    std::scoped_lock lk(g_lock);
+    for (const auto& buf : g_buffers) buf->events.clear();
+}
+
+void trace_write() {
+    if (!trace_enabled()) return;
+    std::scoped_lock lk(g_lock);
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    const auto sep = [&] {
+        if (!first) out += ",\n";
+        first = false;
+    };
+    for (const auto& buf : g_buffers) {
+        sep();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(buf->tid) +
+               ",\"args\":{\"name\":\"" + (buf->tid == 1 ? std::string("main") : "worker " + std::to_string(buf->tid)) + "\"}}";
+        for (const auto& e : buf->events) {
+            sep();
+            out += "{\"name\":\"";
+            append_escaped(out, e.name);
+            out += "\",\"cat\":\"launch\",\"ph\":\"";
+            out.push_back(e.phase);
+            out += "\",\"pid\":1,\"tid\":" + std::to_string(buf->tid) + ",\"ts\":" + std::to_string(e.ts);
+            if (e.phase == 'X') out += ",\"dur\":" + std::to_string(e.value) + "}";
+            else out += ",\"args\":{\"value\":" + std::to_string(e.value) + "}}";
+        }
+    }
+    out += "\n]}\n";
+
+    std::ofstream ofs(g_out, std::ios::binary | std::ios::trunc);
+    ofs.write(out.data(), static_cast<std::streamsize>(out.size()));
+}
\ No newline at end of file
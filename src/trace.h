@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common.h"
+#include <atomic>
+
+// chrome trace / perfetto json output for the launch phases. off unless --trace <file> or
+// SPECTRE_TRACE=<file> is given, and when its off a TRACE_SCOPE is one relaxed load and a branch
+
+namespace trace_detail {
+    inline std::atomic<bool> enabled{ false };
+
+    [[nodiscard]] long long now_us();
+    void complete(const char* name, long long start_us);
+    void counter(const char* name, long long value);
+}
+
+// turns tracing on, events get written to out by trace_write. call it from the main thread
+void trace_start(const fs::path& out);
+
+// dumps everything recorded so far as trace-event json, no-op when tracing is off.
+// call it once the worker threads are done recording
+void trace_write();
+
+// turns tracing back off and drops whatever was recorded, for tests and benchmarks that only want it for a
+// while. same as trace_write, nothing else may be recording when its called
+void trace_stop();
+
+[[nodiscard]] inline bool trace_enabled() {
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+// counter track ("C" event), shows up as a graph in the viewer
+inline void trace_counter(const char* name, const long long value) {
+    if (trace_enabled()) trace_detail::counter(name, value);
+}
+
+// name has to outlive the trace (string literals)
+struct trace_scope {
+    explicit trace_scope(const char* name) : name_(name), start_(trace_enabled() ? trace_detail::now_us() : -1) {}
+    ~trace_scope() { if (start_ >= 0) trace_detail::complete(name_, start_); }
+
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+
+private:
+    const char* name_;
+    long long start_;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) trace_scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include "trigger_locator.h"
+#include "bin_io.h"
+#include "file_utils.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace {
+    // file layout (little endian):
+    //   "SLTR" u16 version u16 reserved u32 count
+    //   count * { u32 image_size, u32 timestamp, u32 signature_key, u64 rva }
+    //   u32 crc32 of everything above
+    inline constexpr char MAGIC[4] = { 'S', 'L', 'T', 'R' };
+    inline constexpr std::uint16_t VERSION = 1;
+    // one entry per game build and signature, the oldest fall off the front
+    inline constexpr size_t MAX_ENTRIES = 32;
+    // a 100+ MiB code section is still only a handful of ReadProcessMemory calls
+    inline constexpr size_t READ_CHUNK = 16 << 20;
+
+    using steady = std::chrono::steady_clock;
+
+    std::atomic<unsigned long long> g_hits{ 0 };
+    std::atomic<unsigned long long> g_scans{ 0 };
+    std::atomic<unsigned long long> g_scanned{ 0 };
+
+    struct entry {
+        std::uint32_t image_size = 0;
+        std::uint32_t timestamp = 0;
+        std::uint32_t key = 0;
+        std::uint64_t rva = 0;
+    };
+
+    // the bits of an IMAGE_SECTION_HEADER the scan needs
+    struct image_section {
+        std::uint32_t virtual_size = 0;
+        std::uint32_t virtual_address = 0;
+        std::uint32_t raw_size = 0;
+        std::uint32_t characteristics = 0;
+    };
+
+    struct image_layout {
+        std::uint32_t size = 0;
+        std::uint32_t timestamp = 0;
+        std::vector<image_section> sections;
+    };
+
+    // pe header offsets and constants, as winnt.h has them. read by offset so this builds off windows too
+    inline constexpr std::uint16_t DOS_MAGIC = 0x5A4D;        // "MZ"
+    inline constexpr size_t DOS_LFANEW = 0x3C;
+    inline constexpr std::uint32_t NT_SIGNATURE = 0x4550;     // "PE\0\0"
+    inline constexpr size_t NT_SECTIONS = 4 + 2;              // FileHeader.NumberOfSections
+    inline constexpr size_t NT_TIMESTAMP = 4 + 4;             // FileHeader.TimeDateStamp
+    inline constexpr size_t NT_OPT_SIZE = 4 + 16;             // FileHeader.SizeOfOptionalHeader
+    inline constexpr size_t NT_OPT = 4 + 20;                  // OptionalHeader
+    inline constexpr std::uint16_t OPT_PE32_PLUS = 0x20B;
+    inline constexpr size_t OPT_IMAGE_SIZE = 56;              // OptionalHeader.SizeOfImage
+    inline constexpr size_t NT_READ = NT_OPT + OPT_IMAGE_SIZE + 4;
+    inline constexpr size_t SECTION_SIZE = 40;
+    inline constexpr std::uint32_t SCN_MEM_READ = 0x40000000;
+
+    template <typename T>
+    [[nodiscard]] T field(const unsigned char* p, const size_t off) {
+        T v;
+        std::memcpy(&v, p + off, sizeof(T));
+        return v;
+    }
+
+    std::mutex g_lock;
+    std::vector<entry> g_entries;
+    bool g_loaded = false;
+
+    [[nodiscard]] fs::path cache_file() {
+        return get_launcher_data_dir() / L"triggercache.bin";
+    }
+
+    // anything off just means we scan again
+    [[nodiscard]] std::vector<entry> load_entries() {
+        std::vector<entry> out;
+        const auto buf = read_file_bytes(cache_file());
+        if (!buf) return out;
+
+        bin_reader r{ *buf };
+        std::uint32_t count = 0;
+        if (!bin_open(r, MAGIC, VERSION) || !r.get(count) || count > MAX_ENTRIES) return out;
+        for (std::uint32_t i = 0; i < count; ++i) {
+            entry e;
+            if (!r.get(e.image_size) || !r.get(e.timestamp) || !r.get(e.key) || !r.get(e.rva)) return {};
+            out.push_back(e);
+        }
+        if (r.pos != buf->size() - 4) return {};
+        return out;
+    }
+
+    [[nodiscard]] bool save_entries(const std::vector<entry>& entries) {
+        std::string out;
+        out.append(MAGIC, 4);
+        bin_put(out, VERSION);
+        bin_put(out, std::uint16_t{ 0 });
+        bin_put(out, static_cast<std::uint32_t>(entries.size()));
+        for (const auto& e : entries) {
+            bin_put(out, e.image_size);
+            bin_put(out, e.timestamp);
+            bin_put(out, e.key);
+            bin_put(out, e.rva);
+        }
+        bin_seal(out);
+        return write_file_atomic(cache_file(), out);
+    }
+
+    void ensure_loaded() {
+        if (g_loaded) return;
+        g_entries = load_entries();
+        g_loaded = true;
+    }
+
+    // everything that changes what the signature resolves to
+    [[nodiscard]] std::uint32_t signature_key(const trigger_signature& ts) {
+        std::string k = ts.text;
+        bin_put(k, ts.rel32_at ? static_cast<long long>(*ts.rel32_at) : -1ll);
+        bin_put(k, ts.offset);
+        return crc32(reinterpret_cast<const unsigned char*>(k.data()), k.size());
+    }
+
+    // the headers straight out of the mapped image, so this is whatever the loader actually mapped
+    [[nodiscard]] std::optional<image_layout> read_layout(const remote_process& process, const std::uintptr_t base) {
+        unsigned char dos[DOS_LFANEW + 4];
+        if (!remote_read(process, base, dos, sizeof(dos)) || field<std::uint16_t>(dos, 0) != DOS_MAGIC) return std::nullopt;
+        const std::uintptr_t ntAddr = base + static_cast<std::uintptr_t>(field<std::int32_t>(dos, DOS_LFANEW));
+        unsigned char nt[NT_READ];
+        if (!remote_read(process, ntAddr, nt, sizeof(nt)) || field<std::uint32_t>(nt, 0) != NT_SIGNATURE ||
+            field<std::uint16_t>(nt, NT_OPT) != OPT_PE32_PLUS) {
+            return std::nullopt;
+        }
+
+        image_layout out{ field<std::uint32_t>(nt, NT_OPT + OPT_IMAGE_SIZE), field<std::uint32_t>(nt, NT_TIMESTAMP), {} };
+        std::vector<unsigned char> raw(field<std::uint16_t>(nt, NT_SECTIONS) * SECTION_SIZE);
+        const std::uintptr_t secAddr = ntAddr + NT_OPT + field<std::uint16_t>(nt, NT_OPT_SIZE);
+        if (!raw.empty() && !remote_read(process, secAddr, raw.data(), raw.size())) return std::nullopt;
+        for (size_t off = 0; off < raw.size(); off += SECTION_SIZE) {
+            out.sections.push_back({ field<std::uint32_t>(raw.data(), off + 8), field<std::uint32_t>(raw.data(), off + 12),
+                                     field<std::uint32_t>(raw.data(), off + 16), field<std::uint32_t>(raw.data(), off + 36) });
+        }
+        return out;
+    }
+
+    // match rva -> trigger rva. nullopt if it lands outside the image
+    [[nodiscard]] std::optional<std::uintptr_t> resolve(const trigger_signature& ts, const std::uint32_t imageSize,
+                                                        const long long matchRva, const unsigned char* match) {
+        long long rva = matchRva;
+        if (ts.rel32_at) {
+            std::int32_t disp = 0;
+            std::memcpy(&disp, match + *ts.rel32_at, sizeof(disp));
+            rva += static_cast<long long>(*ts.rel32_at) + 4 + disp;
+        }
+        rva += ts.offset;
+        if (rva < 0 || rva >= static_cast<long long>(imageSize)) return std::nullopt;
+        return static_cast<std::uintptr_t>(rva);
+    }
+
+    // copies each readable section out in READ_CHUNK pieces and searches them where they land. the search keeps
+    // going after the first hit, a signature that matches twice is no better than none
+    [[nodiscard]] std::expected<std::uintptr_t, locate_error> scan_image(const remote_process& process, const std::uintptr_t base, const image_layout& img,
+                                                                         const trigger_signature& ts, unsigned long long& scanned) {
+        const size_t overlap = ts.sig.bytes.size() - 1;
+        std::vector<unsigned char> buf(READ_CHUNK + overlap);
+        std::optional<std::uintptr_t> hit;
+        bool readAll = true;
+        for (const auto& s : img.sections) {
+            if (!(s.characteristics & SCN_MEM_READ) || s.virtual_address >= img.size) continue;
+            const size_t size = std::min<size_t>(s.virtual_size ? s.virtual_size : s.raw_size, img.size - s.virtual_address);
+
+            // each read lands after the tail of the one before, so a match across the seam is still whole. the
+            // tail is one byte shorter than the signature, so nothing gets found twice
+            size_t kept = 0;
+            for (size_t off = 0; off < size; ) {
+                const size_t n = std::min(READ_CHUNK, size - off);
+                if (!remote_read(process, base + s.virtual_address + off, buf.data() + kept, n)) {
+                    // guard pages or something not committed yet, skip it and see if the rest has the match
+                    readAll = false;
+                    kept = 0;
+                    off += n;
+                    continue;
+                }
+                const size_t have = kept + n;
+                const std::span<const unsigned char> view(buf.data(), have);
+                const long long viewRva = static_cast<long long>(s.virtual_address + off) - static_cast<long long>(kept);
+                for (auto p = find_signature(view, ts.sig); p; p = find_signature(view, ts.sig, *p + 1)) {
+                    if (hit) return std::unexpected(locate_error::ambiguous);
+                    hit = resolve(ts, img.size, viewRva + static_cast<long long>(*p), view.data() + *p);
+                    if (!hit) return std::unexpected(locate_error::ambiguous);
+                }
+                scanned += n;
+                kept = std::min(overlap, have);
+                std::memmove(buf.data(), buf.data() + have - kept, kept);
+                off += n;
+            }
+        }
+        if (hit) return *hit;
+        return std::unexpected(readAll ? locate_error::not_found : locate_error::not_mapped);
+    }
+} // anon namespace
+
+[[nodiscard]] std::optional<trigger_signature> make_trigger_signature(const std::string_view text, const std::optional<size_t> rel32_at, const long long offset) {
+    auto sig = parse_signature(text);
+    if (!sig) return std::nullopt;
+    if (rel32_at && *rel32_at + 4 > sig->bytes.size()) return std::nullopt;
+    return trigger_signature{ std::string(text), std::move(*sig), rel32_at, offset };
+}
+
+[[nodiscard]] std::expected<std::uintptr_t, locate_error> locate_trigger_rva(const remote_process& process, const std::uintptr_t base, const trigger_signature& sig) {
+    TRACE_SCOPE("locate_trigger_rva");
+    const auto img = read_layout(process, base);
+    if (!img) return std::unexpected(locate_error::not_mapped);
+
+    const std::uint32_t key = signature_key(sig);
+    {
+        std::lock_guard lk(g_lock);
+        ensure_loaded();
+        for (const auto& e : g_entries) {
+            if (e.image_size == img->size && e.timestamp == img->timestamp && e.key == key) {
+                ++g_hits;
+                return static_cast<std::uintptr_t>(e.rva);
+            }
+        }
+    }
+
+    const auto start = steady::now();
+    unsigned long long scanned = 0;
+    const auto found = scan_image(process, base, *img, sig, scanned);
+    const double ms = std::chrono::duration<double, std::milli>(steady::now() - start).count();
+    ++g_scans;
+    g_scanned += scanned;
+    trace_counter("trigger scan bytes", static_cast<long long>(scanned));
+    if (!found) return found;
+    std::printf("trigger signature found at rva 0x%llx (%.1f MiB in %.1f ms, %s)\n", static_cast<unsigned long long>(*found),
+                static_cast<double>(scanned) / (1 << 20), ms, sig_scan_backend());
+
+    std::lock_guard lk(g_lock);
+    // a fleet can have several clients of the same build racing here, only the first one needs to land
+    const bool known = std::ranges::any_of(g_entries, [&](const entry& e) {
+        return e.image_size == img->size && e.timestamp == img->timestamp && e.key == key;
+    });
+    if (!known) {
+        g_entries.push_back({ img->size, img->timestamp, key, *found });
+        if (g_entries.size() > MAX_ENTRIES) g_entries.erase(g_entries.begin());
+        (void)save_entries(g_entries);
+    }
+    return found;
+}
+
+[[nodiscard]] trigger_locator_counters trigger_locator_get_counters() {
+    return { g_hits.load(), g_scans.load(), g_scanned.load() };
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common.h"
+#include "remote_process.h"
+#include "sig_scan.h"
+#include <cstdint>
+#include <expected>
+
+// finds the trigger page by signature instead of a hardcoded rva, so a game patch that moves things around
+// doesnt need a launcher release. the match is either the address itself or an instruction that references
+// it rip relative, plus a fixed offset on top
+struct trigger_signature {
+    std::string text;               // as given, part of the cache key
+    byte_signature sig;
+    // the match is an instruction ending in a disp32 at this offset (lea/mov/call/jmp rip forms), follow it
+    std::optional<size_t> rel32_at;
+    long long offset = 0;
+};
+
+// nullopt if text isnt a signature or rel32_at doesnt leave room for the disp32 inside it
+[[nodiscard]] std::optional<trigger_signature> make_trigger_signature(std::string_view text, std::optional<size_t> rel32_at, long long offset);
+
+enum class locate_error {
+    not_mapped,  // headers or sections couldnt be read yet, worth trying again
+    not_found,   // no match, a packed exe may not have unpacked the code yet
+    ambiguous,   // more than one match or one that points outside the image, no point trying again
+};
+
+// rva the signature resolves to in the image mapped at base. the readable sections are copied out in big reads
+// and scanned in place, and a hit is cached by image size + link timestamp so the same build never gets scanned twice
+[[nodiscard]] std::expected<std::uintptr_t, locate_error> locate_trigger_rva(const remote_process& process, std::uintptr_t base, const trigger_signature& sig);
+
+struct trigger_locator_counters {
+    unsigned long long cache_hits = 0;
+    unsigned long long scans = 0;
+    unsigned long long scanned_bytes = 0;  // what the scans read out of the process, 0 added on a cache hit
+};
+
+[[nodiscard]] trigger_locator_counters trigger_locator_get_counters();
\ No newline at end of file
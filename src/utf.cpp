@@ -0,0 +1,170 @@
+#include "utf.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define UTF_SSE2 1
+// sse2 is part of x64 so theres nothing to detect
+#include <emmintrin.h>
+#endif
+
+namespace {
+    [[nodiscard]] constexpr bool is_cont(const unsigned char c) {
+        return (c & 0xC0) == 0x80;
+    }
+
+#ifdef UTF_SSE2
+    // 16 ascii bytes -> 16 units. false (and nothing written) if any of them isnt ascii
+    [[nodiscard]] bool widen_ascii16(const char* in, wchar_t* out) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        if (_mm_movemask_epi8(v)) return false;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        if constexpr (sizeof(wchar_t) == 2) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), hi);
+        } else {
+            // 4 byte wchar_t off windows
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12), _mm_unpackhi_epi16(hi, zero));
+        }
+        return true;
+    }
+
+    // 16 ascii units -> 16 bytes, same deal
+    [[nodiscard]] bool narrow_ascii16(const wchar_t* in, char* out) {
+        const auto load = [in](const size_t i) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)); };
+        const __m128i zero = _mm_setzero_si128();
+        __m128i a, b;
+        if constexpr (sizeof(wchar_t) == 2) {
+            a = load(0);
+            b = load(8);
+            const __m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(static_cast<short>(0xFF80)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, zero)) != 0xFFFF) return false;
+        } else {
+            const __m128i w0 = load(0), w1 = load(4), w2 = load(8), w3 = load(12);
+            const __m128i all = _mm_or_si128(_mm_or_si128(w0, w1), _mm_or_si128(w2, w3));
+            const __m128i high = _mm_and_si128(all, _mm_set1_epi32(static_cast<int>(0xFFFFFF80)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, zero)) != 0xFFFF) return false;
+            a = _mm_packs_epi32(w0, w1);
+            b = _mm_packs_epi32(w2, w3);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+        return true;
+    }
+#endif
+} // anon namespace
+
+[[nodiscard]] std::optional<size_t> utf8_to_utf16(const std::string_view in, const std::span<wchar_t> out) {
+    const auto* s = reinterpret_cast<const unsigned char*>(in.data());
+    const size_t n = in.size();
+    size_t i = 0, o = 0;
+    while (i < n) {
+        const unsigned c = s[i];
+        if (c < 0x80) {
+#ifdef UTF_SSE2
+            if (n - i >= 16 && out.size() - o >= 16 && widen_ascii16(in.data() + i, out.data() + o)) {
+                i += 16;
+                o += 16;
+                continue;
+            }
+#endif
+            if (o == out.size()) return std::nullopt;
+            out[o++] = static_cast<wchar_t>(c);
+            ++i;
+            continue;
+        }
+
+        unsigned cp = 0;
+        size_t len = 0;
+        // lead bytes below these minimums can only start overlong forms, F5+ would be past U+10FFFF
+        if (c >= 0xC2 && c <= 0xDF) { cp = c & 0x1F; len = 2; }
+        else if (c >= 0xE0 && c <= 0xEF) { cp = c & 0x0F; len = 3; }
+        else if (c >= 0xF0 && c <= 0xF4) { cp = c & 0x07; len = 4; }
+        else return std::nullopt;
+        if (n - i < len) return std::nullopt;
+        for (size_t k = 1; k < len; ++k) {
+            if (!is_cont(s[i + k])) return std::nullopt;
+            cp = (cp << 6) | (s[i + k] & 0x3F);
+        }
+        if ((len == 3 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) || (len == 4 && (cp < 0x10000 || cp > 0x10FFFF))) return std::nullopt;
+        i += len;
+
+        if (cp < 0x10000 || sizeof(wchar_t) == 4) {
+            if (o == out.size()) return std::nullopt;
+            out[o++] = static_cast<wchar_t>(cp);
+        } else {
+            if (out.size() - o < 2) return std::nullopt;
+            cp -= 0x10000;
+            out[o++] = static_cast<wchar_t>(0xD800 + (cp >> 10));
+            out[o++] = static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+        }
+    }
+    return o;
+}
+
+[[nodiscard]] std::optional<size_t> utf16_to_utf8(const std::wstring_view in, const std::span<char> out) {
+    const size_t n = in.size();
+    size_t i = 0, o = 0;
+    while (i < n) {
+        unsigned cp = static_cast<unsigned>(in[i]);
+        if (cp < 0x80) {
+#ifdef UTF_SSE2
+            if (n - i >= 16 && out.size() - o >= 16 && narrow_ascii16(in.data() + i, out.data() + o)) {
+                i += 16;
+                o += 16;
+                continue;
+            }
+#endif
+            if (o == out.size()) return std::nullopt;
+            out[o++] = static_cast<char>(cp);
+            ++i;
+            continue;
+        }
+        ++i;
+        if (sizeof(wchar_t) == 4) {
+            if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) return std::nullopt;
+        } else if (cp >= 0xD800 && cp <= 0xDBFF) {
+            if (i == n) return std::nullopt;
+            const unsigned lo = static_cast<unsigned>(in[i]);
+            if (lo < 0xDC00 || lo > 0xDFFF) return std::nullopt;
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            ++i;
+        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+            // lone low surrogate
+            return std::nullopt;
+        }
+
+        const size_t len = cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+        if (out.size() - o < len) return std::nullopt;
+        if (len == 2) {
+            out[o++] = static_cast<char>(0xC0 | (cp >> 6));
+        } else if (len == 3) {
+            out[o++] = static_cast<char>(0xE0 | (cp >> 12));
+            out[o++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        } else {
+            out[o++] = static_cast<char>(0xF0 | (cp >> 18));
+            out[o++] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out[o++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        }
+        out[o++] = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return o;
+}
+
+[[nodiscard]] std::optional<std::wstring> widen_utf8(const std::string_view in) {
+    std::wstring out(utf16_max_units(in.size()), L'\0');
+    const auto n = utf8_to_utf16(in, out);
+    if (!n) return std::nullopt;
+    out.resize(*n);
+    return out;
+}
+
+[[nodiscard]] std::optional<std::string> narrow_utf8(const std::wstring_view in) {
+    std::string out(utf8_max_bytes(in.size()), '\0');
+    const auto n = utf16_to_utf8(in, out);
+    if (!n) return std::nullopt;
+    out.resize(*n);
+    return out;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// validated utf8 <-> utf16, with utf16 held in wchar_t like every win32 string. where wchar_t is 4 bytes (linux)
+// the wide side is utf32 instead, one unit per code point, since thats what a wide string means to the c library there.
+// malformed input is rejected instead of guessed at: bad or truncated sequences, overlong forms and encoded
+// surrogates in utf8, unpaired surrogates in utf16 and any surrogate or anything past U+10FFFF in utf32.
+// ascii runs (nearly everything we convert) go through sse2 16 at a time
+
+// worst case output sizes, for sizing the buffers handed to the non allocating versions
+[[nodiscard]] constexpr size_t utf16_max_units(const size_t utf8_bytes) { return utf8_bytes; }
+[[nodiscard]] constexpr size_t utf8_max_bytes(const size_t utf16_units) { return utf16_units * (sizeof(wchar_t) == 2 ? 3 : 4); }
+
+// converts into out and returns how many units were written. nullopt if in is invalid or out is too small
+[[nodiscard]] std::optional<size_t> utf8_to_utf16(std::string_view in, std::span<wchar_t> out);
+[[nodiscard]] std::optional<size_t> utf16_to_utf8(std::wstring_view in, std::span<char> out);
+
+// allocating versions, one allocation for the worst case that then gets trimmed
+[[nodiscard]] std::optional<std::wstring> widen_utf8(std::string_view in);
+[[nodiscard]] std::optional<std::string> narrow_utf8(std::wstring_view in);
\ No newline at end of file
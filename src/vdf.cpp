@@ -0,0 +1,153 @@
+#include "vdf.h"
+
+namespace {
+    // libraryfolders/loginusers are like 4 levels deep, this is just so a broken file cant blow the stack
+    inline constexpr int MAX_DEPTH = 64;
+
+    enum class tok { str, open, close, end, bad };
+
+    struct cursor {
+        std::string_view txt;
+        size_t pos = 0;
+
+        void skip_ws_and_comments() {
+            while (pos < txt.size()) {
+                const char c = txt[pos];
+                if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                    ++pos;
+                } else if (c == '/' && pos + 1 < txt.size() && txt[pos + 1] == '/') {
+                    while (pos < txt.size() && txt[pos] != '\n') ++pos;
+                } else {
+                    break;
+                }
+            }
+        }
+
+        [[nodiscard]] tok next(std::string_view& out) {
+            skip_ws_and_comments();
+            if (pos >= txt.size()) return tok::end;
+            const char c = txt[pos];
+            if (c == '{') { ++pos; return tok::open; }
+            if (c == '}') { ++pos; return tok::close; }
+            if (c == '"') {
+                const size_t start = ++pos;
+                while (pos < txt.size() && txt[pos] != '"') {
+                    // skip whatever is escaped so \" doesnt end the string
+                    if (txt[pos] == '\\' && pos + 1 < txt.size()) ++pos;
+                    ++pos;
+                }
+                if (pos >= txt.size()) return tok::bad;
+                out = txt.substr(start, pos - start);
+                ++pos;
+                return tok::str;
+            }
+            // unquoted token, runs until whitespace or a structural char
+            const size_t start = pos;
+            while (pos < txt.size()) {
+                const char d = txt[pos];
+                if (d == ' ' || d == '\t' || d == '\r' || d == '\n' || d == '{' || d == '}' || d == '"') break;
+                ++pos;
+            }
+            out = txt.substr(start, pos - start);
+            return tok::str;
+        }
+
+        // drops a trailing [$WIN32] style conditional if there is one
+        void skip_conditional() {
+            skip_ws_and_comments();
+            if (pos < txt.size() && txt[pos] == '[') {
+                while (pos < txt.size() && txt[pos] != ']' && txt[pos] != '\n') ++pos;
+                if (pos < txt.size() && txt[pos] == ']') ++pos;
+            }
+        }
+    };
+
+    [[nodiscard]] bool parse_block(cursor& cur, vdf_node& parent, const int depth) {
+        if (depth > MAX_DEPTH) return false;
+        for (;;) {
+            std::string_view key;
+            switch (cur.next(key)) {
+                case tok::end:   return depth == 0;
+                case tok::close: return depth > 0;
+                case tok::str:   break;
+                default:         return false;
+            }
+            cur.skip_conditional();
+
+            vdf_node& node = parent.children.emplace_back();
+            node.key = key;
+            std::string_view val;
+            switch (cur.next(val)) {
+                case tok::open:
+                    node.is_block = true;
+                    if (!parse_block(cur, node, depth + 1)) return false;
+                    break;
+                case tok::str:
+                    node.value = val;
+                    cur.skip_conditional();
+                    break;
+                default:
+                    return false;
+            }
+        }
+    }
+} // anon namespace
+
+[[nodiscard]] bool vdf_key_equals(const std::string_view a, const std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x = static_cast<char>(x - 'A' + 'a');
+        if (y >= 'A' && y <= 'Z') y = static_cast<char>(y - 'A' + 'a');
+        if (x != y) return false;
+    }
+    return true;
+}
+
+[[nodiscard]] const vdf_node* vdf_node::find(const std::string_view k) const {
+    for (const auto& c : children) {
+        if (vdf_key_equals(c.key, k)) return &c;
+    }
+    return nullptr;
+}
+
+[[nodiscard]] std::optional<std::string> vdf_node::get(const std::string_view k) const {
+    const vdf_node* n = find(k);
+    if (!n || n->is_block) return std::nullopt;
+    return vdf_unescape(n->value);
+}
+
+[[nodiscard]] std::optional<vdf_node> vdf_parse(const std::string_view txt) {
+    cursor cur{ .txt = txt };
+    // skip the utf8 bom if some tool wrote one
+    if (txt.starts_with("\xEF\xBB\xBF")) cur.pos = 3;
+    vdf_node root;
+    root.is_block = true;
+    if (!parse_block(cur, root, 0)) return std::nullopt;
+    return root;
+}
+
+[[nodiscard]] std::string vdf_unescape(const std::string_view raw) {
+    // most values have no escapes at all so dont bother walking them char by char
+    if (raw.find('\\') == std::string_view::npos) return std::string(raw);
+    std::string out;
+    out.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] == '\\' && i + 1 < raw.size()) {
+            switch (raw[++i]) {
+                case 'n':  out.push_back('\n'); break;
+                case 't':  out.push_back('\t'); break;
+                case '\\': out.push_back('\\'); break;
+                case '"':  out.push_back('"');  break;
+                default:
+                    // unknown escape, keep it as is
+                    out.push_back('\\');
+                    out.push_back(raw[i]);
+                    break;
+            }
+        } else {
+            out.push_back(raw[i]);
+        }
+    }
+    return out;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "common.h"
+#include <string_view>
+#include <vector>
+
+// one node of a valve keyvalues (vdf/acf) tree. keys and values point straight into
+// the parsed buffer so the buffer has to outlive the tree
+struct vdf_node {
+    std::string_view key;
+    // raw value as it appears between the quotes, escapes are NOT resolved (use vdf_unescape)
+    std::string_view value;
+    std::vector<vdf_node> children;
+    bool is_block = false;
+
+    // first direct child whose key matches (case insensitive like steam does it)
+    [[nodiscard]] const vdf_node* find(std::string_view k) const;
+
+    // unescaped value of a direct leaf child
+    [[nodiscard]] std::optional<std::string> get(std::string_view k) const;
+};
+
+// parses a whole vdf document in one pass. the returned root is a block holding the top level pairs
+[[nodiscard]] std::optional<vdf_node> vdf_parse(std::string_view txt);
+
+// resolves the \\ \" \n \t escapes valve uses in quoted strings
+[[nodiscard]] std::string vdf_unescape(std::string_view raw);
+
+// ascii case insensitive compare for vdf keys
+[[nodiscard]] bool vdf_key_equals(std::string_view a, std::string_view b);
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "verify.h"
+#include "file_utils.h"
+#include "sha256.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+    inline constexpr std::string_view MAGIC = "SLVM";
+    inline constexpr int VERSION = 1;
+    // past this the disk is the limit on pretty much anything, more threads just means more seeking
+    inline constexpr size_t MAX_THREADS = 16;
+    inline constexpr size_t SLOWEST_SHOWN = 10;
+
+    using steady = std::chrono::steady_clock;
+
+    struct file_entry {
+        fs::path rel;
+        unsigned long long size = 0;
+        std::vector<std::string> digests;  // expected, only filled when checking
+    };
+
+    struct chunk_job {
+        size_t file = 0;
+        size_t index = 0;
+        unsigned long long offset = 0;
+        unsigned long long len = 0;
+    };
+
+    struct hashed {
+        std::vector<std::vector<sha256_digest>> digests;  // per file, per chunk
+        std::vector<bool> failed;                         // per file, couldnt be read all the way
+        std::vector<double> seconds;                      // per file, first chunk start to last chunk end
+        double total_seconds = 0;
+    };
+
+    // a trailing * on a skip component matches anything that starts with the rest of it
+    [[nodiscard]] bool component_matches(const fs::path& have, const fs::path& want) {
+        const wstr w = want.wstring();
+        if (w.ends_with(L'*')) return have.wstring().starts_with(std::wstring_view(w).substr(0, w.size() - 1));
+        return have == want;
+    }
+
+    [[nodiscard]] bool is_skipped(const fs::path& rel, const std::vector<fs::path>& skip) {
+        for (const auto& prefix : skip) {
+            auto a = rel.begin();
+            auto b = prefix.begin();
+            while (a != rel.end() && b != prefix.end() && component_matches(*a, *b)) { ++a; ++b; }
+            if (b == prefix.end()) return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] std::string utf8_of(const fs::path& p) {
+        const std::u8string s = p.generic_u8string();
+        return { reinterpret_cast<const char*>(s.data()), s.size() };
+    }
+
+    [[nodiscard]] fs::path path_of_utf8(const std::string_view s) {
+        return fs::path(std::u8string(reinterpret_cast<const char8_t*>(s.data()), s.size()));
+    }
+
+    [[nodiscard]] size_t thread_count(const verify_options& opts) {
+        if (opts.threads) return opts.threads;
+        const size_t hw = std::thread::hardware_concurrency();
+        return std::clamp<size_t>(hw, 1, MAX_THREADS);
+    }
+
+    [[nodiscard]] bool hash_chunk(const fs::path& p, const chunk_job& job, sha256_digest& out, std::atomic<unsigned long long>& done) {
+        TRACE_SCOPE("verify chunk");
+        std::ifstream in(p, std::ios::binary);
+        if (!in) return false;
+        in.seekg(static_cast<std::streamoff>(job.offset));
+        thread_local std::vector<char> buf(1 << 20);
+        sha256 h;
+        for (unsigned long long left = job.len; left > 0; ) {
+            const auto n = static_cast<std::streamsize>(std::min<unsigned long long>(left, buf.size()));
+            in.read(buf.data(), n);
+            if (in.gcount() != n) return false;
+            h.update(buf.data(), static_cast<size_t>(n));
+            left -= static_cast<unsigned long long>(n);
+            done += static_cast<unsigned long long>(n);
+        }
+        out = h.finish();
+        return true;
+    }
+
+    void print_progress(const unsigned long long done, const unsigned long long total, const steady::time_point start) {
+        const double secs = std::chrono::duration<double>(steady::now() - start).count();
+        const double mb = static_cast<double>(done) / (1 << 20);
+        std::printf("\rverify: %.0f / %.0f MiB  %.0f MiB/s   ", mb, static_cast<double>(total) / (1 << 20), secs > 0 ? mb / secs : 0.0);
+        std::fflush(stdout);
+    }
+
+    // hashes every file in chunk_size pieces spread over the pool
+    [[nodiscard]] hashed hash_files(const fs::path& root, const std::vector<file_entry>& files, const verify_options& opts) {
+        TRACE_SCOPE("verify hash files");
+        const unsigned long long chunk = opts.chunk_size ? opts.chunk_size : 1;
+        std::vector<chunk_job> jobs;
+        hashed out;
+        out.digests.resize(files.size());
+        out.failed.assign(files.size(), false);
+        out.seconds.assign(files.size(), 0);
+        unsigned long long total = 0;
+        for (size_t f = 0; f < files.size(); ++f) {
+            const unsigned long long size = files[f].size;
+            // empty files still get one (empty) chunk so they have a digest
+            const size_t n = size ? static_cast<size_t>((size + chunk - 1) / chunk) : 1;
+            out.digests[f].resize(n);
+            for (size_t i = 0; i < n; ++i) {
+                const unsigned long long off = i * chunk;
+                jobs.push_back({ f, i, off, std::min(chunk, size - off) });
+            }
+            total += size;
+        }
+
+        // per job so the workers never share anything but the counter
+        std::vector<char> jobFailed(jobs.size(), 0);
+        std::vector<long long> jobStart(jobs.size()), jobEnd(jobs.size());
+        std::atomic<unsigned long long> done{ 0 };
+        std::atomic<bool> finished{ false };
+        const auto start = steady::now();
+        const auto us_since_start = [start] {
+            return std::chrono::duration_cast<std::chrono::microseconds>(steady::now() - start).count();
+        };
+
+        std::jthread progress;
+        if (opts.progress) {
+            progress = std::jthread([&](const std::stop_token st) {
+                while (!st.stop_requested() && !finished) {
+                    print_progress(done, total, start);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                }
+            });
+        }
+        parallel_for_stealing(jobs.size(), thread_count(opts), [&](const size_t j) {
+            const chunk_job& job = jobs[j];
+            jobStart[j] = us_since_start();
+            jobFailed[j] = !hash_chunk(root / files[job.file].rel, job, out.digests[job.file][job.index], done);
+            jobEnd[j] = us_since_start();
+        });
+        finished = true;
+        if (progress.joinable()) {
+            progress.request_stop();
+            progress.join();
+            print_progress(done, total, start);
+            std::puts("");
+        }
+        out.total_seconds = std::chrono::duration<double>(steady::now() - start).count();
+
+        // jobs are in file order, so each file's chunks are one run
+        for (size_t j = 0; j < jobs.size(); ) {
+            const size_t f = jobs[j].file;
+            long long first = jobStart[j], last = jobEnd[j];
+            for (; j < jobs.size() && jobs[j].file == f; ++j) {
+                first = std::min(first, jobStart[j]);
+                last = std::max(last, jobEnd[j]);
+                if (jobFailed[j]) out.failed[f] = true;
+            }
+            out.seconds[f] = static_cast<double>(last - first) / 1e6;
+        }
+        trace_counter("verify bytes", static_cast<long long>(total));
+        return out;
+    }
+
+    void print_timing(const std::vector<file_entry>& files, const hashed& h) {
+        std::vector<size_t> order(files.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        const size_t shown = std::min(order.size(), SLOWEST_SHOWN);
+        std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(shown), order.end(),
+                          [&h](const size_t a, const size_t b) { return h.seconds[a] > h.seconds[b]; });
+        std::puts("slowest files:");
+        for (size_t i = 0; i < shown; ++i) {
+            const file_entry& f = files[order[i]];
+            const double mb = static_cast<double>(f.size) / (1 << 20);
+            const double s = h.seconds[order[i]];
+            std::printf("  %8.2f s  %10.1f MiB  %8.1f MiB/s  %s\n", s, mb, s > 0 ? mb / s : 0.0, utf8_of(f.rel).c_str());
+        }
+    }
+
+    [[nodiscard]] std::vector<file_entry> list_files(const fs::path& root, const std::vector<fs::path>& skip) {
+        TRACE_SCOPE("verify list files");
+        std::vector<file_entry> out;
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec)) {
+            std::error_code ec2;
+            if (!it->is_regular_file(ec2)) continue;
+            fs::path rel = it->path().lexically_relative(root);
+            if (is_skipped(rel, skip)) continue;
+            out.push_back({ std::move(rel), it->file_size(ec2), {} });
+        }
+        // stable order so manifests diff nicely
+        std::ranges::sort(out, {}, &file_entry::rel);
+        return out;
+    }
+
+    [[nodiscard]] std::optional<std::pair<unsigned long long, std::vector<file_entry>>> read_manifest(const fs::path& p) {
+        const auto txt = read_file_bytes(p);
+        if (!txt) return std::nullopt;
+        std::istringstream in(*txt);
+        std::string magic;
+        int version = 0;
+        unsigned long long chunk = 0;
+        if (!(in >> magic >> version >> chunk) || magic != MAGIC || version != VERSION || chunk == 0) return std::nullopt;
+        std::vector<file_entry> files;
+        std::string line;
+        std::getline(in, line);
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            // <size> <digests> <path>, the path is the rest of the line so it can have spaces
+            const auto sp1 = line.find(' ');
+            const auto sp2 = sp1 == std::string::npos ? sp1 : line.find(' ', sp1 + 1);
+            if (sp2 == std::string::npos) return std::nullopt;
+            file_entry e;
+            e.size = std::strtoull(line.c_str(), nullptr, 10);
+            for (size_t pos = sp1 + 1; pos < sp2; ) {
+                const size_t comma = std::min(line.find(',', pos), sp2);
+                e.digests.push_back(line.substr(pos, comma - pos));
+                pos = comma + 1;
+            }
+            e.rel = path_of_utf8(std::string_view(line).substr(sp2 + 1));
+            files.push_back(std::move(e));
+        }
+        return std::pair{ chunk, std::move(files) };
+    }
+} // anon namespace
+
+[[nodiscard]] bool make_install_manifest(const fs::path& root, const fs::path& manifest, const verify_options& opts) {
+    TRACE_SCOPE("make_install_manifest");
+    const std::vector<file_entry> files = list_files(root, opts.skip);
+    const hashed h = hash_files(root, files, opts);
+    std::string out = std::string(MAGIC) + " " + std::to_string(VERSION) + " " + std::to_string(opts.chunk_size) + "\n";
+    for (size_t f = 0; f < files.size(); ++f) {
+        if (h.failed[f]) {
+            std::fprintf(stderr, "could not read %s\n", utf8_of(files[f].rel).c_str());
+            return false;
+        }
+        out += std::to_string(files[f].size) + " ";
+        for (size_t i = 0; i < h.digests[f].size(); ++i) {
+            if (i) out += ",";
+            out += to_hex(h.digests[f][i]);
+        }
+        out += " " + utf8_of(files[f].rel) + "\n";
+    }
+    if (opts.progress) print_timing(files, h);
+    return write_file_atomic(manifest, out);
+}
+
+[[nodiscard]] std::optional<verify_report> verify_install(const fs::path& root, const fs::path& manifest, const verify_options& opts) {
+    TRACE_SCOPE("verify_install");
+    auto parsed = read_manifest(manifest);
+    if (!parsed) return std::nullopt;
+    auto& [chunk, expected] = *parsed;
+
+    verify_report rep;
+    // size checks are free, only hash what could still match
+    std::vector<file_entry> toHash;
+    for (auto& e : expected) {
+        if (is_skipped(e.rel, opts.skip)) continue;
+        ++rep.files;
+        std::error_code ec;
+        const auto size = fs::file_size(root / e.rel, ec);
+        if (ec) rep.missing.push_back(e.rel);
+        else if (size != e.size) rep.wrong_size.push_back(e.rel);
+        else toHash.push_back(std::move(e));
+    }
+
+    verify_options hashOpts = opts;
+    hashOpts.chunk_size = chunk;
+    const hashed h = hash_files(root, toHash, hashOpts);
+    for (size_t f = 0; f < toHash.size(); ++f) {
+        rep.bytes += toHash[f].size;
+        bool good = !h.failed[f] && h.digests[f].size() == toHash[f].digests.size();
+        for (size_t i = 0; good && i < h.digests[f].size(); ++i) good = to_hex(h.digests[f][i]) == toHash[f].digests[i];
+        if (!good) rep.corrupt.push_back(toHash[f].rel);
+    }
+    rep.seconds = h.total_seconds;
+    if (opts.progress) print_timing(toHash, h);
+    return rep;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common.h"
+#include <vector>
+
+// full install integrity check. files are hashed in fixed size chunks so one big pak gets spread over every
+// core, which also means the manifest stores one digest per chunk instead of one per file.
+//
+// manifest is plain text:
+//   SLVM 1 <chunk_bytes>
+//   <size> <hex digest of chunk 0>,<chunk 1>,... <path relative to the root, utf8, forward slashes>
+
+struct verify_options {
+    // 0 means one per core
+    size_t threads = 0;
+    unsigned long long chunk_size = 64ull << 20;
+    // relative path prefixes that are left out of both making and checking (our own BattlEye dll isnt steam's).
+    // a component ending in * matches by prefix
+    std::vector<fs::path> skip;
+    bool progress = true;
+};
+
+struct verify_report {
+    unsigned long long files = 0;
+    unsigned long long bytes = 0;
+    double seconds = 0;
+    std::vector<fs::path> missing;
+    std::vector<fs::path> wrong_size;
+    std::vector<fs::path> corrupt;
+
+    [[nodiscard]] bool ok() const { return missing.empty() && wrong_size.empty() && corrupt.empty(); }
+};
+
+// hashes everything under root and writes the manifest for it
+[[nodiscard]] bool make_install_manifest(const fs::path& root, const fs::path& manifest, const verify_options& opts);
+
+// checks root against manifest. nullopt if the manifest cant be read
+[[nodiscard]] std::optional<verify_report> verify_install(const fs::path& root, const fs::path& manifest, const verify_options& opts);
@@ -0,0 +1,39 @@
+#include "zstd_stream.h"
+
+#ifdef SPECTRE_HAVE_ZSTD
+#include <zstd.h>
+
+zstd_stream::zstd_stream() : ctx_(ZSTD_createDStream()), out_(ZSTD_DStreamOutSize()) {
+    // a release artifact has no business needing more than a 128 MiB window, so dont let one allocate it
+    if (ctx_) ZSTD_DCtx_setParameter(static_cast<ZSTD_DStream*>(ctx_), ZSTD_d_windowLogMax, 27);
+}
+
+zstd_stream::~zstd_stream() {
+    ZSTD_freeDStream(static_cast<ZSTD_DStream*>(ctx_));
+}
+
+[[nodiscard]] bool zstd_stream::feed(const std::span<const char> in, const std::function<bool(const char* data, size_t len)>& sink) {
+    if (!ctx_) return false;
+    ZSTD_inBuffer src{ in.data(), in.size(), 0 };
+    // keep going until the input is used up and the decoder has nothing buffered for us either
+    for (;;) {
+        ZSTD_outBuffer dst{ out_.data(), out_.size(), 0 };
+        const size_t before = src.pos;
+        const size_t ret = ZSTD_decompressStream(static_cast<ZSTD_DStream*>(ctx_), &dst, &src);
+        if (ZSTD_isError(ret)) return false;
+        if (dst.pos && !sink(out_.data(), dst.pos)) return false;
+        // a frame that ends right as the output buffer fills takes one more empty call to notice theres nothing
+        // left, and that call already asks for the next frame's header. only a call that did something counts
+        if (ret == 0 || src.pos != before || dst.pos) complete_ = ret == 0;
+        if (src.pos == src.size && dst.pos < dst.size) return true;
+    }
+}
+#else
+zstd_stream::zstd_stream() = default;
+
+zstd_stream::~zstd_stream() = default;
+
+[[nodiscard]] bool zstd_stream::feed(std::span<const char>, const std::function<bool(const char* data, size_t len)>&) {
+    return false;
+}
+#endif
\ No newline at end of file
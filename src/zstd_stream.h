@@ -0,0 +1,35 @@
+#pragma once
+
+#include <functional>
+#include <span>
+#include <vector>
+
+// streaming zstd decoder for download bodies. only real when built with SPECTRE_HAVE_ZSTD (cmake found libzstd),
+// without it every feed fails, so check zstd_available before asking a server for zstd
+[[nodiscard]] constexpr bool zstd_available() {
+#ifdef SPECTRE_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+class zstd_stream {
+public:
+    zstd_stream();
+    ~zstd_stream();
+    zstd_stream(const zstd_stream&) = delete;
+    zstd_stream& operator=(const zstd_stream&) = delete;
+
+    // decodes the next piece of compressed input and hands the output to sink as it comes out, so nothing
+    // bigger than one output buffer is ever held. false on corrupt input or as soon as sink returns false
+    [[nodiscard]] bool feed(std::span<const char> in, const std::function<bool(const char* data, size_t len)>& sink);
+
+    // the input so far ended exactly on a frame boundary. false after the last feed means the body was cut short
+    [[nodiscard]] bool complete() const { return complete_; }
+
+private:
+    void* ctx_ = nullptr;
+    bool complete_ = false;
+    std::vector<char> out_;
+};
\ No newline at end of file
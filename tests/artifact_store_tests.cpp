@@ -0,0 +1,162 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "artifact_store.h"
+#include "file_utils.h"
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    struct artifact {
+        std::string bytes;
+        std::string hex;
+    };
+
+    [[nodiscard]] artifact make_artifact(const size_t n, const std::uint64_t seed) {
+        artifact a{ code_like_bytes(n, seed), {} };
+        a.hex = to_hex(sha256_of(a.bytes.data(), a.bytes.size()));
+        return a;
+    }
+
+    [[nodiscard]] fs::path store_dir() {
+        return get_launcher_data_dir() / "store";
+    }
+
+    [[nodiscard]] size_t files_in(const fs::path& dir) {
+        size_t n = 0;
+        std::error_code ec;
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) ++n;
+        return n;
+    }
+} // anon namespace
+
+TEST(artifact_store, put_then_install_a_copy) {
+    const temp_dir tmp("store");
+    const artifact a = make_artifact(300'000, 1);
+    REQUIRE(write_file(tmp.path / "dl", a.bytes));
+    REQUIRE(store_put(tmp.path / "dl", a.hex));
+    std::error_code ec;
+    CHECK(!fs::exists(tmp.path / "dl", ec));
+    CHECK(store_has(a.hex));
+
+    const fs::path installed = tmp.path / "game" / "BEClient_x64.dll";
+    fs::create_directories(installed.parent_path(), ec);
+    const store_install_counters before = store_get_install_counters();
+    REQUIRE(store_install(a.hex, installed));
+    CHECK_EQ(read_file_bytes(installed), std::optional<std::string>(a.bytes));
+    // exactly one of the two, which one depends on the filesystem the temp dir is on
+    const store_install_counters after = store_get_install_counters();
+    CHECK_EQ((after.reflinks - before.reflinks) + (after.copies - before.copies), 1u);
+    // its own file either way, never a hardlink to the object
+    const auto obj_id = get_file_identity(store_dir() / "objects" / a.hex);
+    const auto dst_id = get_file_identity(installed);
+    REQUIRE(obj_id && dst_id);
+    CHECK(obj_id->file_index != dst_id->file_index);
+
+    // the game side gets rewritten in place, the stored object must not notice. with a reflink this is the
+    // write that makes the filesystem unshare the extents
+    {
+        positional_file f = open_positional(installed, a.bytes.size(), true);
+        REQUIRE(f);
+        REQUIRE(f.write_at(0, "MZ patched", 10));
+    }
+    CHECK(store_has(a.hex));
+    CHECK_EQ(read_file_bytes(store_dir() / "objects" / a.hex), std::optional<std::string>(a.bytes));
+    REQUIRE(store_install(a.hex, installed));
+    CHECK_EQ(read_file_bytes(installed), std::optional<std::string>(a.bytes));
+}
+
+TEST(artifact_store, damaged_object_is_dropped_on_install) {
+    const temp_dir tmp("store");
+    const artifact a = make_artifact(100'000, 2);
+    REQUIRE(write_file(tmp.path / "dl", a.bytes));
+    REQUIRE(store_put(tmp.path / "dl", a.hex));
+    REQUIRE(write_file_atomic(store_dir() / "objects" / a.hex, "not what the name says"));
+    CHECK(!store_install(a.hex, tmp.path / "out"));
+    CHECK(!store_has(a.hex));
+}
+
+TEST(artifact_store, pins_and_prefixes_resolve) {
+    const temp_dir tmp("store");
+    const artifact a = make_artifact(10'000, 3);
+    REQUIRE(write_file(tmp.path / "dl", a.bytes));
+    REQUIRE(store_put(tmp.path / "dl", a.hex));
+    REQUIRE(store_pin("known-good", a.hex));
+    CHECK_EQ(store_resolve("known-good"), std::optional<std::string>(a.hex));
+    CHECK_EQ(store_resolve(a.hex.substr(0, 12)), std::optional<std::string>(a.hex));
+    CHECK(!store_resolve(a.hex.substr(0, 4)));
+    CHECK(!store_pin("../escape", a.hex));
+}
+
+TEST(artifact_store, gc_keeps_pinned_and_recent) {
+    const temp_dir tmp("store");
+    // whatever earlier tests left in the shared store goes first
+    store_gc(0);
+    std::vector<artifact> arts;
+    for (int i = 0; i < 4; ++i) {
+        arts.push_back(make_artifact(100'000, 10 + i));
+        REQUIRE(write_file(tmp.path / "dl", arts.back().bytes));
+        REQUIRE(store_put(tmp.path / "dl", arts.back().hex));
+        // lru order is by used mtime, make sure they dont all land on the same tick
+        std::error_code ec;
+        fs::last_write_time(store_dir() / "used" / arts.back().hex, fs::file_time_type::clock::now() - std::chrono::minutes(10 - i), ec);
+    }
+    REQUIRE(store_pin("oldest", arts[0].hex));
+    store_gc(250'000);
+    CHECK(store_has(arts[0].hex));
+    CHECK(!store_has(arts[1].hex));
+    CHECK(!store_has(arts[2].hex));
+    CHECK(store_has(arts[3].hex));
+}
+
+TEST(artifact_store, concurrent_puts_of_one_object_in_threads) {
+    const temp_dir tmp("store");
+    const artifact a = make_artifact(2 << 20, 20);
+    std::vector<char> ok(8, 0);
+    {
+        std::vector<std::jthread> writers;
+        for (size_t i = 0; i < ok.size(); ++i) {
+            REQUIRE(write_file(tmp.path / ("dl" + std::to_string(i)), a.bytes));
+            writers.emplace_back([&, i] { ok[i] = store_put(tmp.path / ("dl" + std::to_string(i)), a.hex); });
+        }
+    }
+    for (const char o : ok) CHECK(o);
+    CHECK_EQ(read_file_bytes(store_dir() / "objects" / a.hex), std::optional<std::string>(a.bytes));
+    // every loser cleaned up after itself
+    CHECK_EQ(files_in(store_dir() / "tmp"), 0u);
+}
+
+#ifndef _WIN32
+TEST(artifact_store, concurrent_puts_from_several_instances) {
+    // what two launchers and a prefetcher finishing the same download at once look like
+    const temp_dir tmp("store");
+    const artifact a = make_artifact(4 << 20, 21);
+    std::vector<pid_t> children;
+    for (int i = 0; i < 4; ++i) {
+        const fs::path mine = tmp.path / ("dl" + std::to_string(i));
+        REQUIRE(write_file(mine, a.bytes));
+        const pid_t child = ::fork();
+        REQUIRE(child >= 0);
+        if (child == 0) {
+            const bool put = store_put(mine, a.hex);
+            // a collector running alongside must not take the object out from under anyone
+            store_gc(64ull << 20);
+            ::_exit(put && store_has(a.hex) ? 0 : 1);
+        }
+        children.push_back(child);
+    }
+    for (const pid_t child : children) {
+        int status = 0;
+        REQUIRE(::waitpid(child, &status, 0) == child);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    CHECK_EQ(read_file_bytes(store_dir() / "objects" / a.hex), std::optional<std::string>(a.bytes));
+    CHECK_EQ(files_in(store_dir() / "tmp"), 0u);
+    const fs::path installed = tmp.path / "BEClient_x64.dll";
+    REQUIRE(store_install(a.hex, installed));
+    CHECK_EQ(read_file_bytes(installed), std::optional<std::string>(a.bytes));
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "test.h"
+#include "support/loopback_server.h"
+#include "backend_bench.h"
+#include "steam_library.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+namespace {
+    // the steamid64 out of a provider id body, 0 if it isnt one
+    [[nodiscard]] unsigned long long provider_id_of(const std::string& body) {
+        const std::string_view prefix = R"({"providerId":")";
+        if (!body.starts_with(prefix)) return 0;
+        return std::stoull(body.substr(prefix.size()));
+    }
+
+    // a stand-in backend that remembers every provider id it was sent
+    struct stand_in {
+        std::mutex lock;
+        std::vector<unsigned long long> ids;
+        std::function<loopback_reply(unsigned long long)> answer = [](unsigned long long) { return loopback_reply{ .body = "{}" }; };
+        loopback_server srv{ [this](const loopback_request& req) {
+            const unsigned long long id = req.method == "POST" && req.target == "/v1/submitproviderid" ? provider_id_of(req.body) : 0;
+            {
+                std::scoped_lock lk(lock);
+                ids.push_back(id);
+            }
+            return answer(id);
+        } };
+    };
+
+    [[nodiscard]] backend_bench_options quick(const stand_in& s) {
+        backend_bench_options o;
+        o.url = s.srv.url(L"/v1/submitproviderid");
+        o.duration = std::chrono::milliseconds(500);
+        o.timeout = std::chrono::seconds(5);
+        o.threads = 2;
+        o.concurrency = 4;
+        o.progress = false;
+        return o;
+    }
+} // anon namespace
+
+TEST(backend_bench, needs_a_url_that_isnt_production) {
+    CHECK(backend_bench_refusal(L"").has_value());
+    CHECK(backend_bench_refusal(L"not a url").has_value());
+    CHECK(backend_bench_refusal(L"https://127.0.0.1/v1/submitproviderid").has_value());
+    CHECK(backend_bench_refusal(L"http://game.spectre.astro-dev.uk/v1/submitproviderid").has_value());
+    CHECK(backend_bench_refusal(L"http://game.spectre.astro-dev.uk:8081/").has_value());
+    CHECK(backend_bench_refusal(L"http://GAME.Spectre.Astro-Dev.UK./v1/submitproviderid").has_value());
+    CHECK(!backend_bench_refusal(L"http://127.0.0.1:8081/v1/submitproviderid").has_value());
+    CHECK(!backend_bench_refusal(L"http://staging.spectre.astro-dev.uk/v1/submitproviderid").has_value());
+
+    backend_bench_options o;
+    o.url = L"http://game.spectre.astro-dev.uk/v1/submitproviderid";
+    o.progress = false;
+    CHECK(!backend_bench(o).has_value());
+    CHECK(run_backend_bench(o) != 0);
+}
+
+TEST(backend_bench, closed_loop_keeps_its_connections_busy) {
+    stand_in s;
+    backend_bench_options o = quick(s);
+    o.first_account = 5000;
+    const auto r = backend_bench(o);
+    REQUIRE(r.has_value());
+    CHECK(r->requests() > 20);
+    CHECK_EQ(r->ok, r->requests());
+    CHECK_EQ(r->latency.total, r->requests());
+    CHECK_EQ(s.srv.requests(), r->requests());
+    // keep-alive the whole way, one socket per request in flight
+    CHECK(r->connects <= 4);
+    CHECK_EQ(s.srv.connections(), r->connects);
+    CHECK_EQ(std::accumulate(r->ok_per_second.begin(), r->ok_per_second.end(), 0ull), r->ok);
+
+    // every synthetic login is a different account, handed out in order from first_account
+    std::scoped_lock lk(s.lock);
+    auto ids = s.ids;
+    std::ranges::sort(ids);
+    CHECK(std::ranges::adjacent_find(ids) == ids.end());
+    CHECK_EQ(ids.front(), steamid64_from_account(5000));
+    CHECK_EQ(ids.back(), steamid64_from_account(5000 + ids.size() - 1));
+}
+
+TEST(backend_bench, open_loop_sends_exactly_the_schedule) {
+    stand_in s;
+    backend_bench_options o = quick(s);
+    o.rate = 200;
+    const auto start = std::chrono::steady_clock::now();
+    const auto r = backend_bench(o);
+    REQUIRE(r.has_value());
+    CHECK_EQ(r->requests(), 100u);
+    CHECK_EQ(r->ok, 100u);
+    // spread over the duration instead of fired off in one go
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(500));
+    CHECK(r->max_lag_us < 250'000);
+}
+
+TEST(backend_bench, counts_errors_and_timeouts_apart) {
+    stand_in s;
+    s.answer = [](const unsigned long long id) {
+        loopback_reply rep{ .body = "{}" };
+        const unsigned long long k = id - steamid64_from_account(900000000);
+        if (k % 4 == 0) rep.status = 503;
+        if (k % 4 == 1) std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        return rep;
+    };
+    backend_bench_options o = quick(s);
+    o.rate = 40;
+    o.timeout = std::chrono::milliseconds(150);
+    // enough room that nothing queues behind the slow ones and times out on their account
+    o.concurrency = 20;
+    const auto r = backend_bench(o);
+    REQUIRE(r.has_value());
+    CHECK_EQ(r->requests(), 20u);
+    CHECK_EQ(r->http_error, 5u);
+    CHECK_EQ(r->timed_out, 5u);
+    CHECK_EQ(r->ok, 10u);
+    CHECK_EQ(r->failed, 0u);
+    // the timed out ones are counted at their deadline, not whenever the server got around to it
+    CHECK(r->latency.max < 400'000);
+}
+
+TEST(backend_bench, dead_target_counts_as_failed) {
+    backend_bench_options o;
+    {
+        stand_in s;
+        o = quick(s);
+    }
+    // nothing listens there anymore
+    o.rate = 20;
+    const auto r = backend_bench(o);
+    REQUIRE(r.has_value());
+    CHECK_EQ(r->requests(), 10u);
+    CHECK_EQ(r->failed, 10u);
+    CHECK_EQ(r->ok, 0u);
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "delta.h"
+#include "file_utils.h"
+#include <cstring>
+
+namespace {
+    // about what BEClient_x64.dll weighs
+    inline constexpr size_t DLL_SIZE = 3 << 20;
+
+    // what a rebuild with a small fix does to a dll: a few hundred addresses and immediates shift, a new function
+    // lands in the middle and an old one goes away further on
+    [[nodiscard]] std::string next_build(const std::string& old, const std::uint64_t seed) {
+        splitmix64 rng(seed);
+        std::string out = old;
+        for (int i = 0; i < 300; ++i) {
+            const size_t at = rng.below(out.size() - 4);
+            const auto v = static_cast<std::uint32_t>(rng.next());
+            std::memcpy(out.data() + at, &v, 4);
+        }
+        out.insert(out.size() / 3, code_like_bytes(6000, seed + 1));
+        out.erase(out.size() * 2 / 3, 9000);
+        return out;
+    }
+
+    [[nodiscard]] std::string hex_of(const std::string& bytes) {
+        return to_hex(sha256_of(bytes.data(), bytes.size()));
+    }
+
+    struct fixture {
+        temp_dir dir{ "delta" };
+        std::string old_dll = code_like_bytes(DLL_SIZE, 7);
+        std::string new_dll = next_build(old_dll, 8);
+        fs::path source = dir.path / "old.dll";
+        fs::path patch = dir.path / "dll.patch";
+        fs::path out = dir.path / "new.dll";
+
+        fixture() {
+            REQUIRE(write_file(source, old_dll));
+            REQUIRE(write_file(patch, delta_generate(old_dll, new_dll)));
+        }
+    };
+} // anon namespace
+
+TEST(delta, rebuild_round_trips_in_a_small_patch) {
+    fixture f;
+    sha256_digest target{};
+    CHECK(delta_apply(f.patch, f.source, f.out, &target) == delta_result::ok);
+    CHECK(read_file_bytes(f.out) == f.new_dll);
+    CHECK_EQ(to_hex(target), hex_of(f.new_dll));
+    // the point of the whole thing: a few percent of the full download
+    CHECK(fs::file_size(f.patch) < f.new_dll.size() / 20);
+}
+
+TEST(delta, header_names_the_source) {
+    fixture f;
+    const auto sd = delta_source_digest(f.patch);
+    REQUIRE(sd.has_value());
+    CHECK_EQ(to_hex(*sd), hex_of(f.old_dll));
+
+    REQUIRE(write_file(f.dir.path / "junk", "MZ not a patch at all"));
+    CHECK(!delta_source_digest(f.dir.path / "junk").has_value());
+    CHECK(!delta_source_digest(f.dir.path / "missing").has_value());
+}
+
+TEST(delta, wrong_source_is_refused_before_writing) {
+    fixture f;
+    REQUIRE(write_file(f.source, next_build(f.old_dll, 9)));
+    CHECK(delta_apply(f.patch, f.source, f.out) == delta_result::wrong_source);
+    CHECK(!fs::exists(f.out));
+}
+
+TEST(delta, checked_source_that_was_wrong_still_fails) {
+    // the caller vouched for the source (hash cache) but the file changed since, the target digest catches it
+    fixture f;
+    std::string touched = f.old_dll;
+    for (size_t i = 0; i < touched.size(); i += 4096) touched[i] = static_cast<char>(~touched[i]);
+    REQUIRE(write_file(f.source, touched));
+    CHECK(delta_apply(f.patch, f.source, f.out, nullptr, true) == delta_result::target_mismatch);
+    CHECK(!fs::exists(f.out));
+}
+
+TEST(delta, checked_source_skips_the_hash) {
+    fixture f;
+    sha256_digest target{};
+    CHECK(delta_apply(f.patch, f.source, f.out, &target, true) == delta_result::ok);
+    CHECK(read_file_bytes(f.out) == f.new_dll);
+}
+
+TEST(delta, damaged_patches_are_rejected) {
+    fixture f;
+    const std::string good = *read_file_bytes(f.patch);
+
+    // cut short in the middle of the ops
+    REQUIRE(write_file(f.patch, std::string_view(good).substr(0, good.size() / 2)));
+    CHECK(delta_apply(f.patch, f.source, f.out) == delta_result::bad_patch);
+    CHECK(!fs::exists(f.out));
+
+    // a copy reaching past the end of the source
+    std::string far = good.substr(0, 4 + 4 + 32 + 32 + 8);
+    far.push_back(1);
+    const std::uint64_t off = f.old_dll.size() - 10;
+    const std::uint32_t len = 100;
+    far.append(reinterpret_cast<const char*>(&off), 8);
+    far.append(reinterpret_cast<const char*>(&len), 4);
+    far.push_back(0);
+    REQUIRE(write_file(f.patch, far));
+    CHECK(delta_apply(f.patch, f.source, f.out) == delta_result::bad_patch);
+
+    // right ops, wrong version
+    std::string v2 = good;
+    v2[4] = 2;
+    REQUIRE(write_file(f.patch, v2));
+    CHECK(delta_apply(f.patch, f.source, f.out) == delta_result::bad_patch);
+    CHECK(!delta_source_digest(f.patch).has_value());
+    CHECK(!fs::exists(f.out));
+}
+
+TEST(delta, unrelated_and_empty_inputs) {
+    const temp_dir dir("delta_edge");
+    const std::string a = random_bytes(200'000, 11), b = random_bytes(150'000, 12);
+    // nothing in common, so it all goes in as inserts
+    for (const auto& [src, dst] : { std::pair{ a, b }, std::pair{ std::string(), b }, std::pair{ a, std::string() } }) {
+        REQUIRE(write_file(dir.path / "src", src));
+        REQUIRE(write_file(dir.path / "patch", delta_generate(src, dst)));
+        CHECK(delta_apply(dir.path / "patch", dir.path / "src", dir.path / "out") == delta_result::ok);
+        CHECK(read_file_bytes(dir.path / "out").value_or("x") == dst);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,604 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "support/loopback_server.h"
+#include "downloader.h"
+#include "file_utils.h"
+#include "sha256.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <utility>
+#ifdef SPECTRE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+    // a release host: the artifact at /BEClient_x64.dll with ranges and an etag, 404 for everything else
+    // (.zst, .sha256) unless a test fills those in. records every Range header it was asked for
+    struct release_host {
+        std::string body;
+        std::string etag = "\"v1\"";
+        std::string sidecar;
+        std::string repr_digest;
+        // served as /BEClient_x64.dll.zst when set, a 404 otherwise
+        std::string zst;
+        int zst_asks = 0;
+        // range requests starting at or past this byte get cut off after a few kb, -1 never
+        std::atomic<long long> cut_from{ -1 };
+        unsigned long long server_rate = 0;
+        std::mutex lock;
+        std::vector<std::string> ranges;
+        int full_gets = 0;
+        loopback_server srv{ [this](const loopback_request& req) { return answer(req); } };
+
+        loopback_reply answer(const loopback_request& req) {
+            loopback_reply rep;
+            if (req.target == "/BEClient_x64.dll.sha256" && !sidecar.empty()) {
+                rep.body = sidecar + "  BEClient_x64.dll\n";
+                return rep;
+            }
+            if (req.target == "/BEClient_x64.dll.zst") {
+                std::scoped_lock lk(lock);
+                ++zst_asks;
+                if (zst.empty()) rep.status = 404;
+                rep.body = zst;
+                return rep;
+            }
+            if (req.target != "/BEClient_x64.dll") {
+                rep.status = 404;
+                return rep;
+            }
+            if (const auto inm = req.header("If-None-Match"); inm && *inm == etag) {
+                rep.status = 304;
+                return rep;
+            }
+            rep.body = body;
+            rep.ranges = true;
+            rep.bytes_per_sec = server_rate;
+            rep.headers = { { "ETag", etag } };
+            if (!repr_digest.empty()) rep.headers.emplace_back("Repr-Digest", "sha-256=:" + repr_digest + ":");
+            const auto range = req.header("Range");
+            std::scoped_lock lk(lock);
+            if (!range) {
+                ++full_gets;
+                return rep;
+            }
+            ranges.emplace_back(*range);
+            const long long first = std::atoll(std::string(range->substr(6)).c_str());
+            if (const long long cut = cut_from; cut >= 0 && first >= cut) rep.cut_after = 4096;
+            return rep;
+        }
+
+        // range requests other than the 1 byte probes
+        [[nodiscard]] std::vector<std::string> chunk_ranges() {
+            std::scoped_lock lk(lock);
+            std::vector<std::string> out;
+            for (const auto& r : ranges) {
+                if (r != "bytes=0-0") out.push_back(r);
+            }
+            return out;
+        }
+
+        [[nodiscard]] wstr url() const { return srv.url(L"/BEClient_x64.dll"); }
+    };
+
+    [[nodiscard]] std::string hex_of(const std::string& s) {
+        return to_hex(sha256_of(s.data(), s.size()));
+    }
+
+    [[nodiscard]] std::string base64_of(const sha256_digest& d) {
+        static constexpr char B64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        for (size_t i = 0; i < d.size(); i += 3) {
+            const unsigned v = (d[i] << 16) | ((i + 1 < d.size() ? d[i + 1] : 0) << 8) | (i + 2 < d.size() ? d[i + 2] : 0);
+            out += B64[(v >> 18) & 63];
+            out += B64[(v >> 12) & 63];
+            out += i + 1 < d.size() ? B64[(v >> 6) & 63] : '=';
+            out += i + 2 < d.size() ? B64[v & 63] : '=';
+        }
+        return out;
+    }
+
+#ifdef SPECTRE_HAVE_ZSTD
+    [[nodiscard]] std::string zstd_of(const std::string& s) {
+        std::string out(ZSTD_compressBound(s.size()), '\0');
+        out.resize(ZSTD_compress(out.data(), out.size(), s.data(), s.size(), 3));
+        return out;
+    }
+#endif
+
+    [[nodiscard]] ranged_options small_chunks(const int connections) {
+        ranged_options o;
+        o.connections = connections;
+        o.chunk_size = 1 << 20;
+        return o;
+    }
+} // anon namespace
+
+TEST(downloader, ranged_download_is_exact) {
+    release_host host;
+    host.body = random_bytes(5 << 20, 1);
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "BEClient_x64.dll.download";
+    fetch_state state;
+    REQUIRE(fetch_ranged_to_file(host.url().c_str(), dst, state, small_chunks(3)) == fetch_result::downloaded);
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(host.body));
+    CHECK_EQ(state.sha256, hex_of(host.body));
+    CHECK_EQ(state.size, host.body.size());
+    CHECK_EQ(state.etag, L"\"v1\"");
+    CHECK_EQ(host.chunk_ranges().size(), 5u);
+    std::error_code ec;
+    CHECK(!fs::exists(fs::path(dst) += L".journal", ec));
+}
+
+TEST(downloader, small_artifacts_take_one_stream) {
+    // under two chunks theres nothing to win from splitting
+    release_host host;
+    host.body = random_bytes(1536 << 10, 2);
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    REQUIRE(fetch_ranged_to_file(host.url().c_str(), dst, state, small_chunks(4)) == fetch_result::downloaded);
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(host.body));
+    CHECK(host.chunk_ranges().empty());
+    CHECK_EQ(host.full_gets, 1);
+}
+
+TEST(downloader, wrong_digest_is_rejected_and_removed) {
+    release_host host;
+    host.body = random_bytes(3 << 20, 3);
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    ranged_options o = small_chunks(2);
+    o.expected_sha256 = hex_of("something else");
+    CHECK(fetch_ranged_to_file(host.url().c_str(), dst, state, o) == fetch_result::hash_mismatch);
+    std::error_code ec;
+    CHECK(!fs::exists(dst, ec));
+    o.expected_sha256 = hex_of(host.body);
+    CHECK(fetch_ranged_to_file(host.url().c_str(), dst, state, o) == fetch_result::downloaded);
+}
+
+TEST(downloader, wrong_size_is_rejected) {
+    release_host host;
+    host.body = random_bytes(3 << 20, 4);
+    const temp_dir dir("dl");
+    fetch_state state;
+    ranged_options o = small_chunks(2);
+    o.limits.expected_size = host.body.size() + 1;
+    CHECK(fetch_ranged_to_file(host.url().c_str(), dir.path / "out", state, o) == fetch_result::size_mismatch);
+}
+
+TEST(downloader, throttled_server_still_completes) {
+    release_host host;
+    host.body = random_bytes(3 << 20, 5);
+    host.server_rate = 6 << 20;
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    ranged_options o = small_chunks(3);
+    o.expected_sha256 = hex_of(host.body);
+    CHECK(fetch_ranged_to_file(host.url().c_str(), dst, state, o) == fetch_result::downloaded);
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(host.body));
+}
+
+TEST(downloader, client_rate_cap_holds_across_connections) {
+    release_host host;
+    host.body = random_bytes(4 << 20, 6);
+    const temp_dir dir("dl");
+    fetch_state state;
+    ranged_options o = small_chunks(4);
+    o.limits.max_bytes_per_sec = 8 << 20;
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(fetch_ranged_to_file(host.url().c_str(), dir.path / "out", state, o) == fetch_result::downloaded);
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // 4 MiB at 8 MiB/s, minus the read that was already in flight when the budget ran out
+    CHECK(s >= 0.4);
+}
+
+TEST(downloader, cut_connections_resume_from_the_journal) {
+    release_host host;
+    host.body = random_bytes(4 << 20, 7);
+    host.cut_from = 2 << 20;
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    // every try at the back half gets cut, so the download gives up but keeps what it has
+    CHECK(fetch_ranged_to_file(host.url().c_str(), dst, state, small_chunks(2)) == fetch_result::failed);
+    std::error_code ec;
+    CHECK(fs::exists(fs::path(dst) += L".journal", ec));
+    CHECK(host.chunk_ranges().size() >= 3u);
+
+    host.cut_from = -1;
+    {
+        std::scoped_lock lk(host.lock);
+        host.ranges.clear();
+    }
+    REQUIRE(fetch_ranged_to_file(host.url().c_str(), dst, state, small_chunks(2)) == fetch_result::downloaded);
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(host.body));
+    // the first chunk finished before anything was cut, the resume must not ask for it again
+    for (const auto& r : host.chunk_ranges()) CHECK(!r.starts_with("bytes=0-"));
+    CHECK(host.chunk_ranges().size() < 4u);
+}
+
+TEST(downloader, resume_is_refused_when_the_etag_changed) {
+    release_host host;
+    host.body = random_bytes(4 << 20, 8);
+    host.cut_from = 2 << 20;
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    CHECK(fetch_ranged_to_file(host.url().c_str(), dst, state, small_chunks(2)) == fetch_result::failed);
+
+    // a new build went up in between, the half we have belongs to the old one
+    host.body = random_bytes(4 << 20, 9);
+    host.etag = "\"v2\"";
+    host.cut_from = -1;
+    REQUIRE(fetch_ranged_to_file(host.url().c_str(), dst, state, small_chunks(2)) == fetch_result::downloaded);
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(host.body));
+}
+
+TEST(downloader, probe_reports_size_and_published_digest) {
+    release_host host;
+    host.body = random_bytes(300'000, 10);
+    fetch_state fresh;
+    REQUIRE(probe_remote(host.url().c_str(), {}, fresh) == fetch_result::downloaded);
+    CHECK_EQ(fresh.size, host.body.size());
+    CHECK(fresh.sha256.empty());
+
+    // header first
+    host.repr_digest = base64_of(sha256_of(host.body.data(), host.body.size()));
+    REQUIRE(probe_remote(host.url().c_str(), {}, fresh) == fetch_result::downloaded);
+    CHECK_EQ(fresh.sha256, hex_of(host.body));
+
+    // then the sha256sum style sidecar, lowercase on the wire
+    host.repr_digest.clear();
+    std::string lower = hex_of(host.body);
+    for (char& c : lower) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    host.sidecar = lower;
+    fresh = {};
+    REQUIRE(probe_remote(host.url().c_str(), {}, fresh) == fetch_result::downloaded);
+    CHECK_EQ(fresh.sha256, hex_of(host.body));
+
+    // and nothing changed means nothing to download
+    fetch_state known;
+    known.etag = L"\"v1\"";
+    CHECK(probe_remote(host.url().c_str(), known, fresh) == fetch_result::not_modified);
+}
+
+TEST(downloader, fetch_state_round_trips) {
+    const temp_dir dir("dl");
+    fetch_state s;
+    s.etag = L"\"abc\"";
+    s.last_modified = L"Wed, 21 Oct 2015 07:28:00 GMT";
+    s.final_url = L"https://objects.example/BEClient_x64.dll?sig=1";
+    s.sha256 = hex_of("x");
+    s.size = 1234567;
+    REQUIRE(save_fetch_state(dir.path / "f", s));
+    const auto back = load_fetch_state(dir.path / "f");
+    REQUIRE(back);
+    CHECK(back->etag == s.etag && back->last_modified == s.last_modified && back->final_url == s.final_url);
+    CHECK(back->sha256 == s.sha256 && back->size == s.size);
+}
+
+namespace {
+    // github style latest/download: /latest 302s to /tag, that 301s to the artifact. the artifact has whichever
+    // validators the test fills in and answers 304 when either conditional header matches. every hop records
+    // the conditional headers it was sent
+    struct redirect_host {
+        std::string body = "v1 body";
+        std::string etag;
+        std::string last_modified;
+        std::mutex lock;
+        std::vector<std::pair<std::string, std::string>> asked;  // target, "If-None-Match|If-Modified-Since"
+        loopback_server srv{ [this](const loopback_request& req) {
+            const std::string inm(req.header("If-None-Match").value_or(""));
+            const std::string ims(req.header("If-Modified-Since").value_or(""));
+            {
+                std::scoped_lock lk(lock);
+                asked.emplace_back(req.target, inm + "|" + ims);
+            }
+            loopback_reply rep;
+            if (req.target == "/latest") {
+                rep.status = 302;
+                rep.headers = { { "Location", "/tag" } };
+            } else if (req.target == "/tag") {
+                rep.status = 301;
+                rep.headers = { { "Location", "/BEClient_x64.dll" } };
+            } else if ((!etag.empty() && inm == etag) || (!last_modified.empty() && ims == last_modified)) {
+                rep.status = 304;
+            } else {
+                rep.body = body;
+                if (!etag.empty()) rep.headers.emplace_back("ETag", etag);
+                if (!last_modified.empty()) rep.headers.emplace_back("Last-Modified", last_modified);
+            }
+            return rep;
+        } };
+
+        [[nodiscard]] std::vector<std::pair<std::string, std::string>> take_asked() {
+            std::scoped_lock lk(lock);
+            return std::exchange(asked, {});
+        }
+    };
+} // anon namespace
+
+TEST(downloader, redirect_chain_records_where_it_ended_up) {
+    redirect_host host;
+    host.etag = "\"v1\"";
+    host.last_modified = "Tue, 01 Sep 2026 10:00:00 GMT";
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    REQUIRE(fetch_to_file(host.srv.url(L"/latest").c_str(), dst, state) == fetch_result::downloaded);
+    CHECK_EQ(state.final_url, host.srv.url(L"/BEClient_x64.dll"));
+    CHECK_EQ(state.etag, L"\"v1\"");
+    CHECK_EQ(state.last_modified, L"Tue, 01 Sep 2026 10:00:00 GMT");
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(host.body));
+    CHECK_EQ(host.take_asked().size(), 3u);
+
+    // a new release swaps both validators, the next fetch through the same chain picks them up
+    host.body = "v2 body";
+    host.etag = "\"v2\"";
+    host.last_modified = "Thu, 01 Oct 2026 10:00:00 GMT";
+    REQUIRE(fetch_to_file(host.srv.url(L"/latest").c_str(), dst, state) == fetch_result::downloaded);
+    CHECK_EQ(state.etag, L"\"v2\"");
+    CHECK_EQ(state.last_modified, L"Thu, 01 Oct 2026 10:00:00 GMT");
+    CHECK_EQ(state.sha256, hex_of("v2 body"));
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>("v2 body"));
+}
+
+TEST(downloader, not_modified_through_a_redirect_chain) {
+    redirect_host host;
+    host.etag = "\"v1\"";
+    host.last_modified = "Tue, 01 Sep 2026 10:00:00 GMT";
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    REQUIRE(fetch_to_file(host.srv.url(L"/latest").c_str(), dst, state) == fetch_result::downloaded);
+    (void)host.take_asked();
+
+    const fetch_state before = state;
+    CHECK(fetch_to_file(host.srv.url(L"/latest").c_str(), dst, state) == fetch_result::not_modified);
+    CHECK_EQ(state.etag, before.etag);
+    CHECK_EQ(state.sha256, before.sha256);
+    // the 304 can only come from the last hop, so thats where the conditional headers have to arrive
+    const auto asked = host.take_asked();
+    REQUIRE(asked.size() == 3u);
+    CHECK_EQ(asked.back().first, "/BEClient_x64.dll");
+    CHECK_EQ(asked.back().second, "\"v1\"|Tue, 01 Sep 2026 10:00:00 GMT");
+}
+
+TEST(downloader, last_modified_alone_is_enough_for_a_304) {
+    // no etag at all, only If-Modified-Since can make it conditional
+    redirect_host host;
+    host.last_modified = "Tue, 01 Sep 2026 10:00:00 GMT";
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    REQUIRE(fetch_to_file(host.srv.url(L"/BEClient_x64.dll").c_str(), dst, state) == fetch_result::downloaded);
+    CHECK(state.etag.empty());
+    CHECK_EQ(state.last_modified, L"Tue, 01 Sep 2026 10:00:00 GMT");
+
+    // whatever is in dst now has to survive a not_modified
+    REQUIRE(write_file(dst, "installed"));
+    CHECK(fetch_to_file(host.srv.url(L"/BEClient_x64.dll").c_str(), dst, state) == fetch_result::not_modified);
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>("installed"));
+    const auto asked = host.take_asked();
+    REQUIRE(asked.size() == 2u);
+    CHECK_EQ(asked.back().second, "|Tue, 01 Sep 2026 10:00:00 GMT");
+}
+
+#ifdef SPECTRE_HAVE_ZSTD
+TEST(downloader, precompressed_copy_wins) {
+    release_host host;
+    host.body = code_like_bytes(3 << 20, 11);
+    host.zst = zstd_of(host.body);
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    ranged_options o = small_chunks(2);
+    o.expected_sha256 = hex_of(host.body);
+    REQUIRE(fetch_ranged_to_file(host.url().c_str(), dst, state, o) == fetch_result::downloaded);
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(host.body));
+    CHECK_EQ(state.etag, L"\"v1\"");
+    CHECK(host.chunk_ranges().empty());
+}
+
+TEST(downloader, broken_precompressed_copy_leaves_dst_alone) {
+    release_host host;
+    host.body = code_like_bytes(3 << 20, 12);
+    // cut off half way through the frame
+    host.zst = zstd_of(host.body);
+    host.zst.resize(host.zst.size() / 2);
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    REQUIRE(write_file(dst, "whatever was here before"));
+    fetch_state state;
+    ranged_options o = small_chunks(1);
+    // one connection falls back to a single stream, the ranges would have replaced dst anyway
+    CHECK(fetch_ranged_to_file(host.url().c_str(), dst, state, o) == fetch_result::downloaded);
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(host.body));
+    std::error_code ec;
+    CHECK(!fs::exists(fs::path(dst) += L".zst.part", ec));
+}
+
+TEST(downloader, missing_precompressed_copy_is_asked_for_once_per_build) {
+    release_host host;
+    host.body = random_bytes(3 << 20, 13);
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    REQUIRE(fetch_ranged_to_file(host.url().c_str(), dst, state, small_chunks(2)) == fetch_result::downloaded);
+    CHECK_EQ(host.zst_asks, 1);
+    fetch_state again;
+    REQUIRE(fetch_ranged_to_file(host.url().c_str(), dst, again, small_chunks(2)) == fetch_result::downloaded);
+    CHECK_EQ(host.zst_asks, 1);
+
+    // a new build might come with one
+    host.etag = "\"v2\"";
+    fetch_state next;
+    REQUIRE(fetch_ranged_to_file(host.url().c_str(), dst, next, small_chunks(2)) == fetch_result::downloaded);
+    CHECK_EQ(host.zst_asks, 2);
+}
+
+TEST(downloader, resume_skips_the_precompressed_copy) {
+    release_host host;
+    host.body = random_bytes(4 << 20, 14);
+    host.cut_from = 2 << 20;
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    CHECK(fetch_ranged_to_file(host.url().c_str(), dst, state, small_chunks(2)) == fetch_result::failed);
+    CHECK_EQ(host.zst_asks, 1);
+
+    // published in the meantime, but we are half way through the ranges already
+    host.zst = zstd_of(host.body);
+    host.cut_from = -1;
+    REQUIRE(fetch_ranged_to_file(host.url().c_str(), dst, state, small_chunks(2)) == fetch_result::downloaded);
+    CHECK_EQ(host.zst_asks, 1);
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(host.body));
+}
+#endif
+
+// fetch_to_file, the single stream path the digest is computed on while the body lands
+
+namespace {
+    [[nodiscard]] loopback_server plain_host(const std::string& body, const bool chunked = false, const long long cut = -1) {
+        return loopback_server([&body, chunked, cut](const loopback_request&) {
+            loopback_reply rep;
+            rep.body = body;
+            rep.chunked = chunked;
+            rep.cut_after = cut;
+            return rep;
+        });
+    }
+} // anon namespace
+
+TEST(downloader, streamed_digest_matches_the_file) {
+    // empty, one byte, either side of a read buffer and a few mb, each with and without content-length
+    const temp_dir dir("dl");
+    for (const size_t size : { size_t(0), size_t(1), size_t(65535), size_t(65537), size_t(5 << 20) + 3 }) {
+        const std::string body = random_bytes(size, 40 + size);
+        for (const bool chunked : { false, true }) {
+            loopback_server srv = plain_host(body, chunked);
+            const fs::path dst = dir.path / "out";
+            fetch_state state;
+            REQUIRE(fetch_to_file(srv.url(L"/BEClient_x64.dll").c_str(), dst, state) == fetch_result::downloaded);
+            CHECK_EQ(state.sha256, hex_of(body));
+            CHECK_EQ(sha256_file(dst), std::optional<std::string>(hex_of(body)));
+            CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(body));
+        }
+    }
+}
+
+TEST(downloader, limit_stops_on_content_length) {
+    // the header alone says its too big, nothing of the body gets written
+    const std::string body = random_bytes(4 << 20, 41);
+    loopback_server srv = plain_host(body);
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    CHECK(fetch_to_file(srv.url(L"/x").c_str(), dst, state, { .max_bytes = 1 << 20 }) == fetch_result::too_large);
+    std::error_code ec;
+    CHECK(!fs::exists(dst, ec) || fs::file_size(dst, ec) == 0);
+    CHECK(state.sha256.empty());
+}
+
+TEST(downloader, limit_stops_a_chunked_body_early) {
+    // no length up front, so it has to notice while counting, well before the whole 8 mb is in
+    const std::string body = random_bytes(8 << 20, 42);
+    loopback_server srv = plain_host(body, true);
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    CHECK(fetch_to_file(srv.url(L"/x").c_str(), dst, state, { .max_bytes = 1 << 20 }) == fetch_result::too_large);
+    std::error_code ec;
+    CHECK(fs::file_size(dst, ec) <= (2u << 20));
+}
+
+TEST(downloader, expected_size_is_enforced) {
+    const std::string body = random_bytes(1 << 20, 43);
+    const temp_dir dir("dl");
+    fetch_state state;
+    for (const bool chunked : { false, true }) {
+        loopback_server srv = plain_host(body, chunked);
+        const wstr url = srv.url(L"/x");
+        CHECK(fetch_to_file(url.c_str(), dir.path / "out", state, { .expected_size = body.size() + 1 }) == fetch_result::size_mismatch);
+        CHECK(fetch_to_file(url.c_str(), dir.path / "out", state, { .expected_size = body.size() - 1 }) == fetch_result::size_mismatch);
+        CHECK(fetch_to_file(url.c_str(), dir.path / "out", state, { .expected_size = body.size() }) == fetch_result::downloaded);
+    }
+}
+
+TEST(downloader, short_body_is_not_downloaded) {
+    // the connection drops before content-length worth arrived, that must never look like a finished file
+    const std::string body = random_bytes(2 << 20, 44);
+    loopback_server srv = plain_host(body, false, 300'000);
+    const temp_dir dir("dl");
+    fetch_state state;
+    const fetch_result r = fetch_to_file(srv.url(L"/x").c_str(), dir.path / "out", state);
+    CHECK(r == fetch_result::size_mismatch || r == fetch_result::failed);
+    CHECK(state.sha256.empty());
+}
+
+
+// content-encoding on the plain url, what gets offered and what comes back
+
+namespace {
+    // serves body under whatever coding the test asks for and remembers the accept-encoding it was sent
+    [[nodiscard]] loopback_server coded_host(const std::string& body, const std::string& coding, std::string& accepted) {
+        return loopback_server([&body, coding, &accepted](const loopback_request& req) {
+            accepted = std::string(req.header("Accept-Encoding").value_or(""));
+            loopback_reply rep;
+            rep.body = body;
+            if (!coding.empty()) rep.headers = { { "Content-Encoding", coding } };
+            return rep;
+        });
+    }
+} // anon namespace
+
+TEST(downloader, accept_encoding_offers_zstd) {
+    const std::string body = random_bytes(64 << 10, 45);
+    std::string accepted;
+    loopback_server srv = coded_host(body, "", accepted);
+    const temp_dir dir("dl");
+    fetch_state state;
+    REQUIRE(fetch_to_file(srv.url(L"/BEClient_x64.dll").c_str(), dir.path / "out", state) == fetch_result::downloaded);
+#ifdef SPECTRE_HAVE_ZSTD
+    CHECK(accepted.starts_with("zstd"));
+#else
+    // nothing to decode it with, so it must not be asked for
+    CHECK(accepted.find("zstd") == std::string::npos);
+#endif
+}
+
+#ifdef SPECTRE_HAVE_ZSTD
+TEST(downloader, zstd_content_encoding_on_the_plain_url_is_decoded) {
+    const std::string body = code_like_bytes(3 << 20, 46);
+    const std::string zst = zstd_of(body);
+    std::string accepted;
+    loopback_server srv = coded_host(zst, "zstd", accepted);
+    const temp_dir dir("dl");
+    const fs::path dst = dir.path / "out";
+    fetch_state state;
+    const download_counters before = download_get_counters();
+    REQUIRE(fetch_to_file(srv.url(L"/BEClient_x64.dll").c_str(), dst, state) == fetch_result::downloaded);
+    const download_counters after = download_get_counters();
+    CHECK_EQ(state.sha256, hex_of(body));
+    CHECK_EQ(state.size, body.size());
+    CHECK_EQ(read_file_bytes(dst), std::optional<std::string>(body));
+    CHECK_EQ(after.bytes - before.bytes, body.size());
+    CHECK_EQ(after.wire_bytes - before.wire_bytes, zst.size());
+}
+#endif
+
+TEST(downloader, unsupported_content_encoding_fails) {
+    // brotli is never offered, a server sending it anyway must not leave its bytes behind as the artifact
+    const std::string body = random_bytes(64 << 10, 47);
+    std::string accepted;
+    loopback_server srv = coded_host(body, "br", accepted);
+    const temp_dir dir("dl");
+    fetch_state state;
+    CHECK(fetch_to_file(srv.url(L"/BEClient_x64.dll").c_str(), dir.path / "out", state) == fetch_result::failed);
+    CHECK(state.sha256.empty());
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "env_block.h"
+#include <algorithm>
+
+namespace {
+    [[nodiscard]] std::vector<wstr> entries_of(const std::vector<wchar_t>& block) {
+        std::vector<wstr> out;
+        for (const wchar_t* p = block.data(); *p; p += out.back().size() + 1) out.emplace_back(p);
+        return out;
+    }
+} // anon namespace
+
+TEST(env_block, overrides_replace_and_add) {
+    const wchar_t current[] = L"PATH=C:\\Windows\0STEAMID=old\0=C:=C:\\Games\0TEMP=C:\\Temp\0";
+    const auto block = merge_environment_block(current, { { L"STEAMID", L"7656" }, { L"SteamAppId", L"2641470" } });
+    REQUIRE(block.size() >= 2);
+    CHECK(block[block.size() - 1] == L'\0' && block[block.size() - 2] == L'\0');
+    const std::vector<wstr> want = { L"PATH=C:\\Windows", L"STEAMID=7656", L"SteamAppId=2641470", L"TEMP=C:\\Temp" };
+    CHECK(entries_of(block) == want);
+}
+
+TEST(env_block, empty_environment) {
+    const auto block = merge_environment_block(nullptr, { { L"A", L"1" } });
+    CHECK(entries_of(block) == std::vector<wstr>{ L"A=1" });
+    const auto none = merge_environment_block(nullptr, {});
+    CHECK(none == std::vector<wchar_t>{ L'\0' });
+}
+
+TEST(env_block, sorted_and_complete) {
+    const auto current = make_env_block(300, 9);
+    const auto block = merge_environment_block(current.data(), { { L"ZZZ", L"last" } });
+    const auto got = entries_of(block);
+    CHECK_EQ(got.size(), entries_of(current).size() + 1);
+    CHECK(std::is_sorted(got.begin(), got.end(), [](const wstr& a, const wstr& b) {
+        return a.substr(0, a.find(L'=')) < b.substr(0, b.find(L'='));
+    }));
+    CHECK_EQ(got.back(), L"ZZZ=last");
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "file_utils.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+TEST(file_utils, trims_trailing_slashes) {
+    CHECK_EQ(wtrim_trailing_slash(L"C:\\Steam\\"), L"C:\\Steam");
+    CHECK_EQ(wtrim_trailing_slash(L"C:\\Steam\\\\//"), L"C:\\Steam");
+    CHECK_EQ(wtrim_trailing_slash(L"/home/x/.steam/"), L"/home/x/.steam");
+    CHECK_EQ(wtrim_trailing_slash(L"C:\\Steam"), L"C:\\Steam");
+    CHECK_EQ(wtrim_trailing_slash(L"\\\\"), L"");
+    CHECK_EQ(wtrim_trailing_slash(L""), L"");
+}
+
+TEST(file_utils, atomic_write_round_trips) {
+    const temp_dir dir("fu");
+    const fs::path p = dir.path / "nested" / "a.bin";
+    const std::string data = random_bytes(100'000, 1);
+    REQUIRE(write_file_atomic(p, data));
+    CHECK_EQ(read_file_bytes(p), std::optional<std::string>(data));
+    // replacing it leaves no temp file next to it
+    REQUIRE(write_file_atomic(p, "short"));
+    CHECK_EQ(read_file_bytes(p), std::optional<std::string>("short"));
+    std::error_code ec;
+    CHECK_EQ(std::distance(fs::directory_iterator(p.parent_path(), ec), fs::directory_iterator()), 1);
+    CHECK(!read_file_bytes(dir.path / "missing"));
+}
+
+TEST(file_utils, concurrent_atomic_writes_never_mix) {
+    // several writers replacing the same file (two launchers saving a cache at once). whatever wins, dst is
+    // always exactly one of the payloads and no temp files are left over
+    const temp_dir dir("fu");
+    const fs::path p = dir.path / "cache.bin";
+    std::vector<std::string> payloads;
+    for (int i = 0; i < 4; ++i) payloads.push_back(random_bytes(200'000 + i * 1000, 10 + i));
+    std::atomic<bool> all_ok{ true };
+    std::vector<std::thread> writers;
+    for (const auto& payload : payloads) {
+        writers.emplace_back([&] {
+            for (int n = 0; n < 25; ++n) {
+                if (!write_file_atomic(p, payload)) all_ok = false;
+            }
+        });
+    }
+    for (auto& t : writers) t.join();
+#ifndef _WIN32
+    // MoveFileEx can refuse while another rename over the same name is in flight, rename(2) never does
+    CHECK(all_ok);
+#endif
+    const auto got = read_file_bytes(p);
+    REQUIRE(got);
+    CHECK(std::ranges::find(payloads, *got) != payloads.end());
+    std::error_code ec;
+    CHECK_EQ(std::distance(fs::directory_iterator(dir.path, ec), fs::directory_iterator()), 1);
+}
+
+TEST(file_utils, identity_follows_rewrites) {
+    const temp_dir dir("fu");
+    const fs::path p = dir.path / "f";
+    REQUIRE(write_file(p, "one"));
+    const auto a = get_file_identity(p);
+    REQUIRE(a);
+    CHECK_EQ(a->size, 3ull);
+    const auto again = get_file_identity(p);
+    REQUIRE(again);
+    CHECK(again->mtime == a->mtime && again->file_index == a->file_index && again->volume == a->volume);
+    // replace by rename, the way steam and our own writers do it
+    REQUIRE(write_file_atomic(p, "three"));
+    const auto b = get_file_identity(p);
+    REQUIRE(b);
+    CHECK_EQ(b->size, 5ull);
+    CHECK(!get_file_identity(dir.path / "missing"));
+}
+
+TEST(file_utils, mapped_hash_matches_in_memory) {
+    const temp_dir dir("fu");
+    for (const size_t n : { size_t{ 0 }, size_t{ 1 }, size_t{ 64 }, size_t{ 3 << 20 } }) {
+        const std::string data = random_bytes(n, n);
+        const fs::path p = dir.path / ("h" + std::to_string(n));
+        REQUIRE(write_file(p, data));
+        const auto d = sha256_of_mapped_file(p);
+        REQUIRE(d);
+        CHECK(*d == sha256_of(data.data(), data.size()));
+        CHECK_EQ(sha256_file(p), std::optional<std::string>(to_hex(*d)));
+    }
+}
+
+TEST(file_utils, positional_writes_land_at_their_offsets) {
+    const temp_dir dir("fu");
+    const fs::path p = dir.path / "ranges";
+    {
+        positional_file f = open_positional(p, 10, false);
+        REQUIRE(f);
+        CHECK(f.write_at(6, "6789", 4));
+        CHECK(f.write_at(0, "012", 3));
+    }
+    {
+        // keep reopens without truncating, like a resumed download
+        positional_file f = open_positional(p, 10, true);
+        REQUIRE(f);
+        CHECK(f.write_at(3, "345", 3));
+    }
+    CHECK_EQ(read_file_bytes(p), std::optional<std::string>("0123456789"));
+}
+
+TEST(file_utils, lock_is_exclusive) {
+    const temp_dir dir("fu");
+    const fs::path p = dir.path / "x.lock";
+    {
+        const file_lock a = try_lock_file(p);
+        REQUIRE(a);
+        CHECK(!try_lock_file(p));
+    }
+    CHECK(static_cast<bool>(try_lock_file(p)));
+}
\ No newline at end of file
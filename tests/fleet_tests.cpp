@@ -0,0 +1,348 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "fleet.h"
+#include "client_fleet.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+#endif
+
+namespace {
+    using steady = std::chrono::steady_clock;
+    using ms = std::chrono::milliseconds;
+
+    // what a stub child does after it is spawned
+    struct stub_run {
+        enum kind { exits, triggers, hangs } what = hangs;
+        ms after{ 0 };
+    };
+
+    using script = std::vector<std::vector<stub_run>>;
+
+    // a fleet_host with no processes behind it, every member follows a script of runs (one per spawn, the last
+    // one repeats) and the host counts what the supervisor asked of it
+    struct stub_host final : fleet_host {
+        script runs;
+        std::vector<char> spawn_fails;
+
+        std::mutex lock;
+        std::vector<std::vector<steady::time_point>> spawns;
+        std::vector<unsigned> kills, submits;
+        // alive as far as the stub is concerned, killed or exited ones arent
+        std::vector<char> running;
+        size_t most_starting = 0;
+
+        explicit stub_host(script s)
+            : runs(std::move(s)), spawn_fails(runs.size(), 0), spawns(runs.size()), kills(runs.size(), 0),
+              submits(runs.size(), 0), running(runs.size(), 0) {}
+
+        [[nodiscard]] stub_run current(const size_t i) {
+            const auto& mine = runs[i];
+            return mine[std::min(spawns[i].size(), mine.size()) - 1];
+        }
+
+        [[nodiscard]] bool spawn(const size_t i, const fleet_member&) override {
+            std::scoped_lock lk(lock);
+            if (spawn_fails[i]) return false;
+            spawns[i].push_back(steady::now());
+            running[i] = 1;
+            return true;
+        }
+
+        [[nodiscard]] std::optional<size_t> wait_exit(const std::vector<size_t>& children, const ms timeout) override {
+            auto until = steady::now() + timeout;
+            std::optional<size_t> first;
+            {
+                std::scoped_lock lk(lock);
+                most_starting = std::max(most_starting, children.size());
+                for (const size_t i : children) {
+                    const stub_run r = current(i);
+                    if (r.what != stub_run::exits) continue;
+                    if (const auto at = spawns[i].back() + r.after; at <= until) {
+                        until = at;
+                        first = i;
+                    }
+                }
+            }
+            std::this_thread::sleep_until(until);
+            if (first) {
+                std::scoped_lock lk(lock);
+                running[*first] = 0;
+            }
+            return first;
+        }
+
+        [[nodiscard]] bool triggered(const size_t i) override {
+            std::scoped_lock lk(lock);
+            const stub_run r = current(i);
+            return r.what == stub_run::triggers && steady::now() >= spawns[i].back() + r.after;
+        }
+
+        [[nodiscard]] bool submit(const size_t i, const fleet_member&) override {
+            std::scoped_lock lk(lock);
+            ++submits[i];
+            return true;
+        }
+
+        void release(size_t) override {}
+
+        void kill(const size_t i) override {
+            std::scoped_lock lk(lock);
+            ++kills[i];
+            running[i] = 0;
+        }
+    };
+
+    [[nodiscard]] std::vector<fleet_member> members(const size_t n) {
+        std::vector<fleet_member> out;
+        for (size_t i = 0; i < n; ++i) out.push_back({ L"7656119800000000" + std::to_wstring(i % 10), {} });
+        return out;
+    }
+
+    [[nodiscard]] fleet_options quick_options() {
+        fleet_options o;
+        o.stagger = ms(0);
+        o.poll = ms(5);
+        o.backoff = ms(20);
+        return o;
+    }
+} // anon namespace
+
+TEST(fleet, parses_member_list) {
+    const auto list = parse_fleet_list("# load test\n76561198000000001\n\n  76561198000000002  -windowed -nosound \r\n");
+    REQUIRE(list && list->size() == 2);
+    CHECK((*list)[0].steam_id == L"76561198000000001");
+    CHECK((*list)[0].extra_args.empty());
+    CHECK((*list)[1].extra_args == L"-windowed -nosound");
+    CHECK(!parse_fleet_list("7656119800000000x\n").has_value());
+    CHECK(!parse_fleet_list("1234 -windowed\n").has_value());
+}
+
+TEST(fleet, submits_everyone_within_concurrency) {
+    stub_host host(script(6, { { stub_run::triggers, ms(20) } }));
+    fleet_options o = quick_options();
+    o.max_starting = 2;
+    const auto results = run_fleet(host, members(6), o);
+    for (size_t i = 0; i < results.size(); ++i) {
+        CHECK(results[i].outcome == fleet_outcome::submitted);
+        CHECK_EQ(results[i].restarts, 0u);
+        CHECK(results[i].trigger_ms >= 20);
+        CHECK_EQ(host.submits[i], 1u);
+        CHECK_EQ(host.kills[i], 0u);
+    }
+    CHECK(host.most_starting <= 2);
+}
+
+TEST(fleet, restarts_after_early_exit) {
+    stub_host host(script{ { { stub_run::exits, ms(10) }, { stub_run::triggers, ms(10) } } });
+    fleet_options o = quick_options();
+    o.backoff = ms(100);
+    const auto results = run_fleet(host, members(1), o);
+    CHECK(results[0].outcome == fleet_outcome::submitted);
+    CHECK_EQ(results[0].restarts, 1u);
+    REQUIRE(host.spawns[0].size() == 2);
+    // 10 ms to die, then the whole backoff before the next go
+    CHECK(host.spawns[0][1] - host.spawns[0][0] >= ms(110));
+}
+
+TEST(fleet, backoff_doubles_then_gives_up) {
+    stub_host host(script{ { { stub_run::exits, ms(5) } } });
+    fleet_options o = quick_options();
+    o.restarts = 2;
+    o.backoff = ms(50);
+    const auto results = run_fleet(host, members(1), o);
+    CHECK(results[0].outcome == fleet_outcome::exited);
+    CHECK_EQ(results[0].restarts, 2u);
+    REQUIRE(host.spawns[0].size() == 3);
+    CHECK(host.spawns[0][1] - host.spawns[0][0] >= ms(55));
+    CHECK(host.spawns[0][2] - host.spawns[0][1] >= ms(105));
+    CHECK_EQ(host.submits[0], 0u);
+}
+
+TEST(fleet, backoff_is_capped) {
+    stub_host host(script{ { { stub_run::exits, ms(0) } } });
+    fleet_options o = quick_options();
+    o.restarts = 3;
+    o.backoff = ms(40);
+    o.max_backoff = ms(50);
+    const auto start = steady::now();
+    const auto results = run_fleet(host, members(1), o);
+    CHECK(results[0].outcome == fleet_outcome::exited);
+    CHECK_EQ(host.spawns[0].size(), 4u);
+    // 40 + 50 + 50 instead of 40 + 80 + 160
+    CHECK(steady::now() - start < ms(250));
+}
+
+TEST(fleet, restart_waits_for_a_starting_slot) {
+    // member 1 hogs the only slot while 0 is backing off, 0 only goes again once 1 triggered
+    stub_host host(script{ { { stub_run::exits, ms(0) }, { stub_run::triggers, ms(0) } }, { { stub_run::triggers, ms(80) } } });
+    fleet_options o = quick_options();
+    o.max_starting = 1;
+    o.backoff = ms(10);
+    const auto results = run_fleet(host, members(2), o);
+    CHECK(results[0].outcome == fleet_outcome::submitted);
+    CHECK(results[1].outcome == fleet_outcome::submitted);
+    REQUIRE(host.spawns[0].size() == 2 && host.spawns[1].size() == 1);
+    CHECK(host.spawns[0][1] - host.spawns[1][0] >= ms(80));
+    CHECK(host.most_starting <= 1);
+}
+
+TEST(fleet, timeout_kills_the_child) {
+    stub_host host(script{ { { stub_run::hangs } } });
+    fleet_options o = quick_options();
+    o.trigger_timeout = ms(50);
+    o.restarts = 1;
+    const auto results = run_fleet(host, members(1), o);
+    CHECK(results[0].outcome == fleet_outcome::timed_out);
+    CHECK_EQ(results[0].restarts, 1u);
+    CHECK_EQ(host.spawns[0].size(), 2u);
+    CHECK_EQ(host.kills[0], 2u);
+    CHECK(!host.running[0]);
+}
+
+TEST(fleet, spawn_failure_is_not_retried) {
+    stub_host host(script{ { { stub_run::triggers } }, { { stub_run::triggers } } });
+    host.spawn_fails[0] = 1;
+    const auto results = run_fleet(host, members(2), quick_options());
+    CHECK(results[0].outcome == fleet_outcome::spawn_failed);
+    CHECK_EQ(results[0].restarts, 0u);
+    CHECK(results[1].outcome == fleet_outcome::submitted);
+}
+
+TEST(fleet, stop_kills_the_whole_fleet) {
+    // 0 is in the game, 1 backing off, 2 and 3 still starting and 4 not spawned yet when the stop comes
+    stub_host host(script{ { { stub_run::triggers, ms(0) } },
+                     { { stub_run::exits, ms(0) } },
+                     { { stub_run::hangs } },
+                     { { stub_run::hangs } },
+                     { { stub_run::hangs } } });
+    fleet_options o = quick_options();
+    o.max_starting = 2;
+    o.backoff = ms(10000);
+    std::stop_source stop;
+    std::jthread stopper([&stop] {
+        std::this_thread::sleep_for(ms(150));
+        stop.request_stop();
+    });
+    const auto start = steady::now();
+    const auto results = run_fleet(host, members(5), o, stop.get_token());
+    CHECK(steady::now() - start < ms(1000));
+    CHECK(results[0].outcome == fleet_outcome::submitted);
+    CHECK(results[1].outcome == fleet_outcome::stopped);
+    CHECK(results[2].outcome == fleet_outcome::stopped);
+    CHECK(results[3].outcome == fleet_outcome::stopped);
+    CHECK(results[4].outcome == fleet_outcome::stopped);
+    CHECK(host.spawns[4].empty());
+    for (size_t i = 0; i < 5; ++i) CHECK(!host.running[i]);
+    // the submitted one goes too, and nothing gets killed twice
+    CHECK_EQ(host.kills[0], 1u);
+    CHECK_EQ(host.kills[1], 0u);
+    CHECK_EQ(host.kills[2], 1u);
+    CHECK_EQ(host.kills[3], 1u);
+}
+
+#ifndef _WIN32
+namespace {
+    // an executable shell script standing in for the game client
+    [[nodiscard]] fs::path stub_client(const temp_dir& dir, const char* name, const std::string& body) {
+        const fs::path p = dir.path / name;
+        REQUIRE(write_file(p, "#!/bin/sh\n" + body + "\n"));
+        ::chmod(p.c_str(), 0755);
+        return p;
+    }
+
+    [[nodiscard]] std::vector<std::string> lines_of(const fs::path& p) {
+        std::ifstream in(p);
+        std::vector<std::string> out;
+        for (std::string line; std::getline(in, line);) out.push_back(line);
+        return out;
+    }
+
+    [[nodiscard]] bool wait_for_lines(const fs::path& p, const size_t n) {
+        const auto deadline = steady::now() + std::chrono::seconds(5);
+        while (lines_of(p).size() < n) {
+            if (steady::now() > deadline) return false;
+            std::this_thread::sleep_for(ms(10));
+        }
+        return true;
+    }
+} // anon namespace
+
+TEST(fleet, posix_host_spawns_like_a_launch) {
+    temp_dir dir("fleet_spawn");
+    const fs::path log = dir.path / "log";
+    // cwd, steamid and args on one line, then sit there like a client on its title screen
+    const fs::path exe = stub_client(dir, "client", "echo \"$(pwd) $STEAMID $SteamAppId $*\" >> \"" + log.string() + "\"\nexec sleep 30");
+    const auto host = make_client_fleet_host(exe, 1);
+    REQUIRE(host->spawn(0, { L"76561198000000007", L"-windowed  -nosound" }));
+    REQUIRE(wait_for_lines(log, 1));
+    const std::string line = lines_of(log)[0];
+    CHECK(line == fs::canonical(dir.path).string() + " 76561198000000007 2641470 -PragmaEnvironment=live "
+                  "-PragmaBackendAddress=http://game.spectre.astro-dev.uk:8081 -windowed -nosound");
+
+    CHECK(!host->wait_exit({ 0 }, ms(50)).has_value());
+    CHECK(!host->triggered(0));
+    host->kill(0);
+    host->kill(0);
+}
+
+TEST(fleet, posix_host_restarts_exiting_clients) {
+    temp_dir dir("fleet_restart");
+    const fs::path log = dir.path / "log";
+    const fs::path exe = stub_client(dir, "client", "echo $$ >> \"" + log.string() + "\"\nexit 3");
+    const auto host = make_client_fleet_host(exe, 2);
+    fleet_options o = quick_options();
+    o.restarts = 2;
+    const auto results = run_fleet(*host, members(2), o);
+    for (const fleet_result& r : results) {
+        CHECK(r.outcome == fleet_outcome::exited);
+        CHECK_EQ(r.restarts, 2u);
+    }
+    // 2 members with 3 goes each, and every one of them reaped
+    const auto pids = lines_of(log);
+    CHECK_EQ(pids.size(), 6u);
+    for (const auto& pid : pids) CHECK(::kill(std::stoi(pid), 0) != 0);
+}
+
+TEST(fleet, posix_host_stop_kills_every_client) {
+    temp_dir dir("fleet_stop");
+    const fs::path log = dir.path / "log";
+    const fs::path exe = stub_client(dir, "client", "echo $$ >> \"" + log.string() + "\"\nexec sleep 30");
+    const auto host = make_client_fleet_host(exe, 3);
+    std::stop_source stop;
+    std::jthread stopper([&] {
+        if (wait_for_lines(log, 3)) std::this_thread::sleep_for(ms(50));
+        stop.request_stop();
+    });
+    const auto start = steady::now();
+    const auto results = run_fleet(*host, members(3), quick_options(), stop.get_token());
+    CHECK(steady::now() - start < std::chrono::seconds(5));
+    for (const fleet_result& r : results) CHECK(r.outcome == fleet_outcome::stopped);
+    const auto pids = lines_of(log);
+    CHECK_EQ(pids.size(), 3u);
+    for (const auto& pid : pids) CHECK(::kill(std::stoi(pid), 0) != 0);
+}
+
+TEST(fleet, posix_host_takes_the_fleet_with_it) {
+    temp_dir dir("fleet_host_gone");
+    const fs::path log = dir.path / "log";
+    const fs::path exe = stub_client(dir, "client", "echo $$ >> \"" + log.string() + "\"\nexec sleep 30");
+    {
+        const auto host = make_client_fleet_host(exe, 2);
+        REQUIRE(host->spawn(0, { L"76561198000000001", {} }));
+        REQUIRE(host->spawn(1, { L"76561198000000002", {} }));
+        // released, as if both had triggered and been submitted
+        host->release(0);
+        host->release(1);
+        REQUIRE(wait_for_lines(log, 2));
+    }
+    for (const auto& pid : lines_of(log)) CHECK(::kill(std::stoi(pid), 0) != 0);
+}
+#endif
\ No newline at end of file
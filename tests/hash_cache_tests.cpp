@@ -0,0 +1,149 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "bin_io.h"
+#include "file_utils.h"
+#include "hash_cache.h"
+#include <functional>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    [[nodiscard]] fs::path canonical_of(const fs::path& p) {
+        std::error_code ec;
+        return fs::weakly_canonical(p, ec);
+    }
+} // anon namespace
+
+TEST(hash_cache, miss_then_hit_then_miss_after_change) {
+    const temp_dir dir("hc");
+    const fs::path p = dir.path / "BEClient_x64.dll";
+    REQUIRE(write_file(p, random_bytes(50'000, 1)));
+
+    const auto before = hash_cache_get_counters();
+    const auto first = sha256_file(p);
+    REQUIRE(first);
+    const auto afterFirst = hash_cache_get_counters();
+    CHECK_EQ(afterFirst.misses, before.misses + 1);
+    CHECK_EQ(afterFirst.hits, before.hits);
+
+    CHECK_EQ(sha256_file(p), first);
+    const auto afterSecond = hash_cache_get_counters();
+    CHECK_EQ(afterSecond.hits, afterFirst.hits + 1);
+
+    // a rewrite changes the identity so it has to be hashed again, and the answer has to be the new one
+    REQUIRE(write_file_atomic(p, "patched"));
+    const auto third = sha256_file(p);
+    REQUIRE(third);
+    CHECK(*third != *first);
+    CHECK_EQ(hash_cache_get_counters().misses, afterSecond.misses + 1);
+    const std::string patched = "patched";
+    CHECK_EQ(*third, to_hex(sha256_of(patched.data(), patched.size())));
+}
+
+TEST(hash_cache, revalidate_forces_misses) {
+    const temp_dir dir("hc");
+    const fs::path p = dir.path / "f";
+    REQUIRE(write_file(p, "abc"));
+    REQUIRE(sha256_file(p));
+    hash_cache_force_revalidate(true);
+    const auto before = hash_cache_get_counters();
+    CHECK(sha256_file(p).has_value());
+    CHECK_EQ(hash_cache_get_counters().hits, before.hits);
+    hash_cache_force_revalidate(false);
+    CHECK(sha256_file(p).has_value());
+    CHECK_EQ(hash_cache_get_counters().hits, before.hits + 1);
+}
+
+TEST(hash_cache, stale_identity_is_not_served) {
+    const temp_dir dir("hc");
+    const fs::path p = dir.path / "f";
+    REQUIRE(write_file(p, "abc"));
+    const auto id = get_file_identity(p);
+    REQUIRE(id);
+    const sha256_digest fake{};
+    hash_cache_store(canonical_of(p), *id, fake);
+    CHECK(hash_cache_lookup(canonical_of(p), *id) == std::optional<sha256_digest>(fake));
+    file_identity moved = *id;
+    ++moved.mtime;
+    CHECK(!hash_cache_lookup(canonical_of(p), moved));
+}
+
+TEST(hash_cache, damaged_cache_file_is_a_clean_miss) {
+    // a flipped byte fails the crc, a short file fails before that, a newer version is refused even with a good
+    // crc. each one has to lose every entry (a miss and a rehash) rather than serve a digest out of the damage
+    const temp_dir dir("hc");
+    const fs::path p = dir.path / "BEClient_x64.dll";
+    const std::string body = random_bytes(40'000, 2);
+    REQUIRE(write_file(p, body));
+    const std::string want = to_hex(sha256_of(body.data(), body.size()));
+    const fs::path cache = get_launcher_data_dir() / "hashcache.bin";
+
+    const std::function<void(std::string&)> damage[] = {
+        [](std::string& b) { b[b.size() / 2] ^= 0x5a; },
+        [](std::string& b) { b.resize(b.size() - 7); },
+        [](std::string& b) {
+            b[4] = static_cast<char>(b[4] + 1);
+            b.resize(b.size() - 4);
+            bin_seal(b);
+        },
+    };
+    int round = 0;
+    for (const auto& hit : damage) {
+        REQUIRE(sha256_file(p) == std::optional<std::string>(want));
+        const auto warm = hash_cache_get_counters();
+        REQUIRE(sha256_file(p) == std::optional<std::string>(want));
+        REQUIRE(hash_cache_get_counters().hits == warm.hits + 1);
+
+        auto bytes = read_file_bytes(cache);
+        REQUIRE(bytes && bytes->size() > 64);
+        hit(*bytes);
+        REQUIRE(write_file(cache, *bytes));
+        // the next store starts from whats on disk, so hashing anything else pulls the damage in
+        const fs::path other = dir.path / ("other" + std::to_string(round++));
+        REQUIRE(write_file(other, "other"));
+        REQUIRE(sha256_file(other));
+
+        const auto before = hash_cache_get_counters();
+        CHECK_EQ(sha256_file(p), std::optional<std::string>(want));
+        const auto after = hash_cache_get_counters();
+        CHECK_EQ(after.misses, before.misses + 1);
+        CHECK_EQ(after.hits, before.hits);
+        // and the file it wrote back is whole again
+        CHECK_EQ(sha256_file(p), std::optional<std::string>(want));
+        CHECK_EQ(hash_cache_get_counters().hits, after.hits + 1);
+    }
+}
+
+#ifndef _WIN32
+TEST(hash_cache, store_keeps_entries_other_processes_wrote) {
+    const temp_dir dir("hc");
+    const fs::path mine = dir.path / "mine";
+    const fs::path theirs = dir.path / "theirs";
+    REQUIRE(write_file(mine, "mine"));
+    REQUIRE(write_file(theirs, "theirs"));
+    // load the cache in this process first so our in memory copy is older than what the child writes
+    REQUIRE(sha256_file(dir.path / "mine"));
+
+    const pid_t child = ::fork();
+    REQUIRE(child >= 0);
+    if (child == 0) {
+        // a second launcher instance hashing a file this one never looked at
+        const auto d = sha256_file(theirs);
+        ::_exit(d ? 0 : 1);
+    }
+    int status = 0;
+    REQUIRE(::waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // our next store merges with the file on disk instead of writing our stale list over it
+    REQUIRE(write_file_atomic(mine, "mine, changed"));
+    REQUIRE(sha256_file(mine));
+    const auto id = get_file_identity(theirs);
+    REQUIRE(id);
+    const std::string t = "theirs";
+    CHECK(hash_cache_lookup(canonical_of(theirs), *id) == std::optional<sha256_digest>(sha256_of(t.data(), t.size())));
+}
+#endif
\ No newline at end of file
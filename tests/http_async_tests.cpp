@@ -0,0 +1,133 @@
+#include "test.h"
+#include "support/loopback_server.h"
+#include "http_async.h"
+#include "utf.h"
+#include <chrono>
+#include <map>
+#include <thread>
+
+namespace {
+    [[nodiscard]] http_request get_of(const wstr& url) {
+        http_request r;
+        r.url = url;
+        r.timeout = std::chrono::seconds(5);
+        return r;
+    }
+} // anon namespace
+
+TEST(http_async, many_requests_share_a_few_connections) {
+    loopback_server srv([](const loopback_request& req) {
+        loopback_reply rep;
+        rep.body = "echo " + req.target;
+        return rep;
+    });
+    http_async client(4);
+    std::vector<std::string> bodies(200);
+    int answered = 0;
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        client.submit(get_of(srv.url(L"/n/" + std::to_wstring(i))), [&, i](http_async_result&& res) {
+            ++answered;
+            if (res.status == 200) bodies[i] = std::move(res.body);
+        });
+    }
+    client.run();
+    CHECK_EQ(answered, 200);
+    for (size_t i = 0; i < bodies.size(); ++i) CHECK_EQ(bodies[i], "echo /n/" + std::to_string(i));
+    CHECK(client.connects() <= 4u);
+    CHECK_EQ(srv.connections(), client.connects());
+}
+
+TEST(http_async, every_framing) {
+    loopback_server srv([](const loopback_request& req) {
+        loopback_reply rep;
+        rep.body = std::string(70'000, 'x') + req.target;
+        rep.chunked = req.target == "/chunked";
+        rep.close = req.target == "/close";
+        if (req.target == "/empty") rep.body.clear();
+        if (req.target == "/304") {
+            rep.status = 304;
+            rep.body.clear();
+        }
+        return rep;
+    });
+    http_async client;
+    std::map<std::string, http_async_result> got;
+    for (const char* path : { "/length", "/chunked", "/close", "/empty", "/304" }) {
+        client.submit(get_of(srv.url(widen_utf8(path).value_or(L""))), [&got, path](http_async_result&& res) { got[path] = std::move(res); });
+    }
+    client.run();
+    CHECK_EQ(got["/length"].body, std::string(70'000, 'x') + "/length");
+    CHECK_EQ(got["/chunked"].body, std::string(70'000, 'x') + "/chunked");
+    CHECK_EQ(got["/close"].body, std::string(70'000, 'x') + "/close");
+    CHECK_EQ(got["/empty"].status, 200u);
+    CHECK(got["/empty"].body.empty());
+    CHECK_EQ(got["/304"].status, 304u);
+}
+
+TEST(http_async, keep_alive_carries_over_between_runs) {
+    loopback_server srv([](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = "ok";
+        return rep;
+    });
+    http_async client(1);
+    http_async_result first, second;
+    client.submit(get_of(srv.url()), [&](http_async_result&& res) { first = std::move(res); });
+    client.run();
+    client.submit(get_of(srv.url()), [&](http_async_result&& res) { second = std::move(res); });
+    client.run();
+    CHECK(!first.reused);
+    CHECK(second.reused);
+    CHECK_EQ(second.body, "ok");
+    CHECK_EQ(srv.connections(), 1ull);
+}
+
+TEST(http_async, post_body_and_callbacks_that_submit_more) {
+    loopback_server srv([](const loopback_request& req) {
+        loopback_reply rep;
+        rep.body = req.method + ":" + req.body;
+        return rep;
+    });
+    http_async client;
+    std::vector<std::string> chain;
+    const std::string body = R"({"providerId":"76561198000000000"})";
+    http_request post = get_of(srv.url(L"/v1/submitproviderid"));
+    post.verb = L"POST";
+    post.headers = L"Content-Type: application/json\r\n";
+    post.body = body;
+    client.submit(post, [&](http_async_result&& res) {
+        chain.push_back(res.body);
+        client.submit(get_of(srv.url(L"/next")), [&](http_async_result&& next) { chain.push_back(next.body); });
+    });
+    client.run();
+    REQUIRE(chain.size() == 2u);
+    CHECK_EQ(chain[0], "POST:" + body);
+    CHECK_EQ(chain[1], "GET:");
+}
+
+TEST(http_async, deadlines_and_dead_hosts) {
+    loopback_server slow([](const loopback_request&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        return loopback_reply{};
+    });
+    std::optional<loopback_server> gone(std::in_place, [](const loopback_request&) { return loopback_reply{}; });
+    const wstr deadUrl = gone->url();
+    gone.reset();
+
+    http_async client;
+    http_async_result timedOut{ .status = 1 }, refused{ .status = 1 }, https{ .status = 1 };
+    http_request r = get_of(slow.url());
+    r.timeout = std::chrono::milliseconds(200);
+    client.submit(r, [&](http_async_result&& res) { timedOut = std::move(res); });
+    http_request d = get_of(deadUrl);
+    d.attempts = 3;
+    client.submit(d, [&](http_async_result&& res) { refused = std::move(res); });
+    client.submit(get_of(L"https://127.0.0.1/"), [&](http_async_result&& res) { https = std::move(res); });
+    const auto start = std::chrono::steady_clock::now();
+    client.run();
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1000));
+    CHECK_EQ(timedOut.status, 0u);
+    CHECK(timedOut.latency >= std::chrono::milliseconds(200));
+    CHECK_EQ(refused.status, 0u);
+    CHECK_EQ(https.status, 0u);
+}
\ No newline at end of file
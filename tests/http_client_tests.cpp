@@ -0,0 +1,262 @@
+#include "test.h"
+#include "support/loopback_server.h"
+#include "http_client.h"
+#include "http_transport.h"
+
+namespace {
+    [[nodiscard]] std::optional<std::string> get_body(const wstr& url, unsigned* status = nullptr) {
+        http_request r;
+        r.url = url;
+        r.timeout = std::chrono::seconds(5);
+        auto res = http_send(r);
+        if (!res) return std::nullopt;
+        if (status) *status = res->status;
+        std::string body;
+        if (!res->read_all(body, 64 << 20)) return std::nullopt;
+        return body;
+    }
+} // anon namespace
+
+TEST(http_client, parses_urls) {
+    const auto a = parse_url(L"https://github.com/astroval0/SpectrePatcher/releases/latest/download/BEClient_x64.dll");
+    REQUIRE(a);
+    CHECK(a->https);
+    CHECK_EQ(a->host, L"github.com");
+    CHECK_EQ(a->port, 443);
+    CHECK_EQ(a->path, L"/astroval0/SpectrePatcher/releases/latest/download/BEClient_x64.dll");
+
+    const auto b = parse_url(L"http://game.spectre.astro-dev.uk:8081");
+    REQUIRE(b);
+    CHECK(!b->https);
+    CHECK_EQ(b->port, 8081);
+    CHECK_EQ(b->path, L"/");
+
+    const auto c = parse_url(L"http://[::1]:9000?x=1");
+    REQUIRE(c);
+    CHECK_EQ(c->host, L"::1");
+    CHECK_EQ(c->port, 9000);
+    CHECK_EQ(c->path, L"/?x=1");
+
+    CHECK(!parse_url(L"ftp://host/x"));
+    CHECK(!parse_url(L"http://:80/"));
+    CHECK(!parse_url(L"http://host:99999/"));
+    CHECK(!parse_url(L"http://host:8a/"));
+}
+
+TEST(http_client, content_length_body_and_headers) {
+    loopback_server srv([](const loopback_request& req) {
+        loopback_reply rep;
+        rep.body = "hello " + req.target;
+        rep.headers = { { "ETag", "\"abc\"" }, { "Last-Modified", "Wed, 21 Oct 2015 07:28:00 GMT" } };
+        return rep;
+    });
+    http_request r;
+    r.url = srv.url(L"/x");
+    auto res = http_send(r);
+    REQUIRE(res);
+    CHECK_EQ(res->status, 200u);
+    CHECK_EQ(res->header(http_header::etag), L"\"abc\"");
+    CHECK_EQ(res->header(http_header::last_modified), L"Wed, 21 Oct 2015 07:28:00 GMT");
+    CHECK(res->header(http_header::content_range).empty());
+    CHECK_EQ(res->content_length(), std::optional<unsigned long long>(8));
+    std::string body;
+    REQUIRE(res->read_all(body));
+    CHECK_EQ(body, "hello /x");
+}
+
+TEST(http_client, chunked_body) {
+    std::string big(200'000, '\0');
+    for (size_t i = 0; i < big.size(); ++i) big[i] = static_cast<char>('a' + i % 23);
+    loopback_server srv([&](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = big;
+        rep.chunked = true;
+        return rep;
+    });
+    CHECK_EQ(get_body(srv.url()), std::optional<std::string>(big));
+    // the socket went back to the pool after the terminating chunk
+    CHECK_EQ(get_body(srv.url()), std::optional<std::string>(big));
+    CHECK_EQ(srv.connections(), 1ull);
+}
+
+TEST(http_client, keep_alive_reuses_the_socket) {
+    loopback_server srv([](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = "ok";
+        return rep;
+    });
+    for (int i = 0; i < 5; ++i) CHECK_EQ(get_body(srv.url()), std::optional<std::string>("ok"));
+    CHECK_EQ(srv.requests(), 5ull);
+    CHECK_EQ(srv.connections(), 1ull);
+}
+
+TEST(http_client, connection_close_is_not_reused) {
+    loopback_server srv([](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = "bye";
+        rep.close = true;
+        return rep;
+    });
+    for (int i = 0; i < 3; ++i) CHECK_EQ(get_body(srv.url()), std::optional<std::string>("bye"));
+    CHECK_EQ(srv.connections(), 3ull);
+}
+
+TEST(http_client, follows_relative_redirects) {
+    loopback_server srv([](const loopback_request& req) {
+        loopback_reply rep;
+        if (req.target == "/a/start") {
+            rep.status = 302;
+            rep.headers = { { "Location", "next" } };
+        } else if (req.target == "/a/next") {
+            rep.status = 301;
+            rep.headers = { { "Location", "/final" } };
+        } else {
+            rep.body = "landed";
+        }
+        return rep;
+    });
+    http_request r;
+    r.url = srv.url(L"/a/start");
+    auto res = http_send(r);
+    REQUIRE(res);
+    CHECK_EQ(res->status, 200u);
+    CHECK_EQ(res->url, srv.url(L"/final"));
+    std::string body;
+    CHECK(res->read_all(body));
+    CHECK_EQ(body, "landed");
+
+    r.follow_redirects = false;
+    auto raw = http_send(r);
+    REQUIRE(raw);
+    CHECK_EQ(raw->status, 302u);
+    CHECK_EQ(raw->header(http_header::location), L"next");
+}
+
+TEST(http_client, retries_503_then_succeeds) {
+    int calls = 0;
+    loopback_server srv([&](const loopback_request&) {
+        loopback_reply rep;
+        if (++calls < 3) rep.status = 503;
+        else rep.body = "up";
+        return rep;
+    });
+    http_request r;
+    r.url = srv.url();
+    r.attempts = 3;
+    auto res = http_send(r);
+    REQUIRE(res);
+    CHECK_EQ(res->status, 200u);
+    CHECK_EQ(calls, 3);
+}
+
+TEST(http_client, post_sends_the_body) {
+    loopback_server srv([](const loopback_request& req) {
+        loopback_reply rep;
+        rep.body = req.method + ":" + req.body + ":" + std::string(req.header("Content-Type").value_or(""));
+        return rep;
+    });
+    http_request r;
+    r.verb = L"POST";
+    r.url = srv.url(L"/v1/submit");
+    r.headers = L"Content-Type: application/json\r\n";
+    r.body = R"({"id":1})";
+    auto res = http_send(r);
+    REQUIRE(res);
+    std::string body;
+    CHECK(res->read_all(body));
+    CHECK_EQ(body, R"(POST:{"id":1}:application/json)");
+}
+
+TEST(http_client, cut_body_is_an_error) {
+    loopback_server srv([](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = std::string(100'000, 'x');
+        rep.cut_after = 5000;
+        return rep;
+    });
+    CHECK(!get_body(srv.url()));
+}
+
+TEST(http_client, prewarm_leaves_a_pooled_socket) {
+    loopback_server srv([](const loopback_request&) {
+        loopback_reply rep;
+        rep.body = "warm";
+        return rep;
+    });
+    CHECK(http_prewarm(srv.url(L"/v1/anything")));
+    CHECK_EQ(get_body(srv.url()), std::optional<std::string>("warm"));
+    CHECK_EQ(srv.requests(), 2ull);
+    CHECK_EQ(srv.connections(), 1ull);
+}
+
+TEST(http_client, unreachable_host_fails_fast) {
+    std::optional<loopback_server> srv(std::in_place, [](const loopback_request&) { return loopback_reply{}; });
+    const wstr url = srv->url();
+    srv.reset();
+    http_request r;
+    r.url = url;
+    r.timeout = std::chrono::seconds(2);
+    CHECK(!http_send(r));
+}
+
+TEST(http_client, redirects_turn_a_post_into_a_get_where_they_should) {
+    loopback_server srv([](const loopback_request& req) {
+        loopback_reply rep;
+        if (req.target == "/see-other") {
+            rep.status = 303;
+            rep.headers = { { "Location", "/result" } };
+        } else if (req.target == "/found") {
+            rep.status = 302;
+            rep.headers = { { "Location", "/result" } };
+        } else if (req.target == "/temporary") {
+            rep.status = 307;
+            rep.headers = { { "Location", "/result" } };
+        } else {
+            rep.body = req.method + ":" + req.body + ":" + std::string(req.header("Content-Type").value_or(""));
+        }
+        return rep;
+    });
+    const auto post_to = [&](const wchar_t* path) {
+        http_request r;
+        r.verb = L"POST";
+        r.url = srv.url(path);
+        r.headers = L"Content-Type: application/json\r\nX-Trace: 1\r\n";
+        r.body = "{}";
+        auto res = http_send(r);
+        std::string body;
+        if (!res || !res->read_all(body)) return std::string("failed");
+        return body;
+    };
+    CHECK_EQ(post_to(L"/see-other"), "GET::");
+    CHECK_EQ(post_to(L"/found"), "GET::");
+    CHECK_EQ(post_to(L"/temporary"), "POST:{}:application/json");
+}
+
+TEST(http_client, unsent_only_retries_never_repeat_a_gateway_error) {
+    int calls = 0;
+    unsigned status = 502;
+    loopback_server srv([&](const loopback_request&) {
+        loopback_reply rep;
+        rep.status = ++calls < 3 ? status : 200;
+        return rep;
+    });
+    http_request r;
+    r.verb = L"POST";
+    r.url = srv.url();
+    r.body = "{}";
+    r.attempts = 3;
+    r.retry_unsent_only = true;
+    // the upstream may have acted on it before the gateway gave up
+    auto res = http_send(r);
+    REQUIRE(res);
+    CHECK_EQ(res->status, 502u);
+    CHECK_EQ(calls, 1);
+
+    // 503 says it wasnt taken on, that one is fine to repeat
+    calls = 0;
+    status = 503;
+    res = http_send(r);
+    REQUIRE(res);
+    CHECK_EQ(res->status, 200u);
+    CHECK_EQ(calls, 3);
+}
\ No newline at end of file
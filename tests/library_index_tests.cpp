@@ -0,0 +1,148 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "file_utils.h"
+#include "library_index.h"
+#include <chrono>
+
+namespace {
+    [[nodiscard]] unsigned long long rescans() {
+        return library_index_get_counters().rescans;
+    }
+
+    // moves an mtime along by hand, a test runs faster than some filesystems tick
+    void bump(const fs::path& p) {
+        std::error_code ec;
+        fs::last_write_time(p, fs::last_write_time(p, ec) + std::chrono::seconds(2), ec);
+    }
+
+    [[nodiscard]] fs::path install_of(const fs::path& lib, const int appid) {
+        return lib / "steamapps" / "common" / ("Game " + std::to_string(appid));
+    }
+
+    [[nodiscard]] std::vector<int> with_missing(std::vector<int> ids) {
+        ids.push_back(424242);
+        return ids;
+    }
+} // anon namespace
+
+TEST(library_index, resolves_every_app_in_one_pass) {
+    const temp_dir dir("libindex");
+    const steam_tree t = make_steam_tree(dir.path, 4, 5, 1);
+    const unsigned long long before = rescans();
+    const auto found = library_index_resolve(t.steam.wstring(), with_missing(t.appids));
+    // one scan per library, not per id
+    CHECK_EQ(rescans() - before, 4ull);
+    REQUIRE(found.size() == t.appids.size());
+    for (size_t i = 0; i < t.appids.size(); ++i) {
+        const int id = t.appids[i];
+        const auto it = found.find(id);
+        REQUIRE(it != found.end());
+        CHECK(fs::path(it->second.path) == install_of(t.libraries[i / 5], id));
+        CHECK(it->second.size_on_disk >= 1000000);
+        CHECK(it->second.buildid >= 10000000);
+    }
+    CHECK(!found.contains(424242));
+    CHECK(library_index_find(t.steam.wstring(), t.appids[7]) == install_of(t.libraries[1], t.appids[7]).wstring());
+}
+
+TEST(library_index, warm_pass_reads_no_manifests) {
+    const temp_dir dir("libindex");
+    const steam_tree t = make_steam_tree(dir.path, 3, 10, 2);
+    const auto cold = library_index_resolve(t.steam.wstring(), t.appids);
+    const unsigned long long before = rescans();
+    const auto warm = library_index_resolve(t.steam.wstring(), t.appids);
+    CHECK_EQ(rescans(), before);
+    REQUIRE(warm.size() == cold.size());
+    for (const auto& [id, a] : cold) CHECK(warm.at(id).path == a.path);
+}
+
+TEST(library_index, only_the_changed_library_is_rescanned) {
+    const temp_dir dir("libindex");
+    const steam_tree t = make_steam_tree(dir.path, 4, 5, 3);
+    (void)library_index_resolve(t.steam.wstring(), t.appids);
+
+    // steam installs something new into library 2
+    const fs::path lib = t.libraries[2];
+    REQUIRE(write_file(lib / "steamapps" / "appmanifest_777.acf", make_app_manifest(777, "Game 777", 123456789, 42)));
+    std::error_code ec;
+    fs::create_directories(install_of(lib, 777), ec);
+    bump(lib / "steamapps");
+
+    const unsigned long long before = rescans();
+    const auto found = library_index_resolve(t.steam.wstring(), std::vector<int>{ 777, t.appids[0] });
+    CHECK_EQ(rescans() - before, 1ull);
+    REQUIRE(found.contains(777));
+    CHECK(fs::path(found.at(777).path) == install_of(lib, 777));
+    CHECK_EQ(found.at(777).buildid, 42ull);
+}
+
+TEST(library_index, new_library_keeps_the_old_scans) {
+    const temp_dir dir("libindex");
+    const steam_tree t = make_steam_tree(dir.path, 2, 5, 4);
+    (void)library_index_resolve(t.steam.wstring(), t.appids);
+
+    // a third drive gets added, libraryfolders.vdf is rewritten in place
+    const fs::path extra = dir.path / "Library2";
+    REQUIRE(write_file(extra / "steamapps" / "appmanifest_888.acf", make_app_manifest(888, "Game 888", 1, 2)));
+    std::error_code ec;
+    fs::create_directories(install_of(extra, 888), ec);
+    REQUIRE(write_file(t.steam / "steamapps" / "libraryfolders.vdf",
+                       make_libraryfolders_vdf({ t.libraries[0].string(), t.libraries[1].string(), extra.string() },
+                                               { { 1000, 1001, 1002, 1003, 1004 }, { 1005, 1006, 1007, 1008, 1009 }, { 888 } })));
+    bump(t.steam / "steamapps" / "libraryfolders.vdf");
+
+    const unsigned long long before = rescans();
+    const auto found = library_index_resolve(t.steam.wstring(), std::vector<int>{ 888, 1003, 1008 });
+    CHECK_EQ(rescans() - before, 1ull);
+    CHECK_EQ(found.size(), 3u);
+    CHECK(fs::path(found.at(888).path) == install_of(extra, 888));
+}
+
+TEST(library_index, moved_install_is_found_with_one_rescan) {
+    // the manifest gets rewritten in place to a new installdir, the dir mtime doesnt move. the stale hit
+    // points at a folder thats gone, which is what makes us look again
+    const temp_dir dir("libindex");
+    const steam_tree t = make_steam_tree(dir.path, 2, 3, 5);
+    const int id = t.appids[4];
+    const fs::path lib = t.libraries[1];
+    (void)library_index_resolve(t.steam.wstring(), t.appids);
+
+    const fs::path steamapps = lib / "steamapps";
+    std::error_code ec;
+    const auto mtime = fs::last_write_time(steamapps, ec);
+    fs::rename(install_of(lib, id), steamapps / "common" / "Renamed", ec);
+    REQUIRE(!ec);
+    REQUIRE(write_file(steamapps / ("appmanifest_" + std::to_string(id) + ".acf"), make_app_manifest(id, "Renamed", 1, 3)));
+    fs::last_write_time(steamapps, mtime, ec);
+
+    const unsigned long long before = rescans();
+    const auto found = library_index_find(t.steam.wstring(), id);
+    CHECK_EQ(rescans() - before, 1ull);
+    CHECK(found == (steamapps / "common" / "Renamed").wstring());
+
+    // gone for good: one rescan, then its just missing
+    fs::remove_all(steamapps / "common" / "Renamed", ec);
+    const unsigned long long again = rescans();
+    CHECK(!library_index_find(t.steam.wstring(), id).has_value());
+    CHECK_EQ(rescans() - again, 1ull);
+}
+
+TEST(library_index, broken_cache_file_means_a_cold_rebuild) {
+    const temp_dir dir("libindex");
+    const steam_tree t = make_steam_tree(dir.path, 3, 4, 6);
+    (void)library_index_resolve(t.steam.wstring(), t.appids);
+    const fs::path cache = get_launcher_data_dir() / "libraryindex.bin";
+    auto bytes = read_file_bytes(cache);
+    REQUIRE(bytes && bytes->size() > 32);
+    (*bytes)[bytes->size() / 2] ^= 0x5a;
+    REQUIRE(write_file(cache, *bytes));
+
+    const unsigned long long before = rescans();
+    const auto found = library_index_resolve(t.steam.wstring(), t.appids);
+    CHECK_EQ(rescans() - before, 3ull);
+    CHECK_EQ(found.size(), t.appids.size());
+    // and the rewritten cache is good again
+    const unsigned long long warm = rescans();
+    (void)library_index_resolve(t.steam.wstring(), t.appids);
+    CHECK_EQ(rescans(), warm);
+}
\ No newline at end of file
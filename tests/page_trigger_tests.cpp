@@ -0,0 +1,344 @@
+#include "test.h"
+#include "support/loopback_server.h"
+#include "file_utils.h"
+#include "page_trigger.h"
+#include "remote_process.h"
+#include "trigger_locator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    using steady = std::chrono::steady_clock;
+
+    [[nodiscard]] process_id self_pid() {
+#ifdef _WIN32
+        return GetCurrentProcessId();
+#else
+        return ::getpid();
+#endif
+    }
+
+    template <typename T>
+    void put(std::vector<unsigned char>& img, const size_t off, const T v) {
+        std::memcpy(img.data() + off, &v, sizeof(T));
+    }
+
+    // a pe32+ image the way the loader would have mapped it: headers, a readable .text at 0x1000 and .data at 0x2000
+    [[nodiscard]] std::vector<unsigned char> fake_image(const std::uint32_t timestamp) {
+        std::vector<unsigned char> img(0x3000);
+        put<std::uint16_t>(img, 0, 0x5A4D);
+        put<std::int32_t>(img, 0x3C, 0x80);
+        put<std::uint32_t>(img, 0x80, 0x4550);
+        put<std::uint16_t>(img, 0x84, 0x8664);
+        put<std::uint16_t>(img, 0x86, 2);
+        put<std::uint32_t>(img, 0x88, timestamp);
+        put<std::uint16_t>(img, 0x94, 0xF0);
+        put<std::uint16_t>(img, 0x98, 0x20B);
+        put<std::uint32_t>(img, 0x98 + 56, 0x3000);
+        const auto section = [&img](const size_t off, const std::uint32_t va, const std::uint32_t characteristics) {
+            put<std::uint32_t>(img, off + 8, 0x1000);
+            put<std::uint32_t>(img, off + 12, va);
+            put<std::uint32_t>(img, off + 16, 0x1000);
+            put<std::uint32_t>(img, off + 36, characteristics);
+        };
+        section(0x98 + 0xF0, 0x1000, 0x60000020);
+        section(0x98 + 0xF0 + 40, 0x2000, 0xC0000040);
+        return img;
+    }
+
+    // lea rcx, [rip + disp32] at rva, pointing at target
+    void put_lea(std::vector<unsigned char>& img, const size_t rva, const size_t target) {
+        const unsigned char lea[] = { 0x48, 0x8D, 0x0D };
+        std::memcpy(img.data() + rva, lea, sizeof(lea));
+        put<std::int32_t>(img, rva + 3, static_cast<std::int32_t>(target - (rva + 7)));
+        img[rva + 7] = 0xE8;
+    }
+
+    [[nodiscard]] trigger_signature lea_signature() {
+        return *make_trigger_signature("48 8D 0D ?? ?? ?? ?? E8", 3, 0);
+    }
+
+    [[nodiscard]] std::expected<std::uintptr_t, locate_error> locate_in_self(const std::vector<unsigned char>& img, const trigger_signature& sig) {
+        const process_id pid = self_pid();
+        const native_process h = open_process(pid);
+        const auto out = locate_trigger_rva({ h, pid }, reinterpret_cast<std::uintptr_t>(img.data()), sig);
+        close_process(h);
+        return out;
+    }
+} // anon namespace
+
+TEST(page_trigger, locate_follows_rip_relative_reference) {
+    auto img = fake_image(0x1001);
+    put_lea(img, 0x1234, 0x2040);
+    const trigger_locator_counters cold = trigger_locator_get_counters();
+    const auto rva = locate_in_self(img, lea_signature());
+    REQUIRE(rva.has_value());
+    CHECK_EQ(*rva, 0x2040u);
+    const trigger_locator_counters scanned = trigger_locator_get_counters();
+    CHECK_EQ(scanned.scans, cold.scans + 1);
+    CHECK(scanned.scanned_bytes > cold.scanned_bytes);
+    std::error_code ec;
+    CHECK(fs::is_regular_file(get_launcher_data_dir() / "triggercache.bin", ec));
+
+    // second time round it comes out of the cache without reading a byte of the sections
+    CHECK_EQ(locate_in_self(img, lea_signature()).value_or(0), 0x2040u);
+    const trigger_locator_counters cached = trigger_locator_get_counters();
+    CHECK_EQ(cached.scans, scanned.scans);
+    CHECK_EQ(cached.scanned_bytes, scanned.scanned_bytes);
+    CHECK_EQ(cached.cache_hits, scanned.cache_hits + 1);
+
+    // a relink of the same size is a new build, the cached rva cant be trusted for it
+    put<std::uint32_t>(img, 0x88, 0x1011);
+    CHECK_EQ(locate_in_self(img, lea_signature()).value_or(0), 0x2040u);
+    const trigger_locator_counters relinked = trigger_locator_get_counters();
+    CHECK_EQ(relinked.scans, cached.scans + 1);
+    CHECK(relinked.scanned_bytes > cached.scanned_bytes);
+    CHECK_EQ(relinked.cache_hits, cached.cache_hits);
+}
+
+TEST(page_trigger, locate_rejects_two_matches) {
+    auto img = fake_image(0x1002);
+    put_lea(img, 0x1100, 0x2040);
+    put_lea(img, 0x1800, 0x2080);
+    const auto rva = locate_in_self(img, lea_signature());
+    REQUIRE(!rva.has_value());
+    CHECK(rva.error() == locate_error::ambiguous);
+}
+
+TEST(page_trigger, locate_misses_without_headers) {
+    auto img = fake_image(0x1003);
+    put_lea(img, 0x1100, 0x2040);
+    img[0] = 0;
+    const auto rva = locate_in_self(img, lea_signature());
+    REQUIRE(!rva.has_value());
+    CHECK(rva.error() == locate_error::not_mapped);
+
+    auto empty = fake_image(0x1004);
+    const auto none = locate_in_self(empty, lea_signature());
+    REQUIRE(!none.has_value());
+    CHECK(none.error() == locate_error::not_found);
+}
+
+#ifndef _WIN32
+TEST(page_trigger, locate_in_a_child_process) {
+    // the image only exists in the child, which gets its own copy at the same address when it forks. the one
+    // in here is wiped right after, so a hit can only have come from reading the child
+    auto img = fake_image(0x1005);
+    put_lea(img, 0x1ABC, 0x2100);
+    int ready[2];
+    REQUIRE(::pipe(ready) == 0);
+    const pid_t child = ::fork();
+    if (child == 0) {
+        char c;
+        (void)!::read(ready[0], &c, 1);
+        ::_exit(0);
+    }
+    REQUIRE(child > 0);
+    std::ranges::fill(img, 0);
+    const native_process h = open_process(child);
+    const auto rva = locate_trigger_rva({ h, child }, reinterpret_cast<std::uintptr_t>(img.data()), lea_signature());
+    CHECK(rva.has_value() && *rva == 0x2100u);
+    const auto here = locate_in_self(img, lea_signature());
+    CHECK(!here.has_value() && here.error() == locate_error::not_mapped);
+    close_process(h);
+    (void)!::write(ready[1], "x", 1);
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    ::close(ready[0]);
+    ::close(ready[1]);
+}
+#endif
+
+namespace {
+    // the warmer works on its own thread, give it a moment to get to n
+    [[nodiscard]] bool wait_for_warms(const backend_warmer& w, const unsigned n) {
+        const auto deadline = steady::now() + std::chrono::seconds(3);
+        while (w.warms() < n && steady::now() < deadline) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return w.warms() == n;
+    }
+} // anon namespace
+
+TEST(page_trigger, warmer_warms_once_up_front) {
+    loopback_server srv([](const loopback_request& req) {
+        loopback_reply rep;
+        rep.status = req.method == "HEAD" ? 200 : 405;
+        return rep;
+    });
+    {
+        backend_warmer w(srv.url(L"/v1/submitproviderid"));
+        CHECK(wait_for_warms(w, 1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        CHECK_EQ(w.warms(), 1u);
+    }
+    CHECK_EQ(srv.requests(), 1ull);
+}
+
+TEST(page_trigger, warmer_ignores_nudges_while_warm) {
+    loopback_server srv([](const loopback_request&) { return loopback_reply{}; });
+    {
+        backend_warmer w(srv.url(L"/v1/submitproviderid"));
+        CHECK(wait_for_warms(w, 1));
+        for (int i = 0; i < 10; ++i) w.nudge();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        CHECK_EQ(w.warms(), 1u);
+    }
+    CHECK_EQ(srv.requests(), 1ull);
+}
+
+TEST(page_trigger, warmer_stops_at_the_cap) {
+    loopback_server srv([](const loopback_request&) { return loopback_reply{}; });
+    {
+        // no interval at all, so every nudge is worth a warm until the cap says otherwise
+        backend_warmer w(srv.url(L"/v1/submitproviderid"), std::chrono::milliseconds(0), 3);
+        const auto deadline = steady::now() + std::chrono::seconds(3);
+        while (w.warms() < 3 && steady::now() < deadline) {
+            w.nudge();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        CHECK_EQ(w.warms(), 3u);
+        for (int i = 0; i < 10; ++i) w.nudge();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK_EQ(w.warms(), 3u);
+    }
+    CHECK_EQ(srv.requests(), 3ull);
+}
+
+#ifndef _WIN32
+namespace {
+    inline constexpr auto CHILD_DELAY = std::chrono::milliseconds(200);
+    // wait_adaptive has no timeout of its own, a probe that never fires kills the child past this instead
+    inline constexpr auto GIVE_UP = std::chrono::seconds(5);
+
+    // a forked child that runs fn and then idles until it gets killed
+    struct child_process {
+        pid_t pid = -1;
+        native_process handle = NO_PROCESS;
+
+        template <typename Fn>
+        explicit child_process(Fn&& fn) {
+            pid = ::fork();
+            if (pid == 0) {
+                fn();
+                for (;;) ::pause();
+            }
+            handle = pid > 0 ? open_process(pid) : NO_PROCESS;
+        }
+
+        ~child_process() {
+            close_process(handle);
+            if (pid <= 0) return;
+            ::kill(pid, SIGKILL);
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+        }
+    };
+
+    // one page nothing is mapped at, in this process and so in a child forked right after
+    [[nodiscard]] void* free_page() {
+        void* p = ::mmap(nullptr, 4096, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        ::munmap(p, 4096);
+        return p;
+    }
+
+    // the probe looks at base + rva, so the rva of addr is relative to our own exe which a fork shares
+    [[nodiscard]] std::uintptr_t rva_of(const void* addr) {
+        const auto base = remote_main_module_base({ NO_PROCESS, ::getpid() });
+        return reinterpret_cast<std::uintptr_t>(addr) - base.value_or(0);
+    }
+} // anon namespace
+
+TEST(page_trigger, finds_own_main_module) {
+    const auto base = remote_main_module_base({ NO_PROCESS, ::getpid() });
+    REQUIRE(base.has_value());
+    // the headers of this very binary
+    const char* p = reinterpret_cast<const char*>(*base);
+    CHECK(std::memcmp(p, "\x7f" "ELF", 4) == 0);
+}
+
+TEST(page_trigger, probe_sees_page_mapped_after_delay) {
+    void* page = free_page();
+    REQUIRE(page != MAP_FAILED);
+    const auto start = steady::now();
+    child_process child([page] {
+        std::this_thread::sleep_for(CHILD_DELAY);
+#ifdef MAP_FIXED_NOREPLACE
+        ::mmap(page, 4096, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+#else
+        ::mmap(page, 4096, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+#endif
+    });
+    REQUIRE(child.handle != NO_PROCESS);
+
+    target_page_probe probe = make_trigger_probe(child.handle, child.pid);
+    probe.rva = rva_of(page);
+    trigger_wait_stats stats;
+    const wait_outcome res = wait_adaptive(child.handle, [&] {
+        if (steady::now() - start > GIVE_UP) ::kill(child.pid, SIGKILL);
+        return probe.poll();
+    }, {}, stats);
+    const auto took = steady::now() - start;
+    CHECK(res == wait_outcome::ready);
+    CHECK(took >= CHILD_DELAY);
+    // backed off to 25 ms polls while nothing moved, so this is a handful of polls and not one per ms
+    CHECK(stats.polls > 1);
+    CHECK(stats.polls < 100);
+    CHECK(took < CHILD_DELAY + std::chrono::seconds(2));
+}
+
+TEST(page_trigger, probe_sees_protection_flip) {
+    void* page = ::mmap(nullptr, 4096, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(page != MAP_FAILED);
+    const auto start = steady::now();
+    child_process child([page] {
+        std::this_thread::sleep_for(CHILD_DELAY);
+        ::mprotect(page, 4096, PROT_READ | PROT_WRITE);
+    });
+    ::munmap(page, 4096);
+    REQUIRE(child.handle != NO_PROCESS);
+
+    target_page_probe probe = make_trigger_probe(child.handle, child.pid);
+    probe.rva = rva_of(page);
+    // mapped but no access yet: the first poll finds the base and the region, nothing is ready
+    CHECK(probe.poll() == probe_state::progress);
+    CHECK(probe.poll() == probe_state::waiting);
+    trigger_wait_stats stats;
+    CHECK(wait_adaptive(child.handle, [&] {
+        if (steady::now() - start > GIVE_UP) ::kill(child.pid, SIGKILL);
+        return probe.poll();
+    }, {}, stats) == wait_outcome::ready);
+}
+
+TEST(page_trigger, wait_wakes_on_exit) {
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+        std::this_thread::sleep_for(CHILD_DELAY);
+        ::_exit(0);
+    }
+    REQUIRE(pid > 0);
+    const native_process h = open_process(pid);
+    REQUIRE(h != NO_PROCESS);
+
+    const auto start = steady::now();
+    trigger_wait_stats stats;
+    // a long poll interval, the exit has to come from the pidfd and not from the next poll
+    const wait_outcome res = wait_adaptive(h, [] { return probe_state::waiting; }, { .min_interval_ms = 5000, .max_interval_ms = 5000 }, stats);
+    CHECK(res == wait_outcome::process_exited);
+    CHECK(steady::now() - start < std::chrono::seconds(2));
+    CHECK_EQ(stats.polls, 1u);
+    close_process(h);
+    int status = 0;
+    CHECK(::waitpid(pid, &status, 0) == pid);
+}
+#endif
\ No newline at end of file
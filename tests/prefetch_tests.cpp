@@ -0,0 +1,137 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "support/loopback_server.h"
+#include "prefetch.h"
+#include "artifact_store.h"
+#include "file_utils.h"
+#include "sha256.h"
+#include <mutex>
+
+namespace {
+    // a release that gets replaced every now and then: the artifact with an etag per version, 304 for the
+    // current one. counts the full downloads and the conditional asks
+    struct release_feed {
+        std::mutex lock;
+        std::string body;
+        std::string etag;
+        int version = 0;
+        int downloads = 0;
+        int not_modified = 0;
+        loopback_server srv{ [this](const loopback_request& req) {
+            std::scoped_lock lk(lock);
+            loopback_reply rep;
+            if (req.target != "/BEClient_x64.dll") {
+                rep.status = 404;
+                return rep;
+            }
+            if (const auto inm = req.header("If-None-Match"); inm && *inm == etag) {
+                ++not_modified;
+                rep.status = 304;
+                return rep;
+            }
+            if (!req.header("Range") || *req.header("Range") != "bytes=0-0") ++downloads;
+            rep.body = body;
+            rep.ranges = true;
+            rep.headers = { { "ETag", etag } };
+            return rep;
+        } };
+
+        explicit release_feed(const std::uint64_t seed) { publish(seed); }
+
+        // a new build goes out, returns its digest
+        std::string publish(const std::uint64_t seed) {
+            std::scoped_lock lk(lock);
+            body = code_like_bytes(200'000, seed);
+            etag = "\"v" + std::to_string(++version) + "\"";
+            return to_hex(sha256_of(body.data(), body.size()));
+        }
+
+        [[nodiscard]] wstr url() const { return srv.url(L"/BEClient_x64.dll"); }
+    };
+
+    // every test starts without anything a previous one prefetched or downloaded
+    void forget_prefetch() {
+        std::error_code ec;
+        fs::remove(get_launcher_data_dir() / L"prefetch.state", ec);
+        fs::remove(get_launcher_data_dir() / L"beclient.fetch", ec);
+    }
+
+    [[nodiscard]] prefetch_options once_from(const release_feed& feed) {
+        prefetch_options o;
+        o.once = true;
+        o.url = feed.url();
+        return o;
+    }
+} // anon namespace
+
+TEST(prefetch, staged_build_is_used_while_the_release_says_304) {
+    forget_prefetch();
+    release_feed feed(1);
+    const std::string v1 = to_hex(sha256_of(feed.body.data(), feed.body.size()));
+    CHECK(!prefetch_staged(feed.url().c_str()).has_value());
+
+    CHECK_EQ(run_prefetch(once_from(feed)), 0);
+    CHECK_EQ(feed.downloads, 1);
+    CHECK(store_has(v1));
+
+    const auto staged = prefetch_staged(feed.url().c_str());
+    CHECK(staged == v1);
+    // one conditional probe and nothing else
+    CHECK_EQ(feed.not_modified, 1);
+    CHECK_EQ(feed.downloads, 1);
+}
+
+TEST(prefetch, new_release_since_the_check_isnt_trusted) {
+    forget_prefetch();
+    release_feed feed(2);
+    CHECK_EQ(run_prefetch(once_from(feed)), 0);
+    // a fresh state file means nothing once the release moved on
+    const std::string v2 = feed.publish(3);
+    CHECK(!prefetch_staged(feed.url().c_str()).has_value());
+
+    // the next round picks it up and stages that one instead
+    CHECK_EQ(run_prefetch(once_from(feed)), 0);
+    CHECK_EQ(feed.downloads, 2);
+    CHECK(prefetch_staged(feed.url().c_str()) == v2);
+}
+
+TEST(prefetch, unreachable_release_isnt_trusted) {
+    forget_prefetch();
+    wstr url;
+    {
+        release_feed feed(4);
+        url = feed.url();
+        CHECK_EQ(run_prefetch(once_from(feed)), 0);
+        CHECK(prefetch_staged(url.c_str()).has_value());
+    }
+    CHECK(!prefetch_staged(url.c_str()).has_value());
+}
+
+TEST(prefetch, unchanged_release_isnt_downloaded_again) {
+    forget_prefetch();
+    release_feed feed(5);
+    CHECK_EQ(run_prefetch(once_from(feed)), 0);
+    CHECK_EQ(run_prefetch(once_from(feed)), 0);
+    CHECK_EQ(run_prefetch(once_from(feed)), 0);
+    CHECK_EQ(feed.downloads, 1);
+    CHECK_EQ(feed.not_modified, 2);
+}
+
+TEST(prefetch, state_without_validators_isnt_trusted) {
+    forget_prefetch();
+    release_feed feed(6);
+    CHECK_EQ(run_prefetch(once_from(feed)), 0);
+    const std::string v6 = to_hex(sha256_of(feed.body.data(), feed.body.size()));
+    // what an older prefetcher wrote: digest and timestamps, nothing to ask the server about
+    REQUIRE(write_file(get_launcher_data_dir() / L"prefetch.state", "checked=4102444800\ninterval=1800\nsha256=" + v6 + "\n"));
+    CHECK(!prefetch_staged(feed.url().c_str()).has_value());
+}
+
+TEST(prefetch, one_prefetcher_at_a_time) {
+    forget_prefetch();
+    release_feed feed(7);
+    const file_lock held = try_lock_file(get_launcher_data_dir() / L"prefetch.lock");
+    REQUIRE(held);
+    CHECK_EQ(run_prefetch(once_from(feed)), 12);
+    CHECK_EQ(feed.downloads, 0);
+}
\ No newline at end of file
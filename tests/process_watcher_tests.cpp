@@ -0,0 +1,134 @@
+#include "test.h"
+#include "process_watcher.h"
+#include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+    using steady = std::chrono::steady_clock;
+
+    // a sleep that shows up in the process list as name, killed and reaped when this goes away
+    struct named_child {
+        pid_t pid = -1;
+
+        explicit named_child(const char* name) {
+            char* argv[] = { const_cast<char*>(name), const_cast<char*>("30"), nullptr };
+            if (::posix_spawnp(&pid, "sleep", nullptr, nullptr, argv, environ) != 0) pid = -1;
+        }
+
+        ~named_child() {
+            if (pid <= 0) return;
+            ::kill(pid, SIGKILL);
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+        }
+    };
+} // anon namespace
+
+TEST(process_watcher, finds_child_by_name) {
+    CHECK(!process_watch_find(L"spectre_watch_a").has_value());
+    std::optional<process_id> found;
+    {
+        named_child child("spectre_watch_a");
+        REQUIRE(child.pid > 0);
+        // the spawn returns while exec is still filling in the cmdline, so this can take one more refresh
+        CHECK(process_watch_wait(L"spectre_watch_a", std::chrono::seconds(2)));
+        found = process_watch_find(L"SPECTRE_WATCH_A");
+        CHECK(found == child.pid);
+    }
+    CHECK(!process_watch_find(L"spectre_watch_a").has_value());
+}
+
+TEST(process_watcher, names_only_new_pids) {
+    process_watch_reset();
+    process_watch_refresh();
+    CHECK_EQ(process_watch_get_counters().snapshots, 1u);
+
+    named_child a("spectre_watch_b"), b("spectre_watch_b"), c("spectre_watch_b");
+    REQUIRE(a.pid > 0 && b.pid > 0 && c.pid > 0);
+    process_watch_refresh();
+    const process_watch_counters after = process_watch_get_counters();
+    CHECK_EQ(after.refreshes, 2u);
+    // three new pids get named one by one, the first snapshot isnt repeated
+    CHECK_EQ(after.snapshots, 1u);
+    CHECK(after.names_resolved >= 3);
+
+    process_watch_refresh();
+    CHECK_EQ(process_watch_get_counters().names_resolved, after.names_resolved);
+}
+
+TEST(process_watcher, wait_wakes_when_process_appears) {
+    std::optional<named_child> child;
+    steady::time_point spawned;
+    std::jthread starter([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        spawned = steady::now();
+        child.emplace("spectre_watch_c");
+    });
+    const auto start = steady::now();
+    CHECK(process_watch_wait(L"spectre_watch_c", std::chrono::seconds(5)));
+    const auto woke = steady::now();
+    starter.join();
+    REQUIRE(child && child->pid > 0);
+    CHECK(woke - start >= std::chrono::milliseconds(150));
+    // at most one poll interval late, plus room for a slow box
+    CHECK(woke - spawned < std::chrono::milliseconds(500));
+}
+
+TEST(process_watcher, wait_sees_fork_exec_rename) {
+    // named after the test binary right after the fork, spectre_watch_d once it execs. the name has to be picked
+    // up again even though the pid was already known by then
+    process_watch_refresh();
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ::execlp("sleep", "spectre_watch_d", "30", static_cast<char*>(nullptr));
+        ::_exit(1);
+    }
+    REQUIRE(pid > 0);
+    process_watch_refresh();
+    CHECK(process_watch_wait(L"spectre_watch_d", std::chrono::seconds(3)));
+    ::kill(pid, SIGKILL);
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+}
+
+TEST(process_watcher, wait_wakes_on_stop) {
+    std::stop_source stop;
+    std::jthread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        stop.request_stop();
+    });
+    const auto start = steady::now();
+    CHECK(!process_watch_wait(L"spectre_watch_never", std::chrono::seconds(10), stop.get_token()));
+    CHECK(steady::now() - start < std::chrono::seconds(2));
+}
+
+TEST(process_watcher, wait_wakes_when_spawned_exits) {
+    // the bootstrapper case: what we started hands over to the real process and exits. the hand over is
+    // looked for right when it exits, not on the next poll
+    const pid_t boot = ::fork();
+    if (boot == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        pid_t real = -1;
+        char* argv[] = { const_cast<char*>("spectre_watch_e"), const_cast<char*>("30"), nullptr };
+        ::posix_spawnp(&real, "sleep", nullptr, nullptr, argv, environ);
+        ::_exit(0);
+    }
+    REQUIRE(boot > 0);
+    const native_process h = open_process(boot);
+    REQUIRE(h != NO_PROCESS);
+    CHECK(process_watch_wait(L"spectre_watch_e", std::chrono::seconds(3), {}, h));
+    close_process(h);
+    int status = 0;
+    ::waitpid(boot, &status, 0);
+    if (const auto real = process_watch_find(L"spectre_watch_e")) ::kill(*real, SIGKILL);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "file_utils.h"
+#include "sha256.h"
+#include <algorithm>
+#include <string_view>
+
+namespace {
+    struct vector_case {
+        std::string message;
+        std::string_view digest;
+    };
+
+    // fips 180-2 examples plus the long one from the nist cavs set
+    [[nodiscard]] std::vector<vector_case> vectors() {
+        return {
+            { "", "E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855" },
+            { "abc", "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD" },
+            { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "248D6A61D20638B8E5C026930C3E6039A33CE45964FF2167F6ECEDD419DB06C1" },
+            { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+              "CF5B16A778AF8380036CE59E7B0492370B249B11E8F07A51AFAC45037AFEE9D1" },
+            { std::string(1'000'000, 'a'), "CDC76E5C9914FB9281A1C7E284D73E67F1809A48A497200E046D39CCC7112CD0" },
+        };
+    }
+
+    // puts the default backend back even when a REQUIRE bails out of the test
+    struct backend_guard {
+        ~backend_guard() { (void)sha256_use_backend({}); }
+    };
+} // anon namespace
+
+TEST(sha256, known_vectors_on_every_backend) {
+    const backend_guard guard;
+    for (const char* name : sha256_backends()) {
+        REQUIRE(sha256_use_backend(name));
+        for (const auto& v : vectors()) {
+            const auto d = sha256_of(v.message.data(), v.message.size());
+            if (to_hex(d) != v.digest) std::fprintf(stderr, "  backend %s, %zu byte message\n", name, v.message.size());
+            CHECK_EQ(to_hex(d), v.digest);
+        }
+    }
+}
+
+TEST(sha256, backends_agree_on_every_length_and_split) {
+    const backend_guard guard;
+    const auto names = sha256_backends();
+    const std::string data = random_bytes(4096 + 257, 11);
+    for (size_t len = 0; len <= 300; ++len) {
+        std::vector<sha256_digest> got;
+        for (const char* name : names) {
+            REQUIRE(sha256_use_backend(name));
+            got.push_back(sha256_of(data.data(), len));
+        }
+        for (const auto& d : got) CHECK(d == got.front());
+    }
+    // block boundaries in awkward places, fed through update in pieces
+    for (const char* name : names) {
+        REQUIRE(sha256_use_backend(name));
+        const auto whole = sha256_of(data.data(), data.size());
+        for (const size_t step : { 1, 3, 63, 64, 65, 1000 }) {
+            sha256 h;
+            for (size_t off = 0; off < data.size(); off += step) h.update(data.data() + off, std::min(step, data.size() - off));
+            CHECK(h.finish() == whole);
+        }
+    }
+}
+
+TEST(sha256, finish_resets_for_reuse) {
+    sha256 h;
+    h.update("abc", 3);
+    const auto a = h.finish();
+    h.update("abc", 3);
+    CHECK(h.finish() == a);
+}
+
+TEST(sha256, unknown_backend_is_refused) {
+    CHECK(!sha256_use_backend("avx512-imaginary"));
+    CHECK(!sha256_backends().empty());
+    CHECK_EQ(std::string_view(sha256_backends().front()), std::string_view(sha256_backend_name()));
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "sig_scan.h"
+#include <string>
+
+namespace {
+    [[nodiscard]] std::span<const unsigned char> bytes_of(const std::string& s) {
+        return { reinterpret_cast<const unsigned char*>(s.data()), s.size() };
+    }
+
+    // the obvious search every backend has to agree with
+    [[nodiscard]] std::optional<size_t> naive_find(const std::span<const unsigned char> hay, const byte_signature& sig, size_t from) {
+        for (; from + sig.bytes.size() <= hay.size(); ++from) {
+            bool ok = true;
+            for (size_t i = 0; ok && i < sig.bytes.size(); ++i) ok = !sig.mask[i] || hay[from + i] == sig.bytes[i];
+            if (ok) return from;
+        }
+        return std::nullopt;
+    }
+
+    // a signature cut out of hay at pos, every byte past the first wildcarded with probability 1 in 3
+    [[nodiscard]] std::string signature_at(const std::string& hay, const size_t pos, const size_t len, splitmix64& rng) {
+        static constexpr char HEX[] = "0123456789ABCDEF";
+        std::string out;
+        for (size_t i = 0; i < len; ++i) {
+            if (i) out += ' ';
+            const auto b = static_cast<unsigned char>(hay[pos + i]);
+            if (i && rng.below(3) == 0) out += "??";
+            else out += { HEX[b >> 4], HEX[b & 15] };
+        }
+        return out;
+    }
+
+    // runs fn once per backend with that backend forced, then puts the default back
+    template <typename Fn>
+    void for_each_backend(Fn&& fn) {
+        for (const char* name : sig_scan_backends()) {
+            REQUIRE(sig_scan_use_backend(name));
+            CHECK(std::string(sig_scan_backend()) == name);
+            fn(name);
+        }
+        CHECK(sig_scan_use_backend({}));
+    }
+} // anon namespace
+
+TEST(sig_scan, parses_disassembler_style) {
+    const auto sig = parse_signature("48 8D 0D ?? ?? ?? ?? E8 ? c0");
+    REQUIRE(sig.has_value());
+    CHECK(sig->bytes == std::vector<unsigned char>({ 0x48, 0x8D, 0x0D, 0, 0, 0, 0, 0xE8, 0, 0xC0 }));
+    CHECK(sig->mask == std::vector<unsigned char>({ 0xFF, 0xFF, 0xFF, 0, 0, 0, 0, 0xFF, 0, 0xFF }));
+    // 0D is the only byte the commonness table doesnt know, 48 and E8 are everywhere in x64 code
+    CHECK_EQ(sig->first, 2u);
+    CHECK(sig->mask[sig->second] && sig->second != sig->first);
+
+    const auto one = parse_signature("  ?? 7F\t?? ");
+    REQUIRE(one.has_value());
+    CHECK_EQ(one->first, 1u);
+    CHECK_EQ(one->second, 1u);
+
+    CHECK(!parse_signature("").has_value());
+    CHECK(!parse_signature("?? ??").has_value());
+    CHECK(!parse_signature("48 8").has_value());
+    CHECK(!parse_signature("48 8DD").has_value());
+    CHECK(!parse_signature("48 GG").has_value());
+    CHECK(!parse_signature("48,8D").has_value());
+}
+
+TEST(sig_scan, scalar_is_always_there) {
+    const auto all = sig_scan_backends();
+    REQUIRE(!all.empty());
+    CHECK(std::string(all.back()) == "scalar");
+    CHECK(std::string(sig_scan_backend()) == all.front());
+    CHECK(!sig_scan_use_backend("neon"));
+    CHECK(std::string(sig_scan_backend()) == all.front());
+}
+
+TEST(sig_scan, every_backend_agrees_with_a_naive_search) {
+    // code like input so the filter bytes hit a lot, signatures taken from it so there is always a match
+    const std::string hay = code_like_bytes(256 << 10, 3);
+    splitmix64 rng(4);
+    std::vector<std::pair<byte_signature, size_t>> cases;
+    for (int i = 0; i < 300; ++i) {
+        const size_t len = 1 + rng.below(24);
+        const size_t pos = rng.below(hay.size() - len);
+        auto sig = parse_signature(signature_at(hay, pos, len, rng));
+        REQUIRE(sig.has_value());
+        const size_t from = rng.below(2) ? 0 : rng.below(pos + 1);
+        cases.emplace_back(std::move(*sig), from);
+    }
+    for_each_backend([&](const char*) {
+        for (const auto& [sig, from] : cases) {
+            CHECK(find_signature(bytes_of(hay), sig, from) == naive_find(bytes_of(hay), sig, from));
+        }
+    });
+}
+
+TEST(sig_scan, matches_at_every_edge_of_a_block) {
+    // the signature at each position of buffers from one signature long to past two avx2 blocks, so every
+    // vector loop tail and scalar fallback gets a turn
+    const auto sig = parse_signature("4D ?? 5A A5");
+    REQUIRE(sig.has_value());
+    for_each_backend([&](const char*) {
+        for (size_t n = 4; n < 80; ++n) {
+            for (size_t at = 0; at + 4 <= n; ++at) {
+                std::string hay(n, '\x11');
+                hay[at] = '\x4D';
+                hay[at + 1] = static_cast<char>(at);
+                hay[at + 2] = '\x5A';
+                hay[at + 3] = '\xA5';
+                CHECK(find_signature(bytes_of(hay), *sig) == at);
+                CHECK(!find_signature(bytes_of(hay), *sig, at + 1).has_value());
+            }
+            // a match cut off by the end of the buffer isnt one
+            std::string cut(n, '\x11');
+            cut[n - 3] = '\x4D';
+            cut[n - 1] = '\x5A';
+            CHECK(!find_signature(bytes_of(cut), *sig).has_value());
+        }
+    });
+}
+
+TEST(sig_scan, short_or_exhausted_input_finds_nothing) {
+    const auto sig = parse_signature("01 02 03 04 05");
+    REQUIRE(sig.has_value());
+    const std::string hay = "\x01\x02\x03\x04";
+    const std::string exact = "\x01\x02\x03\x04\x05";
+    for_each_backend([&](const char*) {
+        CHECK(!find_signature(bytes_of(hay), *sig).has_value());
+        CHECK(!find_signature({}, *sig).has_value());
+        CHECK(find_signature(bytes_of(exact), *sig) == size_t(0));
+        CHECK(!find_signature(bytes_of(exact), *sig, 1).has_value());
+        CHECK(!find_signature(bytes_of(exact), *sig, 1000).has_value());
+    });
+}
+
+TEST(sig_scan, finds_every_match_in_turn) {
+    // what the locator does to tell one match from several
+    std::string hay = random_bytes(100'000, 5);
+    const size_t at[] = { 17, 4096, 4100, 65'520, 99'990 };
+    for (const size_t p : at) hay.replace(p, 4, "\xDE\xAD\xBE\xEF");
+    const auto sig = parse_signature("DE AD ?? EF");
+    REQUIRE(sig.has_value());
+    for_each_backend([&](const char*) {
+        std::vector<size_t> found;
+        for (auto p = find_signature(bytes_of(hay), *sig); p; p = find_signature(bytes_of(hay), *sig, *p + 1)) found.push_back(*p);
+        std::vector<size_t> want;
+        for (auto p = naive_find(bytes_of(hay), *sig, 0); p; p = naive_find(bytes_of(hay), *sig, *p + 1)) want.push_back(*p);
+        CHECK(found == want);
+        CHECK(found.size() >= std::size(at));
+    });
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "file_utils.h"
+#include "staged_install.h"
+#include <cstdio>
+#include <map>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace {
+    // rel path -> contents, the whole tree under dir
+    [[nodiscard]] std::map<std::string, std::string> contents(const fs::path& dir) {
+        std::map<std::string, std::string> out;
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file()) out[it->path().lexically_relative(dir).generic_string()] = read_file_bytes(it->path()).value_or("?");
+        }
+        return out;
+    }
+
+    // whatever sits next to dir besides dir itself
+    [[nodiscard]] std::vector<std::string> leftovers(const fs::path& dir) {
+        std::vector<std::string> out;
+        std::error_code ec;
+        for (fs::directory_iterator it(dir.parent_path(), ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->path() != dir) out.push_back(it->path().filename().string());
+        }
+        return out;
+    }
+
+    const std::map<std::string, std::string> OLD = { { "BEClient_x64.dll", "old client" }, { "sub/keep.txt", "old" } };
+    const std::map<std::string, std::string> NEW = { { "BEClient_x64.dll", "new client" }, { "added.txt", "new" } };
+
+    [[nodiscard]] bool fill_with(const fs::path& root, const std::map<std::string, std::string>& files) {
+        for (const auto& [rel, data] : files) {
+            if (!write_file(root / rel, data)) return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] fs::path old_install(const temp_dir& tmp) {
+        const fs::path dir = tmp.path / "BattlEye";
+        (void)fill_with(dir, OLD);
+        return dir;
+    }
+} // anon namespace
+
+TEST(staged_install, swaps_the_whole_tree) {
+    const temp_dir tmp("staged");
+    const fs::path dir = old_install(tmp);
+    REQUIRE(staged_install(dir, [](const fs::path& staging) { return fill_with(staging, NEW); }));
+    staged_wait_cleanup();
+    CHECK(contents(dir) == NEW);
+    CHECK(leftovers(dir).empty());
+}
+
+TEST(staged_install, failed_fill_leaves_dir_alone) {
+    const temp_dir tmp("staged");
+    const fs::path dir = old_install(tmp);
+    CHECK(!staged_install(dir, [](const fs::path& staging) { return fill_with(staging, NEW) && false; }));
+    staged_wait_cleanup();
+    CHECK(contents(dir) == OLD);
+    CHECK(leftovers(dir).empty());
+}
+
+TEST(staged_install, recover_clears_parked_cleanups) {
+    const temp_dir tmp("staged");
+    const fs::path dir = old_install(tmp);
+    REQUIRE(fill_with(tmp.path / "BattlEye.old.12345", OLD));
+    REQUIRE(fill_with(tmp.path / "BattlEye.old", OLD));
+    REQUIRE(fill_with(tmp.path / "BattlEye.staging", NEW));
+    REQUIRE(staged_recover(dir));
+    staged_wait_cleanup();
+    CHECK(contents(dir) == OLD);
+    CHECK(leftovers(dir).empty());
+}
+
+#ifndef _WIN32
+namespace {
+    const char* g_die_at = nullptr;
+
+    void die_at(const char* step) {
+        if (g_die_at && std::strcmp(step, g_die_at) == 0) ::_exit(0);
+    }
+
+    // runs the swap in a child that gets killed right before step, like a crash or a power cut would
+    [[nodiscard]] bool crash_swap_at(const fs::path& dir, const char* step) {
+        const pid_t child = ::fork();
+        if (child < 0) return false;
+        if (child == 0) {
+            g_die_at = step;
+            staged_set_step_hook(die_at);
+            (void)staged_install(dir, [](const fs::path& staging) { return fill_with(staging, NEW); });
+            // never reached the step
+            ::_exit(1);
+        }
+        int status = 0;
+        return ::waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+} // anon namespace
+
+TEST(staged_install, crash_at_every_step_leaves_one_whole_tree) {
+    // before the marker the new tree isnt finished as far as recovery knows, so the old one stays.
+    // from the marker on its rolled forward
+    const std::pair<const char*, const std::map<std::string, std::string>*> cases[] = {
+        { "mark", &OLD },
+        { "park", &NEW },
+        { "swap", &NEW },
+        { "unmark", &NEW },
+    };
+    for (const auto& [step, want] : cases) {
+        const temp_dir tmp("staged");
+        const fs::path dir = old_install(tmp);
+        REQUIRE(crash_swap_at(dir, step));
+        REQUIRE(staged_recover(dir));
+        staged_wait_cleanup();
+        if (contents(dir) != *want) std::fprintf(stderr, "  crashed at %s\n", step);
+        CHECK(contents(dir) == *want);
+        CHECK(leftovers(dir).empty());
+    }
+}
+
+TEST(staged_install, swap_after_a_crash_finishes_cleanly) {
+    const temp_dir tmp("staged");
+    const fs::path dir = old_install(tmp);
+    REQUIRE(crash_swap_at(dir, "swap"));
+    // no explicit recover, the next install does it on the way in
+    const std::map<std::string, std::string> newer = { { "BEClient_x64.dll", "newer client" } };
+    REQUIRE(staged_install(dir, [&](const fs::path& staging) { return fill_with(staging, newer); }));
+    staged_wait_cleanup();
+    CHECK(contents(dir) == newer);
+    CHECK(leftovers(dir).empty());
+}
+#endif
\ No newline at end of file
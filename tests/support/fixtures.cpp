@@ -0,0 +1,234 @@
+#include "fixtures.h"
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+std::uint64_t splitmix64::next() {
+    std::uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+std::uint64_t splitmix64::below(const std::uint64_t n) {
+    return n ? next() % n : 0;
+}
+
+temp_dir::temp_dir(const std::string_view tag) {
+    static std::atomic<unsigned> counter{ 0 };
+#ifdef _WIN32
+    const int pid = _getpid();
+#else
+    const int pid = static_cast<int>(::getpid());
+#endif
+    std::error_code ec;
+    const fs::path base = fs::temp_directory_path(ec);
+    for (;;) {
+        path = base / ("spectre-" + std::string(tag) + "-" + std::to_string(pid) + "-" + std::to_string(counter++));
+        if (fs::create_directories(path, ec)) return;
+        if (ec) return;
+    }
+}
+
+temp_dir::~temp_dir() {
+    std::error_code ec;
+    fs::remove_all(path, ec);
+}
+
+void set_env(const char* name, const std::string& value) {
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    ::setenv(name, value.c_str(), 1);
+#endif
+}
+
+bool write_file(const fs::path& p, const std::string_view data) {
+    std::error_code ec;
+    if (const fs::path parent = p.parent_path(); !parent.empty()) fs::create_directories(parent, ec);
+    std::ofstream out(p, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(out);
+}
+
+[[nodiscard]] std::string random_bytes(const size_t n, const std::uint64_t seed) {
+    splitmix64 rng(seed);
+    std::string out(n, '\0');
+    for (size_t i = 0; i < n; i += 8) {
+        const std::uint64_t v = rng.next();
+        for (size_t b = 0; b < 8 && i + b < n; ++b) out[i + b] = static_cast<char>(v >> (b * 8));
+    }
+    return out;
+}
+
+[[nodiscard]] std::string code_like_bytes(const size_t n, const std::uint64_t seed) {
+    // a handful of common x64 encodings (mov/lea/call/cmp/jcc), immediates are what varies
+    static constexpr std::string_view OPS[] = {
+        "\x48\x8B\x05", "\x48\x8D\x0D", "\xE8", "\x48\x89\x5C\x24", "\x48\x83\xEC", "\x0F\x84", "\x48\x85\xC0", "\xC3\xCC\xCC\xCC",
+    };
+    splitmix64 rng(seed);
+    std::string out;
+    out.reserve(n + 16);
+    while (out.size() < n) {
+        const std::string_view op = OPS[rng.below(std::size(OPS))];
+        out.append(op);
+        const int imm = static_cast<int>(rng.below(5));
+        const std::uint64_t v = rng.next() & 0xFFFF;  // small immediates like real code has
+        for (int b = 0; b < imm; ++b) out.push_back(static_cast<char>(v >> (b * 8)));
+    }
+    out.resize(n);
+    return out;
+}
+
+namespace {
+    [[nodiscard]] std::string vdf_escape(const std::string_view s) {
+        std::string out;
+        for (const char c : s) {
+            if (c == '\\' || c == '"') out.push_back('\\');
+            out.push_back(c);
+        }
+        return out;
+    }
+} // anon namespace
+
+[[nodiscard]] std::string make_libraryfolders_vdf(const std::vector<std::string>& paths, const std::vector<std::vector<int>>& apps) {
+    std::string out = "\"libraryfolders\"\n{\n";
+    for (size_t i = 0; i < paths.size(); ++i) {
+        out += "\t\"" + std::to_string(i) + "\"\n\t{\n";
+        out += "\t\t\"path\"\t\t\"" + vdf_escape(paths[i]) + "\"\n";
+        out += "\t\t\"label\"\t\t\"\"\n";
+        out += "\t\t\"contentid\"\t\t\"" + std::to_string(7000000000000000000ull + i) + "\"\n";
+        out += "\t\t\"totalsize\"\t\t\"0\"\n";
+        out += "\t\t\"update_clean_bytes_tally\"\t\t\"0\"\n";
+        out += "\t\t\"time_last_update_verified\"\t\t\"0\"\n";
+        out += "\t\t\"apps\"\n\t\t{\n";
+        if (i < apps.size()) {
+            for (const int id : apps[i]) out += "\t\t\t\"" + std::to_string(id) + "\"\t\t\"123456789\"\n";
+        }
+        out += "\t\t}\n\t}\n";
+    }
+    out += "}\n";
+    return out;
+}
+
+[[nodiscard]] std::string make_app_manifest(const int appid, const std::string_view installdir, const unsigned long long size_on_disk,
+                                            const unsigned long long buildid, const unsigned state_flags) {
+    const std::string id = std::to_string(appid);
+    std::string out = "\"AppState\"\n{\n";
+    out += "\t\"appid\"\t\t\"" + id + "\"\n";
+    out += "\t\"universe\"\t\t\"1\"\n";
+    out += "\t\"LauncherPath\"\t\t\"C:\\\\Program Files (x86)\\\\Steam\\\\steam.exe\"\n";
+    out += "\t\"name\"\t\t\"App " + id + "\"\n";
+    out += "\t\"StateFlags\"\t\t\"" + std::to_string(state_flags) + "\"\n";
+    out += "\t\"installdir\"\t\t\"" + vdf_escape(installdir) + "\"\n";
+    out += "\t\"LastUpdated\"\t\t\"1700000000\"\n";
+    out += "\t\"SizeOnDisk\"\t\t\"" + std::to_string(size_on_disk) + "\"\n";
+    out += "\t\"StagingSize\"\t\t\"0\"\n";
+    out += "\t\"buildid\"\t\t\"" + std::to_string(buildid) + "\"\n";
+    out += "\t\"LastOwner\"\t\t\"76561198000000000\"\n";
+    out += "\t\"AutoUpdateBehavior\"\t\t\"0\"\n";
+    out += "\t\"AllowOtherDownloadsWhileRunning\"\t\t\"0\"\n";
+    out += "\t\"ScheduledAutoUpdate\"\t\t\"0\"\n";
+    out += "\t\"InstalledDepots\"\n\t{\n";
+    out += "\t\t\"" + std::to_string(appid + 1) + "\"\n\t\t{\n\t\t\t\"manifest\"\t\t\"1234567890123456789\"\n\t\t\t\"size\"\t\t\"" +
+           std::to_string(size_on_disk) + "\"\n\t\t}\n";
+    out += "\t}\n";
+    out += "\t\"UserConfig\"\n\t{\n\t\t\"language\"\t\t\"english\"\n\t}\n";
+    out += "\t\"MountedConfig\"\n\t{\n\t\t\"language\"\t\t\"english\"\n\t}\n";
+    out += "}\n";
+    return out;
+}
+
+[[nodiscard]] std::string make_loginusers_vdf(const size_t users, const size_t most_recent) {
+    std::string out = "\"users\"\n{\n";
+    for (size_t i = 0; i < users; ++i) {
+        const std::string n = std::to_string(i);
+        out += "\t\"" + std::to_string(76561198000000000ull + i) + "\"\n\t{\n";
+        out += "\t\t\"AccountName\"\t\t\"player" + n + "\"\n";
+        out += "\t\t\"PersonaName\"\t\t\"Player \\\"" + n + "\\\"\"\n";
+        out += "\t\t\"RememberPassword\"\t\t\"1\"\n";
+        out += "\t\t\"WantsOfflineMode\"\t\t\"0\"\n";
+        out += "\t\t\"SkipOfflineModeWarning\"\t\t\"0\"\n";
+        out += "\t\t\"AllowAutoLogin\"\t\t\"1\"\n";
+        out += std::string("\t\t\"MostRecent\"\t\t\"") + (i == most_recent ? "1" : "0") + "\"\n";
+        out += "\t\t\"Timestamp\"\t\t\"" + std::to_string(1700000000 + i) + "\"\n";
+        out += "\t}\n";
+    }
+    out += "}\n";
+    return out;
+}
+
+[[nodiscard]] std::vector<std::string> make_path_corpus(const size_t count, const std::uint64_t seed) {
+    static constexpr const char* ROOTS[] = { "C:\\Program Files (x86)\\Steam", "D:\\SteamLibrary", "E:\\Spiele\\Steam",
+                                             "/home/player/.local/share/Steam" };
+    static constexpr const char* ASCII[] = { "steamapps", "common", "Spectre Divide", "Binaries", "Win64", "Content", "Paks" };
+    static constexpr const char* MIXED[] = { "Bibliothek \xC3\xA4\xC3\xB6\xC3\xBC", "Jeux Vid\xC3\xA9o",
+                                             "\xD0\x98\xD0\xB3\xD1\x80\xD1\x8B", "\xCE\xA0\xCE\xB1\xCE\xB9\xCF\x87\xCE\xBD\xCE\xAF\xCE\xB4\xCE\xB9\xCE\xB1",
+                                             "\xE3\x82\xB2\xE3\x83\xBC\xE3\x83\xA0", "\xE6\xB8\xB8\xE6\x88\x8F\xE5\xBA\x93",
+                                             "Games \xF0\x9F\x8E\xAE", "\xEA\xB2\x8C\xEC\x9E\x84 SSD" };
+    splitmix64 rng(seed);
+    std::vector<std::string> out;
+    out.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const bool ascii = rng.below(4) == 0;
+        const char* root = ROOTS[rng.below(std::size(ROOTS))];
+        const char sep = root[0] == '/' ? '/' : '\\';
+        std::string p = root;
+        const size_t parts = 2 + rng.below(4);
+        for (size_t k = 0; k < parts; ++k) {
+            p += sep;
+            p += ascii || rng.below(3) ? ASCII[rng.below(std::size(ASCII))] : MIXED[rng.below(std::size(MIXED))];
+        }
+        out.push_back(std::move(p));
+    }
+    return out;
+}
+
+[[nodiscard]] steam_tree make_steam_tree(const fs::path& root, const int libraries, const int apps_per_library, const std::uint64_t seed) {
+    splitmix64 rng(seed);
+    steam_tree t;
+    t.steam = root / "Steam";
+    std::vector<std::string> paths;
+    std::vector<std::vector<int>> apps;
+    int next = 1000;
+    for (int l = 0; l < libraries; ++l) {
+        const fs::path lib = l == 0 ? t.steam : root / ("Library" + std::to_string(l));
+        t.libraries.push_back(lib);
+        paths.push_back(lib.string());
+        auto& ids = apps.emplace_back();
+        std::error_code ec;
+        fs::create_directories(lib / "steamapps" / "common", ec);
+        for (int a = 0; a < apps_per_library; ++a) {
+            const int id = next++;
+            const std::string dir = "Game " + std::to_string(id);
+            ids.push_back(id);
+            t.appids.push_back(id);
+            write_file(lib / "steamapps" / ("appmanifest_" + std::to_string(id) + ".acf"),
+                       make_app_manifest(id, dir, 1000000 + rng.below(1ull << 34), 10000000 + rng.below(1000000)));
+            fs::create_directories(lib / "steamapps" / "common" / dir, ec);
+        }
+    }
+    write_file(t.steam / "steamapps" / "libraryfolders.vdf", make_libraryfolders_vdf(paths, apps));
+    return t;
+}
+
+[[nodiscard]] std::vector<wchar_t> make_env_block(const size_t vars, const std::uint64_t seed) {
+    splitmix64 rng(seed);
+    std::vector<wchar_t> out;
+    for (size_t i = 0; i < vars; ++i) {
+        wstr entry = L"VAR_" + std::to_wstring(rng.next() % 100000) + L"_" + std::to_wstring(i) + L"=";
+        const size_t len = 8 + rng.below(120);
+        for (size_t c = 0; c < len; ++c) entry.push_back(static_cast<wchar_t>(L'a' + rng.below(26)));
+        out.insert(out.end(), entry.begin(), entry.end());
+        out.push_back(L'\0');
+    }
+    out.push_back(L'\0');
+    return out;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// generated inputs shared by the tests and the benchmarks. everything is seeded so a run sees the same bytes
+// on every machine, nothing here reads the real steam install or the real launcher data dir
+
+// small fast prng, plenty for making up file contents
+struct splitmix64 {
+    std::uint64_t s;
+    explicit splitmix64(const std::uint64_t seed) : s(seed) {}
+    std::uint64_t next();
+    // uniform in [0, n)
+    std::uint64_t below(std::uint64_t n);
+};
+
+// a fresh directory under the temp dir, removed with everything in it when this goes away
+struct temp_dir {
+    fs::path path;
+    explicit temp_dir(std::string_view tag);
+    ~temp_dir();
+    temp_dir(const temp_dir&) = delete;
+    temp_dir& operator=(const temp_dir&) = delete;
+};
+
+void set_env(const char* name, const std::string& value);
+
+// creates the parent dirs too. false if anything failed
+bool write_file(const fs::path& p, std::string_view data);
+
+// incompressible
+[[nodiscard]] std::string random_bytes(size_t n, std::uint64_t seed);
+// looks a bit like x64 code: short repeated instruction patterns with random immediates, compresses and deltas
+// the way a real dll does
+[[nodiscard]] std::string code_like_bytes(size_t n, std::uint64_t seed);
+
+// libraryfolders.vdf in the current (block) format, one entry per path with apps[i] listed under it
+[[nodiscard]] std::string make_libraryfolders_vdf(const std::vector<std::string>& paths, const std::vector<std::vector<int>>& apps);
+// appmanifest_<appid>.acf with the fields steam writes and a few it always has that we dont read
+[[nodiscard]] std::string make_app_manifest(int appid, std::string_view installdir, unsigned long long size_on_disk,
+                                            unsigned long long buildid, unsigned state_flags = 4);
+
+// config/loginusers.vdf with users accounts starting at steamid64 76561198000000000, the one at most_recent
+// flagged mostrecent (none when its past the end)
+[[nodiscard]] std::string make_loginusers_vdf(size_t users, size_t most_recent);
+
+// library and install paths in utf8 the way players name them: mostly ascii, then latin accents, cyrillic, greek,
+// cjk and the odd emoji. about one in four is pure ascii, the rest mix scripts inside a component
+[[nodiscard]] std::vector<std::string> make_path_corpus(size_t count, std::uint64_t seed);
+
+struct steam_tree {
+    fs::path steam;                   // the steam install, also library 0
+    std::vector<fs::path> libraries;  // every library including the steam install
+    std::vector<int> appids;          // every app installed somewhere, in creation order
+};
+
+// steam at root/Steam plus libraries-1 extra libraries, each with apps_per_library manifests and install dirs.
+// appids start at 1000 and are unique across the tree
+[[nodiscard]] steam_tree make_steam_tree(const fs::path& root, int libraries, int apps_per_library, std::uint64_t seed);
+
+// vars random NAME=value entries in the GetEnvironmentStringsW layout, double null terminated
+[[nodiscard]] std::vector<wchar_t> make_env_block(size_t vars, std::uint64_t seed);
\ No newline at end of file
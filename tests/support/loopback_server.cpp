@@ -0,0 +1,252 @@
+#include "loopback_server.h"
+#include "utf.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    using sock = SOCKET;
+    inline constexpr int SEND_FLAGS = 0;
+    void close_socket(const std::intptr_t s) { closesocket(static_cast<sock>(s)); }
+    void shutdown_socket(const std::intptr_t s) { shutdown(static_cast<sock>(s), SD_BOTH); }
+    [[nodiscard]] bool net_init() {
+        static const bool ok = [] {
+            WSADATA d;
+            return WSAStartup(MAKEWORD(2, 2), &d) == 0;
+        }();
+        return ok;
+    }
+#else
+    using sock = int;
+    inline constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+    void close_socket(const std::intptr_t s) { ::close(static_cast<sock>(s)); }
+    void shutdown_socket(const std::intptr_t s) { ::shutdown(static_cast<sock>(s), SHUT_RDWR); }
+    [[nodiscard]] bool net_init() { return true; }
+#endif
+
+    [[nodiscard]] bool send_all(const std::intptr_t fd, const char* data, size_t len) {
+        while (len) {
+            const auto n = ::send(static_cast<sock>(fd), data, static_cast<int>(std::min<size_t>(len, 1 << 20)), SEND_FLAGS);
+            if (n <= 0) return false;
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool iequals(const std::string_view a, const std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const char x, const char y) {
+            return (x | 0x20) == (y | 0x20);
+        });
+    }
+
+    // "bytes=a-b" or "bytes=a-" against a body of size total, inclusive last. false if its not something we serve
+    [[nodiscard]] bool parse_range(const std::string_view v, const size_t total, size_t& first, size_t& last) {
+        if (!v.starts_with("bytes=") || total == 0) return false;
+        const std::string spec(v.substr(6));
+        char* end = nullptr;
+        first = std::strtoull(spec.c_str(), &end, 10);
+        if (end == spec.c_str() || *end != '-' || first >= total) return false;
+        const char* second = end + 1;
+        last = *second ? std::strtoull(second, &end, 10) : total - 1;
+        if (last >= total) last = total - 1;
+        return last >= first;
+    }
+
+    // writes body[from, to) paced to bytes_per_sec, counting against the cut budget. false once the socket is gone or cut
+    [[nodiscard]] bool send_body(const std::intptr_t fd, const std::string_view body, const loopback_reply& rep, long long& budget) {
+        const auto start = std::chrono::steady_clock::now();
+        size_t off = 0;
+        while (off < body.size()) {
+            size_t n = std::min<size_t>(body.size() - off, 16 * 1024);
+            if (budget >= 0) n = std::min<size_t>(n, static_cast<size_t>(budget));
+            if (n == 0) return false;
+            if (!send_all(fd, body.data() + off, n)) return false;
+            off += n;
+            if (budget >= 0) budget -= static_cast<long long>(n);
+            if (rep.bytes_per_sec) {
+                std::this_thread::sleep_until(start + std::chrono::microseconds(off * 1'000'000 / rep.bytes_per_sec));
+            }
+        }
+        return true;
+    }
+} // anon namespace
+
+[[nodiscard]] std::optional<std::string_view> loopback_request::header(const std::string_view name) const {
+    for (const auto& [k, v] : headers) {
+        if (iequals(k, name)) return std::string_view(v);
+    }
+    return std::nullopt;
+}
+
+loopback_server::loopback_server(handler h) : handler_(std::move(h)) {
+    if (!net_init()) return;
+    const sock s = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s, 128) != 0 ||
+        ::getsockname(s, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        close_socket(static_cast<std::intptr_t>(s));
+        return;
+    }
+    listen_ = static_cast<std::intptr_t>(s);
+    port_ = ntohs(addr.sin_port);
+    acceptor_ = std::thread([this] { accept_loop(); });
+}
+
+loopback_server::~loopback_server() {
+    stopping_ = true;
+    if (listen_ != -1) {
+        shutdown_socket(listen_);
+        close_socket(listen_);
+    }
+    if (acceptor_.joinable()) acceptor_.join();
+    {
+        // wakes every connection thread out of its recv
+        std::scoped_lock lk(lock_);
+        for (const auto fd : open_) shutdown_socket(fd);
+    }
+    for (auto& t : workers_) t.join();
+}
+
+[[nodiscard]] wstr loopback_server::url(const std::wstring_view path) const {
+    return L"http://127.0.0.1:" + std::to_wstring(port_) + wstr(path);
+}
+
+void loopback_server::accept_loop() {
+    while (!stopping_) {
+        const sock c = ::accept(static_cast<sock>(listen_), nullptr, nullptr);
+#ifdef _WIN32
+        if (c == INVALID_SOCKET) return;
+#else
+        if (c < 0) return;
+#endif
+        const int one = 1;
+        ::setsockopt(c, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+        ++connections_;
+        const auto fd = static_cast<std::intptr_t>(c);
+        std::scoped_lock lk(lock_);
+        open_.push_back(fd);
+        workers_.emplace_back([this, fd] { serve(fd); });
+    }
+}
+
+void loopback_server::serve(const std::intptr_t fd) {
+    std::string in;
+    while (answer(fd, in)) {}
+    {
+        std::scoped_lock lk(lock_);
+        std::erase(open_, fd);
+    }
+    close_socket(fd);
+}
+
+// reads one request off fd (in carries whatever came after the previous one) and replies. false when the
+// connection should go away
+[[nodiscard]] bool loopback_server::answer(const std::intptr_t fd, std::string& in) {
+    char buf[16 * 1024];
+    const auto more = [&] {
+        const auto n = ::recv(static_cast<sock>(fd), buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        in.append(buf, static_cast<size_t>(n));
+        return true;
+    };
+    size_t end;
+    while ((end = in.find("\r\n\r\n")) == std::string::npos) {
+        if (!more()) return false;
+    }
+    loopback_request req;
+    const std::string_view head = std::string_view(in).substr(0, end);
+    size_t eol = head.find("\r\n");
+    const std::string_view first = head.substr(0, eol);
+    const auto sp1 = first.find(' ');
+    const auto sp2 = first.find(' ', sp1 + 1);
+    req.method = first.substr(0, sp1);
+    req.target = first.substr(sp1 + 1, sp2 - sp1 - 1);
+    while (eol != std::string_view::npos) {
+        const size_t from = eol + 2;
+        eol = head.find("\r\n", from);
+        const std::string_view l = head.substr(from, eol == std::string_view::npos ? std::string_view::npos : eol - from);
+        const auto colon = l.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view v = l.substr(colon + 1);
+        while (!v.empty() && v.front() == ' ') v.remove_prefix(1);
+        req.headers.emplace_back(std::string(l.substr(0, colon)), std::string(v));
+    }
+    in.erase(0, end + 4);
+    size_t bodyLen = 0;
+    if (const auto cl = req.header("Content-Length")) bodyLen = std::strtoull(std::string(*cl).c_str(), nullptr, 10);
+    while (in.size() < bodyLen) {
+        if (!more()) return false;
+    }
+    req.body = in.substr(0, bodyLen);
+    in.erase(0, bodyLen);
+    ++requests_;
+
+    loopback_reply rep = handler_(req);
+    std::string_view body = rep.body;
+    unsigned status = rep.status;
+    std::string extra;
+    if (rep.ranges && status == 200) {
+        const auto range = req.header("Range");
+        const auto ifRange = req.header("If-Range");
+        std::optional<std::string_view> etag;
+        for (const auto& [k, v] : rep.headers) {
+            if (iequals(k, "ETag")) etag = v;
+        }
+        size_t a = 0, b = 0;
+        const bool stale = ifRange && (!etag || *ifRange != *etag);
+        if (range && !stale && parse_range(*range, rep.body.size(), a, b)) {
+            status = 206;
+            extra += "Content-Range: bytes " + std::to_string(a) + "-" + std::to_string(b) + "/" + std::to_string(rep.body.size()) + "\r\n";
+            body = body.substr(a, b - a + 1);
+        }
+        extra += "Accept-Ranges: bytes\r\n";
+    }
+    const bool isHead = req.method == "HEAD";
+    std::string out = "HTTP/1.1 " + std::to_string(status) + " X\r\n";
+    for (const auto& [k, v] : rep.headers) out += k + ": " + v + "\r\n";
+    out += extra;
+    if (rep.chunked) out += "Transfer-Encoding: chunked\r\n";
+    else if (status != 204 && status != 304) out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    if (rep.close) out += "Connection: close\r\n";
+    out += "\r\n";
+    if (!send_all(fd, out.data(), out.size())) return false;
+    long long budget = rep.cut_after;
+    if (!isHead && status != 204 && status != 304) {
+        if (rep.chunked) {
+            // a few chunks of uneven size so the client has to stitch them back together
+            size_t off = 0, piece = 1;
+            while (off < body.size()) {
+                const size_t n = std::min(piece, body.size() - off);
+                char len[32];
+                std::snprintf(len, sizeof(len), "%zx\r\n", n);
+                if (!send_all(fd, len, std::strlen(len)) || !send_body(fd, body.substr(off, n), rep, budget) || !send_all(fd, "\r\n", 2)) return false;
+                off += n;
+                piece = piece * 7 + 3;
+            }
+            if (!send_all(fd, "0\r\n\r\n", 5)) return false;
+        } else if (!send_body(fd, body, rep, budget)) {
+            return false;
+        }
+    }
+    return !rep.close;
+}
\ No newline at end of file
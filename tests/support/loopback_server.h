@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// a local http/1.1 server on 127.0.0.1 and an ephemeral port, for exercising the http client, the downloader
+// and the backend bench without any network. keep-alive, one thread per connection, every request goes to a
+// handler that says what to send back. the reply can also be throttled, cut off mid body, or served in ranges
+
+struct loopback_request {
+    std::string method;
+    std::string target;  // path + query as sent
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+
+    // first header with that name, case insensitive
+    [[nodiscard]] std::optional<std::string_view> header(std::string_view name) const;
+};
+
+struct loopback_reply {
+    unsigned status = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    // answers Range: bytes=a-b (and a-) out of body with a 206. an If-Range that doesnt match the ETag header
+    // gets the whole body as a 200, like a real server does when the file changed
+    bool ranges = false;
+    // 0 means as fast as the socket takes it
+    unsigned long long bytes_per_sec = 0;
+    // closes the connection after this many body bytes, -1 sends it all
+    long long cut_after = -1;
+    bool chunked = false;
+    // Connection: close, the socket goes away after this reply
+    bool close = false;
+};
+
+class loopback_server {
+public:
+    using handler = std::function<loopback_reply(const loopback_request&)>;
+
+    explicit loopback_server(handler h);
+    ~loopback_server();
+    loopback_server(const loopback_server&) = delete;
+    loopback_server& operator=(const loopback_server&) = delete;
+
+    [[nodiscard]] unsigned short port() const { return port_; }
+    // http://127.0.0.1:<port><path>
+    [[nodiscard]] wstr url(std::wstring_view path = L"/") const;
+
+    [[nodiscard]] unsigned long long requests() const { return requests_; }
+    // accepted sockets, so tests can tell keep-alive reuse from fresh connects
+    [[nodiscard]] unsigned long long connections() const { return connections_; }
+
+private:
+    void accept_loop();
+    void serve(std::intptr_t fd);
+    [[nodiscard]] bool answer(std::intptr_t fd, std::string& in);
+
+    handler handler_;
+    std::intptr_t listen_ = -1;
+    unsigned short port_ = 0;
+    std::atomic<bool> stopping_{ false };
+    std::atomic<unsigned long long> requests_{ 0 };
+    std::atomic<unsigned long long> connections_{ 0 };
+    std::mutex lock_;
+    std::vector<std::intptr_t> open_;
+    std::vector<std::thread> workers_;
+    std::thread acceptor_;
+};
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "test.h"
+#include "task_graph.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+    using steady = std::chrono::steady_clock;
+    using ms = std::chrono::milliseconds;
+
+    // a mock stage: sleeps for its delay (waking early on a stop), logs when it started and ended
+    struct stage_log {
+        std::mutex lock;
+        std::vector<std::pair<std::string, steady::time_point>> events;
+
+        void note(std::string what) {
+            std::scoped_lock lk(lock);
+            events.emplace_back(std::move(what), steady::now());
+        }
+
+        [[nodiscard]] std::optional<size_t> index(const std::string& what) {
+            std::scoped_lock lk(lock);
+            for (size_t i = 0; i < events.size(); ++i) {
+                if (events[i].first == what) return i;
+            }
+            return std::nullopt;
+        }
+    };
+
+    // false when the sleep was cut short by a stop
+    [[nodiscard]] bool nap(const ms delay, const std::stop_token st) {
+        const auto until = steady::now() + delay;
+        while (steady::now() < until) {
+            if (st.stop_requested()) return false;
+            std::this_thread::sleep_for(ms(2));
+        }
+        return true;
+    }
+
+    [[nodiscard]] auto mock(stage_log& log, std::string name, const ms delay, const int rc = 0) {
+        return [&log, name = std::move(name), delay, rc](const std::stop_token st) -> stage_result<int> {
+            log.note(name + " start");
+            const bool full = nap(delay, st);
+            log.note(name + (full ? " end" : " stopped"));
+            if (rc) return std::unexpected(rc);
+            return static_cast<int>(delay.count());
+        };
+    }
+} // anon namespace
+
+TEST(task_graph, independent_stages_overlap) {
+    // the launch shape: steam, discovery and the update check side by side, launch after all of them.
+    // critical path is the slowest stage, not the sum
+    stage_log log;
+    task_graph g(4);
+    const auto steam = g.add(mock(log, "steam", ms(300)));
+    const auto discover = g.add(mock(log, "discover", ms(100)));
+    const auto update = g.add(mock(log, "update", ms(200)));
+    const auto launch = g.add([&](std::stop_token) -> stage_result<int> {
+        log.note("launch start");
+        return steam.get() + discover.get() + update.get();
+    }, { steam.id, discover.id, update.id });
+    const auto start = steady::now();
+    CHECK_EQ(g.run(), 0);
+    const auto took = steady::now() - start;
+    CHECK_EQ(launch.get(), 600);
+    CHECK(took >= ms(300));
+    CHECK(took < ms(500));
+    // launch only once every dependency has ended
+    const auto at = log.index("launch start");
+    REQUIRE(at.has_value());
+    for (const char* dep : { "steam end", "discover end", "update end" }) CHECK(log.index(dep) < at);
+}
+
+TEST(task_graph, chains_run_in_order) {
+    // a diamond plus a tail: a -> b, a -> c, b + c -> d -> e
+    stage_log log;
+    task_graph g(4);
+    const auto a = g.add(mock(log, "a", ms(20)));
+    const auto b = g.add(mock(log, "b", ms(40)), { a.id });
+    const auto c = g.add(mock(log, "c", ms(10)), { a.id });
+    const auto d = g.add(mock(log, "d", ms(10)), { b.id, c.id });
+    const auto e = g.add([&](std::stop_token) -> stage_result<std::string> {
+        log.note("e start");
+        return std::to_string(a.get() + b.get() + c.get() + d.get());
+    }, { d.id });
+    CHECK_EQ(g.run(), 0);
+    CHECK_EQ(e.get(), std::string("80"));
+    CHECK(log.index("a end") < log.index("b start"));
+    CHECK(log.index("a end") < log.index("c start"));
+    CHECK(log.index("b end") < log.index("d start"));
+    CHECK(log.index("c end") < log.index("d start"));
+    CHECK(log.index("d end") < log.index("e start"));
+}
+
+TEST(task_graph, failure_cancels_the_rest) {
+    // the update fails fast: steam stops waiting, launch never runs, the update exit code comes back
+    stage_log log;
+    task_graph g(4);
+    const auto steam = g.add(mock(log, "steam", ms(5000)));
+    const auto update = g.add(mock(log, "update", ms(50), 7));
+    const auto install = g.add(mock(log, "install", ms(10)), { update.id });
+    (void)g.add(mock(log, "launch", ms(10)), { steam.id, install.id });
+    const auto start = steady::now();
+    CHECK_EQ(g.run(), 7);
+    CHECK(steady::now() - start < ms(1000));
+    CHECK(log.index("steam stopped").has_value());
+    CHECK(!log.index("install start").has_value());
+    CHECK(!log.index("launch start").has_value());
+}
+
+TEST(task_graph, first_added_failure_wins) {
+    // b fails first in time, but a sequential wmain would have run a first and returned its code
+    stage_log log;
+    task_graph g(2);
+    (void)g.add([](std::stop_token) -> stage_result<int> {
+        std::this_thread::sleep_for(ms(80));
+        return std::unexpected(3);
+    });
+    (void)g.add(mock(log, "b", ms(10), 5));
+    CHECK_EQ(g.run(), 3);
+}
+
+TEST(task_graph, queued_stages_never_start_after_a_failure) {
+    // one thread, so the later roots are still queued when the first one fails
+    stage_log log;
+    task_graph g(1);
+    (void)g.add(mock(log, "a", ms(10), 2));
+    std::atomic<int> ran{ 0 };
+    for (int i = 0; i < 4; ++i) {
+        (void)g.add([&ran](const std::stop_token st) -> stage_result<int> {
+            if (st.stop_requested()) return std::unexpected(9);
+            ++ran;
+            return 0;
+        });
+    }
+    CHECK_EQ(g.run(), 2);
+    CHECK_EQ(ran.load(), 0);
+}
+
+TEST(task_graph, stealing_covers_every_index_once) {
+    // uneven items, the slow ones all at the front of the first slice
+    std::vector<std::atomic<int>> hits(1000);
+    parallel_for_stealing(hits.size(), 4, [&](const size_t i) {
+        if (i < 8) std::this_thread::sleep_for(ms(5));
+        ++hits[i];
+    });
+    bool once = true;
+    for (const auto& h : hits) once = once && h == 1;
+    CHECK(once);
+    parallel_for_stealing(0, 4, [](size_t) { CHECK(false); });
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+// tiny in-tree test runner so the tests build anywhere the launcher does without pulling anything in.
+// TEST(suite, name) registers itself, CHECK records a failure and keeps going, REQUIRE gives up on the test
+
+struct test_case {
+    const char* suite;
+    const char* name;
+    void (*fn)();
+};
+
+[[nodiscard]] std::vector<test_case>& test_registry();
+
+struct test_register {
+    test_register(const char* suite, const char* name, void (*fn)()) { test_registry().push_back({ suite, name, fn }); }
+};
+
+// thrown by REQUIRE, caught by the runner
+struct test_abort {};
+
+void test_fail(const char* file, int line, const char* expr);
+
+#define TEST(suite, name)                                                                     \
+    static void test_##suite##_##name();                                                      \
+    static const test_register test_reg_##suite##_##name(#suite, #name, &test_##suite##_##name); \
+    static void test_##suite##_##name()
+
+#define CHECK(cond)                                                 \
+    do {                                                            \
+        if (!(cond)) test_fail(__FILE__, __LINE__, #cond);          \
+    } while (0)
+
+#define REQUIRE(cond)                                               \
+    do {                                                            \
+        if (!(cond)) {                                              \
+            test_fail(__FILE__, __LINE__, #cond);                   \
+            throw test_abort{};                                     \
+        }                                                           \
+    } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include <cstring>
+#include <exception>
+#include <string_view>
+
+// SpectreLauncherTests [suite | suite.name]...  runs everything when nothing is given, ctest runs one suite per test
+
+namespace {
+    int g_failures = 0;
+
+    [[nodiscard]] bool selected(const test_case& t, const int argc, char** argv) {
+        if (argc < 2) return true;
+        const std::string_view suite = t.suite;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view want = argv[i];
+            if (want == suite) return true;
+            if (want.size() > suite.size() && want.starts_with(suite) && want[suite.size()] == '.' && want.substr(suite.size() + 1) == t.name) return true;
+        }
+        return false;
+    }
+} // anon namespace
+
+[[nodiscard]] std::vector<test_case>& test_registry() {
+    static std::vector<test_case> r;
+    return r;
+}
+
+void test_fail(const char* file, const int line, const char* expr) {
+    ++g_failures;
+    std::fprintf(stderr, "  %s:%d: CHECK failed: %s\n", file, line, expr);
+}
+
+int main(const int argc, char** argv) {
+    // nothing under test gets to touch the real launcher data dir
+    const temp_dir data("data");
+    set_env("SPECTRE_DATA_DIR", data.path.string());
+
+    int ran = 0, failed = 0;
+    for (const test_case& t : test_registry()) {
+        if (!selected(t, argc, argv)) continue;
+        ++ran;
+        const int before = g_failures;
+        try {
+            t.fn();
+        } catch (const test_abort&) {
+        } catch (const std::exception& e) {
+            ++g_failures;
+            std::fprintf(stderr, "  threw: %s\n", e.what());
+        }
+        const bool ok = g_failures == before;
+        if (!ok) ++failed;
+        std::printf("[%s] %s.%s\n", ok ? " ok " : "FAIL", t.suite, t.name);
+        std::fflush(stdout);
+    }
+    if (ran == 0) {
+        std::fprintf(stderr, "No tests matched.\n");
+        return 2;
+    }
+    std::printf("%d/%d passed\n", ran - failed, ran);
+    return failed ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "file_utils.h"
+#include "trace.h"
+#include <thread>
+
+TEST(trace, off_records_nothing) {
+    const temp_dir dir("trace");
+    const fs::path out = dir.path / "trace.json";
+    trace_stop();
+    {
+        TRACE_SCOPE("never");
+        trace_counter("never either", 1);
+    }
+    trace_write();
+    CHECK(!trace_enabled());
+    std::error_code ec;
+    CHECK(!fs::exists(out, ec));
+}
+
+TEST(trace, writes_spans_counters_and_threads) {
+    const temp_dir dir("trace");
+    const fs::path out = dir.path / "trace.json";
+    trace_start(out);
+    {
+        TRACE_SCOPE("outer \"quoted\"");
+        std::thread([] { TRACE_SCOPE("on a worker"); }).join();
+        trace_counter("bytes", 4096);
+    }
+    trace_write();
+    trace_stop();
+    const auto json = read_file_bytes(out);
+    REQUIRE(json.has_value());
+    CHECK(json->starts_with("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+    CHECK(json->find(R"("name":"outer \"quoted\"","cat":"launch","ph":"X")") != std::string::npos);
+    CHECK(json->find(R"("name":"on a worker")") != std::string::npos);
+    CHECK(json->find(R"("ph":"C")") != std::string::npos);
+    CHECK(json->find(R"("args":{"value":4096})") != std::string::npos);
+    CHECK(json->find(R"("args":{"name":"main"})") != std::string::npos);
+    CHECK(json->find(R"("args":{"name":"worker )") != std::string::npos);
+
+    // stopping drops what was recorded, the next run starts empty
+    trace_start(out);
+    trace_write();
+    trace_stop();
+    const auto empty = read_file_bytes(out);
+    REQUIRE(empty.has_value());
+    CHECK(empty->find("outer") == std::string::npos);
+}
\ No newline at end of file
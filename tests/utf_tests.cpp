@@ -0,0 +1,116 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "utf.h"
+
+namespace {
+    [[nodiscard]] bool widens_to_nothing(const std::string_view s) {
+        return !widen_utf8(s).has_value();
+    }
+} // anon namespace
+
+TEST(utf, known_strings_both_ways) {
+    const std::pair<std::string_view, std::wstring_view> cases[] = {
+        { "", L"" },
+        { "D:\\SteamLibrary", L"D:\\SteamLibrary" },
+        { "E:\\Spiele\\Bibliothek \xC3\xA4\xC3\xB6\xC3\xBC", L"E:\\Spiele\\Bibliothek \u00e4\u00f6\u00fc" },
+        { "\xD0\x98\xD0\xB3\xD1\x80\xD1\x8B", L"\u0418\u0433\u0440\u044b" },
+        { "\xE3\x82\xB2\xE3\x83\xBC\xE3\x83\xA0", L"\u30b2\u30fc\u30e0" },
+        { "Games \xF0\x9F\x8E\xAE", L"Games \U0001F3AE" },
+        { "\xEF\xBF\xBF\xF4\x8F\xBF\xBF", L"\uffff\U0010FFFF" },
+    };
+    for (const auto& [narrow, wide] : cases) {
+        CHECK(widen_utf8(narrow) == std::wstring(wide));
+        CHECK(narrow_utf8(wide) == std::string(narrow));
+    }
+}
+
+TEST(utf, astral_code_points_match_wchar_t) {
+    // utf16 on windows, one utf32 unit where wchar_t is 4 bytes, which is what a wide string means to the c library there
+    const auto w = widen_utf8("\xF0\x9F\x8E\xAE");
+    REQUIRE(w.has_value());
+    if constexpr (sizeof(wchar_t) == 2) {
+        REQUIRE(w->size() == 2);
+        CHECK_EQ(static_cast<unsigned>((*w)[0]), 0xD83Cu);
+        CHECK_EQ(static_cast<unsigned>((*w)[1]), 0xDFAEu);
+    } else {
+        REQUIRE(w->size() == 1);
+        CHECK_EQ(static_cast<unsigned>((*w)[0]), 0x1F3AEu);
+    }
+}
+
+TEST(utf, path_corpus_round_trips) {
+    for (const auto& p : make_path_corpus(2000, 1)) {
+        const auto w = widen_utf8(p);
+        REQUIRE(w.has_value());
+        CHECK(narrow_utf8(*w) == p);
+        CHECK(w->size() <= utf16_max_units(p.size()));
+        CHECK(p.size() <= utf8_max_bytes(w->size()));
+    }
+}
+
+TEST(utf, non_ascii_anywhere_around_the_fast_path) {
+    // one two byte and one four byte character at every spot in and around a 16 unit block
+    for (const std::string_view odd : { std::string_view("\xC3\xA9"), std::string_view("\xF0\x9F\x8E\xAE") }) {
+        for (size_t len = 0; len < 40; ++len) {
+            for (size_t at = 0; at <= len; ++at) {
+                std::string s(len, 'a');
+                s.insert(at, odd);
+                const auto w = widen_utf8(s);
+                REQUIRE(w.has_value());
+                CHECK(narrow_utf8(*w) == s);
+            }
+        }
+    }
+}
+
+TEST(utf, malformed_utf8_is_rejected) {
+    CHECK(widens_to_nothing("\x80"));                  // continuation with no lead
+    CHECK(widens_to_nothing("\xC3"));                  // truncated at the end
+    CHECK(widens_to_nothing("\xE2\x82"));
+    CHECK(widens_to_nothing("\xC3\x28"));              // lead followed by ascii
+    CHECK(widens_to_nothing("\xC0\xAF"));              // overlong '/'
+    CHECK(widens_to_nothing("\xE0\x80\xAF"));
+    CHECK(widens_to_nothing("\xF0\x80\x80\xAF"));
+    CHECK(widens_to_nothing("\xED\xA0\x80"));          // an encoded surrogate
+    CHECK(widens_to_nothing("\xED\xBF\xBF"));
+    CHECK(widens_to_nothing("\xF4\x90\x80\x80"));      // past U+10FFFF
+    CHECK(widens_to_nothing("\xF5\x80\x80\x80"));
+    CHECK(widens_to_nothing("\xFF"));
+    // the bad byte in the middle of what would otherwise be an ascii block
+    CHECK(widens_to_nothing("0123456789abc\x80" "def0123456789"));
+    CHECK(widens_to_nothing("0123456789abcdef0123456789abcde\xC3"));
+}
+
+TEST(utf, malformed_wide_is_rejected) {
+    CHECK(!narrow_utf8(std::wstring(1, static_cast<wchar_t>(0xD800))).has_value());
+    CHECK(!narrow_utf8(std::wstring(1, static_cast<wchar_t>(0xDC00))).has_value());
+    CHECK(!narrow_utf8(L"abc" + std::wstring(1, static_cast<wchar_t>(0xDBFF)) + L"def").has_value());
+    CHECK(!narrow_utf8(std::wstring(2, static_cast<wchar_t>(0xDC00))).has_value());
+    if constexpr (sizeof(wchar_t) == 4) {
+        // a utf16 pair pushed into utf32 units is still two lone surrogates
+        const wchar_t pair[] = { static_cast<wchar_t>(0xD83C), static_cast<wchar_t>(0xDFAE) };
+        CHECK(!narrow_utf8(std::wstring_view(pair, 2)).has_value());
+        CHECK(!narrow_utf8(std::wstring(1, static_cast<wchar_t>(0x110000))).has_value());
+    }
+}
+
+TEST(utf, fixed_buffers_never_overrun) {
+    const std::string s = "Spiele \xC3\xA4 \xF0\x9F\x8E\xAE";
+    const auto w = widen_utf8(s);
+    REQUIRE(w.has_value());
+    std::wstring wbuf(w->size() + 4, L'#');
+    CHECK(utf8_to_utf16(s, std::span(wbuf.data(), w->size())) == w->size());
+    CHECK(wbuf.substr(0, w->size()) == *w);
+    CHECK(!utf8_to_utf16(s, std::span(wbuf.data(), w->size() - 1)).has_value());
+    CHECK(wbuf.substr(w->size()) == L"####");
+
+    std::string nbuf(s.size() + 4, '#');
+    CHECK(utf16_to_utf8(*w, std::span(nbuf.data(), s.size())) == s.size());
+    CHECK(nbuf.substr(0, s.size()) == s);
+    CHECK(!utf16_to_utf8(*w, std::span(nbuf.data(), s.size() - 1)).has_value());
+    CHECK(nbuf.substr(s.size()) == "####");
+
+    // 20 ascii into 17 units: the block fits, the tail doesnt
+    std::wstring small(17, L'#');
+    CHECK(!utf8_to_utf16(std::string(20, 'x'), small).has_value());
+}
\ No newline at end of file
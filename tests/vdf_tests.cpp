@@ -0,0 +1,113 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "steam_library.h"
+#include "utf.h"
+#include "vdf.h"
+
+TEST(vdf, nested_blocks_and_case_insensitive_keys) {
+    const auto root = vdf_parse("\"AppState\"\n{\n\t\"appid\"\t\t\"42\"\n\t\"UserConfig\"\n\t{\n\t\t\"Language\"\t\"english\"\n\t}\n}\n");
+    REQUIRE(root.has_value());
+    const vdf_node* app = root->find("appstate");
+    REQUIRE(app && app->is_block);
+    CHECK(app->get("APPID") == "42");
+    const vdf_node* cfg = app->find("userconfig");
+    REQUIRE(cfg && cfg->is_block);
+    CHECK(cfg->get("language") == "english");
+    // a block isnt a value and a missing key is nothing
+    CHECK(!app->get("UserConfig").has_value());
+    CHECK(!app->get("buildid").has_value());
+}
+
+TEST(vdf, values_point_into_the_buffer) {
+    const std::string txt = "\"a\" \"one\" \"b\" { \"c\" \"two\" }";
+    const auto root = vdf_parse(txt);
+    REQUIRE(root.has_value());
+    const std::string_view one = root->find("a")->value;
+    CHECK(one == "one");
+    CHECK(one.data() >= txt.data() && one.data() + one.size() <= txt.data() + txt.size());
+}
+
+TEST(vdf, escapes_stay_raw_until_asked) {
+    const auto root = vdf_parse(R"("k" "C:\\Games\\Steam \"Library\"\tx\q")");
+    REQUIRE(root.has_value());
+    CHECK(root->find("k")->value == R"(C:\\Games\\Steam \"Library\"\tx\q)");
+    CHECK(root->get("k") == "C:\\Games\\Steam \"Library\"\tx\\q");
+    CHECK(vdf_unescape("no escapes") == "no escapes");
+}
+
+TEST(vdf, comments_conditionals_bom_and_bare_tokens) {
+    const auto root = vdf_parse("\xEF\xBB\xBF// written by hand\n\"root\"\n{\n\tkey value // trailing\n\t\"win\" \"1\" [$WIN32]\n"
+                                "\t\"block\" [$!X360]\n\t{\n\t}\n}\n");
+    REQUIRE(root.has_value());
+    const vdf_node* r = root->find("root");
+    REQUIRE(r && r->children.size() == 3);
+    CHECK(r->get("key") == "value");
+    CHECK(r->get("win") == "1");
+    CHECK(r->find("block") && r->find("block")->is_block && r->find("block")->children.empty());
+}
+
+TEST(vdf, broken_documents_are_rejected) {
+    CHECK(!vdf_parse("\"a\" { \"b\" \"c\"").has_value());
+    CHECK(!vdf_parse("\"a\" \"b\" }").has_value());
+    CHECK(!vdf_parse("\"a\" \"unterminated").has_value());
+    CHECK(!vdf_parse("\"a\"").has_value());
+    CHECK(!vdf_parse("{ }").has_value());
+    // nesting deep enough to be an attack rather than a config file
+    std::string deep;
+    for (int i = 0; i < 1000; ++i) deep += "\"k\" { ";
+    for (int i = 0; i < 1000; ++i) deep += "} ";
+    CHECK(!vdf_parse(deep).has_value());
+    CHECK(vdf_parse("").has_value());
+}
+
+TEST(vdf, library_roots_from_a_steam_tree) {
+    const temp_dir dir("vdf_libraries");
+    const steam_tree tree = make_steam_tree(dir.path, 4, 2, 1);
+    const auto roots = get_library_roots(tree.steam.wstring());
+    // steam itself comes first and isnt listed twice even though libraryfolders.vdf has it as library 0
+    REQUIRE(roots.size() == tree.libraries.size());
+    for (size_t i = 0; i < roots.size(); ++i) CHECK(fs::path(roots[i]) == tree.libraries[i]);
+}
+
+TEST(vdf, library_roots_old_format_and_unicode) {
+    const temp_dir dir("vdf_libraries_old");
+    const fs::path steam = dir.path / "Steam";
+    // the pre 2021 flat layout, next to a new style block and a path thats not ascii
+    REQUIRE(write_file(steam / "steamapps" / "libraryfolders.vdf",
+                       "\"LibraryFolders\"\n{\n\t\"TimeNextStatsReport\"\t\t\"1700000000\"\n\t\"ContentStatsID\"\t\t\"-1\"\n"
+                       "\t\"1\"\t\t\"/mnt/games/SteamLibrary/\"\n"
+                       "\t\"2\"\n\t{\n\t\t\"path\"\t\t\"/mnt/spiele/Bibliothek \xC3\xA4\"\n\t}\n}\n"));
+    const auto roots = get_library_roots(steam.wstring());
+    REQUIRE(roots.size() == 3);
+    CHECK(fs::path(roots[1]) == fs::path("/mnt/games/SteamLibrary"));
+    CHECK(roots[2] == widen_utf8("/mnt/spiele/Bibliothek \xC3\xA4"));
+}
+
+TEST(vdf, app_manifest_fields) {
+    const temp_dir dir("vdf_acf");
+    const fs::path acf = dir.path / "appmanifest_2641470.acf";
+    REQUIRE(write_file(acf, make_app_manifest(2641470, "Spectre \"Divide\"", 31'000'000'000ull, 15123456, 6)));
+    const auto m = read_app_manifest(acf);
+    REQUIRE(m.has_value());
+    CHECK(m->installdir == "Spectre \"Divide\"");
+    CHECK_EQ(m->size_on_disk, 31'000'000'000ull);
+    CHECK_EQ(m->buildid, 15123456ull);
+    CHECK_EQ(m->state_flags, 6u);
+    CHECK(get_install_dir_from_manifest(acf) == "Spectre \"Divide\"");
+
+    // no installdir is as good as no manifest
+    REQUIRE(write_file(acf, "\"AppState\" { \"appid\" \"1\" }"));
+    CHECK(!read_app_manifest(acf).has_value());
+    CHECK(!get_install_dir_from_manifest(dir.path / "appmanifest_1.acf").has_value());
+}
+
+TEST(vdf, most_recent_login) {
+    CHECK(most_recent_login(make_loginusers_vdf(5, 3)) == "76561198000000003");
+    // nobody flagged, the first one listed wins
+    CHECK(most_recent_login(make_loginusers_vdf(3, 99)) == "76561198000000000");
+    CHECK(!most_recent_login(make_loginusers_vdf(0, 0)).has_value());
+    CHECK(!most_recent_login("\"users\" { \"not_an_id\" { \"mostrecent\" \"1\" } }").has_value());
+    CHECK(!most_recent_login("\"users\" {").has_value());
+    // the key is matched however steam spelled it that year
+    CHECK(most_recent_login("\"Users\" { \"76561198000000001\" { } \"76561198000000002\" { \"mostrecent\" \"1\" } }") == "76561198000000002");
+}
\ No newline at end of file
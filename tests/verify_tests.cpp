@@ -0,0 +1,160 @@
+#include "test.h"
+#include "support/fixtures.h"
+#include "file_utils.h"
+#include "verify.h"
+#include <algorithm>
+#include <fstream>
+
+namespace {
+    [[nodiscard]] verify_options quiet_options() {
+        verify_options o;
+        o.threads = 2;
+        o.chunk_size = 64 << 10;
+        o.progress = false;
+        o.skip = { fs::path("Spectre") / "Binaries" / "Win64" / "BattlEye", fs::path("Spectre") / "Binaries" / "Win64" / "BattlEye.*" };
+        return o;
+    }
+
+    // a little install: one file a few chunks long, some small ones, an empty one and names with spaces and
+    // non ascii in them. paths are relative to the root
+    [[nodiscard]] std::vector<fs::path> make_install(const fs::path& root) {
+        const std::vector<std::pair<fs::path, std::string>> files = {
+            { fs::path("Spectre") / "Content" / "Paks" / "pakchunk0-Windows.pak", random_bytes((1 << 20) + 12345, 10) },
+            { fs::path("Spectre") / "Binaries" / "Win64" / "Spectre-Win64-Shipping.exe", code_like_bytes(300'000, 11) },
+            { fs::path("Engine") / "Config" / "Base Engine.ini", "[Core.System]\nPaths=../../../Engine/Content\n" },
+            { fs::path("Engine") / "Extras" / "empty.txt", "" },
+            { fs::path(u8"Spectre/Content/Localization/Game/de/Spiel \u00e4.locres"), random_bytes(70'000, 12) },
+        };
+        std::vector<fs::path> rel;
+        for (const auto& [p, data] : files) {
+            if (!write_file(root / p, data)) return {};
+            rel.push_back(p);
+        }
+        return rel;
+    }
+
+    void flip_byte(const fs::path& p, const std::streamoff at) {
+        std::fstream f(p, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekg(at);
+        const char c = static_cast<char>(f.get() ^ 0x20);
+        f.seekp(at);
+        f.put(c);
+    }
+} // anon namespace
+
+TEST(verify, battleye_and_its_swap_leftovers_are_skipped) {
+    const temp_dir tmp("verify");
+    const fs::path root = tmp.path / "game";
+    const fs::path bin = root / "Spectre" / "Binaries" / "Win64";
+    REQUIRE(write_file(bin / "Spectre-Win64-Shipping.exe", random_bytes(200'000, 1)));
+    REQUIRE(write_file(bin / "BattlEye" / "BEClient_x64.dll", "ours"));
+    const fs::path manifest = tmp.path / "manifest.txt";
+    REQUIRE(make_install_manifest(root, manifest, quiet_options()));
+
+    // a swap in progress (or one that crashed) when verify runs. none of it is steam's business
+    REQUIRE(write_file(bin / "BattlEye" / "BEClient_x64.dll", "ours, updated"));
+    REQUIRE(write_file(bin / "BattlEye.staging" / "BEClient_x64.dll", "staged"));
+    REQUIRE(write_file(bin / "BattlEye.swap", "staged\n"));
+    REQUIRE(write_file(bin / "BattlEye.old.1234" / "BEClient_x64.dll", "old"));
+    const auto rep = verify_install(root, manifest, quiet_options());
+    REQUIRE(rep);
+    CHECK(rep->ok());
+    CHECK_EQ(rep->files, 1u);
+
+    // but the prefix match is per component, a file that merely starts with BattlEye still counts
+    REQUIRE(write_file(bin / "BattlEyeHelper.dll", "x"));
+    REQUIRE(make_install_manifest(root, manifest, quiet_options()));
+    const auto again = verify_install(root, manifest, quiet_options());
+    REQUIRE(again);
+    CHECK_EQ(again->files, 2u);
+}
+
+TEST(verify, clean_install_passes_with_any_thread_count) {
+    const temp_dir tmp("verify");
+    const fs::path root = tmp.path / "game";
+    const auto files = make_install(root);
+    REQUIRE(files.size() == 5);
+    unsigned long long total = 0;
+    for (const auto& f : files) total += fs::file_size(root / f);
+    const fs::path manifest = tmp.path / "manifest.txt";
+    REQUIRE(make_install_manifest(root, manifest, quiet_options()));
+    for (const size_t threads : { 1u, 2u, 7u }) {
+        verify_options o = quiet_options();
+        o.threads = threads;
+        const auto rep = verify_install(root, manifest, o);
+        REQUIRE(rep);
+        CHECK(rep->ok());
+        CHECK_EQ(rep->files, 5u);
+        CHECK_EQ(rep->bytes, total);
+    }
+}
+
+TEST(verify, manifest_chunking_is_independent_of_threads) {
+    // the same tree hashed on 1 and 8 threads gives the same manifest byte for byte
+    const temp_dir tmp("verify");
+    const fs::path root = tmp.path / "game";
+    REQUIRE(!make_install(root).empty());
+    verify_options one = quiet_options(), many = quiet_options();
+    one.threads = 1;
+    many.threads = 8;
+    REQUIRE(make_install_manifest(root, tmp.path / "one.txt", one));
+    REQUIRE(make_install_manifest(root, tmp.path / "many.txt", many));
+    const auto a = read_file_bytes(tmp.path / "one.txt");
+    REQUIRE(a.has_value());
+    CHECK_EQ(a, read_file_bytes(tmp.path / "many.txt"));
+    // 64 KiB chunks: the pak is 17 of them, so 17 digests on its line
+    const auto line = a->find("pakchunk0");
+    REQUIRE(line != std::string::npos);
+    const auto start = a->rfind('\n', line) + 1;
+    CHECK_EQ(std::count(a->begin() + static_cast<std::ptrdiff_t>(start), a->begin() + static_cast<std::ptrdiff_t>(line), ','), 16);
+}
+
+TEST(verify, damage_is_reported_by_kind) {
+    const temp_dir tmp("verify");
+    const fs::path root = tmp.path / "game";
+    const auto files = make_install(root);
+    REQUIRE(files.size() == 5);
+    const fs::path manifest = tmp.path / "manifest.txt";
+    REQUIRE(make_install_manifest(root, manifest, quiet_options()));
+
+    // one flipped byte deep in the last chunk of the pak, the exe cut short, the ini gone, an extra file nobody
+    // asked about
+    flip_byte(root / files[0], (1 << 20) + 12000);
+    fs::resize_file(root / files[1], 299'999);
+    std::error_code ec;
+    fs::remove(root / files[2], ec);
+    REQUIRE(write_file(root / "Spectre" / "Saved" / "Logs" / "Spectre.log", "not in the manifest"));
+
+    const auto rep = verify_install(root, manifest, quiet_options());
+    REQUIRE(rep);
+    CHECK(!rep->ok());
+    CHECK_EQ(rep->files, 5u);
+    CHECK(rep->corrupt == std::vector<fs::path>{ files[0] });
+    CHECK(rep->wrong_size == std::vector<fs::path>{ files[1] });
+    CHECK(rep->missing == std::vector<fs::path>{ files[2] });
+}
+
+TEST(verify, same_size_swap_in_the_first_chunk_is_caught) {
+    const temp_dir tmp("verify");
+    const fs::path root = tmp.path / "game";
+    const auto files = make_install(root);
+    REQUIRE(files.size() == 5);
+    const fs::path manifest = tmp.path / "manifest.txt";
+    REQUIRE(make_install_manifest(root, manifest, quiet_options()));
+    flip_byte(root / files[4], 0);
+    const auto rep = verify_install(root, manifest, quiet_options());
+    REQUIRE(rep);
+    CHECK(rep->corrupt == std::vector<fs::path>{ files[4] });
+    CHECK(rep->missing.empty() && rep->wrong_size.empty());
+}
+
+TEST(verify, unreadable_manifest_is_nullopt) {
+    const temp_dir tmp("verify");
+    const fs::path root = tmp.path / "game";
+    REQUIRE(!make_install(root).empty());
+    CHECK(!verify_install(root, tmp.path / "nope.txt", quiet_options()).has_value());
+    REQUIRE(write_file(tmp.path / "old.txt", "SLVM 0 65536\n1 AA x\n"));
+    CHECK(!verify_install(root, tmp.path / "old.txt", quiet_options()).has_value());
+    REQUIRE(write_file(tmp.path / "bad.txt", "SLVM 1 65536\nnospaces\n"));
+    CHECK(!verify_install(root, tmp.path / "bad.txt", quiet_options()).has_value());
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "delta.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// builds a BEClient delta patch for a release:
+//   make_patch <old dll> <new dll> <out.patch>
+// upload the result next to the dll as BEClient_x64.dll.<first 16 hex of old sha256, lowercase>.patch
+
+namespace {
+    [[nodiscard]] std::optional<std::string> read_all(const char* path) {
+        std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+        if (!ifs) return std::nullopt;
+        std::string out(static_cast<size_t>(ifs.tellg()), '\0');
+        ifs.seekg(0);
+        if (!ifs.read(out.data(), static_cast<std::streamsize>(out.size()))) return std::nullopt;
+        return out;
+    }
+} // anon namespace
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        std::fprintf(stderr, "usage: %s <old> <new> <out.patch>\n", argv[0]);
+        return 1;
+    }
+    const auto oldBytes = read_all(argv[1]);
+    const auto newBytes = read_all(argv[2]);
+    if (!oldBytes || !newBytes) {
+        std::fprintf(stderr, "failed to read input files\n");
+        return 1;
+    }
+
+    const std::string patch = delta_generate(*oldBytes, *newBytes);
+    std::ofstream ofs(argv[3], std::ios::binary | std::ios::trunc);
+    if (!ofs.write(patch.data(), static_cast<std::streamsize>(patch.size()))) {
+        std::fprintf(stderr, "failed to write %s\n", argv[3]);
+        return 1;
+    }
+
+    const sha256_digest sd = sha256_of(oldBytes->data(), oldBytes->size());
+    std::printf("%zu -> %zu bytes, patch %zu bytes\nname: BEClient_x64.dll.", oldBytes->size(), newBytes->size(), patch.size());
+    for (size_t i = 0; i < 8; ++i) std::printf("%02x", sd[i]);
+    std::printf(".patch\n");
+    return 0;
+}
\ No newline at end of file